@@ -24,6 +24,12 @@
 #define RFX_FORMAT_BGR  2
 #define RFX_FORMAT_RGB  3
 #define RFX_FORMAT_YUV  4 /* YUV444 linear tiled mode */
+/* 4:2:0, a y plane of height rows, height as in rfxcodec_encode_create,
+ * followed by an interleaved uv plane with the same stride_bytes */
+#define RFX_FORMAT_NV12 5
+/* 4:2:0, a y plane of height rows followed by a u and a v plane with
+ * stride_bytes / 2 */
+#define RFX_FORMAT_I420 6
 
 #define RFX_FLAGS_NONE  0 /* default RFX_FLAGS_RLGR3 and RFX_FLAGS_SAFE */
 
@@ -31,10 +37,21 @@
 #define RFX_FLAGS_OPT1    (1 << 3)
 #define RFX_FLAGS_OPT2    (1 << 4)
 #define RFX_FLAGS_NOACCEL (1 << 6)
+#define RFX_FLAGS_TILE_HASH (1 << 7) /* skip unchanged tiles */
+/* rfxcodec_encode_progressive uses the reduce extrapolate DWT */
+#define RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE (1 << 8)
+/* rfxcodec_encode_create and rfxcodec_decode_create print nothing */
+#define RFX_FLAGS_QUIET (1 << 9)
 
 #define RFX_FLAGS_RLGR3 0 /* default */
 #define RFX_FLAGS_RLGR1 1
 
 #define RFX_FLAGS_ALPHAV1 1 /* used in flags for rfxcodec_encode */
+/* used in flags for rfxcodec_encode, the encoder picks the quants of each
+ * tile from what is in it, quants and the tile quant indices are not used */
+#define RFX_FLAGS_QUANT_ADAPTIVE 2
+/* used in flags for rfxcodec_encode, send the sync, context, codec versions
+ * and channels header before the frame again */
+#define RFX_FLAGS_HEADER 4
 
 #endif
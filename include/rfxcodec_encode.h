@@ -19,8 +19,15 @@
 #ifndef __RFXCODEC_ENCODE_H
 #define __RFXCODEC_ENCODE_H
 
+#include <stddef.h>
+
 #include <rfxcodec_common.h>
 
+/* rfxcodec_encode returns this when cdata_bytes is too small, the
+ * encoder is left as it was so the call can be repeated with a bigger
+ * cdata, see rfxcodec_encode_bound */
+#define RFX_ERROR_OVERFLOW 3
+
 struct rfx_rect
 {
     int x;
@@ -40,13 +47,173 @@ struct rfx_tile
     int quant_cr;
 };
 
+/* one rfxcodec_encode_ex call for rfxcodec_encode_batch */
+struct rfx_encode_job
+{
+    void *handle;
+    char *cdata;
+    int cdata_bytes; /* in, size of cdata, out, bytes used */
+    const char *buf;
+    int width;
+    int height;
+    int stride_bytes;
+    const struct rfx_rect *regions;
+    int num_regions;
+    const struct rfx_tile *tiles;
+    int num_tiles;
+    const char *quants;
+    int num_quants;
+    int flags;
+    int error; /* out, what rfxcodec_encode_ex would return */
+};
+
+/* gets the output of rfxcodec_encode_ex in order, see
+ * rfxcodec_encode_set_sink, a nonzero return stops the encode */
+typedef int (*rfxcodec_encode_sink_proc)(void *user, const char *data,
+                                         int bytes);
+
+/* memory of an encoder, see rfxcodec_encode_create_with_allocator
+ * free_proc frees what either of the allocs made */
+typedef void *(*rfxcodec_malloc_proc)(void *user, size_t bytes);
+typedef void (*rfxcodec_free_proc)(void *user, void *ptr);
+typedef void *(*rfxcodec_aligned_alloc_proc)(void *user, size_t alignment,
+                                             size_t bytes);
+
+struct rfxcodec_allocator
+{
+    rfxcodec_malloc_proc malloc_proc;
+    rfxcodec_free_proc free_proc;
+    rfxcodec_aligned_alloc_proc aligned_alloc_proc;
+    void *user; /* first param of the procs */
+};
+
+struct rfx_tile_cache_stats
+{
+    int hits;
+    int misses;
+    int evictions;
+    int num_entries;
+    int bytes;
+};
+
+/* stages in struct rfx_encode_stats */
+#define RFX_STATS_FORMAT 0 /* pixel format and rgb to yuv */
+#define RFX_STATS_DWT    1 /* DWT and quantization */
+#define RFX_STATS_DIFF   2 /* differential, in RLGR with the SIMD DWT */
+#define RFX_STATS_RLGR   3
+#define RFX_STATS_ALPHA  4 /* alpha plane */
+#define RFX_STATS_STAGES 5
+
+struct rfx_encode_stats
+{
+    long long stage_ns[RFX_STATS_STAGES];
+    long long stage_calls[RFX_STATS_STAGES];
+    long long tiles;
+    long long y_bytes;
+    long long u_bytes;
+    long long v_bytes;
+    long long a_bytes;
+    long long solid_tiles; /* of tiles, one colour, no DWT or RLGR */
+    /* functions in use */
+    const char *rfx_encode_name;
+    const char *rfx_rgb_to_yuv_name; /* or 4:2:0 to yuv */
+    const char *rfx_tile_hash_name;
+    const char *rfx_tile_stats_name;
+    const char *rfx_tile_solid_name;
+    const char *rfx_alpha_delta_name;
+    const char *rfx_dwt_rem_name; /* RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE */
+};
+
 void *
 rfxcodec_encode_create(int width, int height, int format, int flags);
 int
 rfxcodec_encode_create_ex(int width, int height, int format, int flags,
                           void **handle);
+/* same as rfxcodec_encode_create_ex but the encoder and its tile
+ * workers, see rfxcodec_encode_set_threads, get their context from
+ * malloc_proc and their scratch, 64 byte aligned, from aligned_alloc_proc
+ * so the memory can be put on a chosen NUMA node or in huge pages
+ * allocator is copied, 0 is the same as rfxcodec_encode_create_ex
+ * these encoders are not kept in the pool of rfxcodec_encode_set_pool */
+int
+rfxcodec_encode_create_with_allocator(int width, int height, int format,
+                                      int flags,
+                                      const struct rfxcodec_allocator *allocator,
+                                      void **handle);
 int
 rfxcodec_encode_destroy(void *handle);
+/* keep up to max_contexts encoder contexts for the process, all made now,
+ * rfxcodec_encode_destroy gives one back and rfxcodec_encode_create takes
+ * one instead of allocating, 0, the default, frees on destroy */
+int
+rfxcodec_encode_set_pool(int max_contexts);
+/* encode the tiles of each call on num_threads threads, the calling
+ * thread is one of them, 0 or 1 is single threaded
+ * output is the same as single threaded */
+int
+rfxcodec_encode_set_threads(void *handle, int num_threads);
+/* keep up to max_bytes of encoded tiles and their pixels, a tile with the
+ * same pixels, size and quant values as a cached one is copied from the
+ * cache instead of encoded, 0 turns the cache off
+ * this also clears the cache and its stats */
+int
+rfxcodec_encode_set_tile_cache(void *handle, int max_bytes);
+int
+rfxcodec_encode_get_tile_cache_stats(void *handle,
+                                     struct rfx_tile_cache_stats *stats);
+/* rfxcodec_encode_reset flags */
+#define RFX_RESET_FRAME_IDX 1 /* the next frame is frame 0 again */
+
+/* start over as if for a new client, the next rfxcodec_encode call sends
+ * the header, with RFX_FLAGS_TILE_HASH all of its tiles and with rate
+ * control the bucket starts over, what was learnt is kept
+ * the frame numbers carry on unless flags has RFX_RESET_FRAME_IDX
+ * to send the header once without the rest, use RFX_FLAGS_HEADER */
+int
+rfxcodec_encode_reset(void *handle, int flags);
+/* the tiles and regions for num_damage damage rects, the rects can
+ * overlap and go past the surface, the width and height of create
+ * tiles is each 64x64 tile a rect touches, once, top to bottom and left
+ * to right, clipped to the surface, with quant indexes 0
+ * regions is the union of the damage clipped to the surface, top to
+ * bottom and left to right, in bands that do not overlap with a band
+ * that is the same as the one above merged into it, or where that takes
+ * more rects than num_damage, the clipped damage rects
+ * tiles must have room for one per tile of the surface,
+ * ((width + 63) / 64) * ((height + 63) / 64), and regions for num_damage */
+int
+rfxcodec_encode_damage(void *handle, const struct rfx_rect *damage,
+                       int num_damage, struct rfx_rect *regions,
+                       int *num_regions, struct rfx_tile *tiles,
+                       int *num_tiles);
+/* rate control, each rfxcodec_encode call picks the quant values for
+ * its tiles so the output averages bytes_per_second at
+ * frames_per_second calls a second and calls aim to stay under
+ * max_frame_bytes, 0 is a second worth, by as little as the model allows
+ * the estimate follows how busy the tiles of each call are, but a call
+ * can still go over after the content changes, as can one where even
+ * the coarsest quants do not fit, the calls after it make up for it
+ * with RFX_FLAGS_TILE_HASH an unchanged tile that was sent with coarser
+ * quants than the finest is sent again when a call has room for it with
+ * finer ones
+ * the quants, tile quant indexes and RFX_FLAGS_QUANT_ADAPTIVE of the
+ * calls are not used while it is on, bytes_per_second 0 turns it off */
+int
+rfxcodec_encode_set_rate(void *handle, int bytes_per_second,
+                         int frames_per_second, int max_frame_bytes);
+/* with a sink, rfxcodec_encode_ex sends its output to sink as it goes
+ * instead of returning it all at once, every chunk_tiles tiles are sent
+ * as a frame of their own, with all of the regions, as soon as they are
+ * encoded, the first frame carries the header if there is one
+ * cdata is then only work space for one of these frames, size it with
+ * rfxcodec_encode_bound for chunk_tiles tiles, *cdata_bytes is set to
+ * the total sent
+ * when sink fails the call returns an error, the frames it already got
+ * count as sent, the next call goes on after them
+ * sink 0 turns this off */
+int
+rfxcodec_encode_set_sink(void *handle, rfxcodec_encode_sink_proc sink,
+                         void *user, int chunk_tiles);
 /* quants, 5 ints per set, should be num_quants * 5 chars in quants)
  * each char is 2 quant values
  * quantizer order is
@@ -72,5 +239,77 @@ rfxcodec_encode_ex(void *handle, char *cdata, int *cdata_bytes,
                    const struct rfx_rect *region, int num_region,
                    const struct rfx_tile *tiles, int num_tiles,
                    const char *quants, int num_quants, int flags);
+/* RemoteFX progressive, MS-RDPEGFX RFX_PROGRESSIVE_BITMAP_STREAM, for
+ * RDPGFX_CODECID_CAPROGRESSIVE
+ * levels is num_levels RFX_PROGRESSIVE_CODEC_QUANT of 16 chars, a
+ * quality char then 5 chars each of y, cb and cr values added to the
+ * tile quant values, coarsest first, no value more than the one in the
+ * level before
+ * a tile in rfxcodec_encode_progressive tiles is sent at the first level
+ * and each later call without it sends it one level better, after the
+ * last level it is at full quality
+ * num_levels 0, the default, sends tiles at full quality at once
+ * the client does not get the tiles still to get better after this */
+#define RFX_PROGRESSIVE_MAX_LEVELS 16
+int
+rfxcodec_encode_set_progressive(void *handle, const char *levels,
+                                int num_levels);
+/* rfxcodec_encode_ex with RemoteFX progressive output, always RLGR1
+ * quants are RFX_COMPONENT_CODEC_QUANT, up to RFX_PROGRESSIVE_MAX_QUANTS,
+ * in the order LL3, HL3, LH3, HH3, HL2, LH2, HH2, HL1, LH1, HH1, so HL
+ * and LH swapped from rfxcodec_encode
+ * regions and tiles can be empty to only send what is still to get
+ * better, the region then has a rect for each of those tiles
+ * with RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE in rfxcodec_encode_create the
+ * tiles use the reduce extrapolate DWT, for clients that ask for it
+ * flags can only be RFX_FLAGS_HEADER, the header, sync and context, is
+ * sent in the first call and after rfxcodec_encode_reset, which also
+ * drops the tiles still to get better
+ * threads, the tile hash and cache, rate control and the sink are not
+ * used, on RFX_ERROR_OVERFLOW do the call again with the same tiles */
+#define RFX_PROGRESSIVE_MAX_QUANTS 7
+int
+rfxcodec_encode_progressive(void *handle, char *cdata, int *cdata_bytes,
+                            const char *buf, int width, int height,
+                            int stride_bytes,
+                            const struct rfx_rect *regions, int num_regions,
+                            const struct rfx_tile *tiles, int num_tiles,
+                            const char *quants, int num_quants, int flags);
+/* tiles rfxcodec_encode_progressive still has to make better, call it
+ * with no tiles until this is 0 */
+int
+rfxcodec_encode_progressive_pending(void *handle);
+/* same as rfxcodec_encode_ex for each job, in order, but the tiles of all
+ * the jobs are encoded together on the threads of handle, see
+ * rfxcodec_encode_set_threads, so many small surfaces keep them all busy
+ * a handle can be in jobs only once, handle itself can be one of them
+ * job handles with a sink are encoded on their own, one after the other
+ * returns 1 if the jobs are not valid, else 0 and each job error is set */
+int
+rfxcodec_encode_batch(void *handle, struct rfx_encode_job *jobs,
+                      int num_jobs);
+/* most bytes rfxcodec_encode_ex can write for num_tiles tiles with
+ * num_regions rects, num_quants quant sets and flags, cdata_bytes of
+ * at least this never gets RFX_ERROR_OVERFLOW
+ * quant values must be 6 to 15, as the spec requires
+ * num_quants is not used with RFX_FLAGS_QUANT_ADAPTIVE
+ * returns -1 if the arguments are not valid or it does not fit in an int */
+int
+rfxcodec_encode_bound(void *handle, int num_tiles, int num_regions,
+                      int num_quants, int flags);
+/* cumulative since create or rfxcodec_encode_reset_stats, summed over
+ * threads, returns 1 and only the function names when the library was
+ * configured with --disable-stats */
+int
+rfxcodec_encode_get_stats(void *handle, struct rfx_encode_stats *stats);
+int
+rfxcodec_encode_reset_stats(void *handle);
+/* the tiles the last rfxcodec_encode call put in cdata, with
+ * RFX_FLAGS_TILE_HASH this leaves out the tiles that did not change and
+ * were not sent again for rate control
+ * tiles is valid until the next rfxcodec_encode call */
+int
+rfxcodec_encode_get_tiles(void *handle, const struct rfx_tile **tiles,
+                          int *num_tiles);
 
 #endif
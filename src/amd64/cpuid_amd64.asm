@@ -46,3 +46,20 @@ PROC _cpuid_amd64
     ret
     align 16
 
+;int
+;xgetbv_amd64(int ecx_in, int *eax, int *edx)
+
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC xgetbv_amd64
+%else
+PROC _xgetbv_amd64
+%endif
+    mov r8, rdx
+    mov rcx, rdi
+    xgetbv
+    mov [rsi], eax
+    mov [r8], edx
+    mov rax, 0
+    ret
+    align 16
+
@@ -30,6 +30,8 @@ extern "C" {
 
 int
 cpuid_amd64(int eax_in, int ecx_in, int *eax, int *ebx, int *ecx, int *edx);
+int
+xgetbv_amd64(int ecx_in, int *eax, int *edx);
 
 int
 rfxcodec_encode_dwt_shift_amd64_sse2(const char *qtable,
@@ -41,6 +43,130 @@ rfxcodec_encode_dwt_shift_amd64_sse41(const char *qtable,
                                       const unsigned char *data,
                                       short *dwt_buffer1,
                                       short *dwt_buffer);
+int
+rfxcodec_encode_dwt_shift_amd64_avx2(const char *qtable,
+                                     const unsigned char *data,
+                                     short *dwt_buffer1,
+                                     short *dwt_buffer);
+int
+rfxcodec_encode_dwt_shift_amd64_avx512bw(const char *qtable,
+                                         const unsigned char *data,
+                                         short *dwt_buffer1,
+                                         short *dwt_buffer);
+int
+rfxcodec_encode_bgra_to_yuv_amd64_sse2(const char *bgra_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer,
+                                       unsigned char *a_buffer);
+int
+rfxcodec_encode_rgba_to_yuv_amd64_sse2(const char *rgba_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer,
+                                       unsigned char *a_buffer);
+int
+rfxcodec_encode_bgr_to_yuv_amd64_ssse3(const char *bgr_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer,
+                                       unsigned char *a_buffer);
+int
+rfxcodec_encode_rgb_to_yuv_amd64_ssse3(const char *rgb_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer,
+                                       unsigned char *a_buffer);
+int
+rfxcodec_encode_bgra_to_yuv_amd64_avx2(const char *bgra_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer,
+                                       unsigned char *a_buffer);
+int
+rfxcodec_encode_rgba_to_yuv_amd64_avx2(const char *rgba_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer,
+                                       unsigned char *a_buffer);
+int
+rfxcodec_encode_bgr_to_yuv_amd64_avx2(const char *bgr_data,
+                                      int stride_bytes,
+                                      unsigned char *y_buffer,
+                                      unsigned char *u_buffer,
+                                      unsigned char *v_buffer,
+                                      unsigned char *a_buffer);
+int
+rfxcodec_encode_rgb_to_yuv_amd64_avx2(const char *rgb_data,
+                                      int stride_bytes,
+                                      unsigned char *y_buffer,
+                                      unsigned char *u_buffer,
+                                      unsigned char *v_buffer,
+                                      unsigned char *a_buffer);
+int
+rfxcodec_encode_nv12_to_yuv_amd64_sse2(const char *y_data,
+                                       const char *u_data,
+                                       const char *v_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer);
+int
+rfxcodec_encode_i420_to_yuv_amd64_sse2(const char *y_data,
+                                       const char *u_data,
+                                       const char *v_data,
+                                       int stride_bytes,
+                                       unsigned char *y_buffer,
+                                       unsigned char *u_buffer,
+                                       unsigned char *v_buffer);
+int
+rfxcodec_decode_idwt_shift_amd64_sse2(const char *qtable,
+                                      short *buffer,
+                                      short *dwt_buffer);
+int
+rfxcodec_decode_yuv_to_bgra_amd64_sse2(const short *y_buffer,
+                                       const short *u_buffer,
+                                       const short *v_buffer,
+                                       const unsigned char *a_buffer,
+                                       char *bgra_data,
+                                       int stride_bytes);
+int
+rfxcodec_decode_yuv_to_rgba_amd64_sse2(const short *y_buffer,
+                                       const short *u_buffer,
+                                       const short *v_buffer,
+                                       const unsigned char *a_buffer,
+                                       char *rgba_data,
+                                       int stride_bytes);
+int
+rfxcodec_encode_tile_hash_amd64_sse42(const char *data,
+                                      int row_bytes,
+                                      int rows,
+                                      int stride_bytes,
+                                      unsigned int *hash);
+int
+rfxcodec_encode_tile_stats_amd64_sse2(const unsigned char *y_buffer,
+                                      int *stats);
+int
+rfxcodec_encode_tile_solid_amd64_sse2(const char *data, int stride_bytes,
+                                      int with_alpha);
+int
+rfxcodec_encode_alpha_delta_amd64_sse2(const unsigned char *plane,
+                                       unsigned char *delta_plane,
+                                       unsigned long long *runs);
+int
+rfxcodec_encode_dwt_rem_amd64_sse2(const unsigned char *in_buffer,
+                                   short *buffer, short *dwt_buffer,
+                                   short *dwt_buffer2);
+int
+rfxcodec_encode_dwt_rem_amd64_avx2(const unsigned char *in_buffer,
+                                   short *buffer, short *dwt_buffer,
+                                   short *dwt_buffer2);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,263 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm dequantize and inverse dwt, 64x64 tile
+;
+;inverse of the lifting in rfxcodec_encode_dwt_shift_amd64_sse2
+;even[n] = l[n] - ((h[n - 1] + h[n]) >> 1)
+;odd[n] = (h[n] << 1) + ((even[n] + even[n + 1]) >> 1)
+;with h[-1] = h[0] and even[w] = even[w - 1]
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; shift one sub-band left by its quant factor - 6 + 5
+; %1 qtable byte, %2 nibble shift, %3 first word, %4 word count
+%macro DEQUANT 4
+    movzx eax, byte [rdi + %1]
+    shr eax, %2
+    and eax, 0xF
+    sub eax, 1
+    jge %%shift_ok
+    xor eax, eax
+%%shift_ok:
+    movd xmm0, eax
+    lea rax, [rsi + %3 * 2]
+    mov ecx, %4 / 32
+%%loop:
+    movdqa xmm1, [rax]
+    movdqa xmm2, [rax + 16]
+    movdqa xmm3, [rax + 32]
+    movdqa xmm4, [rax + 48]
+    psllw xmm1, xmm0
+    psllw xmm2, xmm0
+    psllw xmm3, xmm0
+    psllw xmm4, xmm0
+    movdqa [rax], xmm1
+    movdqa [rax + 16], xmm2
+    movdqa [rax + 32], xmm3
+    movdqa [rax + 48], xmm4
+    lea rax, [rax + 64]
+    dec ecx
+    jnz %%loop
+%endmacro
+
+; 8 even outputs
+; %1 l source, %2 h source, %3 out
+; xmm7 in has h[n - 1] for lane 0, out has it for the next 8
+; xmm1 out is h
+%macro EVEN8 3
+    movdqa xmm1, [%2]
+    movdqa xmm2, xmm1
+    pslldq xmm2, 2
+    por xmm2, xmm7                      ; h[n - 1]
+    movdqa xmm7, xmm1
+    psrldq xmm7, 14
+    paddw xmm2, xmm1
+    psraw xmm2, 1
+    movdqa %3, [%1]
+    psubw %3, xmm2
+%endmacro
+
+;******************************************************************************
+; horizontal, rows of l and h, w wide, to rows of 2 * w
+; rsi l, rdi h, rdx out, r10 w
+rfx_dwt_2d_decode_horz_sse2:
+    mov r11, r10
+loop_horz_y:
+    mov rcx, r10
+    shr rcx, 3
+    movdqa xmm7, [rdi]                  ; h[-1] = h[0]
+    pslldq xmm7, 14
+    psrldq xmm7, 14
+    EVEN8 rsi, rdi, xmm4
+    movdqa xmm5, xmm1
+loop_horz_x:
+    dec rcx
+    jz last_horz_x
+    EVEN8 rsi + 16, rdi + 16, xmm6
+    jmp odd_horz_x
+last_horz_x:
+    movdqa xmm6, xmm4                   ; even[w] = even[w - 1]
+    psrldq xmm6, 14
+odd_horz_x:
+    movdqa xmm2, xmm4
+    psrldq xmm2, 2
+    movdqa xmm3, xmm6
+    pslldq xmm3, 14
+    por xmm2, xmm3                      ; even[n + 1]
+    paddw xmm2, xmm4
+    psraw xmm2, 1
+    psllw xmm5, 1
+    paddw xmm2, xmm5                    ; odd
+    movdqa xmm3, xmm4
+    punpcklwd xmm3, xmm2
+    punpckhwd xmm4, xmm2
+    movdqa [rdx], xmm3
+    movdqa [rdx + 16], xmm4
+    ; move right
+    lea rsi, [rsi + 16]
+    lea rdi, [rdi + 16]
+    lea rdx, [rdx + 32]
+    movdqa xmm4, xmm6
+    movdqa xmm5, xmm1
+    test rcx, rcx
+    jnz loop_horz_x
+    dec r11
+    jnz loop_horz_y
+    ret
+
+;******************************************************************************
+; vertical, w rows of l then w rows of h, 2 * w wide, to 2 * w rows
+; rsi l, rdx out, r10 w
+rfx_dwt_2d_decode_vert_sse2:
+    push rbx
+    mov rax, r10
+    shl rax, 2                          ; row bytes
+    mov r11, r10
+    imul r11, rax                       ; h offset
+    mov rcx, r10
+    shr rcx, 2
+loop_vert_x:
+    mov rdi, rsi
+    lea r8, [rsi + r11]
+    mov r9, rdx
+    movdqa xmm1, [r8]                   ; h[0]
+    movdqa xmm4, [rdi]
+    psubw xmm4, xmm1                    ; even[0]
+    movdqa [r9], xmm4
+    mov ebx, r10d
+    dec ebx
+loop_vert_y:
+    lea rdi, [rdi + rax]
+    lea r8, [r8 + rax]
+    movdqa xmm2, [r8]                   ; h[n]
+    movdqa xmm3, xmm1
+    paddw xmm3, xmm2
+    psraw xmm3, 1
+    movdqa xmm5, [rdi]
+    psubw xmm5, xmm3                    ; even[n]
+    movdqa [r9 + rax * 2], xmm5
+    movdqa xmm3, xmm4
+    paddw xmm3, xmm5
+    psraw xmm3, 1
+    psllw xmm1, 1
+    paddw xmm1, xmm3                    ; odd[n - 1]
+    movdqa [r9 + rax], xmm1
+    lea r9, [r9 + rax * 2]
+    movdqa xmm1, xmm2
+    movdqa xmm4, xmm5
+    dec ebx
+    jnz loop_vert_y
+    psllw xmm1, 1
+    paddw xmm1, xmm4                    ; odd[w - 1]
+    movdqa [r9 + rax], xmm1
+    ; move right
+    lea rsi, [rsi + 16]
+    lea rdx, [rdx + 16]
+    dec rcx
+    jnz loop_vert_x
+    pop rbx
+    ret
+
+;******************************************************************************
+; one level, HL, LH, HH, LL sub-bands w * w each
+; rsi sub-bands and out, rdx tmp, r10 w
+rfx_dwt_2d_decode_block_sse2:
+    push rsi
+    push rdx
+    push r10
+    mov rax, r10
+    imul rax, r10
+    shl rax, 1                          ; sub-band bytes
+    mov rdi, rsi                        ; HL
+    lea rsi, [rsi + rax * 2]
+    lea rsi, [rsi + rax]                ; LL
+    call rfx_dwt_2d_decode_horz_sse2
+    mov r10, [rsp]
+    mov rdx, [rsp + 8]
+    mov rsi, [rsp + 16]
+    mov rax, r10
+    imul rax, r10
+    shl rax, 1
+    lea rdi, [rsi + rax * 2]            ; HH
+    lea rsi, [rsi + rax]                ; LH
+    lea rdx, [rdx + rax * 2]
+    call rfx_dwt_2d_decode_horz_sse2
+    pop r10
+    pop rsi
+    pop rdx
+    call rfx_dwt_2d_decode_vert_sse2
+    ret
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_decode_idwt_shift_amd64_sse2(const char *qtable,
+;                                      short *buffer,
+;                                      short *dwt_buffer);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_decode_idwt_shift_amd64_sse2
+%else
+PROC _rfxcodec_decode_idwt_shift_amd64_sse2
+%endif
+    push rsi
+    push rdx
+    DEQUANT 4, 0, 0, 1024               ; HL1
+    DEQUANT 3, 4, 1024, 1024            ; LH1
+    DEQUANT 4, 4, 2048, 1024            ; HH1
+    DEQUANT 2, 4, 3072, 256             ; HL2
+    DEQUANT 2, 0, 3328, 256             ; LH2
+    DEQUANT 3, 0, 3584, 256             ; HH2
+    DEQUANT 1, 0, 3840, 64              ; HL3
+    DEQUANT 0, 4, 3904, 64              ; LH3
+    DEQUANT 1, 4, 3968, 64              ; HH3
+    DEQUANT 0, 0, 4032, 64              ; LL3
+    mov rsi, [rsp + 8]
+    lea rsi, [rsi + 3840 * 2]
+    mov rdx, [rsp]
+    mov r10, 8
+    call rfx_dwt_2d_decode_block_sse2
+    mov rsi, [rsp + 8]
+    lea rsi, [rsi + 3072 * 2]
+    mov rdx, [rsp]
+    mov r10, 16
+    call rfx_dwt_2d_decode_block_sse2
+    mov rsi, [rsp + 8]
+    mov rdx, [rsp]
+    mov r10, 32
+    call rfx_dwt_2d_decode_block_sse2
+    pop rdx
+    pop rsi
+    mov rax, 0
+    ret
+    align 16
+
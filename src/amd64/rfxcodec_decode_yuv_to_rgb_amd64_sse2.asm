@@ -0,0 +1,165 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm yuv to 32 bpp, 64x64 tile
+;
+;same math as rfx_decode_yuv_to_rgb, 1 << 14 is 1.0
+;the yuv words are from the idwt, centered on 0 with 5 fraction bits
+;r = (y * 16384 + v *  22979 + round) >> 19
+;g = (y * 16384 + u *  -5632 + v * -11704 + round) >> 19
+;b = (y * 16384 + u *  28998 + round) >> 19
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .data
+    align 16
+    cdround  times 4 dd 67371008        ; (128 << 19) + (1 << 18)
+    cwr_uv   times 4 dw 0, 22979
+    cwg_uv   times 4 dw -5632, -11704
+    cwb_uv   times 4 dw 28998, 0
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 4 u, v pairs and 4 y dwords to one colour, 4 dwords
+; %1 out, %2 u, v pairs, %3 y, %4 coefficients
+%macro UV_TO_C4 4
+    movdqa %1, %2
+    pmaddwd %1, [rel %4]
+    paddd %1, %3
+    psrad %1, 19
+%endmacro
+
+; 64x64 tile
+; rdi y, rsi u, rdx v, rcx a or 0, r8 dst, r9 stride
+; %1 first colour, b for bgra, %2 third colour
+%macro TILE_32 2
+    mov eax, 64
+%%loop_y:
+    mov r10, r8
+    mov r11d, 8
+%%loop_x:
+    movdqa xmm0, [rdi]                  ; y
+    movdqa xmm1, [rsi]                  ; u
+    movdqa xmm2, [rdx]                  ; v
+    movdqa xmm3, xmm0
+    punpcklwd xmm3, xmm0
+    psrad xmm3, 16
+    pslld xmm3, 14
+    paddd xmm3, [rel cdround]
+    movdqa xmm4, xmm0
+    punpckhwd xmm4, xmm0
+    psrad xmm4, 16
+    pslld xmm4, 14
+    paddd xmm4, [rel cdround]
+    movdqa xmm5, xmm1
+    punpcklwd xmm5, xmm2
+    movdqa xmm6, xmm1
+    punpckhwd xmm6, xmm2
+    ; clamp to 0 - 255, 8 of each
+    UV_TO_C4 xmm7, xmm5, xmm3, cwr_uv
+    UV_TO_C4 xmm0, xmm6, xmm4, cwr_uv
+    packssdw xmm7, xmm0
+    packuswb xmm7, xmm7                 ; r
+    UV_TO_C4 xmm8, xmm5, xmm3, cwg_uv
+    UV_TO_C4 xmm0, xmm6, xmm4, cwg_uv
+    packssdw xmm8, xmm0
+    packuswb xmm8, xmm8                 ; g
+    UV_TO_C4 xmm9, xmm5, xmm3, cwb_uv
+    UV_TO_C4 xmm0, xmm6, xmm4, cwb_uv
+    packssdw xmm9, xmm0
+    packuswb xmm9, xmm9                 ; b
+    test rcx, rcx
+    jz %%no_a
+    movq xmm10, [rcx]
+    lea rcx, [rcx + 8]
+    jmp %%got_a
+%%no_a:
+    pcmpeqb xmm10, xmm10
+%%got_a:
+    punpcklbw %1, xmm8
+    punpcklbw %2, xmm10
+    movdqa xmm0, %1
+    punpcklwd xmm0, %2
+    punpckhwd %1, %2
+    movdqu [r10], xmm0
+    movdqu [r10 + 16], %1
+    ; move right
+    lea rdi, [rdi + 16]
+    lea rsi, [rsi + 16]
+    lea rdx, [rdx + 16]
+    lea r10, [r10 + 8 * 4]
+    dec r11d
+    jnz %%loop_x
+    ; move down
+    add r8, r9
+    dec eax
+    jnz %%loop_y
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_decode_yuv_to_bgra_amd64_sse2(const short *y_buffer,
+;                                       const short *u_buffer,
+;                                       const short *v_buffer,
+;                                       const unsigned char *a_buffer,
+;                                       char *bgra_data,
+;                                       int stride_bytes);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_decode_yuv_to_bgra_amd64_sse2
+%else
+PROC _rfxcodec_decode_yuv_to_bgra_amd64_sse2
+%endif
+    movsxd r9, r9d
+    TILE_32 xmm9, xmm7
+    mov rax, 0
+    ret
+    align 16
+
+;int
+;rfxcodec_decode_yuv_to_rgba_amd64_sse2(const short *y_buffer,
+;                                       const short *u_buffer,
+;                                       const short *v_buffer,
+;                                       const unsigned char *a_buffer,
+;                                       char *rgba_data,
+;                                       int stride_bytes);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_decode_yuv_to_rgba_amd64_sse2
+%else
+PROC _rfxcodec_decode_yuv_to_rgba_amd64_sse2
+%endif
+    movsxd r9, r9d
+    TILE_32 xmm7, xmm9
+    mov rax, 0
+    ret
+    align 16
+
@@ -0,0 +1,121 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm alpha plane delta, 64x64
+;
+;same result as rfx_alpha_delta
+;each line less the one above, the sign folded into bit 0 with
+;(d + d) ^ (0 > d), then each line compared with itself one byte on, the
+;pmovmskb bits are the runs, reads one byte past delta_plane
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 16 bytes of delta
+; %1 offset
+; rdi plane, rsi delta_plane, xmm7 zero
+%macro DELTA16 1
+    movdqu xmm0, [rdi + %1 + 64]
+    movdqu xmm1, [rdi + %1]
+    psubb xmm0, xmm1
+    movdqa xmm2, xmm7
+    pcmpgtb xmm2, xmm0
+    paddb xmm0, xmm0
+    pxor xmm0, xmm2
+    movdqu [rsi + %1 + 64], xmm0
+%endmacro
+
+; 16 bits of runs
+; %1 offset in the line
+; rsi delta_plane line, result in eax
+%macro RUNS16 1
+    movdqu xmm0, [rsi + %1]
+    movdqu xmm1, [rsi + %1 + 1]
+    pcmpeqb xmm0, xmm1
+    pmovmskb eax, xmm0
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_alpha_delta_amd64_sse2(const unsigned char *plane,
+;                                       unsigned char *delta_plane,
+;                                       unsigned long long *runs);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_alpha_delta_amd64_sse2
+%else
+PROC _rfxcodec_encode_alpha_delta_amd64_sse2
+%endif
+    ; first line as is
+    movdqu xmm0, [rdi]
+    movdqu xmm1, [rdi + 16]
+    movdqu xmm2, [rdi + 32]
+    movdqu xmm3, [rdi + 48]
+    movdqu [rsi], xmm0
+    movdqu [rsi + 16], xmm1
+    movdqu [rsi + 32], xmm2
+    movdqu [rsi + 48], xmm3
+    pxor xmm7, xmm7
+    mov r8, rsi
+    mov ecx, 63
+.loop_delta:
+    DELTA16 0
+    DELTA16 16
+    DELTA16 32
+    DELTA16 48
+    lea rdi, [rdi + 64]
+    lea rsi, [rsi + 64]
+    dec ecx
+    jnz .loop_delta
+    mov rsi, r8
+    mov ecx, 64
+.loop_runs:
+    RUNS16 48
+    mov r9, rax
+    shl r9, 16
+    RUNS16 32
+    or r9, rax
+    shl r9, 16
+    RUNS16 16
+    or r9, rax
+    shl r9, 16
+    RUNS16 0
+    or r9, rax
+    btr r9, 63                          ; the last byte has no next one
+    mov [rdx], r9
+    lea rsi, [rsi + 64]
+    lea rdx, [rdx + 8]
+    dec ecx
+    jnz .loop_runs
+    mov rax, 0
+    ret
+    align 16
+
@@ -0,0 +1,319 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm reduce extrapolate dwt, avx2
+;
+;same math as rfxcodec_encode_dwt_rem_amd64_sse2.asm, 16 columns a
+;register in the vertical passes so rows are padded to 16 values
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; transpose the 8x8 in xmm0 to xmm7 to xmm8 to xmm15
+%macro TRANSPOSE8 0
+    vpunpcklwd xmm8, xmm0, xmm1
+    vpunpckhwd xmm9, xmm0, xmm1
+    vpunpcklwd xmm10, xmm2, xmm3
+    vpunpckhwd xmm11, xmm2, xmm3
+    vpunpcklwd xmm12, xmm4, xmm5
+    vpunpckhwd xmm13, xmm4, xmm5
+    vpunpcklwd xmm14, xmm6, xmm7
+    vpunpckhwd xmm15, xmm6, xmm7
+    vpunpckldq xmm0, xmm8, xmm10
+    vpunpckhdq xmm1, xmm8, xmm10
+    vpunpckldq xmm2, xmm9, xmm11
+    vpunpckhdq xmm3, xmm9, xmm11
+    vpunpckldq xmm4, xmm12, xmm14
+    vpunpckhdq xmm5, xmm12, xmm14
+    vpunpckldq xmm6, xmm13, xmm15
+    vpunpckhdq xmm7, xmm13, xmm15
+    vpunpcklqdq xmm8, xmm0, xmm4
+    vpunpckhqdq xmm9, xmm0, xmm4
+    vpunpcklqdq xmm10, xmm1, xmm5
+    vpunpckhqdq xmm11, xmm1, xmm5
+    vpunpcklqdq xmm12, xmm2, xmm6
+    vpunpckhqdq xmm13, xmm2, xmm6
+    vpunpcklqdq xmm14, xmm3, xmm7
+    vpunpckhqdq xmm15, xmm3, xmm7
+%endmacro
+
+; one level
+; %1 count, %2 padded count, %3 bytes of an input row in dwt_buffer
+; %4 offset of the level's HL in buffer
+; r12 buffer, r13 dwt_buffer, r14 dwt_buffer2
+%macro LEVEL 4
+    ; vertical to dwt_buffer2
+    mov rsi, r13
+    mov rdx, %3
+    mov rdi, r14
+    mov r8, %2 * 2
+    mov ecx, %1
+    mov r9d, %2 / 16
+    call rfx_dwt_rem_verti_avx2
+    mov rsi, r14
+    mov rdi, r13
+    mov rdx, %2 * 2
+    mov ecx, %2 / 8
+    call rfx_dwt_rem_transpose_avx2
+    ; horizontal to dwt_buffer2
+    mov rsi, r13
+    mov rdx, %2 * 2
+    mov rdi, r14
+    mov r8, %2 * 2
+    mov ecx, %1
+    mov r9d, %2 / 16
+    call rfx_dwt_rem_verti_avx2
+    mov rsi, r14
+    mov rdi, r13
+    mov rdx, %2 * 2
+    mov ecx, %2 / 8
+    call rfx_dwt_rem_transpose_avx2
+    ; HL, count / 2 + 1 rows of the H columns
+    lea rsi, [r13 + (%1 / 2 + 1) * 2]
+    mov rdx, %2 * 2
+    lea rdi, [r12 + %4 * 2]
+    mov ecx, %1 / 2 + 1
+    mov r9d, %1 - %1 / 2 - 1
+    call rfx_dwt_rem_copy_avx2
+    ; LH
+    lea rsi, [r13 + (%1 / 2 + 1) * %2 * 2]
+    mov rdx, %2 * 2
+    mov ecx, %1 - %1 / 2 - 1
+    mov r9d, %1 / 2 + 1
+    call rfx_dwt_rem_copy_avx2
+    ; HH
+    lea rsi, [r13 + (%1 / 2 + 1) * %2 * 2 + (%1 / 2 + 1) * 2]
+    mov rdx, %2 * 2
+    mov ecx, %1 - %1 / 2 - 1
+    mov r9d, %1 - %1 / 2 - 1
+    call rfx_dwt_rem_copy_avx2
+%endmacro
+
+;******************************************************************************
+; vertical reduce extrapolate DWT, 16 columns at a time
+; rsi src, rdx src stride bytes, rdi dst, r8 dst stride bytes
+; ecx count, r9d columns / 16
+; count / 2 + 1 L rows then the H rows to dst
+    align 16
+rfx_dwt_rem_verti_avx2:
+    mov eax, ecx
+    shr eax, 1
+    lea r10d, [rax + 1]
+    imul r10, r8                        ; offset of the H rows
+    mov ebx, ecx
+    sub ebx, eax
+    dec ebx                             ; H rows
+rem_verti_col_avx2:
+    push rsi
+    push rdi
+    xor r11d, r11d
+    vmovdqu ymm0, [rsi]                 ; src[2n]
+rem_verti_row_avx2:
+    vmovdqu ymm1, [rsi + rdx]           ; src[2n + 1]
+    lea eax, [r11 * 2 + 2]
+    cmp eax, ecx
+    jge rem_verti_extra_avx2
+    vmovdqu ymm2, [rsi + rdx * 2]       ; src[2n + 2]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    ; the sum can be more than 16 bits, (a & b) + ((a ^ b) >> 1) is not
+    vpxor ymm3, ymm0, ymm2
+    vpsraw ymm3, ymm3, 1
+    vpand ymm5, ymm0, ymm2
+    vpaddw ymm3, ymm3, ymm5
+    vpsubw ymm1, ymm1, ymm3
+    vpsraw ymm1, ymm1, 1
+    jmp rem_verti_first_avx2
+rem_verti_extra_avx2:
+    ; past the end, 2 * src[2n + 1] - src[2n], h[n] is 0
+    vpaddw ymm2, ymm1, ymm1
+    vpsubw ymm2, ymm2, ymm0
+    vpxor ymm1, ymm1, ymm1
+rem_verti_first_avx2:
+    test r11d, r11d
+    jnz rem_verti_lo_avx2
+    vmovdqa ymm4, ymm1                  ; h[-1] = h[0]
+rem_verti_lo_avx2:
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm4, ymm4, ymm1
+    vpsraw ymm4, ymm4, 1
+    vpaddw ymm4, ymm4, ymm0
+    vmovdqu [rdi], ymm4
+    cmp r11d, ebx
+    jge rem_verti_skip_avx2
+    vmovdqu [rdi + r10], ymm1
+rem_verti_skip_avx2:
+    vmovdqa ymm4, ymm1
+    vmovdqa ymm0, ymm2
+    lea rsi, [rsi + rdx * 2]
+    add rdi, r8
+    inc r11d
+    lea eax, [r11 * 2 + 1]
+    cmp eax, ecx
+    jl rem_verti_row_avx2
+    ; l[count / 2] = src[count / 2 * 2] + h[count / 2 - 1]
+    vpaddw ymm0, ymm0, ymm4
+    vmovdqu [rdi], ymm0
+    pop rdi
+    pop rsi
+    add rsi, 32
+    add rdi, 32
+    dec r9d
+    jnz rem_verti_col_avx2
+    ret
+
+;******************************************************************************
+; transpose a square of 8x8 blocks
+; rsi src, rdi dst, rdx stride bytes of both, ecx blocks across
+    align 16
+rfx_dwt_rem_transpose_avx2:
+    mov r9, rdx
+    shl r9, 3                           ; 8 rows
+    mov r8d, ecx
+rem_transpose_row_avx2:
+    mov rax, rsi
+    mov rbx, rdi
+    mov r10d, r8d
+rem_transpose_block_avx2:
+    lea r11, [rax + rdx * 4]
+    vmovdqu xmm0, [rax]
+    vmovdqu xmm1, [rax + rdx]
+    vmovdqu xmm2, [rax + rdx * 2]
+    vmovdqu xmm4, [r11]
+    vmovdqu xmm5, [r11 + rdx]
+    vmovdqu xmm6, [r11 + rdx * 2]
+    sub r11, rdx
+    vmovdqu xmm3, [r11]
+    lea r11, [r11 + rdx * 4]
+    vmovdqu xmm7, [r11]
+    TRANSPOSE8
+    lea r11, [rbx + rdx * 4]
+    vmovdqu [rbx], xmm8
+    vmovdqu [rbx + rdx], xmm9
+    vmovdqu [rbx + rdx * 2], xmm10
+    vmovdqu [r11], xmm12
+    vmovdqu [r11 + rdx], xmm13
+    vmovdqu [r11 + rdx * 2], xmm14
+    sub r11, rdx
+    vmovdqu [r11], xmm11
+    lea r11, [r11 + rdx * 4]
+    vmovdqu [r11], xmm15
+    add rax, 16
+    add rbx, r9
+    dec r10d
+    jnz rem_transpose_block_avx2
+    add rsi, r9
+    add rdi, 16
+    dec ecx
+    jnz rem_transpose_row_avx2
+    ret
+
+;******************************************************************************
+; copy rows of 8 or more values to packed rows
+; rsi src, rdx src stride bytes, rdi dst, advanced past what is written
+; ecx rows, r9d values a row
+    align 16
+rfx_dwt_rem_copy_avx2:
+    lea r10, [r9 * 2 - 16]              ; the last 8 values
+rem_copy_row_avx2:
+    xor eax, eax
+rem_copy_chunk_avx2:
+    cmp rax, r10
+    jge rem_copy_last_avx2
+    vmovdqu xmm0, [rsi + rax]
+    vmovdqu [rdi + rax], xmm0
+    add rax, 16
+    jmp rem_copy_chunk_avx2
+rem_copy_last_avx2:
+    vmovdqu xmm0, [rsi + r10]
+    vmovdqu [rdi + r10], xmm0
+    add rsi, rdx
+    lea rdi, [rdi + r9 * 2]
+    dec ecx
+    jnz rem_copy_row_avx2
+    ret
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_dwt_rem_amd64_avx2(const unsigned char *in_buffer,
+;                                   short *buffer, short *dwt_buffer,
+;                                   short *dwt_buffer2);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_dwt_rem_amd64_avx2
+%else
+PROC _rfxcodec_encode_dwt_rem_amd64_avx2
+%endif
+    ; save registers
+    push rbx
+    push r12
+    push r13
+    push r14
+    mov r12, rsi                        ; buffer
+    mov r13, rdx                        ; dwt_buffer
+    mov r14, rcx                        ; dwt_buffer2
+
+    ; (in_buffer - 128) << 5 to dwt_buffer
+    vpcmpeqw ymm6, ymm6, ymm6
+    vpsrlw ymm6, ymm6, 15
+    vpsllw ymm6, ymm6, 7                ; 128
+    mov rsi, r13
+    mov ecx, 256
+rem_load_avx2:
+    vpmovzxbw ymm0, [rdi]
+    vpsubw ymm0, ymm0, ymm6
+    vpsllw ymm0, ymm0, 5
+    vmovdqu [rsi], ymm0
+    add rdi, 16
+    add rsi, 32
+    dec ecx
+    jnz rem_load_avx2
+
+    LEVEL 64, 64, 128, 0
+    LEVEL 33, 48, 128, 3007
+    LEVEL 17, 32, 96, 3807
+
+    ; LL3
+    mov rsi, r13
+    mov rdx, 64
+    lea rdi, [r12 + 4015 * 2]
+    mov ecx, 9
+    mov r9d, 9
+    call rfx_dwt_rem_copy_avx2
+
+    vzeroupper
+    mov rax, 0
+    ; restore registers
+    pop r14
+    pop r13
+    pop r12
+    pop rbx
+    ret
+    align 16
@@ -0,0 +1,346 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm reduce extrapolate dwt, sse2
+;
+;same result as rfx_dwt_2d_encode_rem
+;the 33 and 17 wide levels do not split into even and odd lanes so each
+;level is a vertical pass, 8 columns a register, a transpose, the
+;vertical pass again for the horizontal one and a transpose back, all in
+;dwt_buffer and dwt_buffer2 with rows padded to 8 values, then the rows
+;are copied to the sub-bands, the next level's LL is left in dwt_buffer
+;the values in the padding are not used
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; transpose the 8x8 in xmm0 to xmm7 to
+; xmm0, xmm2, xmm1, xmm6, xmm8, xmm9, xmm3, xmm11
+%macro TRANSPOSE8 0
+    movdqa xmm8, xmm0
+    punpcklwd xmm0, xmm1
+    punpckhwd xmm8, xmm1
+    movdqa xmm9, xmm2
+    punpcklwd xmm2, xmm3
+    punpckhwd xmm9, xmm3
+    movdqa xmm10, xmm4
+    punpcklwd xmm4, xmm5
+    punpckhwd xmm10, xmm5
+    movdqa xmm11, xmm6
+    punpcklwd xmm6, xmm7
+    punpckhwd xmm11, xmm7
+    movdqa xmm1, xmm0
+    punpckldq xmm0, xmm2
+    punpckhdq xmm1, xmm2
+    movdqa xmm3, xmm8
+    punpckldq xmm8, xmm9
+    punpckhdq xmm3, xmm9
+    movdqa xmm5, xmm4
+    punpckldq xmm4, xmm6
+    punpckhdq xmm5, xmm6
+    movdqa xmm7, xmm10
+    punpckldq xmm10, xmm11
+    punpckhdq xmm7, xmm11
+    movdqa xmm2, xmm0
+    punpcklqdq xmm0, xmm4
+    punpckhqdq xmm2, xmm4
+    movdqa xmm6, xmm1
+    punpcklqdq xmm1, xmm5
+    punpckhqdq xmm6, xmm5
+    movdqa xmm9, xmm8
+    punpcklqdq xmm8, xmm10
+    punpckhqdq xmm9, xmm10
+    movdqa xmm11, xmm3
+    punpcklqdq xmm3, xmm7
+    punpckhqdq xmm11, xmm7
+%endmacro
+
+; one level
+; %1 count, %2 padded count, %3 bytes of an input row in dwt_buffer
+; %4 offset of the level's HL in buffer
+; r12 buffer, r13 dwt_buffer, r14 dwt_buffer2
+%macro LEVEL 4
+    ; vertical to dwt_buffer2
+    mov rsi, r13
+    mov rdx, %3
+    mov rdi, r14
+    mov r8, %2 * 2
+    mov ecx, %1
+    mov r9d, %2 / 8
+    call rfx_dwt_rem_verti_sse2
+    mov rsi, r14
+    mov rdi, r13
+    mov rdx, %2 * 2
+    mov ecx, %2 / 8
+    call rfx_dwt_rem_transpose_sse2
+    ; horizontal to dwt_buffer2
+    mov rsi, r13
+    mov rdx, %2 * 2
+    mov rdi, r14
+    mov r8, %2 * 2
+    mov ecx, %1
+    mov r9d, %2 / 8
+    call rfx_dwt_rem_verti_sse2
+    mov rsi, r14
+    mov rdi, r13
+    mov rdx, %2 * 2
+    mov ecx, %2 / 8
+    call rfx_dwt_rem_transpose_sse2
+    ; HL, count / 2 + 1 rows of the H columns
+    lea rsi, [r13 + (%1 / 2 + 1) * 2]
+    mov rdx, %2 * 2
+    lea rdi, [r12 + %4 * 2]
+    mov ecx, %1 / 2 + 1
+    mov r9d, %1 - %1 / 2 - 1
+    call rfx_dwt_rem_copy_sse2
+    ; LH
+    lea rsi, [r13 + (%1 / 2 + 1) * %2 * 2]
+    mov rdx, %2 * 2
+    mov ecx, %1 - %1 / 2 - 1
+    mov r9d, %1 / 2 + 1
+    call rfx_dwt_rem_copy_sse2
+    ; HH
+    lea rsi, [r13 + (%1 / 2 + 1) * %2 * 2 + (%1 / 2 + 1) * 2]
+    mov rdx, %2 * 2
+    mov ecx, %1 - %1 / 2 - 1
+    mov r9d, %1 - %1 / 2 - 1
+    call rfx_dwt_rem_copy_sse2
+%endmacro
+
+;******************************************************************************
+; vertical reduce extrapolate DWT, 8 columns at a time
+; rsi src, rdx src stride bytes, rdi dst, r8 dst stride bytes
+; ecx count, r9d columns / 8
+; count / 2 + 1 L rows then the H rows to dst
+    align 16
+rfx_dwt_rem_verti_sse2:
+    mov eax, ecx
+    shr eax, 1
+    lea r10d, [rax + 1]
+    imul r10, r8                        ; offset of the H rows
+    mov ebx, ecx
+    sub ebx, eax
+    dec ebx                             ; H rows
+rem_verti_col_sse2:
+    push rsi
+    push rdi
+    xor r11d, r11d
+    movdqu xmm0, [rsi]                  ; src[2n]
+rem_verti_row_sse2:
+    movdqu xmm1, [rsi + rdx]            ; src[2n + 1]
+    lea eax, [r11 * 2 + 2]
+    cmp eax, ecx
+    jge rem_verti_extra_sse2
+    movdqu xmm2, [rsi + rdx * 2]        ; src[2n + 2]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    ; the sum can be more than 16 bits, (a & b) + ((a ^ b) >> 1) is not
+    movdqa xmm3, xmm0
+    pxor xmm3, xmm2
+    psraw xmm3, 1
+    movdqa xmm5, xmm0
+    pand xmm5, xmm2
+    paddw xmm3, xmm5
+    psubw xmm1, xmm3
+    psraw xmm1, 1
+    jmp rem_verti_first_sse2
+rem_verti_extra_sse2:
+    ; past the end, 2 * src[2n + 1] - src[2n], h[n] is 0
+    movdqa xmm2, xmm1
+    paddw xmm2, xmm1
+    psubw xmm2, xmm0
+    pxor xmm1, xmm1
+rem_verti_first_sse2:
+    test r11d, r11d
+    jnz rem_verti_lo_sse2
+    movdqa xmm4, xmm1                   ; h[-1] = h[0]
+rem_verti_lo_sse2:
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    paddw xmm4, xmm1
+    psraw xmm4, 1
+    paddw xmm4, xmm0
+    movdqu [rdi], xmm4
+    cmp r11d, ebx
+    jge rem_verti_skip_sse2
+    movdqu [rdi + r10], xmm1
+rem_verti_skip_sse2:
+    movdqa xmm4, xmm1
+    movdqa xmm0, xmm2
+    lea rsi, [rsi + rdx * 2]
+    add rdi, r8
+    inc r11d
+    lea eax, [r11 * 2 + 1]
+    cmp eax, ecx
+    jl rem_verti_row_sse2
+    ; l[count / 2] = src[count / 2 * 2] + h[count / 2 - 1]
+    paddw xmm0, xmm4
+    movdqu [rdi], xmm0
+    pop rdi
+    pop rsi
+    add rsi, 16
+    add rdi, 16
+    dec r9d
+    jnz rem_verti_col_sse2
+    ret
+
+;******************************************************************************
+; transpose a square of 8x8 blocks
+; rsi src, rdi dst, rdx stride bytes of both, ecx blocks across
+    align 16
+rfx_dwt_rem_transpose_sse2:
+    mov r9, rdx
+    shl r9, 3                           ; 8 rows
+    mov r8d, ecx
+rem_transpose_row_sse2:
+    mov rax, rsi
+    mov rbx, rdi
+    mov r10d, r8d
+rem_transpose_block_sse2:
+    lea r11, [rax + rdx * 4]
+    movdqu xmm0, [rax]
+    movdqu xmm1, [rax + rdx]
+    movdqu xmm2, [rax + rdx * 2]
+    movdqu xmm4, [r11]
+    movdqu xmm5, [r11 + rdx]
+    movdqu xmm6, [r11 + rdx * 2]
+    sub r11, rdx
+    movdqu xmm3, [r11]
+    lea r11, [r11 + rdx * 4]
+    movdqu xmm7, [r11]
+    TRANSPOSE8
+    lea r11, [rbx + rdx * 4]
+    movdqu [rbx], xmm0
+    movdqu [rbx + rdx], xmm2
+    movdqu [rbx + rdx * 2], xmm1
+    movdqu [r11], xmm8
+    movdqu [r11 + rdx], xmm9
+    movdqu [r11 + rdx * 2], xmm3
+    sub r11, rdx
+    movdqu [r11], xmm6
+    lea r11, [r11 + rdx * 4]
+    movdqu [r11], xmm11
+    add rax, 16
+    add rbx, r9
+    dec r10d
+    jnz rem_transpose_block_sse2
+    add rsi, r9
+    add rdi, 16
+    dec ecx
+    jnz rem_transpose_row_sse2
+    ret
+
+;******************************************************************************
+; copy rows of 8 or more values to packed rows
+; rsi src, rdx src stride bytes, rdi dst, advanced past what is written
+; ecx rows, r9d values a row
+    align 16
+rfx_dwt_rem_copy_sse2:
+    lea r10, [r9 * 2 - 16]              ; the last 8 values
+rem_copy_row_sse2:
+    xor eax, eax
+rem_copy_chunk_sse2:
+    cmp rax, r10
+    jge rem_copy_last_sse2
+    movdqu xmm0, [rsi + rax]
+    movdqu [rdi + rax], xmm0
+    add rax, 16
+    jmp rem_copy_chunk_sse2
+rem_copy_last_sse2:
+    movdqu xmm0, [rsi + r10]
+    movdqu [rdi + r10], xmm0
+    add rsi, rdx
+    lea rdi, [rdi + r9 * 2]
+    dec ecx
+    jnz rem_copy_row_sse2
+    ret
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_dwt_rem_amd64_sse2(const unsigned char *in_buffer,
+;                                   short *buffer, short *dwt_buffer,
+;                                   short *dwt_buffer2);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_dwt_rem_amd64_sse2
+%else
+PROC _rfxcodec_encode_dwt_rem_amd64_sse2
+%endif
+    ; save registers
+    push rbx
+    push r12
+    push r13
+    push r14
+    mov r12, rsi                        ; buffer
+    mov r13, rdx                        ; dwt_buffer
+    mov r14, rcx                        ; dwt_buffer2
+
+    ; (in_buffer - 128) << 5 to dwt_buffer
+    pxor xmm7, xmm7
+    pcmpeqw xmm6, xmm6
+    psrlw xmm6, 15
+    psllw xmm6, 7                       ; 128
+    mov rsi, r13
+    mov ecx, 256
+rem_load_sse2:
+    movdqu xmm0, [rdi]
+    movdqa xmm1, xmm0
+    punpcklbw xmm0, xmm7
+    punpckhbw xmm1, xmm7
+    psubw xmm0, xmm6
+    psubw xmm1, xmm6
+    psllw xmm0, 5
+    psllw xmm1, 5
+    movdqu [rsi], xmm0
+    movdqu [rsi + 16], xmm1
+    add rdi, 16
+    add rsi, 32
+    dec ecx
+    jnz rem_load_sse2
+
+    LEVEL 64, 64, 128, 0
+    LEVEL 33, 40, 128, 3007
+    LEVEL 17, 24, 80, 3807
+
+    ; LL3
+    mov rsi, r13
+    mov rdx, 48
+    lea rdi, [r12 + 4015 * 2]
+    mov ecx, 9
+    mov r9d, 9
+    call rfx_dwt_rem_copy_sse2
+
+    mov rax, 0
+    ; restore registers
+    pop r14
+    pop r13
+    pop r12
+    pop rbx
+    ret
+    align 16
@@ -0,0 +1,711 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm dwt, avx2
+;
+;same math as rfxcodec_encode_dwt_shift_amd64_sse41.asm, 16 lanes
+;the buffers are only 16 byte aligned so all loads and stores are unaligned
+;
+;ymm8  hi rounding       xmm9  hi shift
+;ymm10 lo rounding       xmm11 lo shift
+;ymm12 h[n] of the block to the left
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .data
+    align 32
+    cw128    times 16 dw 128
+    cdFFFF   times 8 dd 65535
+    ; in lane shuffles for the 16 pixel width, 2 rows per register
+    ; src[2n + 2], last one mirrored
+    cbnext   db 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 14, 15
+             db 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 14, 15
+    ; h[n - 1], first one mirrored
+    cbprev   db 0, 1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13
+             db 0, 1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13
+    ; these are 1 << (factor - 1) 0 to 15 is factor
+    cwa0     times 16 dw 0     ; 0
+    cwa1     times 16 dw 1     ; 1
+    cwa2     times 16 dw 2     ; 2
+    cwa4     times 16 dw 4     ; 3
+    cwa8     times 16 dw 8     ; 4
+    cwa16    times 16 dw 16    ; 5
+    cwa32    times 16 dw 32    ; 6
+    cwa64    times 16 dw 64    ; 7
+    cwa128   times 16 dw 128   ; 8
+    cwa256   times 16 dw 256   ; 9
+    cwa512   times 16 dw 512   ; 10
+    cwa1024  times 16 dw 1024  ; 11
+    cwa2048  times 16 dw 2048  ; 12
+    cwa4096  times 16 dw 4096  ; 13
+    cwa8192  times 16 dw 8192  ; 14
+    cwa16384 times 16 dw 16384 ; 15
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 32 source pixels at rsi to
+; ymm1 src[2n], 16 pixels
+; ymm2 src[2n + 1], 16 pixels
+%macro LOAD_EVEN_ODD 0
+    vmovdqu ymm6, [rsi]
+    vmovdqu ymm7, [rsi + 32]
+    vpand ymm1, ymm6, [rel cdFFFF]
+    vpand ymm2, ymm7, [rel cdFFFF]
+    vpackusdw ymm1, ymm1, ymm2
+    vpermq ymm1, ymm1, 0xD8             ; src[2n]
+    vpsrld ymm2, ymm6, 16
+    vpsrld ymm3, ymm7, 16
+    vpackusdw ymm2, ymm2, ymm3
+    vpermq ymm2, ymm2, 0xD8             ; src[2n + 1]
+%endmacro
+
+; ymm3 src[2n + 2], more pixels to the right
+%macro NEXT_LOAD 0
+    vpbroadcastw ymm4, word [rsi + 64]
+    vperm2i128 ymm3, ymm1, ymm4, 0x21
+    vpalignr ymm3, ymm3, ymm1, 2        ; src[2n + 2]
+%endmacro
+
+; ymm3 src[2n + 2], end of row, last one mirrored
+%macro NEXT_MIRROR 0
+    vpermq ymm4, ymm1, 0xFF
+    vpsrldq ymm4, ymm4, 6
+    vperm2i128 ymm3, ymm1, ymm4, 0x21
+    vpalignr ymm3, ymm3, ymm1, 2        ; src[2n + 2]
+%endmacro
+
+; ymm5 h[n], quantized to rdi
+%macro HI_OUT 0
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vpaddw ymm6, ymm5, ymm8             ; out hi
+    vpsraw ymm6, ymm6, xmm9
+    vmovdqu [rdi], ymm6
+%endmacro
+
+; ymm6 h[n - 1] from ymm5 and ymm12
+%macro PREV_SHIFT 0
+    vperm2i128 ymm6, ymm5, ymm12, 0x03
+    vpalignr ymm6, ymm5, ymm6, 14       ; h[n - 1]
+%endmacro
+
+; ymm6 l[n] from ymm6 h[n - 1]
+%macro LO_CALC 0
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm6, ymm6, ymm5
+    vpsraw ymm6, ymm6, 1
+    vpaddw ymm6, ymm6, ymm1
+%endmacro
+
+; l[n], quantized to rdx
+%macro LO_OUT 0
+    vpaddw ymm6, ymm6, ymm10            ; out lo
+    vpsraw ymm6, ymm6, xmm11
+    vmovdqu [rdx], ymm6
+%endmacro
+
+; l[n] to rdx
+%macro LO_OUT_NO_Q 0
+    vmovdqu [rdx], ymm6                 ; out lo
+%endmacro
+
+;******************************************************************************
+; source 16 bit signed, 16 pixel width, 2 rows at a time
+rfx_dwt_2d_encode_block_horiz_16_16:
+    mov ecx, 4
+loop1a:
+    LOAD_EVEN_ODD
+    vpshufb ymm3, ymm1, [rel cbnext]    ; src[2n + 2]
+    HI_OUT
+    vpshufb ymm6, ymm5, [rel cbprev]    ; h[n - 1]
+    LO_CALC
+    LO_OUT
+
+    ; move down
+    lea rsi, [rsi + 16 * 2 * 2]         ; 2 rows
+    lea rdi, [rdi + 8 * 2 * 2]          ; 2 rows
+    lea rdx, [rdx + 8 * 2 * 2]          ; 2 rows
+
+    dec ecx
+    jnz loop1a
+
+    ret
+
+;******************************************************************************
+; source 16 bit signed, 16 pixel width
+rfx_dwt_2d_encode_block_verti_16_16:
+    ; pre
+    vmovdqu ymm1, [rsi]                 ; src[2n]
+    vmovdqu ymm2, [rsi + 16 * 2]        ; src[2n + 1]
+    vmovdqu ymm3, [rsi + 16 * 2 * 2]    ; src[2n + 2]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    vmovdqa ymm7, ymm5                  ; save hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm5, ymm5, ymm1
+    vmovdqu [rdx], ymm5                 ; out lo
+    ; move down
+    lea rsi, [rsi + 16 * 2 * 2]         ; 2 rows
+    lea rdi, [rdi + 16 * 2]             ; 1 row
+    lea rdx, [rdx + 16 * 2]             ; 1 row
+
+    ; loop
+    mov ecx, 6
+loop2b:
+    vmovdqa ymm1, ymm3                  ; src[2n]
+    vmovdqu ymm2, [rsi + 16 * 2]        ; src[2n + 1]
+    vmovdqu ymm3, [rsi + 16 * 2 * 2]    ; src[2n + 2]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm6, ymm5, ymm7
+    vmovdqa ymm7, ymm5                  ; save hi
+    vpsraw ymm6, ymm6, 1
+    vpaddw ymm6, ymm6, ymm1
+    vmovdqu [rdx], ymm6                 ; out lo
+    ; move down
+    lea rsi, [rsi + 16 * 2 * 2]         ; 2 rows
+    lea rdi, [rdi + 16 * 2]             ; 1 row
+    lea rdx, [rdx + 16 * 2]             ; 1 row
+
+    dec ecx
+    jnz loop2b
+
+    ; post
+    vmovdqa ymm1, ymm3                  ; src[2n]
+    vmovdqu ymm2, [rsi + 16 * 2]        ; src[2n + 1]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm5, ymm5, ymm7
+    vpsraw ymm5, ymm5, 1
+    vpaddw ymm5, ymm5, ymm1
+    vmovdqu [rdx], ymm5                 ; out lo
+
+    ret
+
+;******************************************************************************
+; source 16 bit signed, 32 pixel width
+rfx_dwt_2d_encode_block_horiz_16_32:
+    mov ecx, 16
+loop1c:
+    LOAD_EVEN_ODD
+    NEXT_MIRROR
+    HI_OUT
+    vpbroadcastw ymm12, xmm5            ; mirror h[0]
+    PREV_SHIFT
+    LO_CALC
+    LO_OUT
+
+    ; move down
+    lea rsi, [rsi + 32 * 2]
+    lea rdi, [rdi + 16 * 2]
+    lea rdx, [rdx + 16 * 2]
+
+    dec ecx
+    jnz loop1c
+
+    ret
+
+;******************************************************************************
+; source 16 bit signed, 32 pixel width
+rfx_dwt_2d_encode_block_horiz_16_32_no_lo:
+    mov ecx, 16
+loop1c1:
+    LOAD_EVEN_ODD
+    NEXT_MIRROR
+    HI_OUT
+    vpbroadcastw ymm12, xmm5            ; mirror h[0]
+    PREV_SHIFT
+    LO_CALC
+    LO_OUT_NO_Q
+
+    ; move down
+    lea rsi, [rsi + 32 * 2]
+    lea rdi, [rdi + 16 * 2]
+    lea rdx, [rdx + 16 * 2]
+
+    dec ecx
+    jnz loop1c1
+
+    ret
+
+;******************************************************************************
+; source 16 bit signed, 32 pixel width
+rfx_dwt_2d_encode_block_verti_16_32:
+    mov ecx, 2
+loop1d:
+    ; pre
+    vmovdqu ymm1, [rsi]                 ; src[2n]
+    vmovdqu ymm2, [rsi + 32 * 2]        ; src[2n + 1]
+    vmovdqu ymm3, [rsi + 32 * 2 * 2]    ; src[2n + 2]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    vmovdqa ymm7, ymm5                  ; save hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm5, ymm5, ymm1
+    vmovdqu [rdx], ymm5                 ; out lo
+    ; move down
+    lea rsi, [rsi + 32 * 2 * 2]         ; 2 rows
+    lea rdi, [rdi + 32 * 2]             ; 1 row
+    lea rdx, [rdx + 32 * 2]             ; 1 row
+
+    ; loop
+    shl ecx, 16
+    mov cx, 14
+loop2d:
+    vmovdqa ymm1, ymm3                  ; src[2n]
+    vmovdqu ymm2, [rsi + 32 * 2]        ; src[2n + 1]
+    vmovdqu ymm3, [rsi + 32 * 2 * 2]    ; src[2n + 2]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm6, ymm5, ymm7
+    vmovdqa ymm7, ymm5                  ; save hi
+    vpsraw ymm6, ymm6, 1
+    vpaddw ymm6, ymm6, ymm1
+    vmovdqu [rdx], ymm6                 ; out lo
+    ; move down
+    lea rsi, [rsi + 32 * 2 * 2]         ; 2 rows
+    lea rdi, [rdi + 32 * 2]             ; 1 row
+    lea rdx, [rdx + 32 * 2]             ; 1 row
+
+    dec cx
+    jnz loop2d
+    shr ecx, 16
+
+    ; post
+    vmovdqa ymm1, ymm3                  ; src[2n]
+    vmovdqu ymm2, [rsi + 32 * 2]        ; src[2n + 1]
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm5, ymm5, ymm7
+    vpsraw ymm5, ymm5, 1
+    vpaddw ymm5, ymm5, ymm1
+    vmovdqu [rdx], ymm5                 ; out lo
+    ; move down
+    lea rsi, [rsi + 32 * 2 * 2]         ; 2 row
+    lea rdi, [rdi + 32 * 2]             ; 1 row
+    lea rdx, [rdx + 32 * 2]             ; 1 row
+
+    ; move up
+    lea rsi, [rsi - 32 * 32 * 2]
+    lea rdi, [rdi - 16 * 32 * 2]
+    lea rdx, [rdx - 16 * 32 * 2]
+
+    ; move right
+    lea rsi, [rsi + 32]
+    lea rdi, [rdi + 32]
+    lea rdx, [rdx + 32]
+
+    dec ecx
+    jnz loop1d
+
+    ret
+
+;******************************************************************************
+; source 16 bit signed, 64 pixel width
+rfx_dwt_2d_encode_block_horiz_16_64:
+    mov ecx, 32
+loop1e:
+    ; pre
+    LOAD_EVEN_ODD
+    NEXT_LOAD
+    HI_OUT
+    vpbroadcastw ymm12, xmm5            ; mirror h[0]
+    PREV_SHIFT
+    vmovdqa ymm12, ymm5                 ; save hi
+    LO_CALC
+    LO_OUT
+
+    ; move right
+    lea rsi, [rsi + 32 * 2]
+    lea rdi, [rdi + 16 * 2]
+    lea rdx, [rdx + 16 * 2]
+
+    ; post
+    LOAD_EVEN_ODD
+    NEXT_MIRROR
+    HI_OUT
+    PREV_SHIFT
+    LO_CALC
+    LO_OUT
+
+    ; move right
+    lea rsi, [rsi + 32 * 2]
+    lea rdi, [rdi + 16 * 2]
+    lea rdx, [rdx + 16 * 2]
+
+    dec ecx
+    jnz loop1e
+
+    ret
+
+;******************************************************************************
+; source 16 bit signed, 64 pixel width
+rfx_dwt_2d_encode_block_horiz_16_64_no_lo:
+    mov ecx, 32
+loop1e1:
+    ; pre
+    LOAD_EVEN_ODD
+    NEXT_LOAD
+    HI_OUT
+    vpbroadcastw ymm12, xmm5            ; mirror h[0]
+    PREV_SHIFT
+    vmovdqa ymm12, ymm5                 ; save hi
+    LO_CALC
+    LO_OUT_NO_Q
+
+    ; move right
+    lea rsi, [rsi + 32 * 2]
+    lea rdi, [rdi + 16 * 2]
+    lea rdx, [rdx + 16 * 2]
+
+    ; post
+    LOAD_EVEN_ODD
+    NEXT_MIRROR
+    HI_OUT
+    PREV_SHIFT
+    LO_CALC
+    LO_OUT_NO_Q
+
+    ; move right
+    lea rsi, [rsi + 32 * 2]
+    lea rdi, [rdi + 16 * 2]
+    lea rdx, [rdx + 16 * 2]
+
+    dec ecx
+    jnz loop1e1
+
+    ret
+
+;******************************************************************************
+; source 8 bit unsigned, 64 pixel width
+rfx_dwt_2d_encode_block_verti_8_64:
+    mov ecx, 4
+loop1f:
+    ; pre
+    vpmovzxbw ymm1, [rsi]               ; src[2n]
+    vpmovzxbw ymm2, [rsi + 64 * 1]      ; src[2n + 1]
+    vpmovzxbw ymm3, [rsi + 64 * 1 * 2]  ; src[2n + 2]
+    vpsubw ymm1, ymm1, [rel cw128]
+    vpsubw ymm2, ymm2, [rel cw128]
+    vpsubw ymm3, ymm3, [rel cw128]
+    vpsllw ymm1, ymm1, 5
+    vpsllw ymm2, ymm2, 5
+    vpsllw ymm3, ymm3, 5
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    vmovdqa ymm7, ymm5                  ; save hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm5, ymm5, ymm1
+    vmovdqu [rdx], ymm5                 ; out lo
+    ; move down
+    lea rsi, [rsi + 64 * 1 * 2]         ; 2 rows
+    lea rdi, [rdi + 64 * 2]             ; 1 row
+    lea rdx, [rdx + 64 * 2]             ; 1 row
+
+    ; loop
+    shl ecx, 16
+    mov cx, 30
+loop2f:
+    vmovdqa ymm1, ymm3                  ; src[2n]
+    vpmovzxbw ymm2, [rsi + 64 * 1]      ; src[2n + 1]
+    vpmovzxbw ymm3, [rsi + 64 * 1 * 2]  ; src[2n + 2]
+    vpsubw ymm2, ymm2, [rel cw128]
+    vpsubw ymm3, ymm3, [rel cw128]
+    vpsllw ymm2, ymm2, 5
+    vpsllw ymm3, ymm3, 5
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm6, ymm5, ymm7
+    vmovdqa ymm7, ymm5                  ; save hi
+    vpsraw ymm6, ymm6, 1
+    vpaddw ymm6, ymm6, ymm1
+    vmovdqu [rdx], ymm6                 ; out lo
+    ; move down
+    lea rsi, [rsi + 64 * 1 * 2]         ; 2 rows
+    lea rdi, [rdi + 64 * 2]             ; 1 row
+    lea rdx, [rdx + 64 * 2]             ; 1 row
+
+    dec cx
+    jnz loop2f
+    shr ecx, 16
+
+    ; post
+    vmovdqa ymm1, ymm3                  ; src[2n]
+    vpmovzxbw ymm2, [rsi + 64 * 1]      ; src[2n + 1]
+    vpsubw ymm2, ymm2, [rel cw128]
+    vpsllw ymm2, ymm2, 5
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw ymm4, ymm1, ymm3
+    vpsraw ymm4, ymm4, 1
+    vpsubw ymm5, ymm2, ymm4
+    vpsraw ymm5, ymm5, 1
+    vmovdqu [rdi], ymm5                 ; out hi
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw ymm5, ymm5, ymm7
+    vpsraw ymm5, ymm5, 1
+    vpaddw ymm5, ymm5, ymm1
+    vmovdqu [rdx], ymm5                 ; out lo
+    ; move down
+    lea rsi, [rsi + 64 * 1 * 2]         ; 2 rows
+    lea rdi, [rdi + 64 * 2]             ; 1 row
+    lea rdx, [rdx + 64 * 2]             ; 1 row
+
+    ; move up
+    lea rsi, [rsi - 64 * 1 * 64]
+    lea rdi, [rdi - 32 * 64 * 2]
+    lea rdx, [rdx - 32 * 64 * 2]
+
+    ; move right
+    lea rsi, [rsi + 16]
+    lea rdi, [rdi + 32]
+    lea rdx, [rdx + 32]
+
+    dec ecx
+    jnz loop1f
+
+    ret
+
+set_quants_hi:
+    sub rax, 6 - 5
+    vmovd xmm9, eax
+    imul rax, 32
+    lea rdx, [rel cwa0]
+    add rdx, rax
+    vmovdqu ymm8, [rdx]
+    ret
+
+set_quants_lo:
+    sub rax, 6 - 5
+    vmovd xmm11, eax
+    imul rax, 32
+    lea rdx, [rel cwa0]
+    add rdx, rax
+    vmovdqu ymm10, [rdx]
+    ret
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_dwt_shift_amd64_avx2(const char *qtable,
+;                                     unsigned char *in_buffer,
+;                                     short *out_buffer,
+;                                     short *work_buffer);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_dwt_shift_amd64_avx2
+%else
+PROC _rfxcodec_encode_dwt_shift_amd64_avx2
+%endif
+    ; save registers
+    push rdx
+    push rcx
+    push rsi
+    push rdi
+
+    ; verical DWT to work buffer, level 1
+    mov rsi, [rsp + 8]                  ; src
+    mov rdi, [rsp + 16]                 ; dst hi
+    lea rdi, [rdi + 64 * 32 * 2]        ; dst hi
+    mov rdx, [rsp + 16]                 ; dst lo
+    call rfx_dwt_2d_encode_block_verti_8_64
+
+    ; horizontal DWT to out buffer, level 1, part 1
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 4]
+    and al, 0xF
+    call set_quants_hi
+    mov rsi, [rsp + 16]                 ; src
+    mov rdi, [rsp + 24]                 ; dst hi - HL1
+    mov rdx, [rsp + 24]                 ; dst lo - LL1
+    lea rdx, [rdx + 32 * 32 * 6]        ; dst lo - LL1
+    call rfx_dwt_2d_encode_block_horiz_16_64_no_lo
+
+    ; horizontal DWT to out buffer, level 1, part 2
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 4]
+    shr al, 4
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 3]
+    shr al, 4
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    lea rsi, [rsi + 64 * 32 * 2]        ; src
+    mov rdi, [rsp + 24]                 ; dst hi - HH1
+    lea rdi, [rdi + 32 * 32 * 4]        ; dst hi - HH1
+    mov rdx, [rsp + 24]                 ; dst lo - LH1
+    lea rdx, [rdx + 32 * 32 * 2]        ; dst lo - LH1
+    call rfx_dwt_2d_encode_block_horiz_16_64
+
+    ; verical DWT to work buffer, level 2
+    mov rsi, [rsp + 24]                 ; src
+    lea rsi, [rsi + 32 * 32 * 6]        ; src
+    mov rdi, [rsp + 16]                 ; dst hi
+    lea rdi, [rdi + 32 * 16 * 2]        ; dst hi
+    mov rdx, [rsp + 16]                 ; dst lo
+    call rfx_dwt_2d_encode_block_verti_16_32
+
+    ; horizontal DWT to out buffer, level 2, part 1
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 2]
+    shr al, 4
+    call set_quants_hi
+    mov rsi, [rsp + 16]                 ; src
+    ; 32 * 32 * 6 + 16 * 16 * 0 = 6144
+    mov rdi, [rsp + 24]                 ; dst hi - HL2
+    lea rdi, [rdi + 6144]               ; dst hi - HL2
+    ; 32 * 32 * 6 + 16 * 16 * 6 = 7680
+    mov rdx, [rsp + 24]                 ; dst lo - LL2
+    lea rdx, [rdx + 7680]               ; dst lo - LL2
+    call rfx_dwt_2d_encode_block_horiz_16_32_no_lo
+
+    ; horizontal DWT to out buffer, level 2, part 2
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 3]
+    and al, 0xF
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 2]
+    and al, 0xF
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    lea rsi, [rsi + 32 * 16 * 2]        ; src
+    ; 32 * 32 * 6 + 16 * 16 * 4 = 7168
+    mov rdi, [rsp + 24]                 ; dst hi - HH2
+    lea rdi, [rdi + 7168]               ; dst hi - HH2
+    ; 32 * 32 * 6 + 16 * 16 * 2 = 6656
+    mov rdx, [rsp + 24]                 ; dst lo - LH2
+    lea rdx, [rdx + 6656]               ; dst lo - LH2
+    call rfx_dwt_2d_encode_block_horiz_16_32
+
+    ; verical DWT to work buffer, level 3
+    ; 32 * 32 * 6 + 16 * 16 * 6 = 7680
+    mov rsi, [rsp + 24]                 ; src
+    lea rsi, [rsi + 7680]               ; src
+    mov rdi, [rsp + 16]                 ; dst hi
+    lea rdi, [rdi + 16 * 8 * 2]         ; dst hi
+    mov rdx, [rsp + 16]                 ; dst lo
+    call rfx_dwt_2d_encode_block_verti_16_16
+
+    ; horizontal DWT to out buffer, level 3, part 1
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 1]
+    and al, 0xF
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 0]
+    and al, 0xF
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 0 = 7680
+    mov rdi, [rsp + 24]                 ; dst hi - HL3
+    lea rdi, [rdi + 7680]               ; dst hi - HL3
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 6 = 8064
+    mov rdx, [rsp + 24]                 ; dst lo - LL3
+    lea rdx, [rdx + 8064]               ; dst lo - LL3
+    call rfx_dwt_2d_encode_block_horiz_16_16
+
+    ; horizontal DWT to out buffer, level 3, part 2
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 1]
+    shr al, 4
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 0]
+    shr al, 4
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    lea rsi, [rsi + 16 * 8 * 2]         ; src
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 4 = 7936
+    mov rdi, [rsp + 24]                 ; dst hi - HH3
+    lea rdi, [rdi + 7936]               ; dst hi - HH3
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 2 = 7808
+    mov rdx, [rsp + 24]                 ; dst lo - LH3
+    lea rdx, [rdx + 7808]               ; dst lo - LH3
+    call rfx_dwt_2d_encode_block_horiz_16_16
+
+    vzeroupper
+    mov rax, 0
+    ; restore registers
+    pop rdi
+    pop rsi
+    pop rcx
+    pop rdx
+    ret
+    align 16
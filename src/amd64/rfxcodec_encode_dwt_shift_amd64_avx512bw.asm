@@ -0,0 +1,458 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm dwt, avx512bw
+;
+;same math as rfxcodec_encode_dwt_shift_amd64_sse41.asm, 32 lanes
+;a 64 pixel level 1 row is 2 zmm registers, even and odd are split with
+;vpermt2w and the neighbours come from vpermw so there are no loads across
+;blocks, level 2 and 3 put 2 and 4 rows in each register
+;the buffers are only 16 byte aligned so all loads and stores are unaligned
+;
+;zmm8  hi rounding       xmm9  hi shift
+;zmm10 lo rounding       xmm11 lo shift
+;zmm12 even index        zmm13 odd index
+;zmm14 next index        zmm15 prev index
+;k1    row mask for the vertical DWT
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .data
+    align 64
+    cw128    times 32 dw 128
+    ; vpermt2w, src[2n] and src[2n + 1] from 2 registers
+    cweven   dw 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30
+             dw 32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62
+    cwodd    dw 1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31
+             dw 33, 35, 37, 39, 41, 43, 45, 47, 49, 51, 53, 55, 57, 59, 61, 63
+    ; vpermw, src[2n + 2] from src[2n], last one in each row mirrored
+    cwnext32 dw 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+             dw 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 31
+    cwnext16 dw 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 15
+             dw 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 31
+    cwnext8  dw 1, 2, 3, 4, 5, 6, 7, 7, 9, 10, 11, 12, 13, 14, 15, 15
+             dw 17, 18, 19, 20, 21, 22, 23, 23, 25, 26, 27, 28, 29, 30, 31, 31
+    ; vpermw, h[n - 1] from h[n], first one in each row mirrored
+    cwprev32 dw 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14
+             dw 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30
+    cwprev16 dw 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14
+             dw 16, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30
+    cwprev8  dw 0, 0, 1, 2, 3, 4, 5, 6, 8, 8, 9, 10, 11, 12, 13, 14
+             dw 16, 16, 17, 18, 19, 20, 21, 22, 24, 24, 25, 26, 27, 28, 29, 30
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; zmm5 h[n] from zmm1 src[2n], zmm2 src[2n + 1], zmm3 src[2n + 2]
+%macro HI_CALC 0
+    ; h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+    vpaddw zmm4, zmm1, zmm3
+    vpsraw zmm4, zmm4, 1
+    vpsubw zmm5, zmm2, zmm4
+    vpsraw zmm5, zmm5, 1
+%endmacro
+
+; zmm6 l[n] from zmm6 h[n - 1], zmm5 h[n], zmm1 src[2n]
+%macro LO_CALC 0
+    ; l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+    vpaddw zmm6, zmm6, zmm5
+    vpsraw zmm6, zmm6, 1
+    vpaddw zmm6, zmm6, zmm1
+%endmacro
+
+; 8 bit unsigned at %2 to 16 bit signed in %1, (src - 128) << 5
+%macro LOAD_8 2
+    vpmovzxbw %1, %2
+    vpsubw %1, %1, [rel cw128]
+    vpsllw %1, %1, 5
+%endmacro
+
+;******************************************************************************
+; source 16 bit signed, 64 words, 1, 2 or 4 rows, at a time
+; rsi src, rdi dst hi, rdx dst lo, ecx count
+rfx_dwt_2d_encode_block_horiz_16:
+    vmovdqu16 zmm6, [rsi]
+    vmovdqu16 zmm7, [rsi + 64]
+    vmovdqa64 zmm1, zmm6
+    vpermt2w zmm1, zmm12, zmm7          ; src[2n]
+    vmovdqa64 zmm2, zmm6
+    vpermt2w zmm2, zmm13, zmm7          ; src[2n + 1]
+    vpermw zmm3, zmm14, zmm1            ; src[2n + 2]
+    HI_CALC
+    vpaddw zmm6, zmm5, zmm8             ; out hi
+    vpsraw zmm6, zmm6, xmm9
+    vmovdqu16 [rdi], zmm6
+    vpermw zmm6, zmm15, zmm5            ; h[n - 1]
+    LO_CALC
+    vpaddw zmm6, zmm6, zmm10            ; out lo
+    vpsraw zmm6, zmm6, xmm11
+    vmovdqu16 [rdx], zmm6
+
+    ; move on
+    lea rsi, [rsi + 64 * 2]
+    lea rdi, [rdi + 32 * 2]
+    lea rdx, [rdx + 32 * 2]
+
+    dec ecx
+    jnz rfx_dwt_2d_encode_block_horiz_16
+
+    ret
+
+;******************************************************************************
+; source 16 bit signed, 32 or 16 pixel width, k1 masks the row
+; rsi src, rdi dst hi, rdx dst lo, r8 row bytes, ecx rows out
+rfx_dwt_2d_encode_block_verti_16:
+    ; pre
+    vmovdqu16 zmm1{k1}{z}, [rsi]        ; src[2n]
+    vmovdqu16 zmm2{k1}{z}, [rsi + r8]   ; src[2n + 1]
+    vmovdqu16 zmm3{k1}{z}, [rsi + r8 * 2] ; src[2n + 2]
+    HI_CALC
+    vmovdqu16 [rdi]{k1}, zmm5           ; out hi
+    vmovdqa64 zmm7, zmm5                ; save hi
+    vpaddw zmm5, zmm5, zmm1
+    vmovdqu16 [rdx]{k1}, zmm5           ; out lo
+    ; move down
+    lea rsi, [rsi + r8 * 2]             ; 2 rows
+    add rdi, r8                         ; 1 row
+    add rdx, r8                         ; 1 row
+
+    ; loop
+    sub ecx, 2
+loop1b:
+    vmovdqa64 zmm1, zmm3                ; src[2n]
+    vmovdqu16 zmm2{k1}{z}, [rsi + r8]   ; src[2n + 1]
+    vmovdqu16 zmm3{k1}{z}, [rsi + r8 * 2] ; src[2n + 2]
+    HI_CALC
+    vmovdqu16 [rdi]{k1}, zmm5           ; out hi
+    vmovdqa64 zmm6, zmm7
+    vmovdqa64 zmm7, zmm5                ; save hi
+    LO_CALC
+    vmovdqu16 [rdx]{k1}, zmm6           ; out lo
+    ; move down
+    lea rsi, [rsi + r8 * 2]             ; 2 rows
+    add rdi, r8                         ; 1 row
+    add rdx, r8                         ; 1 row
+
+    dec ecx
+    jnz loop1b
+
+    ; post
+    vmovdqa64 zmm1, zmm3                ; src[2n]
+    vmovdqu16 zmm2{k1}{z}, [rsi + r8]   ; src[2n + 1]
+    HI_CALC
+    vmovdqu16 [rdi]{k1}, zmm5           ; out hi
+    vmovdqa64 zmm6, zmm7
+    LO_CALC
+    vmovdqu16 [rdx]{k1}, zmm6           ; out lo
+
+    ret
+
+;******************************************************************************
+; source 8 bit unsigned, 64 pixel width, 32 pixels at a time
+; rsi src, rdi dst hi, rdx dst lo
+rfx_dwt_2d_encode_block_verti_8_64:
+    mov ecx, 2
+loop1c:
+    ; pre
+    LOAD_8 zmm1, [rsi]                  ; src[2n]
+    LOAD_8 zmm2, [rsi + 64 * 1]         ; src[2n + 1]
+    LOAD_8 zmm3, [rsi + 64 * 1 * 2]     ; src[2n + 2]
+    HI_CALC
+    vmovdqu16 [rdi], zmm5               ; out hi
+    vmovdqa64 zmm7, zmm5                ; save hi
+    vpaddw zmm5, zmm5, zmm1
+    vmovdqu16 [rdx], zmm5               ; out lo
+    ; move down
+    lea rsi, [rsi + 64 * 1 * 2]         ; 2 rows
+    lea rdi, [rdi + 64 * 2]             ; 1 row
+    lea rdx, [rdx + 64 * 2]             ; 1 row
+
+    ; loop
+    shl ecx, 16
+    mov cx, 30
+loop2c:
+    vmovdqa64 zmm1, zmm3                ; src[2n]
+    LOAD_8 zmm2, [rsi + 64 * 1]         ; src[2n + 1]
+    LOAD_8 zmm3, [rsi + 64 * 1 * 2]     ; src[2n + 2]
+    HI_CALC
+    vmovdqu16 [rdi], zmm5               ; out hi
+    vmovdqa64 zmm6, zmm7
+    vmovdqa64 zmm7, zmm5                ; save hi
+    LO_CALC
+    vmovdqu16 [rdx], zmm6               ; out lo
+    ; move down
+    lea rsi, [rsi + 64 * 1 * 2]         ; 2 rows
+    lea rdi, [rdi + 64 * 2]             ; 1 row
+    lea rdx, [rdx + 64 * 2]             ; 1 row
+
+    dec cx
+    jnz loop2c
+    shr ecx, 16
+
+    ; post
+    vmovdqa64 zmm1, zmm3                ; src[2n]
+    LOAD_8 zmm2, [rsi + 64 * 1]         ; src[2n + 1]
+    HI_CALC
+    vmovdqu16 [rdi], zmm5               ; out hi
+    vmovdqa64 zmm6, zmm7
+    LO_CALC
+    vmovdqu16 [rdx], zmm6               ; out lo
+    ; move down
+    lea rsi, [rsi + 64 * 1 * 2]         ; 2 rows
+    lea rdi, [rdi + 64 * 2]             ; 1 row
+    lea rdx, [rdx + 64 * 2]             ; 1 row
+
+    ; move up
+    lea rsi, [rsi - 64 * 1 * 64]
+    lea rdi, [rdi - 32 * 64 * 2]
+    lea rdx, [rdx - 32 * 64 * 2]
+
+    ; move right
+    lea rsi, [rsi + 32]
+    lea rdi, [rdi + 64]
+    lea rdx, [rdx + 64]
+
+    dec ecx
+    jnz loop1c
+
+    ret
+
+; al is the quant value, uses ecx
+set_quants_hi:
+    sub eax, 6 - 5
+    vmovd xmm9, eax
+    lea ecx, [eax - 1]
+    mov eax, 1
+    shl eax, cl
+    vpbroadcastw zmm8, eax
+    ret
+
+; al is the quant value, uses ecx
+set_quants_lo:
+    sub eax, 6 - 5
+    vmovd xmm11, eax
+    lea ecx, [eax - 1]
+    mov eax, 1
+    shl eax, cl
+    vpbroadcastw zmm10, eax
+    ret
+
+; LL1 and LL2 are not quantized
+set_quants_lo_none:
+    vpxord zmm10, zmm10, zmm10
+    vpxor xmm11, xmm11, xmm11
+    ret
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_dwt_shift_amd64_avx512bw(const char *qtable,
+;                                         unsigned char *in_buffer,
+;                                         short *out_buffer,
+;                                         short *work_buffer);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_dwt_shift_amd64_avx512bw
+%else
+PROC _rfxcodec_encode_dwt_shift_amd64_avx512bw
+%endif
+    ; save registers
+    push rdx
+    push rcx
+    push rsi
+    push rdi
+
+    ; verical DWT to work buffer, level 1
+    mov rsi, [rsp + 8]                  ; src
+    mov rdi, [rsp + 16]                 ; dst hi
+    lea rdi, [rdi + 64 * 32 * 2]        ; dst hi
+    mov rdx, [rsp + 16]                 ; dst lo
+    call rfx_dwt_2d_encode_block_verti_8_64
+
+    vmovdqu16 zmm12, [rel cweven]
+    vmovdqu16 zmm13, [rel cwodd]
+    vmovdqu16 zmm14, [rel cwnext32]
+    vmovdqu16 zmm15, [rel cwprev32]
+
+    ; horizontal DWT to out buffer, level 1, part 1
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 4]
+    and al, 0xF
+    call set_quants_hi
+    call set_quants_lo_none
+    mov rsi, [rsp + 16]                 ; src
+    mov rdi, [rsp + 24]                 ; dst hi - HL1
+    mov rdx, [rsp + 24]                 ; dst lo - LL1
+    lea rdx, [rdx + 32 * 32 * 6]        ; dst lo - LL1
+    mov ecx, 32
+    call rfx_dwt_2d_encode_block_horiz_16
+
+    ; horizontal DWT to out buffer, level 1, part 2
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 4]
+    shr al, 4
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 3]
+    shr al, 4
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    lea rsi, [rsi + 64 * 32 * 2]        ; src
+    mov rdi, [rsp + 24]                 ; dst hi - HH1
+    lea rdi, [rdi + 32 * 32 * 4]        ; dst hi - HH1
+    mov rdx, [rsp + 24]                 ; dst lo - LH1
+    lea rdx, [rdx + 32 * 32 * 2]        ; dst lo - LH1
+    mov ecx, 32
+    call rfx_dwt_2d_encode_block_horiz_16
+
+    ; verical DWT to work buffer, level 2, 32 lanes
+    mov eax, 0xFFFFFFFF
+    kmovd k1, eax
+    mov rsi, [rsp + 24]                 ; src
+    lea rsi, [rsi + 32 * 32 * 6]        ; src
+    mov rdi, [rsp + 16]                 ; dst hi
+    lea rdi, [rdi + 32 * 16 * 2]        ; dst hi
+    mov rdx, [rsp + 16]                 ; dst lo
+    mov r8, 32 * 2
+    mov ecx, 16
+    call rfx_dwt_2d_encode_block_verti_16
+
+    vmovdqu16 zmm14, [rel cwnext16]
+    vmovdqu16 zmm15, [rel cwprev16]
+
+    ; horizontal DWT to out buffer, level 2, part 1
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 2]
+    shr al, 4
+    call set_quants_hi
+    call set_quants_lo_none
+    mov rsi, [rsp + 16]                 ; src
+    ; 32 * 32 * 6 + 16 * 16 * 0 = 6144
+    mov rdi, [rsp + 24]                 ; dst hi - HL2
+    lea rdi, [rdi + 6144]               ; dst hi - HL2
+    ; 32 * 32 * 6 + 16 * 16 * 6 = 7680
+    mov rdx, [rsp + 24]                 ; dst lo - LL2
+    lea rdx, [rdx + 7680]               ; dst lo - LL2
+    mov ecx, 8
+    call rfx_dwt_2d_encode_block_horiz_16
+
+    ; horizontal DWT to out buffer, level 2, part 2
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 3]
+    and al, 0xF
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 2]
+    and al, 0xF
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    lea rsi, [rsi + 32 * 16 * 2]        ; src
+    ; 32 * 32 * 6 + 16 * 16 * 4 = 7168
+    mov rdi, [rsp + 24]                 ; dst hi - HH2
+    lea rdi, [rdi + 7168]               ; dst hi - HH2
+    ; 32 * 32 * 6 + 16 * 16 * 2 = 6656
+    mov rdx, [rsp + 24]                 ; dst lo - LH2
+    lea rdx, [rdx + 6656]               ; dst lo - LH2
+    mov ecx, 8
+    call rfx_dwt_2d_encode_block_horiz_16
+
+    ; verical DWT to work buffer, level 3, 16 lanes
+    mov eax, 0xFFFF
+    kmovd k1, eax
+    ; 32 * 32 * 6 + 16 * 16 * 6 = 7680
+    mov rsi, [rsp + 24]                 ; src
+    lea rsi, [rsi + 7680]               ; src
+    mov rdi, [rsp + 16]                 ; dst hi
+    lea rdi, [rdi + 16 * 8 * 2]         ; dst hi
+    mov rdx, [rsp + 16]                 ; dst lo
+    mov r8, 16 * 2
+    mov ecx, 8
+    call rfx_dwt_2d_encode_block_verti_16
+
+    vmovdqu16 zmm14, [rel cwnext8]
+    vmovdqu16 zmm15, [rel cwprev8]
+
+    ; horizontal DWT to out buffer, level 3, part 1
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 1]
+    and al, 0xF
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 0]
+    and al, 0xF
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 0 = 7680
+    mov rdi, [rsp + 24]                 ; dst hi - HL3
+    lea rdi, [rdi + 7680]               ; dst hi - HL3
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 6 = 8064
+    mov rdx, [rsp + 24]                 ; dst lo - LL3
+    lea rdx, [rdx + 8064]               ; dst lo - LL3
+    mov ecx, 2
+    call rfx_dwt_2d_encode_block_horiz_16
+
+    ; horizontal DWT to out buffer, level 3, part 2
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 1]
+    shr al, 4
+    call set_quants_hi
+    xor rax, rax
+    mov rdx, [rsp]
+    mov al, [rdx + 0]
+    shr al, 4
+    call set_quants_lo
+    mov rsi, [rsp + 16]                 ; src
+    lea rsi, [rsi + 16 * 8 * 2]         ; src
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 4 = 7936
+    mov rdi, [rsp + 24]                 ; dst hi - HH3
+    lea rdi, [rdi + 7936]               ; dst hi - HH3
+    ; 32 * 32 * 6 + 16 * 16 * 6 + 8 * 8 * 2 = 7808
+    mov rdx, [rsp + 24]                 ; dst lo - LH3
+    lea rdx, [rdx + 7808]               ; dst lo - LH3
+    mov ecx, 2
+    call rfx_dwt_2d_encode_block_horiz_16
+
+    vzeroupper
+    mov rax, 0
+    ; restore registers
+    pop rdi
+    pop rsi
+    pop rcx
+    pop rdx
+    ret
+    align 16
+
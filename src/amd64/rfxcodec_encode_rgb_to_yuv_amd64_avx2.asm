@@ -0,0 +1,271 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm 32 and 24 bpp to yuv, 64x64 tile, avx2
+;
+;same math as rfx_encode_rgb_to_yuv
+;y = (r *  19595 + g *  38470 + b *   7471) >> 16
+;u = (r * -11071 + g * -21736 + b *  32807) >> 16
+;v = (r *  32756 + g * -27429 + b *  -5327) >> 16
+;38470 and 32807 do not fit in a signed word so g and b are put in both
+;words of the dword and multiplied by half each
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .data
+    align 32
+    cdFF     times 8 dd 255
+    cd128    times 8 dd 128
+    cwy_rb   times 8 dw 19595, 7471
+    cwy_gg   times 8 dw 19235, 19235
+    cwu_rg   times 8 dw -11071, -21736
+    cwu_bb   times 8 dw 16404, 16403
+    cwv_rg   times 8 dw 32756, -27429
+    cwv_b0   times 8 dw -5327, 0
+    ; 3 byte pixels to dwords, low lane from byte 0, high lane from byte 4
+    cbpix    db 0, 1, 2, 128, 3, 4, 5, 128, 6, 7, 8, 128, 9, 10, 11, 128
+             db 4, 5, 6, 128, 7, 8, 9, 128, 10, 11, 12, 128, 13, 14, 15, 128
+    ; after the packs the dwords are 0 - 3, 8 - 11, 4 - 7, 12 - 15 pixels
+    cdorder  dd 0, 4, 1, 5, 2, 6, 3, 7
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 8 pixels, one in each dword, to 8 y, u, v dwords
+; %1 pixels, %2 y, %3 u, %4 v, %5 r shift, %6 b shift
+; uses ymm1, ymm2, ymm3, ymm7
+%macro RGB_TO_YUV8 6
+    vpsrld ymm1, %1, %5
+    vpand ymm1, ymm1, [rel cdFF]        ; r
+    vpsrld ymm2, %1, 8
+    vpand ymm2, ymm2, [rel cdFF]        ; g
+    vpsrld ymm3, %1, %6
+    vpand ymm3, ymm3, [rel cdFF]        ; b
+    ; y
+    vpslld %2, ymm3, 16
+    vpor %2, %2, ymm1                   ; r | b << 16
+    vpmaddwd %2, %2, [rel cwy_rb]
+    vpslld ymm7, ymm2, 16
+    vpor ymm7, ymm7, ymm2               ; g | g << 16
+    vpmaddwd ymm7, ymm7, [rel cwy_gg]
+    vpaddd %2, %2, ymm7
+    vpsrad %2, %2, 16
+    ; u
+    vpslld %4, ymm2, 16
+    vpor %4, %4, ymm1                   ; r | g << 16
+    vpmaddwd %3, %4, [rel cwu_rg]
+    vpslld ymm7, ymm3, 16
+    vpor ymm7, ymm7, ymm3               ; b | b << 16
+    vpmaddwd ymm7, ymm7, [rel cwu_bb]
+    vpaddd %3, %3, ymm7
+    vpsrad %3, %3, 16
+    vpaddd %3, %3, [rel cd128]
+    ; v
+    vpmaddwd %4, %4, [rel cwv_rg]
+    vpmaddwd ymm3, ymm3, [rel cwv_b0]
+    vpaddd %4, %4, ymm3
+    vpsrad %4, %4, 16
+    vpaddd %4, %4, [rel cd128]
+%endmacro
+
+; 16 pixels in ymm0 and ymm11 to rdx, rcx, r8
+; %1 r shift, %2 b shift
+%macro YUV_OUT16 2
+    RGB_TO_YUV8 ymm0, ymm4, ymm5, ymm6, %1, %2
+    RGB_TO_YUV8 ymm11, ymm8, ymm9, ymm10, %1, %2
+    ; clamp to 0 - 255 and store 16 of each
+    vpackssdw ymm4, ymm4, ymm8
+    vpackuswb ymm4, ymm4, ymm4
+    vpermd ymm4, ymm12, ymm4
+    vmovdqu [rdx], xmm4
+    vpackssdw ymm5, ymm5, ymm9
+    vpackuswb ymm5, ymm5, ymm5
+    vpermd ymm5, ymm12, ymm5
+    vmovdqu [rcx], xmm5
+    vpackssdw ymm6, ymm6, ymm10
+    vpackuswb ymm6, ymm6, ymm6
+    vpermd ymm6, ymm12, ymm6
+    vmovdqu [r8], xmm6
+%endmacro
+
+; 64x64 tile
+; rdi src, rsi stride, rdx y, rcx u, r8 v, r9 a or 0
+; %1 r shift, %2 b shift
+%macro TILE_32 2
+    vmovdqu ymm12, [rel cdorder]
+    mov eax, 64
+%%loop_y:
+    mov r10, rdi
+    mov r11d, 4
+%%loop_x:
+    vmovdqu ymm0, [r10]
+    vmovdqu ymm11, [r10 + 32]
+    YUV_OUT16 %1, %2
+    test r9, r9
+    jz %%no_a
+    vpsrld ymm0, ymm0, 24
+    vpsrld ymm11, ymm11, 24
+    vpackssdw ymm0, ymm0, ymm11
+    vpackuswb ymm0, ymm0, ymm0
+    vpermd ymm0, ymm12, ymm0
+    vmovdqu [r9], xmm0
+    lea r9, [r9 + 16]
+%%no_a:
+    ; move right
+    lea r10, [r10 + 16 * 4]
+    lea rdx, [rdx + 16]
+    lea rcx, [rcx + 16]
+    lea r8, [r8 + 16]
+    dec r11d
+    jnz %%loop_x
+    ; move down
+    add rdi, rsi
+    dec eax
+    jnz %%loop_y
+%endmacro
+
+; 64x64 tile
+; rdi src, rsi stride, rdx y, rcx u, r8 v, r9 not used
+; %1 r shift, %2 b shift
+%macro TILE_24 2
+    vmovdqu ymm12, [rel cdorder]
+    vmovdqu ymm13, [rel cbpix]
+    mov eax, 64
+%%loop_y:
+    mov r10, rdi
+    mov r11d, 4
+%%loop_x:
+    ; 48 bytes, each lane loads 16 bytes and uses 12 so not to read
+    ; past the row
+    vmovdqu xmm0, [r10]
+    vinserti128 ymm0, ymm0, [r10 + 8], 1
+    vpshufb ymm0, ymm0, ymm13
+    vmovdqu xmm11, [r10 + 24]
+    vinserti128 ymm11, ymm11, [r10 + 32], 1
+    vpshufb ymm11, ymm11, ymm13
+    YUV_OUT16 %1, %2
+    ; move right
+    lea r10, [r10 + 16 * 3]
+    lea rdx, [rdx + 16]
+    lea rcx, [rcx + 16]
+    lea r8, [r8 + 16]
+    dec r11d
+    jnz %%loop_x
+    ; move down
+    add rdi, rsi
+    dec eax
+    jnz %%loop_y
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_bgra_to_yuv_amd64_avx2(const char *bgra_data,
+;                                       int stride_bytes,
+;                                       unsigned char *y_buffer,
+;                                       unsigned char *u_buffer,
+;                                       unsigned char *v_buffer,
+;                                       unsigned char *a_buffer);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_bgra_to_yuv_amd64_avx2
+%else
+PROC _rfxcodec_encode_bgra_to_yuv_amd64_avx2
+%endif
+    movsxd rsi, esi
+    TILE_32 16, 0
+    vzeroupper
+    mov rax, 0
+    ret
+    align 16
+
+;int
+;rfxcodec_encode_rgba_to_yuv_amd64_avx2(const char *rgba_data,
+;                                       int stride_bytes,
+;                                       unsigned char *y_buffer,
+;                                       unsigned char *u_buffer,
+;                                       unsigned char *v_buffer,
+;                                       unsigned char *a_buffer);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_rgba_to_yuv_amd64_avx2
+%else
+PROC _rfxcodec_encode_rgba_to_yuv_amd64_avx2
+%endif
+    movsxd rsi, esi
+    TILE_32 0, 16
+    vzeroupper
+    mov rax, 0
+    ret
+    align 16
+
+;int
+;rfxcodec_encode_bgr_to_yuv_amd64_avx2(const char *bgr_data,
+;                                      int stride_bytes,
+;                                      unsigned char *y_buffer,
+;                                      unsigned char *u_buffer,
+;                                      unsigned char *v_buffer,
+;                                      unsigned char *a_buffer);
+;a_buffer is not used
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_bgr_to_yuv_amd64_avx2
+%else
+PROC _rfxcodec_encode_bgr_to_yuv_amd64_avx2
+%endif
+    movsxd rsi, esi
+    TILE_24 16, 0
+    vzeroupper
+    mov rax, 0
+    ret
+    align 16
+
+;int
+;rfxcodec_encode_rgb_to_yuv_amd64_avx2(const char *rgb_data,
+;                                      int stride_bytes,
+;                                      unsigned char *y_buffer,
+;                                      unsigned char *u_buffer,
+;                                      unsigned char *v_buffer,
+;                                      unsigned char *a_buffer);
+;a_buffer is not used
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_rgb_to_yuv_amd64_avx2
+%else
+PROC _rfxcodec_encode_rgb_to_yuv_amd64_avx2
+%endif
+    movsxd rsi, esi
+    TILE_24 0, 16
+    vzeroupper
+    mov rax, 0
+    ret
+    align 16
+
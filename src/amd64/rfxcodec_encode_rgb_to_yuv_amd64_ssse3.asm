@@ -0,0 +1,185 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm 24 bpp to yuv, 64x64 tile, ssse3
+;
+;same math as rfx_encode_rgb_to_yuv
+;y = (r *  19595 + g *  38470 + b *   7471) >> 16
+;u = (r * -11071 + g * -21736 + b *  32807) >> 16
+;v = (r *  32756 + g * -27429 + b *  -5327) >> 16
+;38470 and 32807 do not fit in a signed word so g and b are put in both
+;words of the dword and multiplied by half each
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .data
+    align 16
+    cdFF     times 4 dd 255
+    cd128    times 4 dd 128
+    cwy_rb   times 4 dw 19595, 7471
+    cwy_gg   times 4 dw 19235, 19235
+    cwu_rg   times 4 dw -11071, -21736
+    cwu_bb   times 4 dw 16404, 16403
+    cwv_rg   times 4 dw 32756, -27429
+    cwv_b0   times 4 dw -5327, 0
+    ; 3 byte pixels to dwords, 4 pixels from byte 0 and from byte 4
+    cbpix0   db 0, 1, 2, 128, 3, 4, 5, 128, 6, 7, 8, 128, 9, 10, 11, 128
+    cbpix4   db 4, 5, 6, 128, 7, 8, 9, 128, 10, 11, 12, 128, 13, 14, 15, 128
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 4 pixels, one in each dword, to 4 y, u, v dwords
+; %1 pixels, %2 y, %3 u, %4 v, %5 r shift, %6 b shift
+; uses xmm1, xmm2, xmm3, xmm7
+%macro RGB_TO_YUV4 6
+    movdqa xmm1, %1
+    psrld xmm1, %5
+    pand xmm1, [rel cdFF]               ; r
+    movdqa xmm2, %1
+    psrld xmm2, 8
+    pand xmm2, [rel cdFF]               ; g
+    movdqa xmm3, %1
+    psrld xmm3, %6
+    pand xmm3, [rel cdFF]               ; b
+    ; y
+    movdqa %2, xmm3
+    pslld %2, 16
+    por %2, xmm1                        ; r | b << 16
+    pmaddwd %2, [rel cwy_rb]
+    movdqa xmm7, xmm2
+    pslld xmm7, 16
+    por xmm7, xmm2                      ; g | g << 16
+    pmaddwd xmm7, [rel cwy_gg]
+    paddd %2, xmm7
+    psrad %2, 16
+    ; u
+    movdqa %3, xmm2
+    pslld %3, 16
+    por %3, xmm1                        ; r | g << 16
+    movdqa %4, %3
+    pmaddwd %3, [rel cwu_rg]
+    movdqa xmm7, xmm3
+    pslld xmm7, 16
+    por xmm7, xmm3                      ; b | b << 16
+    pmaddwd xmm7, [rel cwu_bb]
+    paddd %3, xmm7
+    psrad %3, 16
+    paddd %3, [rel cd128]
+    ; v
+    pmaddwd %4, [rel cwv_rg]
+    pmaddwd xmm3, [rel cwv_b0]
+    paddd %4, xmm3
+    psrad %4, 16
+    paddd %4, [rel cd128]
+%endmacro
+
+; 64x64 tile
+; rdi src, rsi stride, rdx y, rcx u, r8 v, r9 not used
+; %1 r shift, %2 b shift
+%macro TILE_24 2
+    movdqa xmm12, [rel cbpix0]
+    movdqa xmm13, [rel cbpix4]
+    mov eax, 64
+%%loop_y:
+    mov r10, rdi
+    mov r11d, 8
+%%loop_x:
+    ; 24 bytes, load 0 - 15 and 8 - 23 so not to read past the row
+    movdqu xmm0, [r10]
+    movdqu xmm11, [r10 + 8]
+    pshufb xmm0, xmm12
+    pshufb xmm11, xmm13
+    RGB_TO_YUV4 xmm0, xmm4, xmm5, xmm6, %1, %2
+    RGB_TO_YUV4 xmm11, xmm8, xmm9, xmm10, %1, %2
+    ; clamp to 0 - 255 and store 8 of each
+    packssdw xmm4, xmm8
+    packuswb xmm4, xmm4
+    movq [rdx], xmm4
+    packssdw xmm5, xmm9
+    packuswb xmm5, xmm5
+    movq [rcx], xmm5
+    packssdw xmm6, xmm10
+    packuswb xmm6, xmm6
+    movq [r8], xmm6
+    ; move right
+    lea r10, [r10 + 8 * 3]
+    lea rdx, [rdx + 8]
+    lea rcx, [rcx + 8]
+    lea r8, [r8 + 8]
+    dec r11d
+    jnz %%loop_x
+    ; move down
+    add rdi, rsi
+    dec eax
+    jnz %%loop_y
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_bgr_to_yuv_amd64_ssse3(const char *bgr_data,
+;                                       int stride_bytes,
+;                                       unsigned char *y_buffer,
+;                                       unsigned char *u_buffer,
+;                                       unsigned char *v_buffer,
+;                                       unsigned char *a_buffer);
+;a_buffer is not used
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_bgr_to_yuv_amd64_ssse3
+%else
+PROC _rfxcodec_encode_bgr_to_yuv_amd64_ssse3
+%endif
+    movsxd rsi, esi
+    TILE_24 16, 0
+    mov rax, 0
+    ret
+    align 16
+
+;int
+;rfxcodec_encode_rgb_to_yuv_amd64_ssse3(const char *rgb_data,
+;                                       int stride_bytes,
+;                                       unsigned char *y_buffer,
+;                                       unsigned char *u_buffer,
+;                                       unsigned char *v_buffer,
+;                                       unsigned char *a_buffer);
+;a_buffer is not used
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_rgb_to_yuv_amd64_ssse3
+%else
+PROC _rfxcodec_encode_rgb_to_yuv_amd64_ssse3
+%endif
+    movsxd rsi, esi
+    TILE_24 0, 16
+    mov rax, 0
+    ret
+    align 16
+
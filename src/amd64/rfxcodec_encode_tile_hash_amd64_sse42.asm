@@ -0,0 +1,90 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm crc32c tile hash
+;
+;same result as rfx_tile_hash, each 32 bytes of a row are split over 4
+;crc32 so they do not wait on each other, the 4 are folded at the end
+;row_bytes must be a multiple of 32
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_tile_hash_amd64_sse42(const char *data,
+;                                      int row_bytes,
+;                                      int rows,
+;                                      int stride_bytes,
+;                                      unsigned int *hash);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_tile_hash_amd64_sse42
+%else
+PROC _rfxcodec_encode_tile_hash_amd64_sse42
+%endif
+    push r12
+    movsxd rsi, esi
+    movsxd rcx, ecx
+    mov eax, 0xFFFFFFFF
+    mov r9d, eax
+    mov r10d, eax
+    mov r11d, eax
+    sub rcx, rsi                        ; stride_bytes - row_bytes
+    shr rsi, 5                          ; 32 byte blocks in a row
+    test edx, edx
+    jle .done
+.loop_y:
+    mov r12, rsi
+    test r12, r12
+    jz .next_y
+.loop_x:
+    crc32 rax, qword [rdi]
+    crc32 r9, qword [rdi + 8]
+    crc32 r10, qword [rdi + 16]
+    crc32 r11, qword [rdi + 24]
+    lea rdi, [rdi + 32]
+    dec r12
+    jnz .loop_x
+.next_y:
+    add rdi, rcx
+    dec edx
+    jnz .loop_y
+.done:
+    crc32 eax, r9d
+    crc32 eax, r10d
+    crc32 eax, r11d
+    mov [r8], eax
+    pop r12
+    mov rax, 0
+    ret
+    align 16
+
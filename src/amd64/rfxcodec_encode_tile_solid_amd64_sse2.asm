@@ -0,0 +1,104 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm solid colour check, 64x64 tile, 32 bpp
+;
+;same result as rfx_tile_solid
+;each row is xored with the first pixel and ored together, a row with a
+;bit left under the mask ends it
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .data
+    align 16
+    cdFFFFFF times 4 dd 0x00FFFFFF
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 16 pixels
+; %1 offset in the row
+; xmm0 first pixel, xmm6 or of the xors
+%macro XOR16 1
+    movdqu xmm1, [rdi + %1]
+    movdqu xmm2, [rdi + %1 + 16]
+    movdqu xmm3, [rdi + %1 + 32]
+    movdqu xmm4, [rdi + %1 + 48]
+    pxor xmm1, xmm0
+    pxor xmm2, xmm0
+    pxor xmm3, xmm0
+    pxor xmm4, xmm0
+    por xmm1, xmm2
+    por xmm3, xmm4
+    por xmm6, xmm1
+    por xmm6, xmm3
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_tile_solid_amd64_sse2(const char *data, int stride_bytes,
+;                                      int with_alpha);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_tile_solid_amd64_sse2
+%else
+PROC _rfxcodec_encode_tile_solid_amd64_sse2
+%endif
+    movsxd rsi, esi
+    movd xmm0, [rdi]
+    pshufd xmm0, xmm0, 0                ; first pixel in each dword
+    pcmpeqb xmm7, xmm7                  ; mask, all 32 bits
+    test edx, edx
+    jnz .with_alpha
+    movdqa xmm7, [rel cdFFFFFF]         ; no alpha
+.with_alpha:
+    pxor xmm5, xmm5
+    pxor xmm6, xmm6
+    mov ecx, 64
+.loop_y:
+    XOR16 0
+    XOR16 64
+    XOR16 128
+    XOR16 192
+    movdqa xmm1, xmm6
+    pand xmm1, xmm7
+    pcmpeqb xmm1, xmm5
+    pmovmskb eax, xmm1
+    cmp eax, 0xFFFF
+    jne .not_solid
+    lea rdi, [rdi + rsi]
+    dec ecx
+    jnz .loop_y
+    mov rax, 1
+    ret
+.not_solid:
+    mov rax, 0
+    ret
+    align 16
+
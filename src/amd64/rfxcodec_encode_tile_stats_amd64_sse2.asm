@@ -0,0 +1,113 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm y plane statistics, 64x64 tile
+;
+;same result as rfx_tile_stats
+;the zero and edge counts are kept in bytes, each byte gets 4 * 63 at most,
+;psadbw adds them up at the end
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .data
+    align 16
+    cb31     times 16 db 31
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 16 differences
+; %1 offset in the row
+; xmm4 sad, xmm5 zero count, xmm6 not edge count, xmm7 zero, xmm8 31
+%macro DIFF16 1
+    movdqu xmm0, [rdi + %1]
+    movdqu xmm1, [rdi + %1 + 64]
+    movdqa xmm2, xmm0
+    psubusb xmm2, xmm1
+    psubusb xmm1, xmm0
+    por xmm1, xmm2                      ; abs(below - this)
+    movdqa xmm2, xmm1
+    psadbw xmm2, xmm7
+    paddq xmm4, xmm2
+    movdqa xmm2, xmm1
+    pcmpeqb xmm2, xmm7
+    psubb xmm5, xmm2                    ; + 1 if 0
+    psubusb xmm1, xmm8
+    pcmpeqb xmm1, xmm7
+    psubb xmm6, xmm1                    ; + 1 if less than 32
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_tile_stats_amd64_sse2(const unsigned char *y_buffer,
+;                                      int *stats);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_tile_stats_amd64_sse2
+%else
+PROC _rfxcodec_encode_tile_stats_amd64_sse2
+%endif
+    pxor xmm4, xmm4
+    pxor xmm5, xmm5
+    pxor xmm6, xmm6
+    pxor xmm7, xmm7
+    movdqa xmm8, [rel cb31]
+    mov ecx, 63
+.loop_y:
+    DIFF16 0
+    DIFF16 16
+    DIFF16 32
+    DIFF16 48
+    lea rdi, [rdi + 64]
+    dec ecx
+    jnz .loop_y
+    ; add up the 2 qwords of each
+    psadbw xmm5, xmm7
+    psadbw xmm6, xmm7
+    movq rax, xmm4
+    psrldq xmm4, 8
+    movq rdx, xmm4
+    add eax, edx
+    mov [rsi], eax                      ; RFX_TILE_STATS_SAD
+    movq rax, xmm5
+    psrldq xmm5, 8
+    movq rdx, xmm5
+    add eax, edx
+    mov [rsi + 4], eax                  ; RFX_TILE_STATS_ZERO
+    movq rax, xmm6
+    psrldq xmm6, 8
+    movq rdx, xmm6
+    add eax, edx
+    mov edx, 63 * 64
+    sub edx, eax
+    mov [rsi + 8], edx                  ; RFX_TILE_STATS_EDGE
+    mov rax, 0
+    ret
+    align 16
+
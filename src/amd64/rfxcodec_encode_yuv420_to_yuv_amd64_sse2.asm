@@ -0,0 +1,163 @@
+;
+;Copyright 2016 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;amd64 asm 4:2:0 to yuv, 64x64 tile
+;
+;same result as rfx_encode_format_yuv420
+;y is copied, each u and v byte is doubled for 2 pixels and stored in 2 rows
+
+%ifidn __OUTPUT_FORMAT__,elf64
+section .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+section .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 64 rows of y
+; rdi y_data, rcx stride_bytes, r8 y_buffer
+; uses r10, r11
+%macro COPY_Y 0
+    mov r10, rdi
+    mov r11d, 64
+%%loop_y:
+    movdqu xmm0, [r10]
+    movdqu xmm1, [r10 + 16]
+    movdqu xmm2, [r10 + 32]
+    movdqu xmm3, [r10 + 48]
+    movdqu [r8], xmm0
+    movdqu [r8 + 16], xmm1
+    movdqu [r8 + 32], xmm2
+    movdqu [r8 + 48], xmm3
+    lea r10, [r10 + rcx]
+    lea r8, [r8 + 64]
+    dec r11d
+    jnz %%loop_y
+%endmacro
+
+; 8 uv pairs to 16 u and 16 v pixels in 2 rows
+; %1 offset of the uv, %2 offset in the buffers
+; xmm7 0x00FF words
+%macro UV16 2
+    movdqu xmm0, [rsi + %1]
+    movdqa xmm1, xmm0
+    pand xmm0, xmm7                     ; u in low bytes
+    psrlw xmm1, 8                       ; v in low bytes
+    movdqa xmm2, xmm0
+    movdqa xmm3, xmm1
+    psllw xmm2, 8
+    psllw xmm3, 8
+    por xmm0, xmm2                      ; u u
+    por xmm1, xmm3                      ; v v
+    movdqu [r9 + %2], xmm0
+    movdqu [r9 + %2 + 64], xmm0
+    movdqu [rax + %2], xmm1
+    movdqu [rax + %2 + 64], xmm1
+%endmacro
+
+; 16 chroma bytes to 32 pixels in 2 rows
+; %1 chroma, %2 buffer
+%macro DOUBLE16 2
+    movdqu xmm0, [%1]
+    movdqa xmm1, xmm0
+    punpcklbw xmm0, xmm0
+    punpckhbw xmm1, xmm1
+    movdqu [%2], xmm0
+    movdqu [%2 + 16], xmm1
+    movdqu [%2 + 64], xmm0
+    movdqu [%2 + 64 + 16], xmm1
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+;RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;rfxcodec_encode_nv12_to_yuv_amd64_sse2(const char *y_data,
+;                                       const char *u_data,
+;                                       const char *v_data,
+;                                       int stride_bytes,
+;                                       unsigned char *y_buffer,
+;                                       unsigned char *u_buffer,
+;                                       unsigned char *v_buffer);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_nv12_to_yuv_amd64_sse2
+%else
+PROC _rfxcodec_encode_nv12_to_yuv_amd64_sse2
+%endif
+    movsxd rcx, ecx
+    mov rax, [rsp + 8]                  ; v_buffer
+    COPY_Y
+    ; u_data is the interleaved uv, v_data is not used
+    pcmpeqw xmm7, xmm7
+    psrlw xmm7, 8
+    mov r11d, 32
+.loop_nv12:
+    UV16 0, 0
+    UV16 16, 16
+    UV16 32, 32
+    UV16 48, 48
+    lea rsi, [rsi + rcx]
+    lea r9, [r9 + 128]
+    lea rax, [rax + 128]
+    dec r11d
+    jnz .loop_nv12
+    mov rax, 0
+    ret
+    align 16
+
+;int
+;rfxcodec_encode_i420_to_yuv_amd64_sse2(const char *y_data,
+;                                       const char *u_data,
+;                                       const char *v_data,
+;                                       int stride_bytes,
+;                                       unsigned char *y_buffer,
+;                                       unsigned char *u_buffer,
+;                                       unsigned char *v_buffer);
+
+;******************************************************************************
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC rfxcodec_encode_i420_to_yuv_amd64_sse2
+%else
+PROC _rfxcodec_encode_i420_to_yuv_amd64_sse2
+%endif
+    movsxd rcx, ecx
+    mov rax, [rsp + 8]                  ; v_buffer
+    COPY_Y
+    sar rcx, 1                          ; u and v stride
+    mov r11d, 32
+.loop_i420:
+    DOUBLE16 rsi, r9
+    DOUBLE16 rsi + 16, r9 + 32
+    DOUBLE16 rdx, rax
+    DOUBLE16 rdx + 16, rax + 32
+    lea rsi, [rsi + rcx]
+    lea rdx, [rdx + rcx]
+    lea r9, [r9 + 128]
+    lea rax, [rax + 128]
+    dec r11d
+    jnz .loop_i420
+    mov rax, 0
+    ret
+    align 16
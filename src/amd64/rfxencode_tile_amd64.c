@@ -26,8 +26,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <rfxcodec_encode.h>
+
 #include "rfxcommon.h"
 #include "rfxencode.h"
+#include "rfxencode_stats.h"
 #include "rfxencode_differential.h"
 #include "rfxencode_rlgr1.h"
 #include "rfxencode_rlgr3.h"
@@ -47,13 +50,22 @@ rfx_encode_component_rlgr1_amd64_sse2(struct rfxencode *enc, const char *qtable,
                                       const uint8 *data,
                                       uint8 *buffer, int buffer_size, int *size)
 {
+    STATS_DECLARE;
+
     LLOGLN(10, ("rfx_encode_component_rlgr1_amd64_sse2:"));
+    STATS_START;
     if (rfxcodec_encode_dwt_shift_amd64_sse2(qtable, data, enc->dwt_buffer1,
                                              enc->dwt_buffer) != 0)
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DWT);
     *size = rfx_encode_diff_rlgr1(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
     return 0;
 }
 
@@ -63,13 +75,22 @@ rfx_encode_component_rlgr3_amd64_sse2(struct rfxencode *enc, const char *qtable,
                                       const uint8 *data,
                                       uint8 *buffer, int buffer_size, int *size)
 {
+    STATS_DECLARE;
+
     LLOGLN(10, ("rfx_encode_component_rlgr3_amd64_sse2:"));
+    STATS_START;
     if (rfxcodec_encode_dwt_shift_amd64_sse2(qtable, data, enc->dwt_buffer1,
                                              enc->dwt_buffer) != 0)
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DWT);
     *size = rfx_encode_diff_rlgr3(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
     return 0;
 }
 
@@ -79,13 +100,22 @@ rfx_encode_component_rlgr1_amd64_sse41(struct rfxencode *enc, const char *qtable
                                        const uint8 *data,
                                        uint8 *buffer, int buffer_size, int *size)
 {
+    STATS_DECLARE;
+
     LLOGLN(10, ("rfx_encode_component_rlgr1_amd64_sse41:"));
+    STATS_START;
     if (rfxcodec_encode_dwt_shift_amd64_sse41(qtable, data, enc->dwt_buffer1,
                                               enc->dwt_buffer) != 0)
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DWT);
     *size = rfx_encode_diff_rlgr1(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
     return 0;
 }
 
@@ -95,12 +125,127 @@ rfx_encode_component_rlgr3_amd64_sse41(struct rfxencode *enc, const char *qtable
                                        const uint8 *data,
                                        uint8 *buffer, int buffer_size, int *size)
 {
+    STATS_DECLARE;
+
     LLOGLN(10, ("rfx_encode_component_rlgr3_amd64_sse41:"));
+    STATS_START;
     if (rfxcodec_encode_dwt_shift_amd64_sse41(qtable, data, enc->dwt_buffer1,
                                               enc->dwt_buffer) != 0)
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DWT);
     *size = rfx_encode_diff_rlgr3(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_encode_component_rlgr1_amd64_avx2(struct rfxencode *enc, const char *qtable,
+                                      const uint8 *data,
+                                      uint8 *buffer, int buffer_size, int *size)
+{
+    STATS_DECLARE;
+
+    LLOGLN(10, ("rfx_encode_component_rlgr1_amd64_avx2:"));
+    STATS_START;
+    if (rfxcodec_encode_dwt_shift_amd64_avx2(qtable, data, enc->dwt_buffer1,
+                                             enc->dwt_buffer) != 0)
+    {
+        return 1;
+    }
+    STATS_LAP(enc, RFX_STATS_DWT);
+    *size = rfx_encode_diff_rlgr1(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_encode_component_rlgr3_amd64_avx2(struct rfxencode *enc, const char *qtable,
+                                      const uint8 *data,
+                                      uint8 *buffer, int buffer_size, int *size)
+{
+    STATS_DECLARE;
+
+    LLOGLN(10, ("rfx_encode_component_rlgr3_amd64_avx2:"));
+    STATS_START;
+    if (rfxcodec_encode_dwt_shift_amd64_avx2(qtable, data, enc->dwt_buffer1,
+                                             enc->dwt_buffer) != 0)
+    {
+        return 1;
+    }
+    STATS_LAP(enc, RFX_STATS_DWT);
+    *size = rfx_encode_diff_rlgr3(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_encode_component_rlgr1_amd64_avx512bw(struct rfxencode *enc,
+                                          const char *qtable,
+                                          const uint8 *data,
+                                          uint8 *buffer, int buffer_size,
+                                          int *size)
+{
+    STATS_DECLARE;
+
+    LLOGLN(10, ("rfx_encode_component_rlgr1_amd64_avx512bw:"));
+    STATS_START;
+    if (rfxcodec_encode_dwt_shift_amd64_avx512bw(qtable, data,
+                                                 enc->dwt_buffer1,
+                                                 enc->dwt_buffer) != 0)
+    {
+        return 1;
+    }
+    STATS_LAP(enc, RFX_STATS_DWT);
+    *size = rfx_encode_diff_rlgr1(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_encode_component_rlgr3_amd64_avx512bw(struct rfxencode *enc,
+                                          const char *qtable,
+                                          const uint8 *data,
+                                          uint8 *buffer, int buffer_size,
+                                          int *size)
+{
+    STATS_DECLARE;
+
+    LLOGLN(10, ("rfx_encode_component_rlgr3_amd64_avx512bw:"));
+    STATS_START;
+    if (rfxcodec_encode_dwt_shift_amd64_avx512bw(qtable, data,
+                                                 enc->dwt_buffer1,
+                                                 enc->dwt_buffer) != 0)
+    {
+        return 1;
+    }
+    STATS_LAP(enc, RFX_STATS_DWT);
+    *size = rfx_encode_diff_rlgr3(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
     return 0;
 }
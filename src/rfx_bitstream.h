@@ -28,6 +28,7 @@ struct _RFX_BITSTREAM
     int nbytes;
     int byte_pos;
     int bits_left;
+    int overflow; /* put_bits ran out of buffer */
 };
 typedef struct _RFX_BITSTREAM RFX_BITSTREAM;
 
@@ -35,7 +36,8 @@ typedef struct _RFX_BITSTREAM RFX_BITSTREAM;
     bs.buffer = (uint8 *) (_buffer); \
     bs.nbytes = (_nbytes); \
     bs.byte_pos = 0; \
-    bs.bits_left = 8; } while (0)
+    bs.bits_left = 8; \
+    bs.overflow = 0; } while (0)
 
 #define rfx_bitstream_get_bits(bs, _nbits, _r) do { \
     int nbits = _nbits; \
@@ -77,7 +79,9 @@ typedef struct _RFX_BITSTREAM RFX_BITSTREAM;
             bs.bits_left = 8; \
             bs.byte_pos++; \
         } \
-    } } while (0)
+    } \
+    if (nbits > 0) \
+        bs.overflow = 1; } while (0)
 
 #define rfx_bitstream_eos(_bs) ((_bs).byte_pos >= (_bs).nbytes)
 #define rfx_bitstream_left(_bs) ((_bs).byte_pos >= (_bs).nbytes ? 0 : ((_bs).nbytes - (_bs).byte_pos - 1) * 8 + (_bs)->bits_left)
@@ -25,12 +25,19 @@
 
 #define DWT_FACTOR 5
 
+/* rfxcodec_encode_create and rfxcodec_decode_create print what they pick
+   unless _flags has RFX_FLAGS_QUIET */
+#define CREATE_LOG(_flags, _args) \
+    do { if (((_flags) & RFX_FLAGS_QUIET) == 0) { printf _args ; } } while (0)
+
 typedef signed char sint8;
 typedef unsigned char uint8;
 typedef signed short sint16;
 typedef unsigned short uint16;
 typedef signed int sint32;
 typedef unsigned int uint32;
+typedef signed long long sint64;
+typedef unsigned long long uint64;
 
 struct _STREAM
 {
@@ -127,4 +134,32 @@ typedef struct _STREAM STREAM;
 } while (0)
 #endif
 
+/*
+  index of the lowest set bit of a 64 bit value, _in not 0
+  GCC has __builtin_ctzll, TZCNT or BSF on x86/x64, RBIT and CLZ on ARM
+  Visual C++ has _BitScanForward64 on 64 bit targets
+*/
+#if defined(__GNUC__)
+#define GBSF64(_in, _r) do { \
+    _r = __builtin_ctzll(_in); \
+} while (0)
+#elif defined(_MSC_VER) && (_MSC_VER > 1000) && defined(_WIN64)
+#define GBSF64(_in, _r) do { \
+    unsigned long rv = 0; \
+    _BitScanForward64(&rv, _in); \
+    _r = rv; \
+} while (0)
+#else
+#define GBSF64(_in, _r) do { \
+    int rv = 0; \
+    unsigned long long x = _in; \
+    while ((x & 1) == 0) \
+    { \
+        rv++; \
+        x = x >> 1; \
+    } \
+    _r = rv; \
+} while (0)
+#endif
+
 #endif
@@ -32,6 +32,14 @@
 #include "rfxencode.h"
 #include "rfxconstants.h"
 #include "rfxencode_tile.h"
+#include "rfxencode_rlgr1.h"
+#include "rfxencode_rlgr3.h"
+#include "rfxencode_alpha.h"
+#include "rfxcompose.h"
+#include "rfxencode_threads.h"
+#include "rfxencode_hash.h"
+#include "rfxencode_cache.h"
+#include "rfxencode_quant_adaptive.h"
 
 #define LLOG_LEVEL 1
 #define LLOGLN(_level, _args) \
@@ -45,13 +53,29 @@ static const unsigned char g_rfx_default_quantization_values[] =
     0x66, 0x66, 0x77, 0x88, 0x98
 };
 
+/******************************************************************************/
+/* the quant values a tileset uses for quants */
+const char *
+rfx_compose_quant_vals(const char *quants, int flags)
+{
+    if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
+    {
+        return (const char *) g_rfx_adaptive_quantization_values;
+    }
+    if (quants == 0)
+    {
+        return (const char *) g_rfx_default_quantization_values;
+    }
+    return quants;
+}
+
 /******************************************************************************/
 static int
 rfx_compose_message_sync(struct rfxencode *enc, STREAM *s)
 {
     if (stream_get_left(s) < 12)
     {
-        return 1;
+        return RFX_ERROR_OVERFLOW;
     }
     stream_write_uint16(s, WBT_SYNC); /* BlockT.blockType */
     stream_write_uint32(s, 12); /* BlockT.blockLen */
@@ -69,7 +93,7 @@ rfx_compose_message_context(struct rfxencode *enc, STREAM *s)
 
     if (stream_get_left(s) < 13)
     {
-        return 1;
+        return RFX_ERROR_OVERFLOW;
     }
     stream_write_uint16(s, WBT_CONTEXT); /* CodecChannelT.blockType */
     stream_write_uint32(s, 13); /* CodecChannelT.blockLen */
@@ -105,7 +129,7 @@ rfx_compose_message_codec_versions(struct rfxencode *enc, STREAM *s)
 {
     if (stream_get_left(s) < 10)
     {
-        return 1;
+        return RFX_ERROR_OVERFLOW;
     }
     stream_write_uint16(s, WBT_CODEC_VERSIONS); /* BlockT.blockType */
     stream_write_uint32(s, 10); /* BlockT.blockLen */
@@ -121,7 +145,7 @@ rfx_compose_message_channels(struct rfxencode *enc, STREAM *s)
 {
     if (stream_get_left(s) < 12)
     {
-        return 1;
+        return RFX_ERROR_OVERFLOW;
     }
     stream_write_uint16(s, WBT_CHANNELS); /* BlockT.blockType */
     stream_write_uint32(s, 12); /* BlockT.blockLen */
@@ -132,25 +156,40 @@ rfx_compose_message_channels(struct rfxencode *enc, STREAM *s)
     return 0;
 }
 
+/******************************************************************************/
+/* the header goes with the first frame, after rfxcodec_encode_reset and
+   with RFX_FLAGS_HEADER */
+int
+rfx_compose_header_pending(struct rfxencode *enc, int flags)
+{
+    return (enc->header_processed == 0) || (flags & RFX_FLAGS_HEADER);
+}
+
 /******************************************************************************/
 int
 rfx_compose_message_header(struct rfxencode *enc, STREAM *s)
 {
-    if (rfx_compose_message_sync(enc, s) != 0)
+    int error;
+
+    error = rfx_compose_message_sync(enc, s);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
-    if (rfx_compose_message_context(enc, s) != 0)
+    error = rfx_compose_message_context(enc, s);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
-    if (rfx_compose_message_codec_versions(enc, s) != 0)
+    error = rfx_compose_message_codec_versions(enc, s);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
-    if (rfx_compose_message_channels(enc, s) != 0)
+    error = rfx_compose_message_channels(enc, s);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     enc->header_processed = 1;
     return 0;
@@ -162,7 +201,7 @@ rfx_compose_message_frame_begin(struct rfxencode *enc, STREAM *s)
 {
     if (stream_get_left(s) < 14)
     {
-        return 1;
+        return RFX_ERROR_OVERFLOW;
     }
     stream_write_uint16(s, WBT_FRAME_BEGIN); /* CodecChannelT.blockType */
     stream_write_uint32(s, 14); /* CodecChannelT.blockLen */
@@ -185,7 +224,7 @@ rfx_compose_message_region(struct rfxencode *enc, STREAM *s,
     size = 15 + num_regions * 8;
     if (stream_get_left(s) < size)
     {
-        return 1;
+        return RFX_ERROR_OVERFLOW;
     }
     stream_write_uint16(s, WBT_REGION); /* CodecChannelT.blockType */
     stream_write_uint32(s, size); /* set CodecChannelT.blockLen later */
@@ -212,14 +251,23 @@ rfx_compose_message_tile_yuv(struct rfxencode *enc, STREAM *s,
                              int tile_width, int tile_height,
                              int stride_bytes, const char *quantVals,
                              int quantIdxY, int quantIdxCb, int quantIdxCr,
-                             int xIdx, int yIdx)
+                             int xIdx, int yIdx, int flags)
 {
+    int quant_idx[3];
     int YLen = 0;
     int CbLen = 0;
     int CrLen = 0;
     int start_pos;
     int end_pos;
+    int error;
 
+    if (stream_get_left(s) < 19)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    quant_idx[0] = quantIdxY;
+    quant_idx[1] = quantIdxCb;
+    quant_idx[2] = quantIdxCr;
     start_pos = stream_get_pos(s);
     stream_write_uint16(s, CBT_TILE); /* BlockT.blockType */
     stream_seek_uint32(s); /* set BlockT.blockLen later */
@@ -229,18 +277,21 @@ rfx_compose_message_tile_yuv(struct rfxencode *enc, STREAM *s,
     stream_write_uint16(s, xIdx);
     stream_write_uint16(s, yIdx);
     stream_seek(s, 6); /* YLen, CbLen, CrLen */
-    if (rfx_encode_yuv(enc, tile_data, tile_width, tile_height,
-                       stride_bytes,
-                       quantVals + quantIdxY * 5,
-                       quantVals + quantIdxCb * 5,
-                       quantVals + quantIdxCr * 5,
-                       s, &YLen, &CbLen, &CrLen) != 0)
+    error = rfx_encode_yuv(enc, tile_data, tile_width, tile_height,
+                           stride_bytes,
+                           quantVals, quant_idx, flags,
+                           s, &YLen, &CbLen, &CrLen);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     end_pos = stream_get_pos(s);
     stream_set_pos(s, start_pos + 2);
     stream_write_uint32(s, 19 + YLen + CbLen + CrLen); /* BlockT.blockLen */
+    /* RFX_FLAGS_QUANT_ADAPTIVE picks them in rfx_encode */
+    stream_write_uint8(s, quant_idx[0]);
+    stream_write_uint8(s, quant_idx[1]);
+    stream_write_uint8(s, quant_idx[2]);
     stream_set_pos(s, start_pos + 13);
     stream_write_uint16(s, YLen);
     stream_write_uint16(s, CbLen);
@@ -256,15 +307,24 @@ rfx_compose_message_tile_yuva(struct rfxencode *enc, STREAM *s,
                               int tile_width, int tile_height,
                               int stride_bytes, const char *quantVals,
                               int quantIdxY, int quantIdxCb, int quantIdxCr,
-                              int xIdx, int yIdx)
+                              int xIdx, int yIdx, int flags)
 {
+    int quant_idx[3];
     int YLen = 0;
     int CbLen = 0;
     int CrLen = 0;
     int ALen = 0;
     int start_pos;
     int end_pos;
+    int error;
 
+    if (stream_get_left(s) < 21)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    quant_idx[0] = quantIdxY;
+    quant_idx[1] = quantIdxCb;
+    quant_idx[2] = quantIdxCr;
     start_pos = stream_get_pos(s);
     stream_write_uint16(s, CBT_TILE); /* BlockT.blockType */
     stream_seek_uint32(s); /* set BlockT.blockLen later */
@@ -274,18 +334,21 @@ rfx_compose_message_tile_yuva(struct rfxencode *enc, STREAM *s,
     stream_write_uint16(s, xIdx);
     stream_write_uint16(s, yIdx);
     stream_seek(s, 8); /* YLen, CbLen, CrLen, ALen */
-    if (rfx_encode_yuva(enc, tile_data, tile_width, tile_height,
-                        stride_bytes,
-                        quantVals + quantIdxY * 5,
-                        quantVals + quantIdxCb * 5,
-                        quantVals + quantIdxCr * 5,
-                        s, &YLen, &CbLen, &CrLen, &ALen) != 0)
+    error = rfx_encode_yuva(enc, tile_data, tile_width, tile_height,
+                            stride_bytes,
+                            quantVals, quant_idx, flags,
+                            s, &YLen, &CbLen, &CrLen, &ALen);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     end_pos = stream_get_pos(s);
     stream_set_pos(s, start_pos + 2);
     stream_write_uint32(s, 19 + YLen + CbLen + CrLen + ALen); /* BlockT.blockLen */
+    /* RFX_FLAGS_QUANT_ADAPTIVE picks them in rfx_encode */
+    stream_write_uint8(s, quant_idx[0]);
+    stream_write_uint8(s, quant_idx[1]);
+    stream_write_uint8(s, quant_idx[2]);
     stream_set_pos(s, start_pos + 13);
     stream_write_uint16(s, YLen);
     stream_write_uint16(s, CbLen);
@@ -302,14 +365,23 @@ rfx_compose_message_tile_rgb(struct rfxencode *enc, STREAM *s,
                              int tile_width, int tile_height,
                              int stride_bytes, const char *quantVals,
                              int quantIdxY, int quantIdxCb, int quantIdxCr,
-                             int xIdx, int yIdx)
+                             int xIdx, int yIdx, int flags)
 {
+    int quant_idx[3];
     int YLen = 0;
     int CbLen = 0;
     int CrLen = 0;
     int start_pos;
     int end_pos;
+    int error;
 
+    if (stream_get_left(s) < 19)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    quant_idx[0] = quantIdxY;
+    quant_idx[1] = quantIdxCb;
+    quant_idx[2] = quantIdxCr;
     start_pos = stream_get_pos(s);
     stream_write_uint16(s, CBT_TILE); /* BlockT.blockType */
     stream_seek_uint32(s); /* set BlockT.blockLen later */
@@ -319,18 +391,21 @@ rfx_compose_message_tile_rgb(struct rfxencode *enc, STREAM *s,
     stream_write_uint16(s, xIdx);
     stream_write_uint16(s, yIdx);
     stream_seek(s, 6); /* YLen, CbLen, CrLen */
-    if (rfx_encode_rgb(enc, tile_data, tile_width, tile_height,
-                       stride_bytes,
-                       quantVals + quantIdxY * 5,
-                       quantVals + quantIdxCb * 5,
-                       quantVals + quantIdxCr * 5,
-                       s, &YLen, &CbLen, &CrLen) != 0)
+    error = rfx_encode_rgb(enc, tile_data, tile_width, tile_height,
+                           stride_bytes,
+                           quantVals, quant_idx, flags,
+                           s, &YLen, &CbLen, &CrLen);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     end_pos = stream_get_pos(s);
     stream_set_pos(s, start_pos + 2);
     stream_write_uint32(s, 19 + YLen + CbLen + CrLen); /* BlockT.blockLen */
+    /* RFX_FLAGS_QUANT_ADAPTIVE picks them in rfx_encode */
+    stream_write_uint8(s, quant_idx[0]);
+    stream_write_uint8(s, quant_idx[1]);
+    stream_write_uint8(s, quant_idx[2]);
     stream_set_pos(s, start_pos + 13);
     stream_write_uint16(s, YLen);
     stream_write_uint16(s, CbLen);
@@ -346,16 +421,25 @@ rfx_compose_message_tile_argb(struct rfxencode *enc, STREAM *s,
                               int tile_width, int tile_height,
                               int stride_bytes, const char *quantVals,
                               int quantIdxY, int quantIdxCb, int quantIdxCr,
-                              int xIdx, int yIdx)
+                              int xIdx, int yIdx, int flags)
 {
+    int quant_idx[3];
     int YLen = 0;
     int CbLen = 0;
     int CrLen = 0;
     int ALen = 0;
     int start_pos;
     int end_pos;
+    int error;
 
     LLOGLN(10, ("rfx_compose_message_tile_argb:"));
+    if (stream_get_left(s) < 21)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    quant_idx[0] = quantIdxY;
+    quant_idx[1] = quantIdxCb;
+    quant_idx[2] = quantIdxCr;
     start_pos = stream_get_pos(s);
     stream_write_uint16(s, CBT_TILE); /* BlockT.blockType */
     stream_seek_uint32(s); /* set BlockT.blockLen later */
@@ -365,19 +449,22 @@ rfx_compose_message_tile_argb(struct rfxencode *enc, STREAM *s,
     stream_write_uint16(s, xIdx);
     stream_write_uint16(s, yIdx);
     stream_seek(s, 8); /* YLen, CbLen, CrLen, ALen */
-    if (rfx_encode_argb(enc, tile_data, tile_width, tile_height,
-                        stride_bytes,
-                        quantVals + quantIdxY * 5,
-                        quantVals + quantIdxCb * 5,
-                        quantVals + quantIdxCr * 5,
-                        s, &YLen, &CbLen, &CrLen, &ALen) != 0)
+    error = rfx_encode_argb(enc, tile_data, tile_width, tile_height,
+                            stride_bytes,
+                            quantVals, quant_idx, flags,
+                            s, &YLen, &CbLen, &CrLen, &ALen);
+    if (error != 0)
     {
         LLOGLN(10, ("rfx_compose_message_tile_argb: rfx_encode_argb failed"));
-        return 1;
+        return error;
     }
     end_pos = stream_get_pos(s);
     stream_set_pos(s, start_pos + 2);
     stream_write_uint32(s, 19 + YLen + CbLen + CrLen + ALen); /* BlockT.blockLen */
+    /* RFX_FLAGS_QUANT_ADAPTIVE picks them in rfx_encode */
+    stream_write_uint8(s, quant_idx[0]);
+    stream_write_uint8(s, quant_idx[1]);
+    stream_write_uint8(s, quant_idx[2]);
     stream_set_pos(s, start_pos + 13);
     stream_write_uint16(s, YLen);
     stream_write_uint16(s, CbLen);
@@ -388,68 +475,260 @@ rfx_compose_message_tile_argb(struct rfxencode *enc, STREAM *s,
 }
 
 /******************************************************************************/
+/* RFX_FORMAT_NV12 and RFX_FORMAT_I420, with RFX_FLAGS_ALPHAV1 the tile is
+   opaque */
 static int
-rfx_compose_message_tileset(struct rfxencode *enc, STREAM *s,
-                            const char *buf, int width, int height,
-                            int stride_bytes,
-                            const struct rfx_tile *tiles, int num_tiles,
-                            const char *quants, int num_quants,
-                            int flags)
+rfx_compose_message_tile_yuv420(struct rfxencode *enc, STREAM *s,
+                                const char *buf, int x, int y,
+                                int tile_width, int tile_height,
+                                int stride_bytes, const char *quantVals,
+                                int quantIdxY, int quantIdxCb, int quantIdxCr,
+                                int flags)
 {
-    int size;
+    const char *y_data;
+    const char *u_data;
+    const char *v_data;
+    int quant_idx[3];
+    int YLen = 0;
+    int CbLen = 0;
+    int CrLen = 0;
+    int ALen = 0;
     int start_pos;
     int end_pos;
+    int error;
+
+    if (stream_get_left(s) < 21)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    rfx_encode_yuv420_data(enc, buf, stride_bytes, x, y,
+                           &y_data, &u_data, &v_data);
+    quant_idx[0] = quantIdxY;
+    quant_idx[1] = quantIdxCb;
+    quant_idx[2] = quantIdxCr;
+    start_pos = stream_get_pos(s);
+    stream_write_uint16(s, CBT_TILE); /* BlockT.blockType */
+    stream_seek_uint32(s); /* set BlockT.blockLen later */
+    stream_write_uint8(s, quantIdxY);
+    stream_write_uint8(s, quantIdxCb);
+    stream_write_uint8(s, quantIdxCr);
+    stream_write_uint16(s, x / 64);
+    stream_write_uint16(s, y / 64);
+    if (flags & RFX_FLAGS_ALPHAV1)
+    {
+        stream_seek(s, 8); /* YLen, CbLen, CrLen, ALen */
+        error = rfx_encode_yuv420a(enc, y_data, u_data, v_data,
+                                   tile_width, tile_height, stride_bytes,
+                                   quantVals, quant_idx, flags,
+                                   s, &YLen, &CbLen, &CrLen, &ALen);
+    }
+    else
+    {
+        stream_seek(s, 6); /* YLen, CbLen, CrLen */
+        error = rfx_encode_yuv420(enc, y_data, u_data, v_data,
+                                  tile_width, tile_height, stride_bytes,
+                                  quantVals, quant_idx, flags,
+                                  s, &YLen, &CbLen, &CrLen);
+    }
+    if (error != 0)
+    {
+        return error;
+    }
+    end_pos = stream_get_pos(s);
+    stream_set_pos(s, start_pos + 2);
+    stream_write_uint32(s, 19 + YLen + CbLen + CrLen + ALen); /* BlockT.blockLen */
+    /* RFX_FLAGS_QUANT_ADAPTIVE picks them in rfx_encode */
+    stream_write_uint8(s, quant_idx[0]);
+    stream_write_uint8(s, quant_idx[1]);
+    stream_write_uint8(s, quant_idx[2]);
+    stream_set_pos(s, start_pos + 13);
+    stream_write_uint16(s, YLen);
+    stream_write_uint16(s, CbLen);
+    stream_write_uint16(s, CrLen);
+    if (flags & RFX_FLAGS_ALPHAV1)
+    {
+        stream_write_uint16(s, ALen);
+    }
+    stream_set_pos(s, end_pos);
+    return 0;
+}
+
+/******************************************************************************/
+/* same as rfx_compose_message_tiles but tiles found in enc->tile_cache are
+   copied from it and the ones not found are added */
+static int
+rfx_compose_message_tiles_cached(struct rfxencode *enc, STREAM *s,
+                                 const char *buf, int stride_bytes,
+                                 const struct rfx_tile *tiles, int num_tiles,
+                                 const char *quantVals, int flags)
+{
+    struct rfx_cache_key key;
+    struct rfx_tile_pixels pixels;
+    const struct rfx_tile *tile;
+    const char *tile_data;
     int index;
-    int numQuants;
-    const char *quantVals;
+    int start_pos;
+    int end_pos;
+    int error;
+
+    memset(&key, 0, sizeof(key));
+    key.alpha = flags & RFX_FLAGS_ALPHAV1;
+    for (index = 0; index < num_tiles; index++)
+    {
+        tile = tiles + index;
+        rfx_hash_tile(enc, buf, stride_bytes, tile, &(key.hash));
+        rfx_hash_tile_pixels(enc, buf, stride_bytes, tile, &pixels);
+        key.cx = tile->cx;
+        key.cy = tile->cy;
+        if ((flags & RFX_FLAGS_QUANT_ADAPTIVE) == 0)
+        {
+            /* with RFX_FLAGS_QUANT_ADAPTIVE the pixels decide the quants
+               and these stay 0, never a valid quant value */
+            memcpy(key.quants, quantVals + tile->quant_y * 5, 5);
+            memcpy(key.quants + 5, quantVals + tile->quant_cb * 5, 5);
+            memcpy(key.quants + 10, quantVals + tile->quant_cr * 5, 5);
+        }
+        start_pos = stream_get_pos(s);
+        if (rfx_cache_get(enc->tile_cache, &key, &pixels, s) == 0)
+        {
+            /* the cached block may be from other quant indices or
+               another position */
+            end_pos = stream_get_pos(s);
+            stream_set_pos(s, start_pos + 6);
+            if ((flags & RFX_FLAGS_QUANT_ADAPTIVE) == 0)
+            {
+                stream_write_uint8(s, tile->quant_y);
+                stream_write_uint8(s, tile->quant_cb);
+                stream_write_uint8(s, tile->quant_cr);
+            }
+            else
+            {
+                stream_seek(s, 3);
+            }
+            stream_write_uint16(s, tile->x / 64);
+            stream_write_uint16(s, tile->y / 64);
+            stream_set_pos(s, end_pos);
+            continue;
+        }
+        if ((enc->format == RFX_FORMAT_NV12) ||
+            (enc->format == RFX_FORMAT_I420))
+        {
+            error = rfx_compose_message_tile_yuv420(enc, s, buf,
+                                                    tile->x, tile->y,
+                                                    tile->cx, tile->cy,
+                                                    stride_bytes, quantVals,
+                                                    tile->quant_y, tile->quant_cb,
+                                                    tile->quant_cr, flags);
+        }
+        else if (enc->format == RFX_FORMAT_YUV)
+        {
+            tile_data = buf + (tile->y << 8) * (stride_bytes >> 8) +
+                        (tile->x << 8);
+            if (flags & RFX_FLAGS_ALPHAV1)
+            {
+                error = rfx_compose_message_tile_yuva(enc, s,
+                                                      tile_data, tile->cx, tile->cy,
+                                                      stride_bytes, quantVals,
+                                                      tile->quant_y, tile->quant_cb,
+                                                      tile->quant_cr,
+                                                      tile->x / 64, tile->y / 64,
+                                                      flags);
+            }
+            else
+            {
+                error = rfx_compose_message_tile_yuv(enc, s,
+                                                     tile_data, tile->cx, tile->cy,
+                                                     stride_bytes, quantVals,
+                                                     tile->quant_y, tile->quant_cb,
+                                                     tile->quant_cr,
+                                                     tile->x / 64, tile->y / 64,
+                                                     flags);
+            }
+        }
+        else
+        {
+            tile_data = buf + tile->y * stride_bytes +
+                        tile->x * (enc->bits_per_pixel / 8);
+            if (flags & RFX_FLAGS_ALPHAV1)
+            {
+                error = rfx_compose_message_tile_argb(enc, s,
+                                                      tile_data, tile->cx, tile->cy,
+                                                      stride_bytes, quantVals,
+                                                      tile->quant_y, tile->quant_cb,
+                                                      tile->quant_cr,
+                                                      tile->x / 64, tile->y / 64,
+                                                      flags);
+            }
+            else
+            {
+                error = rfx_compose_message_tile_rgb(enc, s,
+                                                     tile_data, tile->cx, tile->cy,
+                                                     stride_bytes, quantVals,
+                                                     tile->quant_y, tile->quant_cb,
+                                                     tile->quant_cr,
+                                                     tile->x / 64, tile->y / 64,
+                                                     flags);
+            }
+        }
+        if (error != 0)
+        {
+            return error;
+        }
+        rfx_cache_put(enc->tile_cache, &key, &pixels, s->data + start_pos,
+                      stream_get_pos(s) - start_pos);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_compose_message_tiles(struct rfxencode *enc, STREAM *s,
+                          const char *buf, int stride_bytes,
+                          const struct rfx_tile *tiles, int num_tiles,
+                          const char *quantVals, int flags)
+{
+    int index;
+    int numTiles;
     int quantIdxY;
     int quantIdxCb;
     int quantIdxCr;
-    int numTiles;
-    int tilesDataSize;
     int x;
     int y;
     int cx;
     int cy;
     const char *tile_data;
+    int error;
 
-    LLOGLN(10, ("rfx_compose_message_tileset:"));
-    if (quants == 0)
+    if (enc->tile_cache != 0)
     {
-        numQuants = 1;
-        quantVals = (const char *) g_rfx_default_quantization_values;
-    }
-    else
-    {
-        numQuants = num_quants;
-        quantVals = quants;
+        return rfx_compose_message_tiles_cached(enc, s, buf, stride_bytes,
+                                                tiles, num_tiles,
+                                                quantVals, flags);
     }
     numTiles = num_tiles;
-    size = 22 + numQuants * 5;
-    start_pos = stream_get_pos(s);
-    if (flags & RFX_FLAGS_ALPHAV1)
-    {
-        LLOGLN(10, ("rfx_compose_message_tileset: RFX_FLAGS_ALPHAV1 set"));
-        stream_write_uint16(s, WBT_EXTENSION_PLUS); /* CodecChannelT.blockType */
-    }
-    else
+    if ((enc->format == RFX_FORMAT_NV12) || (enc->format == RFX_FORMAT_I420))
     {
-        stream_write_uint16(s, WBT_EXTENSION); /* CodecChannelT.blockType */
+        for (index = 0; index < numTiles; index++)
+        {
+            x = tiles[index].x;
+            y = tiles[index].y;
+            cx = tiles[index].cx;
+            cy = tiles[index].cy;
+            quantIdxY = tiles[index].quant_y;
+            quantIdxCb = tiles[index].quant_cb;
+            quantIdxCr = tiles[index].quant_cr;
+            error = rfx_compose_message_tile_yuv420(enc, s, buf, x, y,
+                                                    cx, cy, stride_bytes,
+                                                    quantVals,
+                                                    quantIdxY, quantIdxCb, quantIdxCr,
+                                                    flags);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
     }
-    stream_seek_uint32(s); /* set CodecChannelT.blockLen later */
-    stream_write_uint8(s, 1); /* CodecChannelT.codecId */
-    stream_write_uint8(s, 0); /* CodecChannelT.channelId */
-    stream_write_uint16(s, CBT_TILESET); /* subtype */
-    stream_write_uint16(s, 0); /* idx */
-    stream_write_uint16(s, enc->properties); /* properties */
-    stream_write_uint8(s, numQuants); /* numQuants */
-    stream_write_uint8(s, 0x40); /* tileSize */
-    stream_write_uint16(s, numTiles); /* numTiles */
-    stream_seek_uint32(s); /* set tilesDataSize later */
-    memcpy(s->p, quantVals, numQuants * 5);
-    s->p += numQuants * 5;
-    end_pos = stream_get_pos(s);
-    if (enc->format == RFX_FORMAT_YUV)
+    else if (enc->format == RFX_FORMAT_YUV)
     {
         if (flags & RFX_FLAGS_ALPHAV1)
         {
@@ -463,13 +742,14 @@ rfx_compose_message_tileset(struct rfxencode *enc, STREAM *s,
                 quantIdxCb = tiles[index].quant_cb;
                 quantIdxCr = tiles[index].quant_cr;
                 tile_data = buf + (y << 8) * (stride_bytes >> 8) + (x << 8);
-                if (rfx_compose_message_tile_yuva(enc, s,
-                                                  tile_data, cx, cy, stride_bytes,
-                                                  quantVals,
-                                                  quantIdxY, quantIdxCb, quantIdxCr,
-                                                  x / 64, y / 64) != 0)
+                error = rfx_compose_message_tile_yuva(enc, s,
+                                                      tile_data, cx, cy, stride_bytes,
+                                                      quantVals,
+                                                      quantIdxY, quantIdxCb, quantIdxCr,
+                                                      x / 64, y / 64, flags);
+                if (error != 0)
                 {
-                    return 1;
+                    return error;
                 }
             }
         }
@@ -485,13 +765,14 @@ rfx_compose_message_tileset(struct rfxencode *enc, STREAM *s,
                 quantIdxCb = tiles[index].quant_cb;
                 quantIdxCr = tiles[index].quant_cr;
                 tile_data = buf + (y << 8) * (stride_bytes >> 8) + (x << 8);
-                if (rfx_compose_message_tile_yuv(enc, s,
-                                                 tile_data, cx, cy, stride_bytes,
-                                                 quantVals,
-                                                 quantIdxY, quantIdxCb, quantIdxCr,
-                                                 x / 64, y / 64) != 0)
+                error = rfx_compose_message_tile_yuv(enc, s,
+                                                     tile_data, cx, cy, stride_bytes,
+                                                     quantVals,
+                                                     quantIdxY, quantIdxCb, quantIdxCr,
+                                                     x / 64, y / 64, flags);
+                if (error != 0)
                 {
-                    return 1;
+                    return error;
                 }
             }
         }
@@ -510,13 +791,14 @@ rfx_compose_message_tileset(struct rfxencode *enc, STREAM *s,
                 quantIdxCb = tiles[index].quant_cb;
                 quantIdxCr = tiles[index].quant_cr;
                 tile_data = buf + y * stride_bytes + x * (enc->bits_per_pixel / 8);
-                if (rfx_compose_message_tile_argb(enc, s,
-                                                  tile_data, cx, cy, stride_bytes,
-                                                  quantVals,
-                                                  quantIdxY, quantIdxCb, quantIdxCr,
-                                                  x / 64, y / 64) != 0)
+                error = rfx_compose_message_tile_argb(enc, s,
+                                                      tile_data, cx, cy, stride_bytes,
+                                                      quantVals,
+                                                      quantIdxY, quantIdxCb, quantIdxCr,
+                                                      x / 64, y / 64, flags);
+                if (error != 0)
                 {
-                    return 1;
+                    return error;
                 }
             }
         }
@@ -532,17 +814,99 @@ rfx_compose_message_tileset(struct rfxencode *enc, STREAM *s,
                 quantIdxCb = tiles[index].quant_cb;
                 quantIdxCr = tiles[index].quant_cr;
                 tile_data = buf + y * stride_bytes + x * (enc->bits_per_pixel / 8);
-                if (rfx_compose_message_tile_rgb(enc, s,
-                                                 tile_data, cx, cy, stride_bytes,
-                                                 quantVals,
-                                                 quantIdxY, quantIdxCb, quantIdxCr,
-                                                 x / 64, y / 64) != 0)
+                error = rfx_compose_message_tile_rgb(enc, s,
+                                                     tile_data, cx, cy, stride_bytes,
+                                                     quantVals,
+                                                     quantIdxY, quantIdxCb, quantIdxCr,
+                                                     x / 64, y / 64, flags);
+                if (error != 0)
                 {
-                    return 1;
+                    return error;
                 }
             }
         }
     }
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rfx_compose_message_tileset(struct rfxencode *enc, STREAM *s,
+                            const char *buf, int width, int height,
+                            int stride_bytes,
+                            const struct rfx_tile *tiles, int num_tiles,
+                            const char *quants, int num_quants,
+                            int flags)
+{
+    int size;
+    int start_pos;
+    int end_pos;
+    int numQuants;
+    const char *quantVals;
+    int numTiles;
+    int tilesDataSize;
+    int error;
+
+    LLOGLN(10, ("rfx_compose_message_tileset:"));
+    if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
+    {
+        numQuants = RFX_ADAPTIVE_NUM_QUANTS;
+    }
+    else
+    {
+        numQuants = (quants == 0) ? 1 : num_quants;
+    }
+    quantVals = rfx_compose_quant_vals(quants, flags);
+    numTiles = num_tiles;
+    size = 22 + numQuants * 5;
+    if (stream_get_left(s) < size)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    start_pos = stream_get_pos(s);
+    if (flags & RFX_FLAGS_ALPHAV1)
+    {
+        LLOGLN(10, ("rfx_compose_message_tileset: RFX_FLAGS_ALPHAV1 set"));
+        stream_write_uint16(s, WBT_EXTENSION_PLUS); /* CodecChannelT.blockType */
+    }
+    else
+    {
+        stream_write_uint16(s, WBT_EXTENSION); /* CodecChannelT.blockType */
+    }
+    stream_seek_uint32(s); /* set CodecChannelT.blockLen later */
+    stream_write_uint8(s, 1); /* CodecChannelT.codecId */
+    stream_write_uint8(s, 0); /* CodecChannelT.channelId */
+    stream_write_uint16(s, CBT_TILESET); /* subtype */
+    stream_write_uint16(s, 0); /* idx */
+    stream_write_uint16(s, enc->properties); /* properties */
+    stream_write_uint8(s, numQuants); /* numQuants */
+    stream_write_uint8(s, 0x40); /* tileSize */
+    stream_write_uint16(s, numTiles); /* numTiles */
+    stream_seek_uint32(s); /* set tilesDataSize later */
+    memcpy(s->p, quantVals, numQuants * 5);
+    s->p += numQuants * 5;
+    end_pos = stream_get_pos(s);
+    if (enc->batch_pool != 0)
+    {
+        /* already encoded by rfxcodec_encode_batch */
+        error = rfx_threads_batch_copy(enc, s);
+    }
+    else if (enc->threads != 0 && numTiles > 1)
+    {
+        error = rfx_threads_compose_tiles(enc, s, buf, stride_bytes,
+                                          tiles, numTiles,
+                                          quantVals, flags);
+    }
+    else
+    {
+        error = rfx_compose_message_tiles(enc, s, buf, stride_bytes,
+                                          tiles, numTiles,
+                                          quantVals, flags);
+    }
+    if (error != 0)
+    {
+        return error;
+    }
     tilesDataSize = stream_get_pos(s) - end_pos;
     size += tilesDataSize;
     end_pos = stream_get_pos(s);
@@ -560,7 +924,7 @@ rfx_compose_message_frame_end(struct rfxencode *enc, STREAM *s)
 {
     if (stream_get_left(s) < 8)
     {
-        return 1;
+        return RFX_ERROR_OVERFLOW;
     }
     stream_write_uint16(s, WBT_FRAME_END); /* CodecChannelT.blockType */
     stream_write_uint32(s, 8); /* CodecChannelT.blockLen */
@@ -578,23 +942,102 @@ rfx_compose_message_data(struct rfxencode *enc, STREAM *s,
                          const struct rfx_tile *tiles, int num_tiles,
                          const char *quants, int num_quants, int flags)
 {
-    if (rfx_compose_message_frame_begin(enc, s) != 0)
+    int error;
+
+    error = rfx_compose_message_frame_begin(enc, s);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
-    if (rfx_compose_message_region(enc, s, regions, num_regions) != 0)
+    error = rfx_compose_message_region(enc, s, regions, num_regions);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
-    if (rfx_compose_message_tileset(enc, s, buf, width, height, stride_bytes,
-                                    tiles, num_tiles, quants, num_quants,
-                                    flags) != 0)
+    error = rfx_compose_message_tileset(enc, s, buf, width, height,
+                                        stride_bytes, tiles, num_tiles,
+                                        quants, num_quants, flags);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
-    if (rfx_compose_message_frame_end(enc, s) != 0)
+    error = rfx_compose_message_frame_end(enc, s);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     return 0;
 }
+
+/******************************************************************************/
+/* most bytes one tile block can take */
+int
+rfx_compose_tile_bound(struct rfxencode *enc, int flags)
+{
+    int bytes;
+
+    if (enc->mode == RLGR1)
+    {
+        bytes = 3 * RFX_MAX_RLGR1_BYTES;
+    }
+    else
+    {
+        bytes = 3 * RFX_MAX_RLGR3_BYTES;
+    }
+    if (flags & RFX_FLAGS_ALPHAV1)
+    {
+        return 21 + bytes + RFX_MAX_ALPHA_BYTES;
+    }
+    return 19 + bytes;
+}
+
+/******************************************************************************/
+/* bytes rfx_compose_message_data writes that are not tiles */
+int
+rfx_compose_frame_bound(struct rfxencode *enc, int num_regions,
+                        int num_quants, int flags)
+{
+    int bytes;
+
+    if (enc->rate != 0)
+    {
+        num_quants = 2; /* rfx_rate_tiles */
+    }
+    else if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
+    {
+        num_quants = RFX_ADAPTIVE_NUM_QUANTS;
+    }
+    else if (num_quants < 1)
+    {
+        num_quants = 1; /* g_rfx_default_quantization_values */
+    }
+    bytes = 14; /* frame begin */
+    bytes += 15 + num_regions * 8; /* region */
+    bytes += 22 + num_quants * 5; /* tileset */
+    bytes += 8; /* frame end */
+    return bytes;
+}
+
+/******************************************************************************/
+/* most bytes rfx_compose_message_header, if it is still to be sent, and
+   rfx_compose_message_data can write, -1 if that does not fit in an int */
+int
+rfx_compose_message_bound(struct rfxencode *enc, int num_tiles,
+                          int num_regions, int num_quants, int flags)
+{
+    int bytes;
+    int tile_bytes;
+
+    bytes = 0;
+    if (rfx_compose_header_pending(enc, flags))
+    {
+        bytes += 12 + 13 + 10 + 12; /* sync, context, versions, channels */
+    }
+    bytes += rfx_compose_frame_bound(enc, num_regions, num_quants, flags);
+    tile_bytes = rfx_compose_tile_bound(enc, flags);
+    if (num_tiles > (0x7FFFFFFF - bytes) / tile_bytes)
+    {
+        return -1;
+    }
+    return bytes + num_tiles * tile_bytes;
+}
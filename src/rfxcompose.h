@@ -21,6 +21,8 @@
 
 #include "rfxcommon.h"
 
+int
+rfx_compose_header_pending(struct rfxencode *enc, int flags);
 int
 rfx_compose_message_header(struct rfxencode *enc, STREAM *s);
 int
@@ -30,5 +32,20 @@ rfx_compose_message_data(struct rfxencode *enc, STREAM *s,
                          int stride_bytes,
                          const struct rfx_tile *tiles, int num_tiles,
                          const char *quants, int num_quants, int flags);
+int
+rfx_compose_message_tiles(struct rfxencode *enc, STREAM *s,
+                          const char *buf, int stride_bytes,
+                          const struct rfx_tile *tiles, int num_tiles,
+                          const char *quantVals, int flags);
+const char *
+rfx_compose_quant_vals(const char *quants, int flags);
+int
+rfx_compose_tile_bound(struct rfxencode *enc, int flags);
+int
+rfx_compose_frame_bound(struct rfxencode *enc, int num_regions,
+                        int num_quants, int flags);
+int
+rfx_compose_message_bound(struct rfxencode *enc, int num_tiles,
+                          int num_regions, int num_quants, int flags);
 
 #endif
@@ -44,6 +44,19 @@ enum _RLGR_MODE
 #define CBT_TILESET             0xCAC2
 #define CBT_TILE                0xCAC3
 
+/* RemoteFX progressive blockType, MS-RDPEGFX */
+#define PROGRESSIVE_WBT_SYNC          0xCCC0
+#define PROGRESSIVE_WBT_FRAME_BEGIN   0xCCC1
+#define PROGRESSIVE_WBT_FRAME_END     0xCCC2
+#define PROGRESSIVE_WBT_CONTEXT       0xCCC3
+#define PROGRESSIVE_WBT_REGION        0xCCC4
+#define PROGRESSIVE_WBT_TILE_SIMPLE   0xCCC5
+#define PROGRESSIVE_WBT_TILE_FIRST    0xCCC6
+#define PROGRESSIVE_WBT_TILE_UPGRADE  0xCCC7
+
+/* RFX_PROGRESSIVE_REGION flags */
+#define RFX_DWT_REDUCE_EXTRAPOLATE    0x01
+
 /* tileSize */
 #define CT_TILE_64x64           0x0040
 
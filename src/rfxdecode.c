@@ -0,0 +1,187 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rfxcodec_encode.h>
+#include <rfxcodec_decode.h>
+
+#include "rfxcommon.h"
+#include "rfxdecode.h"
+#include "rfxparse.h"
+#include "rfxconstants.h"
+#include "rfxdecode_tile.h"
+
+#ifdef RFX_USE_ACCEL_AMD64
+#include "amd64/funcs_amd64.h"
+#endif
+
+/******************************************************************************/
+int
+rfxcodec_decode_create(int width, int height, int format, int flags,
+                       void **handle)
+{
+    struct rfxdecode *dec;
+    void *scratch;
+    int ax;
+    int bx;
+    int cx;
+    int dx;
+
+    dec = (struct rfxdecode *) calloc(1, sizeof(struct rfxdecode));
+    if (dec == 0)
+    {
+        return 1;
+    }
+    if (posix_memalign(&scratch, 64, RFX_DECODE_SCRATCH_BYTES) != 0)
+    {
+        free(dec);
+        return 1;
+    }
+    memset(scratch, 0, RFX_DECODE_SCRATCH_BYTES);
+    dec->scratch = (uint8 *) scratch;
+    dec->a_buffer = dec->scratch;
+    dec->y_buffer = (sint16 *) (dec->scratch + 4096);
+    dec->u_buffer = (sint16 *) (dec->scratch + 3 * 4096);
+    dec->v_buffer = (sint16 *) (dec->scratch + 5 * 4096);
+    dec->dwt_buffer = (sint16 *) (dec->scratch + 7 * 4096);
+    dec->rgb_buffer = (char *) (dec->scratch + 9 * 4096);
+
+#if defined(RFX_USE_ACCEL_AMD64)
+    cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
+#else
+    ax = 0;
+    bx = 0;
+    cx = 0;
+    dx = 0;
+#endif
+    if (dx & (1 << 26)) /* SSE 2 */
+    {
+        CREATE_LOG(flags, ("rfxcodec_decode_create: got sse2\n"));
+        dec->got_sse2 = 1;
+    }
+
+    dec->width = width;
+    dec->height = height;
+    dec->flags = flags;
+    dec->mode = RLGR3;
+    if (flags & RFX_FLAGS_RLGR1)
+    {
+        dec->mode = RLGR1;
+    }
+    switch (format)
+    {
+        case RFX_FORMAT_BGRA:
+            dec->bits_per_pixel = 32;
+            dec->rfx_yuv_to_rgb = rfx_decode_yuv_to_bgra;
+            break;
+        case RFX_FORMAT_RGBA:
+            dec->bits_per_pixel = 32;
+            dec->rfx_yuv_to_rgb = rfx_decode_yuv_to_rgba;
+            break;
+        case RFX_FORMAT_BGR:
+            dec->bits_per_pixel = 24;
+            dec->rfx_yuv_to_rgb = rfx_decode_yuv_to_bgr;
+            break;
+        case RFX_FORMAT_RGB:
+            dec->bits_per_pixel = 24;
+            dec->rfx_yuv_to_rgb = rfx_decode_yuv_to_rgb24;
+            break;
+        default:
+            free(dec->scratch);
+            free(dec);
+            return 2;
+    }
+    dec->format = format;
+    dec->rfx_idwt_shift = rfx_decode_idwt_shift;
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (((flags & RFX_FLAGS_NOACCEL) == 0) && dec->got_sse2)
+    {
+        CREATE_LOG(flags, ("rfxcodec_decode_create: rfx_idwt_shift set to rfxcodec_decode_idwt_shift_amd64_sse2\n"));
+        dec->rfx_idwt_shift = rfxcodec_decode_idwt_shift_amd64_sse2;
+        switch (format)
+        {
+            case RFX_FORMAT_BGRA:
+                CREATE_LOG(flags, ("rfxcodec_decode_create: rfx_yuv_to_rgb set to rfxcodec_decode_yuv_to_bgra_amd64_sse2\n"));
+                dec->rfx_yuv_to_rgb = rfxcodec_decode_yuv_to_bgra_amd64_sse2;
+                break;
+            case RFX_FORMAT_RGBA:
+                CREATE_LOG(flags, ("rfxcodec_decode_create: rfx_yuv_to_rgb set to rfxcodec_decode_yuv_to_rgba_amd64_sse2\n"));
+                dec->rfx_yuv_to_rgb = rfxcodec_decode_yuv_to_rgba_amd64_sse2;
+                break;
+        }
+    }
+#endif
+    if (ax == 0)
+    {
+    }
+    if (bx == 0)
+    {
+    }
+    if (cx == 0)
+    {
+    }
+    *handle = dec;
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_decode_destroy(void *handle)
+{
+    struct rfxdecode *dec;
+
+    dec = (struct rfxdecode *) handle;
+    if (dec == 0)
+    {
+        return 0;
+    }
+    free(dec->rects);
+    free(dec->scratch);
+    free(dec);
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_decode(void *handle, char *cdata, int cdata_bytes,
+                char *data, int width, int height, int stride_bytes)
+{
+    struct rfxdecode *dec;
+    STREAM s;
+
+    dec = (struct rfxdecode *) handle;
+    if ((dec == 0) || (cdata == 0) || (data == 0))
+    {
+        return 1;
+    }
+    s.data = (uint8 *) cdata;
+    s.p = s.data;
+    s.size = cdata_bytes;
+    if (rfx_parse_message(dec, &s, data, width, height, stride_bytes) != 0)
+    {
+        return 2;
+    }
+    return 0;
+}
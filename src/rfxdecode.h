@@ -0,0 +1,62 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXDECODE_H
+#define __RFXDECODE_H
+
+struct rfxdecode;
+
+/* a_buffer, y_buffer, u_buffer, v_buffer, dwt_buffer and rgb_buffer */
+#define RFX_DECODE_SCRATCH_BYTES (4096 + 4 * 4096 * 2 + 64 * 64 * 4)
+
+typedef int (*rfx_idwt_shift_proc)(const char *qtable, sint16 *buffer,
+                                   sint16 *dwt_buffer);
+typedef int (*rfx_yuv_to_rgb_proc)(const sint16 *y_buffer,
+                                   const sint16 *u_buffer,
+                                   const sint16 *v_buffer,
+                                   const uint8 *a_buffer,
+                                   char *rgb_data, int stride_bytes);
+
+struct rfxdecode
+{
+    int width;
+    int height;
+    int mode;
+    int flags;
+    int bits_per_pixel;
+    int format;
+    int num_rects;
+    int max_rects;
+    struct rfx_rect *rects;
+
+    /* scratch of a tile, one 64 byte aligned block of
+       RFX_DECODE_SCRATCH_BYTES, not in this struct */
+    uint8 *scratch;
+    uint8 *a_buffer; /* 4096 */
+    sint16 *y_buffer; /* 4096 */
+    sint16 *u_buffer; /* 4096 */
+    sint16 *v_buffer; /* 4096 */
+    sint16 *dwt_buffer; /* 4096 */
+    char *rgb_buffer; /* 64 * 64 * 4 */
+    rfx_idwt_shift_proc rfx_idwt_shift;
+    rfx_yuv_to_rgb_proc rfx_yuv_to_rgb;
+
+    int got_sse2;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfxcommon.h"
+#include "rfxdecode.h"
+#include "rfxdecode_alpha.h"
+
+/*****************************************************************************/
+/* one line of the run length encoding written by fpack / fout in
+   rfxencode_alpha.c */
+static int
+funpack_line(STREAM *s, uint8 *line, int cx)
+{
+    int code;
+    int collen;
+    int replen;
+    int index;
+    uint8 last;
+
+    index = 0;
+    last = 0;
+    while (index < cx)
+    {
+        if (stream_get_left(s) < 1)
+        {
+            return 1;
+        }
+        stream_read_uint8(s, code);
+        collen = code >> 4;
+        replen = code & 0xF;
+        if (replen == 1)
+        {
+            /* big run */
+            replen = collen + 16;
+            collen = 0;
+        }
+        else if (replen == 2)
+        {
+            /* big run */
+            replen = collen + 32;
+            collen = 0;
+        }
+        if ((index + collen + replen > cx) ||
+            (stream_get_left(s) < collen))
+        {
+            return 1;
+        }
+        if (collen > 0)
+        {
+            memcpy(line + index, s->p, collen);
+            s->p += collen;
+            index += collen;
+            last = line[index - 1];
+        }
+        memset(line + index, last, replen);
+        index += replen;
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+fundelta(uint8 *plane, int cx, int cy)
+{
+    uint8 delta;
+    uint8 *dst8;
+    int index;
+    int jndex;
+
+    dst8 = plane + cx;
+    for (jndex = 1; jndex < cy; jndex++)
+    {
+        for (index = 0; index < cx; index++)
+        {
+            delta = *dst8;
+            if (delta & 1)
+            {
+                delta = -((delta + 1) >> 1);
+            }
+            else
+            {
+                delta = delta >> 1;
+            }
+            *dst8 = dst8[-cx] + delta;
+            dst8++;
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+int
+rfx_decode_plane(struct rfxdecode *dec, STREAM *s, int cx, int cy,
+                 uint8 *plane)
+{
+    int flags;
+    int jndex;
+
+    if (stream_get_left(s) < 1)
+    {
+        return 1;
+    }
+    stream_read_uint8(s, flags);
+    if (flags & 0x10)
+    {
+        /* RLE */
+        for (jndex = 0; jndex < cy; jndex++)
+        {
+            if (funpack_line(s, plane + jndex * cx, cx) != 0)
+            {
+                return 1;
+            }
+        }
+        return fundelta(plane, cx, cy);
+    }
+    if (stream_get_left(s) < cx * cy + 1)
+    {
+        return 1;
+    }
+    memcpy(plane, s->p, cx * cy);
+    s->p += cx * cy;
+    stream_seek_uint8(s); /* pad if not RLE */
+    return 0;
+}
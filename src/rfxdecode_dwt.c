@@ -0,0 +1,135 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfxcommon.h"
+#include "rfxdecode_dwt.h"
+
+/* inverse of the lifting in rfxencode_dwt.c
+ * h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1
+ * l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1)
+ * with src[2n] mirrored at the end and h[-1] = h[0] */
+
+/******************************************************************************/
+static int
+rfx_dwt_2d_decode_horz(const sint16 *l_src, const sint16 *h_src,
+                       sint16 *dst, int subband_width)
+{
+    int total_width;
+    int y;
+    int n;
+
+    total_width = subband_width << 1;
+    for (y = 0; y < subband_width; y++)
+    {
+        /* even */
+        dst[0] = l_src[0] - h_src[0];
+        for (n = 1; n < subband_width; n++)
+        {
+            dst[2 * n] = l_src[n] - ((h_src[n - 1] + h_src[n]) >> 1);
+        }
+
+        /* odd */
+        for (n = 0; n < subband_width - 1; n++)
+        {
+            dst[2 * n + 1] = (h_src[n] << 1) +
+                             ((dst[2 * n] + dst[2 * n + 2]) >> 1);
+        }
+        n = subband_width - 1;
+        dst[2 * n + 1] = (h_src[n] << 1) + dst[2 * n];
+
+        l_src += subband_width;
+        h_src += subband_width;
+        dst += total_width;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rfx_dwt_2d_decode_block(sint16 *buffer, sint16 *idwt, int subband_width)
+{
+    sint16 *ll, *hl, *lh, *hh;
+    sint16 *l, *h, *dst;
+    int total_width;
+    int x;
+    int n;
+
+    total_width = subband_width << 1;
+
+    /* inverse DWT in horizontal direction, the 4 sub-bands are in
+     * HL(0), LH(1), HH(2), LL(3) order, results in L, H order in
+     * tmp buffer idwt. */
+    /* LL(3) and HL(0) make the lower part L. */
+    /* LH(1) and HH(2) make the higher part H. */
+    hl = buffer;
+    lh = buffer + subband_width * subband_width;
+    hh = buffer + subband_width * subband_width * 2;
+    ll = buffer + subband_width * subband_width * 3;
+    rfx_dwt_2d_decode_horz(ll, hl, idwt, subband_width);
+    rfx_dwt_2d_decode_horz(lh, hh, idwt + subband_width * total_width,
+                           subband_width);
+
+    /* inverse DWT in vertical direction, results are stored in original
+     * buffer. */
+    for (x = 0; x < total_width; x++)
+    {
+        l = idwt + x;
+        h = l + subband_width * total_width;
+        dst = buffer + x;
+
+        /* even */
+        dst[0] = l[0] - h[0];
+        for (n = 1; n < subband_width; n++)
+        {
+            dst[2 * n * total_width] = l[n * total_width] -
+                                       ((h[(n - 1) * total_width] +
+                                         h[n * total_width]) >> 1);
+        }
+
+        /* odd */
+        for (n = 0; n < subband_width - 1; n++)
+        {
+            dst[(2 * n + 1) * total_width] =
+                    (h[n * total_width] << 1) +
+                    ((dst[2 * n * total_width] +
+                      dst[(2 * n + 2) * total_width]) >> 1);
+        }
+        n = subband_width - 1;
+        dst[(2 * n + 1) * total_width] = (h[n * total_width] << 1) +
+                                         dst[2 * n * total_width];
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_dwt_2d_decode(sint16 *buffer, sint16 *dwt_buffer)
+{
+    rfx_dwt_2d_decode_block(buffer + 3840, dwt_buffer, 8);
+    rfx_dwt_2d_decode_block(buffer + 3072, dwt_buffer, 16);
+    rfx_dwt_2d_decode_block(buffer, dwt_buffer, 32);
+    return 0;
+}
@@ -0,0 +1,29 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXDECODE_RLGR_H
+#define __RFXDECODE_RLGR_H
+
+#include "rfxcommon.h"
+
+int
+rfx_rlgr1_decode(const uint8 *buffer, int buffer_size, sint16 *data);
+int
+rfx_rlgr3_decode(const uint8 *buffer, int buffer_size, sint16 *data);
+
+#endif
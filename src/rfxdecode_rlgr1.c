@@ -0,0 +1,247 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This implementation of RLGR refers to
+ * [MS-RDPRFX] 3.1.8.1.7.3 RLGR1/RLGR3 Pseudocode
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfxcommon.h"
+#include "rfxdecode_rlgr.h"
+
+/* Constants used within the RLGR1/RLGR3 algorithm */
+#define KPMAX   (80)  /* max value for kp or krp */
+#define LSGR    (3)   /* shift count to convert kp to k */
+#define UP_GR   (4)   /* increase in kp after a zero run in RL mode */
+#define DN_GR   (6)   /* decrease in kp after a nonzero symbol in RL mode */
+#define UQ_GR   (3)   /* increase in kp after nonzero symbol in GR mode */
+#define DQ_GR   (3)   /* decrease in kp after zero symbol in GR mode */
+
+/*
+ * Update the passed parameter and clamp it to the range [0, KPMAX]
+ * Return the value of parameter right-shifted by LSGR
+ */
+#define UpdateParam(_param, _deltaP, _k) \
+do { \
+    _param += _deltaP; \
+    if (_param > KPMAX) \
+    { \
+        _param = KPMAX; \
+    } \
+    if (_param < 0) \
+    { \
+        _param = 0; \
+    } \
+    _k = (_param >> LSGR); \
+} while (0)
+
+/* the next bits are kept msb first in a 32 bit accumulator, at least 25
+   bits are valid after a fill, zeros are read past the end of the input */
+#define FillBits() \
+do { \
+    while (bits_in < 25) \
+    { \
+        if (src < src_end) \
+        { \
+            acc |= ((uint32) (*src++)) << (24 - bits_in); \
+        } \
+        bits_in += 8; \
+    } \
+} while (0)
+
+/* read _nbits, up to 24, from the input bitstream */
+#define InputBits(_nbits, _r) \
+do { \
+    int lnbits = _nbits; \
+    if (lnbits > 0) \
+    { \
+        if (bits_in < lnbits) \
+        { \
+            FillBits(); \
+        } \
+        _r = acc >> (32 - lnbits); \
+        acc <<= lnbits; \
+        bits_in -= lnbits; \
+    } \
+    else \
+    { \
+        _r = 0; \
+    } \
+} while (0)
+
+/* count and remove the one bits up to and including the next zero bit */
+#define InputOnes(_r) \
+do { \
+    int lones; \
+    _r = 0; \
+    do \
+    { \
+        FillBits(); \
+        GBSR((~acc) | 0xFF, lones); \
+        lones = 31 - lones; \
+        _r += lones; \
+        acc <<= lones; \
+        bits_in -= lones; \
+    } while (lones == 24); \
+    acc <<= 1; \
+    bits_in--; \
+} while (0)
+
+/* Writes count zeros to the output, does not write past the end */
+#define OutputZeros(_count) \
+do { \
+    int lcount = _count; \
+    if (lcount > data_size) \
+    { \
+        lcount = data_size; \
+    } \
+    memset(data, 0, lcount * sizeof(sint16)); \
+    data += lcount; \
+    data_size -= lcount; \
+} while (0)
+
+/* Writes one coefficient to the output, does not write past the end */
+#define OutputValue(_val) \
+do { \
+    if (data_size > 0) \
+    { \
+        *data++ = _val; \
+        data_size--; \
+    } \
+} while (0)
+
+/* Converts (2 * abs(input) - sign(input)) back to the signed input */
+#define Get2MagSignValue(_twoMs) \
+    (((_twoMs) & 1) ? -(sint16) (((_twoMs) + 1) >> 1) : (sint16) ((_twoMs) >> 1))
+
+/* Reads the Golomb/Rice encoding of a non-negative integer */
+#define GetGR(_krp, _val) \
+do { \
+    int lkr = (_krp) >> LSGR; \
+    uint32 lvk; \
+    uint32 lrem; \
+    /* unary part of GR code */ \
+    InputOnes(lvk); \
+    /* remainder part of GR code, if needed */ \
+    InputBits(lkr, lrem); \
+    _val = (lvk << lkr) | lrem; \
+    /* update krp, only if it is not equal to 1 */ \
+    if (lvk == 0) \
+    { \
+        UpdateParam(_krp, -2, lkr); \
+    } \
+    else if (lvk > 1) \
+    { \
+        UpdateParam(_krp, lvk, lkr); \
+    } \
+} while (0)
+
+int
+rfx_rlgr1_decode(const uint8 *buffer, int buffer_size, sint16 *data)
+{
+    int k;
+    int kp;
+    int krp;
+    int bit;
+    int run;
+    int sign;
+    int data_size;
+    int bits_in;
+    uint32 acc;
+    uint32 mag;
+    uint32 twoMs;
+    const uint8 *src;
+    const uint8 *src_end;
+
+    src = buffer;
+    src_end = buffer + buffer_size;
+    acc = 0;
+    bits_in = 0;
+
+    /* initialize the parameters */
+    k = 1;
+    kp = 1 << LSGR;
+    krp = 1 << LSGR;
+
+    /* process all the output coefficients */
+    data_size = 4096;
+    while (data_size > 0)
+    {
+        if (k)
+        {
+            /* RUN-LENGTH MODE */
+
+            /* each zero bit is a full run of 1 << k zeros */
+            InputBits(1, bit);
+            while (bit == 0 && data_size > 0)
+            {
+                OutputZeros(1 << k);
+                UpdateParam(kp, UP_GR, k);
+                InputBits(1, bit);
+            }
+            if (data_size < 1)
+            {
+                break;
+            }
+
+            /* the remaining run length is in k bits */
+            InputBits(k, run);
+            OutputZeros(run);
+
+            /* the nonzero value, sign then GR code of (mag - 1) */
+            InputBits(1, sign);
+            GetGR(krp, mag);
+            mag++;
+            OutputValue(sign ? -(sint16) mag : (sint16) mag);
+
+            UpdateParam(kp, -DN_GR, k);
+        }
+        else
+        {
+            /* GOLOMB-RICE MODE */
+
+            /* RLGR1 variant */
+
+            /* (2*magnitude - sign) is GR coded */
+            GetGR(krp, twoMs);
+            OutputValue(Get2MagSignValue(twoMs));
+
+            /* update k, kp */
+            /* NOTE: as of Aug 2011, the algorithm is still wrongly documented
+               and the update direction is reversed */
+            if (twoMs)
+            {
+                UpdateParam(kp, -DQ_GR, k);
+            }
+            else
+            {
+                UpdateParam(kp, UQ_GR, k);
+            }
+        }
+    }
+
+    return 0;
+}
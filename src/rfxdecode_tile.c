@@ -0,0 +1,182 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfxcommon.h"
+#include "rfxconstants.h"
+#include "rfxdecode.h"
+#include "rfxdecode_tile.h"
+#include "rfxdecode_rlgr.h"
+#include "rfxdecode_differential.h"
+#include "rfxdecode_quantization.h"
+#include "rfxdecode_dwt.h"
+
+/* inverse of rfx_encode_rgb_to_yuv, 1 << 14 is 1.0
+ * r = y + 1.402524 * v
+ * g = y - 0.343723 * u - 0.714384 * v
+ * b = y + 1.769894 * u
+ * the idwt output still has DWT_FACTOR fraction bits and is centered on 0 */
+#define YUV_SHIFT (14 + DWT_FACTOR)
+#define YUV_ROUND ((128 << YUV_SHIFT) + (1 << (YUV_SHIFT - 1)))
+
+/******************************************************************************/
+static int
+rfx_decode_yuv_to_rgb(const sint16 *y_buffer, const sint16 *u_buffer,
+                      const sint16 *v_buffer, const uint8 *a_buffer,
+                      char *rgb_data, int stride_bytes,
+                      int bytes_per_pixel, int r_offset, int b_offset)
+{
+    int x;
+    int y;
+    int yy;
+    int u;
+    int v;
+    int r;
+    int g;
+    int b;
+    uint8 *dst;
+
+    for (y = 0; y < 64; y++)
+    {
+        dst = (uint8 *) (rgb_data + y * stride_bytes);
+        for (x = 0; x < 64; x++)
+        {
+            yy = (*y_buffer++) * 16384 + YUV_ROUND;
+            u = *u_buffer++;
+            v = *v_buffer++;
+            r = (yy + v * 22979) >> YUV_SHIFT;
+            g = (yy + u * -5632 + v * -11704) >> YUV_SHIFT;
+            b = (yy + u * 28998) >> YUV_SHIFT;
+            dst[r_offset] = MINMAX(r, 0, 255);
+            dst[1] = MINMAX(g, 0, 255);
+            dst[b_offset] = MINMAX(b, 0, 255);
+            if (bytes_per_pixel == 4)
+            {
+                dst[3] = a_buffer == 0 ? 0xFF : *a_buffer++;
+            }
+            dst += bytes_per_pixel;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_decode_yuv_to_bgra(const sint16 *y_buffer, const sint16 *u_buffer,
+                       const sint16 *v_buffer, const uint8 *a_buffer,
+                       char *rgb_data, int stride_bytes)
+{
+    return rfx_decode_yuv_to_rgb(y_buffer, u_buffer, v_buffer, a_buffer,
+                                 rgb_data, stride_bytes, 4, 2, 0);
+}
+
+/******************************************************************************/
+int
+rfx_decode_yuv_to_rgba(const sint16 *y_buffer, const sint16 *u_buffer,
+                       const sint16 *v_buffer, const uint8 *a_buffer,
+                       char *rgb_data, int stride_bytes)
+{
+    return rfx_decode_yuv_to_rgb(y_buffer, u_buffer, v_buffer, a_buffer,
+                                 rgb_data, stride_bytes, 4, 0, 2);
+}
+
+/******************************************************************************/
+int
+rfx_decode_yuv_to_bgr(const sint16 *y_buffer, const sint16 *u_buffer,
+                      const sint16 *v_buffer, const uint8 *a_buffer,
+                      char *rgb_data, int stride_bytes)
+{
+    return rfx_decode_yuv_to_rgb(y_buffer, u_buffer, v_buffer, a_buffer,
+                                 rgb_data, stride_bytes, 3, 2, 0);
+}
+
+/******************************************************************************/
+int
+rfx_decode_yuv_to_rgb24(const sint16 *y_buffer, const sint16 *u_buffer,
+                        const sint16 *v_buffer, const uint8 *a_buffer,
+                        char *rgb_data, int stride_bytes)
+{
+    return rfx_decode_yuv_to_rgb(y_buffer, u_buffer, v_buffer, a_buffer,
+                                 rgb_data, stride_bytes, 3, 0, 2);
+}
+
+/******************************************************************************/
+int
+rfx_decode_idwt_shift(const char *qtable, sint16 *buffer, sint16 *dwt_buffer)
+{
+    rfx_quantization_decode(buffer, qtable);
+    rfx_dwt_2d_decode(buffer, dwt_buffer);
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rfx_decode_component(struct rfxdecode *dec, const char *qtable,
+                     const uint8 *data, int data_bytes, sint16 *buffer)
+{
+    if (dec->mode == RLGR1)
+    {
+        if (rfx_rlgr1_decode(data, data_bytes, buffer) != 0)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        if (rfx_rlgr3_decode(data, data_bytes, buffer) != 0)
+        {
+            return 1;
+        }
+    }
+    rfx_differential_decode(buffer + 4032, 64);
+    return dec->rfx_idwt_shift(qtable, buffer, dec->dwt_buffer);
+}
+
+/******************************************************************************/
+int
+rfx_decode_yuv(struct rfxdecode *dec,
+               const char *y_quants, const char *u_quants,
+               const char *v_quants,
+               const uint8 *y_data, int y_bytes,
+               const uint8 *u_data, int u_bytes,
+               const uint8 *v_data, int v_bytes)
+{
+    if (rfx_decode_component(dec, y_quants, y_data, y_bytes,
+                             dec->y_buffer) != 0)
+    {
+        return 1;
+    }
+    if (rfx_decode_component(dec, u_quants, u_data, u_bytes,
+                             dec->u_buffer) != 0)
+    {
+        return 1;
+    }
+    if (rfx_decode_component(dec, v_quants, v_data, v_bytes,
+                             dec->v_buffer) != 0)
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXDECODE_TILE_H
+#define __RFXDECODE_TILE_H
+
+#include "rfxcommon.h"
+
+int
+rfx_decode_yuv_to_bgra(const sint16 *y_buffer, const sint16 *u_buffer,
+                       const sint16 *v_buffer, const uint8 *a_buffer,
+                       char *rgb_data, int stride_bytes);
+int
+rfx_decode_yuv_to_rgba(const sint16 *y_buffer, const sint16 *u_buffer,
+                       const sint16 *v_buffer, const uint8 *a_buffer,
+                       char *rgb_data, int stride_bytes);
+int
+rfx_decode_yuv_to_bgr(const sint16 *y_buffer, const sint16 *u_buffer,
+                      const sint16 *v_buffer, const uint8 *a_buffer,
+                      char *rgb_data, int stride_bytes);
+int
+rfx_decode_yuv_to_rgb24(const sint16 *y_buffer, const sint16 *u_buffer,
+                        const sint16 *v_buffer, const uint8 *a_buffer,
+                        char *rgb_data, int stride_bytes);
+int
+rfx_decode_idwt_shift(const char *qtable, sint16 *buffer, sint16 *dwt_buffer);
+int
+rfx_decode_yuv(struct rfxdecode *dec,
+               const char *y_quants, const char *u_quants,
+               const char *v_quants,
+               const uint8 *y_data, int y_bytes,
+               const uint8 *u_data, int u_bytes,
+               const uint8 *v_data, int v_bytes);
+
+#endif
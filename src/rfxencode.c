@@ -31,6 +31,19 @@
 #include "rfxcompose.h"
 #include "rfxconstants.h"
 #include "rfxencode_tile.h"
+#include "rfxencode_threads.h"
+#include "rfxencode_hash.h"
+#include "rfxencode_cache.h"
+#include "rfxencode_quant_adaptive.h"
+#include "rfxencode_rate.h"
+#include "rfxencode_damage.h"
+#include "rfxencode_progressive.h"
+#include "rfxencode_solid.h"
+#include "rfxencode_alpha.h"
+#include "rfxencode_dwt.h"
+#include "rfxencode_stats.h"
+#include "rfxencode_cpu.h"
+#include "rfxencode_pool.h"
 
 #ifdef RFX_USE_ACCEL_X86
 #include "x86/funcs_x86.h"
@@ -42,80 +55,79 @@
 
 /******************************************************************************/
 int
-rfxcodec_encode_create_ex(int width, int height, int format, int flags,
-                          void **handle)
+rfxcodec_encode_create_with_allocator(int width, int height, int format,
+                                      int flags,
+                                      const struct rfxcodec_allocator *allocator,
+                                      void **handle)
 {
     struct rfxencode *enc;
-    int ax;
-    int bx;
-    int cx;
-    int dx;
+    const struct rfx_cpu *cpu;
 
-    enc = (struct rfxencode *) calloc(1, sizeof(struct rfxencode));
+    if (allocator != 0)
+    {
+        if ((allocator->malloc_proc == 0) || (allocator->free_proc == 0) ||
+            (allocator->aligned_alloc_proc == 0))
+        {
+            return 1;
+        }
+    }
+    enc = rfx_pool_get(allocator);
     if (enc == 0)
     {
         return 1;
     }
 
-    enc->dwt_buffer = (sint16 *) (((size_t) (enc->dwt_buffer_a)) & ~15);
-    enc->dwt_buffer1 = (sint16 *) (((size_t) (enc->dwt_buffer1_a)) & ~15);
-    enc->dwt_buffer2 = (sint16 *) (((size_t) (enc->dwt_buffer2_a)) & ~15);
-
-#if defined(RFX_USE_ACCEL_X86)
-    cpuid_x86(1, 0, &ax, &bx, &cx, &dx);
-#elif defined(RFX_USE_ACCEL_AMD64)
-    cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
-#else
-    ax = 0;
-    bx = 0;
-    cx = 0;
-    dx = 0;
-#endif
-    if (dx & (1 << 26)) /* SSE 2 */
+    cpu = rfx_cpu_get();
+    if (cpu->got_sse2)
     {
-        printf("rfxcodec_encode_create: got sse2\n");
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got sse2\n"));
         enc->got_sse2 = 1;
     }
-    if (cx & (1 << 0)) /* SSE 3 */
+    if (cpu->got_sse3)
     {
-        printf("rfxcodec_encode_create: got sse3\n");
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got sse3\n"));
         enc->got_sse3 = 1;
     }
-    if (cx & (1 << 19)) /* SSE 4.1 */
+    if (cpu->got_ssse3)
     {
-        printf("rfxcodec_encode_create: got sse4.1\n");
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got ssse3\n"));
+        enc->got_ssse3 = 1;
+    }
+    if (cpu->got_sse41)
+    {
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got sse4.1\n"));
         enc->got_sse41 = 1;
     }
-    if (cx & (1 << 20)) /* SSE 4.2 */
+    if (cpu->got_sse42)
     {
-        printf("rfxcodec_encode_create: got sse4.2\n");
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got sse4.2\n"));
         enc->got_sse42 = 1;
     }
-    if (cx & (1 << 23)) /* popcnt */
+    if (cpu->got_popcnt)
     {
-        printf("rfxcodec_encode_create: got popcnt\n");
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got popcnt\n"));
         enc->got_popcnt = 1;
     }
-#if defined(RFX_USE_ACCEL_X86)
-    cpuid_x86(0x80000001, 0, &ax, &bx, &cx, &dx);
-#elif defined(RFX_USE_ACCEL_AMD64)
-    cpuid_amd64(0x80000001, 0, &ax, &bx, &cx, &dx);
-#else
-    ax = 0;
-    bx = 0;
-    cx = 0;
-    dx = 0;
-#endif
-    if (cx & (1 << 5)) /* lzcnt */
+    if (cpu->got_lzcnt)
     {
-        printf("rfxcodec_encode_create: got lzcnt\n");
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got lzcnt\n"));
         enc->got_lzcnt = 1;
     }
-    if (cx & (1 << 6)) /* SSE 4.a */
+    if (cpu->got_sse4a)
     {
-        printf("rfxcodec_encode_create: got sse4.a\n");
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got sse4.a\n"));
         enc->got_sse4a = 1;
     }
+    if (cpu->got_avx2)
+    {
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got avx2\n"));
+        enc->got_avx2 = 1;
+    }
+    if (cpu->got_avx512bw)
+    {
+        CREATE_LOG(flags, ("rfxcodec_encode_create: got avx512bw\n"));
+        enc->got_avx512bw = 1;
+    }
 
     enc->width = width;
     enc->height = height;
@@ -124,6 +136,10 @@ rfxcodec_encode_create_ex(int width, int height, int format, int flags,
     {
         enc->mode = RLGR1;
     }
+    if (flags & RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE)
+    {
+        enc->reduce_extrapolate = 1;
+    }
     switch (format)
     {
         case RFX_FORMAT_BGRA:
@@ -141,8 +157,13 @@ rfxcodec_encode_create_ex(int width, int height, int format, int flags,
         case RFX_FORMAT_YUV:
             enc->bits_per_pixel = 32;
             break;
+        case RFX_FORMAT_NV12:
+        case RFX_FORMAT_I420:
+            /* the y plane, u and v are found from it */
+            enc->bits_per_pixel = 8;
+            break;
         default:
-            free(enc);
+            rfx_pool_put(enc);
             return 2;
     }
     enc->format = format;
@@ -151,13 +172,15 @@ rfxcodec_encode_create_ex(int width, int height, int format, int flags,
     {
         if (enc->mode == RLGR3)
         {
-            printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n");
+            CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n"));
             enc->rfx_encode = rfx_encode_component_rlgr3; /* rfxencode_tile.c */
+            enc->rfx_encode_name = "rfx_encode_component_rlgr3";
         }
         else
         {
-            printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n");
+            CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n"));
             enc->rfx_encode = rfx_encode_component_rlgr1; /* rfxencode_tile.c */
+            enc->rfx_encode_name = "rfx_encode_component_rlgr1";
         }
     }
     else
@@ -167,104 +190,312 @@ rfxcodec_encode_create_ex(int width, int height, int format, int flags,
         {
             if (enc->mode == RLGR3)
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_x86_sse41\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_x86_sse41\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr3_x86_sse41; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3_x86_sse41";
             }
             else
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_x86_sse41\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_x86_sse41\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr1_x86_sse41; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1_x86_sse41";
             }
         }
         else if (enc->got_sse2)
         {
             if (enc->mode == RLGR3)
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_x86_sse2\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_x86_sse2\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr3_x86_sse2; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3_x86_sse2";
             }
             else
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_x86_sse2\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_x86_sse2\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr1_x86_sse2; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1_x86_sse2";
             }
         }
         else
         {
             if (enc->mode == RLGR3)
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr3; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3";
             }
             else
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr1; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1";
             }
         }
 #elif defined(RFX_USE_ACCEL_AMD64)
-        if (enc->got_sse41)
+        if (enc->got_avx512bw)
+        {
+            if (enc->mode == RLGR3)
+            {
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_amd64_avx512bw\n"));
+                enc->rfx_encode = rfx_encode_component_rlgr3_amd64_avx512bw; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3_amd64_avx512bw";
+            }
+            else
+            {
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_amd64_avx512bw\n"));
+                enc->rfx_encode = rfx_encode_component_rlgr1_amd64_avx512bw; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1_amd64_avx512bw";
+            }
+        }
+        else if (enc->got_avx2)
+        {
+            if (enc->mode == RLGR3)
+            {
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_amd64_avx2\n"));
+                enc->rfx_encode = rfx_encode_component_rlgr3_amd64_avx2; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3_amd64_avx2";
+            }
+            else
+            {
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_amd64_avx2\n"));
+                enc->rfx_encode = rfx_encode_component_rlgr1_amd64_avx2; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1_amd64_avx2";
+            }
+        }
+        else if (enc->got_sse41)
         {
             if (enc->mode == RLGR3)
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_amd64_sse41\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_amd64_sse41\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr3_amd64_sse41; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3_amd64_sse41";
             }
             else
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_amd64_sse41\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_amd64_sse41\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr1_amd64_sse41; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1_amd64_sse41";
             }
         }
         else if (enc->got_sse2)
         {
             if (enc->mode == RLGR3)
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_amd64_sse2\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3_amd64_sse2\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr3_amd64_sse2; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3_amd64_sse2";
             }
             else
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_amd64_sse2\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1_amd64_sse2\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr1_amd64_sse2; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1_amd64_sse2";
             }
         }
         else
         {
             if (enc->mode == RLGR3)
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr3; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr3";
             }
             else
             {
-                printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n");
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n"));
                 enc->rfx_encode = rfx_encode_component_rlgr1; /* rfxencode_tile.c */
+                enc->rfx_encode_name = "rfx_encode_component_rlgr1";
             }
         }
 #else
         if (enc->mode == RLGR3)
         {
-            printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n");
+            CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr3\n"));
             enc->rfx_encode = rfx_encode_component_rlgr3; /* rfxencode_tile.c */
+            enc->rfx_encode_name = "rfx_encode_component_rlgr3";
         }
         else
         {
-            printf("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n");
+            CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_encode set to rfx_encode_component_rlgr1\n"));
             enc->rfx_encode = rfx_encode_component_rlgr1; /* rfxencode_tile.c */
+            enc->rfx_encode_name = "rfx_encode_component_rlgr1";
         }
 #endif
     }
-    if (ax == 0)
+    /* assign rgb to yuv functions, only used for full 64x64 tiles */
+    enc->rfx_rgb_to_yuv_name = "rfx_encode_rgb_to_yuv";
+#if defined(RFX_USE_ACCEL_AMD64)
+    if ((flags & RFX_FLAGS_NOACCEL) == 0)
     {
+        switch (format)
+        {
+            case RFX_FORMAT_BGRA:
+                if (enc->got_avx2)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_bgra_to_yuv_amd64_avx2\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_bgra_to_yuv_amd64_avx2;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_bgra_to_yuv_amd64_avx2";
+                }
+                else if (enc->got_sse2)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_bgra_to_yuv_amd64_sse2\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_bgra_to_yuv_amd64_sse2;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_bgra_to_yuv_amd64_sse2";
+                }
+                break;
+            case RFX_FORMAT_RGBA:
+                if (enc->got_avx2)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_rgba_to_yuv_amd64_avx2\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_rgba_to_yuv_amd64_avx2;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_rgba_to_yuv_amd64_avx2";
+                }
+                else if (enc->got_sse2)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_rgba_to_yuv_amd64_sse2\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_rgba_to_yuv_amd64_sse2;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_rgba_to_yuv_amd64_sse2";
+                }
+                break;
+            case RFX_FORMAT_BGR:
+                if (enc->got_avx2)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_bgr_to_yuv_amd64_avx2\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_bgr_to_yuv_amd64_avx2;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_bgr_to_yuv_amd64_avx2";
+                }
+                else if (enc->got_ssse3)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_bgr_to_yuv_amd64_ssse3\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_bgr_to_yuv_amd64_ssse3;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_bgr_to_yuv_amd64_ssse3";
+                }
+                break;
+            case RFX_FORMAT_RGB:
+                if (enc->got_avx2)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_rgb_to_yuv_amd64_avx2\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_rgb_to_yuv_amd64_avx2;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_rgb_to_yuv_amd64_avx2";
+                }
+                else if (enc->got_ssse3)
+                {
+                    CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_rgb_to_yuv set to rfxcodec_encode_rgb_to_yuv_amd64_ssse3\n"));
+                    enc->rfx_rgb_to_yuv = rfxcodec_encode_rgb_to_yuv_amd64_ssse3;
+                    enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_rgb_to_yuv_amd64_ssse3";
+                }
+                break;
+        }
     }
-    if (bx == 0)
+#endif
+    /* assign 4:2:0 to yuv functions, only used for full 64x64 tiles */
+    if ((format == RFX_FORMAT_NV12) || (format == RFX_FORMAT_I420))
     {
+        enc->rfx_rgb_to_yuv_name = "rfx_encode_format_yuv420";
+    }
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (((flags & RFX_FLAGS_NOACCEL) == 0) && enc->got_sse2)
+    {
+        switch (format)
+        {
+            case RFX_FORMAT_NV12:
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_yuv420_to_yuv set to rfxcodec_encode_nv12_to_yuv_amd64_sse2\n"));
+                enc->rfx_yuv420_to_yuv = rfxcodec_encode_nv12_to_yuv_amd64_sse2;
+                enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_nv12_to_yuv_amd64_sse2";
+                break;
+            case RFX_FORMAT_I420:
+                CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_yuv420_to_yuv set to rfxcodec_encode_i420_to_yuv_amd64_sse2\n"));
+                enc->rfx_yuv420_to_yuv = rfxcodec_encode_i420_to_yuv_amd64_sse2;
+                enc->rfx_rgb_to_yuv_name = "rfxcodec_encode_i420_to_yuv_amd64_sse2";
+                break;
+        }
+    }
+#endif
+    /* assign tile hash function */
+    enc->rfx_tile_hash = rfx_tile_hash;
+    enc->rfx_tile_hash_name = "rfx_tile_hash";
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (((flags & RFX_FLAGS_NOACCEL) == 0) && enc->got_sse42)
+    {
+        CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_tile_hash set to rfxcodec_encode_tile_hash_amd64_sse42\n"));
+        enc->rfx_tile_hash = rfxcodec_encode_tile_hash_amd64_sse42;
+        enc->rfx_tile_hash_name = "rfxcodec_encode_tile_hash_amd64_sse42";
+    }
+#endif
+    /* assign tile stats function, RFX_FLAGS_QUANT_ADAPTIVE */
+    enc->rfx_tile_stats = rfx_tile_stats;
+    enc->rfx_tile_stats_name = "rfx_tile_stats";
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (((flags & RFX_FLAGS_NOACCEL) == 0) && enc->got_sse2)
+    {
+        CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_tile_stats set to rfxcodec_encode_tile_stats_amd64_sse2\n"));
+        enc->rfx_tile_stats = rfxcodec_encode_tile_stats_amd64_sse2;
+        enc->rfx_tile_stats_name = "rfxcodec_encode_tile_stats_amd64_sse2";
+    }
+#endif
+    /* assign solid tile check function */
+    enc->rfx_tile_solid = rfx_tile_solid;
+    enc->rfx_tile_solid_name = "rfx_tile_solid";
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (((flags & RFX_FLAGS_NOACCEL) == 0) && enc->got_sse2)
+    {
+        CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_tile_solid set to rfxcodec_encode_tile_solid_amd64_sse2\n"));
+        enc->rfx_tile_solid = rfxcodec_encode_tile_solid_amd64_sse2;
+        enc->rfx_tile_solid_name = "rfxcodec_encode_tile_solid_amd64_sse2";
+    }
+#endif
+    /* assign alpha plane delta function, RFX_FLAGS_ALPHAV1 */
+    enc->rfx_alpha_delta = rfx_alpha_delta;
+    enc->rfx_alpha_delta_name = "rfx_alpha_delta";
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (((flags & RFX_FLAGS_NOACCEL) == 0) && enc->got_sse2)
+    {
+        CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_alpha_delta set to rfxcodec_encode_alpha_delta_amd64_sse2\n"));
+        enc->rfx_alpha_delta = rfxcodec_encode_alpha_delta_amd64_sse2;
+        enc->rfx_alpha_delta_name = "rfxcodec_encode_alpha_delta_amd64_sse2";
+    }
+#endif
+    /* assign reduce extrapolate DWT function, rfxcodec_encode_progressive */
+    enc->rfx_dwt_rem = rfx_dwt_2d_encode_rem;
+    enc->rfx_dwt_rem_name = "rfx_dwt_2d_encode_rem";
+#if defined(RFX_USE_ACCEL_AMD64)
+    if ((flags & RFX_FLAGS_NOACCEL) == 0)
+    {
+        if (enc->got_avx2)
+        {
+            CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_dwt_rem set to rfxcodec_encode_dwt_rem_amd64_avx2\n"));
+            enc->rfx_dwt_rem = rfxcodec_encode_dwt_rem_amd64_avx2;
+            enc->rfx_dwt_rem_name = "rfxcodec_encode_dwt_rem_amd64_avx2";
+        }
+        else if (enc->got_sse2)
+        {
+            CREATE_LOG(flags, ("rfxcodec_encode_create: rfx_dwt_rem set to rfxcodec_encode_dwt_rem_amd64_sse2\n"));
+            enc->rfx_dwt_rem = rfxcodec_encode_dwt_rem_amd64_sse2;
+            enc->rfx_dwt_rem_name = "rfxcodec_encode_dwt_rem_amd64_sse2";
+        }
+    }
+#endif
+    if (flags & RFX_FLAGS_TILE_HASH)
+    {
+        if (rfx_hash_create(enc) != 0)
+        {
+            rfx_pool_put(enc);
+            return 1;
+        }
     }
     *handle = enc;
     return 0;
 }
 
+/******************************************************************************/
+int
+rfxcodec_encode_create_ex(int width, int height, int format, int flags,
+                          void **handle)
+{
+    return rfxcodec_encode_create_with_allocator(width, height, format, flags,
+                                                 0, handle);
+}
+
 /******************************************************************************/
 void *
 rfxcodec_encode_create(int width, int height, int format, int flags)
@@ -291,7 +522,262 @@ rfxcodec_encode_destroy(void *handle)
     {
         return 0;
     }
-    free(enc);
+    rfx_threads_delete(enc);
+    rfx_hash_delete(enc);
+    rfx_cache_delete(enc);
+    rfx_rate_delete(enc);
+    rfx_damage_delete(enc);
+    rfx_progressive_delete(enc);
+    rfx_pool_put(enc);
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_set_pool(int max_contexts)
+{
+    return rfx_pool_set_max(max_contexts);
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_set_threads(void *handle, int num_threads)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
+    {
+        return 1;
+    }
+    rfx_threads_delete(enc);
+    if (num_threads > 1)
+    {
+        if (rfx_threads_create(enc, num_threads) != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_set_tile_cache(void *handle, int max_bytes)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
+    {
+        return 1;
+    }
+    rfx_cache_delete(enc);
+    if (max_bytes > 0)
+    {
+        if (rfx_cache_create(enc, max_bytes) != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_reset(void *handle, int flags)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
+    {
+        return 1;
+    }
+    enc->header_processed = 0;
+    if (flags & RFX_RESET_FRAME_IDX)
+    {
+        enc->frame_idx = 0;
+    }
+    enc->last_num_tiles = 0;
+    if (enc->hashes != 0)
+    {
+        /* the client has none of the tiles */
+        rfx_hash_reset(enc);
+    }
+    if (enc->rate != 0)
+    {
+        rfx_rate_reset(enc);
+    }
+    rfx_progressive_reset(enc);
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_damage(void *handle, const struct rfx_rect *damage,
+                       int num_damage, struct rfx_rect *regions,
+                       int *num_regions, struct rfx_tile *tiles,
+                       int *num_tiles)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if ((enc == 0) || (num_damage < 0))
+    {
+        return 1;
+    }
+    return rfx_damage_tiles(enc, damage, num_damage, regions, num_regions,
+                            tiles, num_tiles);
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_set_rate(void *handle, int bytes_per_second,
+                         int frames_per_second, int max_frame_bytes)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
+    {
+        return 1;
+    }
+    return rfx_rate_create(enc, bytes_per_second, frames_per_second,
+                           max_frame_bytes);
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_set_sink(void *handle, rfxcodec_encode_sink_proc sink,
+                         void *user, int chunk_tiles)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if ((enc == 0) || ((sink != 0) && (chunk_tiles < 1)))
+    {
+        return 1;
+    }
+    enc->sink = sink;
+    enc->sink_user = user;
+    enc->sink_tiles = chunk_tiles;
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_get_tile_cache_stats(void *handle,
+                                     struct rfx_tile_cache_stats *stats)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if ((enc == 0) || (stats == 0))
+    {
+        return 1;
+    }
+    if (enc->tile_cache == 0)
+    {
+        memset(stats, 0, sizeof(struct rfx_tile_cache_stats));
+        return 0;
+    }
+    return rfx_cache_get_stats(enc->tile_cache, stats);
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_get_stats(void *handle, struct rfx_encode_stats *stats)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if ((enc == 0) || (stats == 0))
+    {
+        return 1;
+    }
+    memset(stats, 0, sizeof(struct rfx_encode_stats));
+    stats->rfx_encode_name = enc->rfx_encode_name;
+    stats->rfx_rgb_to_yuv_name = enc->rfx_rgb_to_yuv_name;
+    stats->rfx_tile_hash_name = enc->rfx_tile_hash_name;
+    stats->rfx_tile_stats_name = enc->rfx_tile_stats_name;
+    stats->rfx_tile_solid_name = enc->rfx_tile_solid_name;
+    stats->rfx_alpha_delta_name = enc->rfx_alpha_delta_name;
+    stats->rfx_dwt_rem_name = enc->rfx_dwt_rem_name;
+#if defined(RFX_USE_STATS)
+    rfx_stats_add(stats, &(enc->stats));
+    rfx_threads_add_stats(enc, stats);
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_reset_stats(void *handle)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
+    {
+        return 1;
+    }
+    memset(&(enc->stats), 0, sizeof(struct rfx_encode_stats));
+    rfx_threads_reset_stats(enc);
+    return 0;
+}
+
+/******************************************************************************/
+/* the tiles, quants and flags of a call after the hash check and rate
+ * control, in enc->last_tiles, last_quants and last_flags */
+static int
+rfx_encode_frame_setup(struct rfxencode *enc,
+                       const char *buf, int stride_bytes,
+                       int num_regions,
+                       const struct rfx_tile *tiles, int num_tiles,
+                       const char *quants, int num_quants, int flags)
+{
+    if (enc->hashes != 0)
+    {
+        /* drop the tiles that did not change since they were last sent */
+        if (rfx_hash_tiles(enc, buf, stride_bytes, tiles, num_tiles) != 0)
+        {
+            return 1;
+        }
+        tiles = enc->hash_tiles;
+        num_tiles = enc->num_hash_tiles;
+    }
+    if (enc->rate != 0)
+    {
+        if (rfx_rate_tiles(enc, buf, stride_bytes, &tiles, &num_tiles,
+                           num_regions, &quants, &num_quants, &flags) != 0)
+        {
+            return 1;
+        }
+    }
+    enc->last_tiles = tiles;
+    enc->last_num_tiles = num_tiles;
+    enc->last_quants = quants;
+    enc->last_num_quants = num_quants;
+    enc->last_flags = flags;
+    return 0;
+}
+
+/******************************************************************************/
+/* the call made bytes of output */
+static int
+rfx_encode_frame_commit(struct rfxencode *enc, int bytes)
+{
+    if (enc->hashes != 0)
+    {
+        rfx_hash_commit(enc, enc->num_hash_tiles);
+    }
+    if (enc->rate != 0)
+    {
+        rfx_rate_commit(enc, bytes);
+    }
     return 0;
 }
 
@@ -305,6 +791,12 @@ rfxcodec_encode_ex(void *handle, char *cdata, int *cdata_bytes,
 {
     struct rfxencode *enc;
     STREAM s;
+    int frame_idx;
+    int header_processed;
+    int error;
+    int index;
+    int count;
+    int total;
 
     enc = (struct rfxencode *) handle;
 
@@ -312,25 +804,317 @@ rfxcodec_encode_ex(void *handle, char *cdata, int *cdata_bytes,
     s.p = s.data;
     s.size = *cdata_bytes;
 
-    /* Only the first frame should send the RemoteFX header */
-    if ((enc->frame_idx == 0) && (enc->header_processed == 0))
+    /* put back on failure so the frame can be encoded again */
+    frame_idx = enc->frame_idx;
+    header_processed = enc->header_processed;
+
+    if (rfx_encode_frame_setup(enc, buf, stride_bytes, num_regions,
+                               tiles, num_tiles, quants, num_quants,
+                               flags) != 0)
+    {
+        return 1;
+    }
+    tiles = enc->last_tiles;
+    num_tiles = enc->last_num_tiles;
+    quants = enc->last_quants;
+    num_quants = enc->last_num_quants;
+    flags = enc->last_flags;
+    error = 0;
+    if (rfx_compose_header_pending(enc, flags))
+    {
+        error = rfx_compose_message_header(enc, &s);
+    }
+    total = 0;
+    index = 0;
+    if (error != 0)
+    {
+    }
+    else if (enc->sink == 0)
+    {
+        error = rfx_compose_message_data(enc, &s, regions, num_regions,
+                                         buf, width, height, stride_bytes,
+                                         tiles, num_tiles, quants, num_quants,
+                                         flags);
+        total = (int) (s.p - s.data);
+    }
+    else
     {
-        if (rfx_compose_message_header(enc, &s) != 0)
+        /* the tileset lengths are not known until its last tile is done
+           so each chunk of tiles is a frame of its own */
+        do
         {
-            return 1;
+            count = num_tiles - index;
+            if (count > enc->sink_tiles)
+            {
+                count = enc->sink_tiles;
+            }
+            error = rfx_compose_message_data(enc, &s, regions, num_regions,
+                                             buf, width, height, stride_bytes,
+                                             tiles + index, count,
+                                             quants, num_quants, flags);
+            if (error != 0)
+            {
+                break;
+            }
+            if (enc->sink(enc->sink_user, (const char *) (s.data),
+                          (int) (s.p - s.data)) != 0)
+            {
+                error = 1;
+                break;
+            }
+            total += (int) (s.p - s.data);
+            s.p = s.data;
+            /* sent, do not put these back */
+            frame_idx = enc->frame_idx;
+            header_processed = enc->header_processed;
+            index += count;
+        } while (index < num_tiles);
+    }
+    if (error != 0)
+    {
+        enc->frame_idx = frame_idx;
+        enc->header_processed = header_processed;
+        if ((enc->sink != 0) && (enc->hashes != 0))
+        {
+            /* the tiles before index went to the sink, the client has
+               them, the rest are as they were */
+            rfx_hash_commit(enc, index);
         }
+        enc->last_num_tiles = 0;
+        return error;
     }
-    if (rfx_compose_message_data(enc, &s, regions, num_regions,
-                                 buf, width, height, stride_bytes,
-                                 tiles, num_tiles, quants, num_quants,
-                                 flags) != 0)
+    rfx_encode_frame_commit(enc, total);
+    *cdata_bytes = total;
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_set_progressive(void *handle, const char *levels,
+                                int num_levels)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
+    {
+        return 1;
+    }
+    return rfx_progressive_set_levels(enc, levels, num_levels);
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_progressive(void *handle, char *cdata, int *cdata_bytes,
+                            const char *buf, int width, int height,
+                            int stride_bytes,
+                            const struct rfx_rect *regions, int num_regions,
+                            const struct rfx_tile *tiles, int num_tiles,
+                            const char *quants, int num_quants, int flags)
+{
+    struct rfxencode *enc;
+    STREAM s;
+    int error;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
     {
         return 1;
     }
+    s.data = (uint8 *) cdata;
+    s.p = s.data;
+    s.size = *cdata_bytes;
+    error = rfx_progressive_encode(enc, &s, buf, stride_bytes,
+                                   regions, num_regions, tiles, num_tiles,
+                                   quants, num_quants, flags);
+    if (error != 0)
+    {
+        return error;
+    }
     *cdata_bytes = (int) (s.p - s.data);
     return 0;
 }
 
+/******************************************************************************/
+int
+rfxcodec_encode_progressive_pending(void *handle)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if (enc == 0)
+    {
+        return 0;
+    }
+    return rfx_progressive_pending(enc);
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_batch(void *handle, struct rfx_encode_job *jobs,
+                      int num_jobs)
+{
+    struct rfxencode *enc;
+    struct rfxencode *jenc;
+    struct rfx_encode_job *job;
+    STREAM s;
+    int frame_idx;
+    int header_processed;
+    int error;
+    int index;
+    int jndex;
+
+    enc = (struct rfxencode *) handle;
+    if ((enc == 0) || (jobs == 0) || (num_jobs < 0))
+    {
+        return 1;
+    }
+    /* each job moves the frame state of its handle on */
+    for (index = 0; index < num_jobs; index++)
+    {
+        if (jobs[index].handle == 0)
+        {
+            return 1;
+        }
+        for (jndex = 0; jndex < index; jndex++)
+        {
+            if (jobs[jndex].handle == jobs[index].handle)
+            {
+                return 1;
+            }
+        }
+    }
+
+    /* the tiles of each job, after the hash check and rate control */
+    for (index = 0; index < num_jobs; index++)
+    {
+        job = jobs + index;
+        jenc = (struct rfxencode *) (job->handle);
+        job->error = 0;
+        jenc->batch_pool = 0;
+        if (jenc->sink != 0)
+        {
+            continue;
+        }
+        if (rfx_encode_frame_setup(jenc, job->buf, job->stride_bytes,
+                                   job->num_regions,
+                                   job->tiles, job->num_tiles,
+                                   job->quants, job->num_quants,
+                                   job->flags) != 0)
+        {
+            job->error = 1;
+            continue;
+        }
+        jenc->batch_pool = enc->threads;
+    }
+
+    /* encode all the tiles at once */
+    if (enc->threads != 0)
+    {
+        if (rfx_threads_batch(enc, jobs, num_jobs) != 0)
+        {
+            /* no chunks, each tileset encodes its own tiles */
+            for (index = 0; index < num_jobs; index++)
+            {
+                jenc = (struct rfxencode *) (jobs[index].handle);
+                jenc->batch_pool = 0;
+            }
+        }
+    }
+
+    /* then each frame, in order, as rfxcodec_encode_ex does */
+    for (index = 0; index < num_jobs; index++)
+    {
+        job = jobs + index;
+        jenc = (struct rfxencode *) (job->handle);
+        if (jenc->sink != 0)
+        {
+            job->error = rfxcodec_encode_ex(jenc, job->cdata,
+                                            &(job->cdata_bytes), job->buf,
+                                            job->width, job->height,
+                                            job->stride_bytes,
+                                            job->regions, job->num_regions,
+                                            job->tiles, job->num_tiles,
+                                            job->quants, job->num_quants,
+                                            job->flags);
+            continue;
+        }
+        if (job->error != 0)
+        {
+            continue;
+        }
+        s.data = (uint8 *) (job->cdata);
+        s.p = s.data;
+        s.size = job->cdata_bytes;
+        frame_idx = jenc->frame_idx;
+        header_processed = jenc->header_processed;
+        error = 0;
+        if (rfx_compose_header_pending(jenc, jenc->last_flags))
+        {
+            error = rfx_compose_message_header(jenc, &s);
+        }
+        if (error == 0)
+        {
+            error = rfx_compose_message_data(jenc, &s,
+                                             job->regions, job->num_regions,
+                                             job->buf, job->width,
+                                             job->height, job->stride_bytes,
+                                             jenc->last_tiles,
+                                             jenc->last_num_tiles,
+                                             jenc->last_quants,
+                                             jenc->last_num_quants,
+                                             jenc->last_flags);
+        }
+        jenc->batch_pool = 0;
+        if (error != 0)
+        {
+            jenc->frame_idx = frame_idx;
+            jenc->header_processed = header_processed;
+            jenc->last_num_tiles = 0;
+            job->error = error;
+            continue;
+        }
+        job->cdata_bytes = (int) (s.p - s.data);
+        rfx_encode_frame_commit(jenc, job->cdata_bytes);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_bound(void *handle, int num_tiles, int num_regions,
+                      int num_quants, int flags)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if ((enc == 0) || (num_tiles < 0) || (num_tiles > 0xFFFF) ||
+        (num_regions < 0) || (num_regions > 0xFFFF) ||
+        (num_quants < 0) || (num_quants > 0xFF))
+    {
+        return -1;
+    }
+    return rfx_compose_message_bound(enc, num_tiles, num_regions,
+                                     num_quants, flags);
+}
+
+/******************************************************************************/
+int
+rfxcodec_encode_get_tiles(void *handle, const struct rfx_tile **tiles,
+                          int *num_tiles)
+{
+    struct rfxencode *enc;
+
+    enc = (struct rfxencode *) handle;
+    if ((enc == 0) || (tiles == 0) || (num_tiles == 0))
+    {
+        return 1;
+    }
+    *tiles = enc->last_tiles;
+    *num_tiles = enc->last_num_tiles;
+    return 0;
+}
+
 /******************************************************************************/
 int
 rfxcodec_encode(void *handle, char *cdata, int *cdata_bytes,
@@ -20,10 +20,47 @@
 #define __RFXENCODE_H
 
 struct rfxencode;
+struct rfx_thread_pool;
+struct rfx_tile_cache;
+struct rfx_rate;
+struct rfx_damage;
+struct rfx_progressive;
+
+/* quantized DC values of a solid component, -128 to 127 */
+#define RFX_SOLID_DCS 256
+/* most bytes RLGR1 or RLGR3 makes for a solid component, 15 for both */
+#define RFX_SOLID_BYTES 16
+/* rfx_encode_plane_flat, 132 for 255 and 129 for 0 with the flags byte */
+#define RFX_ALPHA_FLAT_BYTES 132
+/* a_buffer, y_r_buffer, u_g_buffer, v_b_buffer and the 3 dwt buffers */
+#define RFX_ENCODE_SCRATCH_BYTES (4 * 4096 + 3 * 4096 * 2)
 
 typedef int (*rfx_encode_proc)(struct rfxencode *enc, const char *qtable,
                                const uint8 *data,
                                uint8 *buffer, int buffer_size, int *size);
+typedef int (*rfx_rgb_to_yuv_proc)(const char *rgb_data, int stride_bytes,
+                                   uint8 *y_buffer, uint8 *u_buffer,
+                                   uint8 *v_buffer, uint8 *a_buffer);
+typedef int (*rfx_yuv420_to_yuv_proc)(const char *y_data, const char *u_data,
+                                      const char *v_data, int stride_bytes,
+                                      uint8 *y_buffer, uint8 *u_buffer,
+                                      uint8 *v_buffer);
+typedef int (*rfx_tile_hash_proc)(const char *data, int row_bytes, int rows,
+                                  int stride_bytes, uint32 *hash);
+typedef int (*rfx_tile_stats_proc)(const uint8 *y_buffer, int *stats);
+typedef int (*rfx_tile_solid_proc)(const char *data, int stride_bytes,
+                                   int with_alpha);
+typedef int (*rfx_alpha_delta_proc)(const uint8 *plane, uint8 *delta_plane,
+                                    uint64 *runs);
+typedef int (*rfx_dwt_rem_proc)(const uint8 *in_buffer, sint16 *buffer,
+                                sint16 *dwt_buffer, sint16 *dwt_buffer2);
+
+struct rfx_tile_hash
+{
+    uint32 hash;
+    int valid;
+    int level; /* rate control level it was sent at */
+};
 
 struct rfxencode
 {
@@ -36,30 +73,110 @@ struct rfxencode
     int flags;
     int bits_per_pixel;
     int format;
-    int pad0[7];
-
-    uint8 a_buffer[4096];
-    uint8 y_r_buffer[4096];
-    uint8 u_g_buffer[4096];
-    uint8 v_b_buffer[4096];
-    uint8 pad1[16];
-    sint16 dwt_buffer_a[4096];
-    sint16 dwt_buffer1_a[4096];
-    sint16 dwt_buffer2_a[4096];
-    uint8 pad2[16];
-    sint16 *dwt_buffer;
-    sint16 *dwt_buffer1;
-    sint16 *dwt_buffer2;
+
+    /* scratch of a tile, one 64 byte aligned block of
+       RFX_ENCODE_SCRATCH_BYTES, not in this struct */
+    uint8 *scratch;
+    uint8 *a_buffer; /* 4096 */
+    uint8 *y_r_buffer; /* 4096 */
+    uint8 *u_g_buffer; /* 4096 */
+    uint8 *v_b_buffer; /* 4096 */
+    sint16 *dwt_buffer; /* 4096 */
+    sint16 *dwt_buffer1; /* 4096 */
+    sint16 *dwt_buffer2; /* 4096 */
+
+    /* rfxcodec_encode_create_with_allocator, else this is from the pool */
+    int with_allocator;
+    struct rfxcodec_allocator allocator;
+
     rfx_encode_proc rfx_encode;
+    rfx_rgb_to_yuv_proc rfx_rgb_to_yuv;
+    rfx_yuv420_to_yuv_proc rfx_yuv420_to_yuv;
+    rfx_tile_hash_proc rfx_tile_hash;
+    rfx_tile_stats_proc rfx_tile_stats;
+    rfx_tile_solid_proc rfx_tile_solid;
+    rfx_alpha_delta_proc rfx_alpha_delta;
+    rfx_dwt_rem_proc rfx_dwt_rem;
+    const char *rfx_encode_name;
+    const char *rfx_rgb_to_yuv_name;
+    const char *rfx_tile_hash_name;
+    const char *rfx_tile_stats_name;
+    const char *rfx_tile_solid_name;
+    const char *rfx_alpha_delta_name;
+    const char *rfx_dwt_rem_name;
 
     int got_sse2;
     int got_sse3;
+    int got_ssse3;
     int got_sse41;
     int got_sse42;
     int got_sse4a;
     int got_popcnt;
     int got_lzcnt;
+    int got_avx2;
+    int got_avx512bw;
     int got_neon;
+
+    int num_threads;
+    struct rfx_thread_pool *threads;
+
+    /* RFX_FLAGS_TILE_HASH */
+    int hash_width;
+    int hash_height;
+    struct rfx_tile_hash *hashes;
+    struct rfx_tile *hash_tiles;
+    uint32 *hash_pending;
+    int hash_tiles_alloc;
+    int num_hash_tiles;
+    /* with rate control, unchanged tiles sent at a coarser level than
+       the finest, rfx_hash_refine */
+    struct rfx_tile *hash_refine;
+    int num_hash_refine;
+
+    /* rfxcodec_encode_set_tile_cache, shared with the tile workers */
+    struct rfx_tile_cache *tile_cache;
+
+    /* RFX_USE_STATS, only the counters are used */
+    struct rfx_encode_stats stats;
+
+    /* rfxcodec_encode_set_sink */
+    rfxcodec_encode_sink_proc sink;
+    void *sink_user;
+    int sink_tiles;
+
+    /* rfxcodec_encode_set_rate */
+    struct rfx_rate *rate;
+
+    /* rfxcodec_encode_damage, made on first use */
+    struct rfx_damage *damage;
+
+    /* rfxcodec_encode_progressive, made on first use */
+    struct rfx_progressive *progressive;
+    int reduce_extrapolate; /* RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE */
+
+    /* tiles of the last rfxcodec_encode call */
+    const struct rfx_tile *last_tiles;
+    int last_num_tiles;
+    /* and the quants and flags they are encoded with */
+    const char *last_quants;
+    int last_num_quants;
+    int last_flags;
+
+    /* rfx_encode_solid, RLGR output of a solid component for each
+       quantized DC value, solid_size 0 is not encoded yet */
+    int solid_mode;
+    uint8 solid_size[RFX_SOLID_DCS];
+    uint8 solid_bytes[RFX_SOLID_DCS][RFX_SOLID_BYTES];
+
+    /* rfx_encode_plane_flat, the alpha plane of a transparent, 0, and an
+       opaque, 1, tile, alpha_flat_size 0 is not packed yet */
+    int alpha_flat_size[2];
+    uint8 alpha_flat_bytes[2][RFX_ALPHA_FLAT_BYTES];
+
+    /* rfxcodec_encode_batch, the tiles are in these chunks of batch_pool */
+    struct rfx_thread_pool *batch_pool;
+    int batch_chunk;
+    int batch_num_chunks;
 };
 
 #endif
@@ -31,19 +31,23 @@
 #include "rfxencode.h"
 #include "rfxconstants.h"
 #include "rfxencode_tile.h"
+#include "rfxencode_alpha.h"
 
 #define LLOG_LEVEL 1
 #define LLOGLN(_level, _args) \
     do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
 
-#if 1
 /*****************************************************************************/
+/* delta of each line from the one above, the sign folded into bit 0, and
+   for each line the bits where a byte is the same as the next one, cx up
+   to 64 */
 static int
-fdelta(const char *in_plane, char *out_plane, int cx, int cy)
+fdelta(const uint8 *in_plane, uint8 *out_plane, uint64 *runs, int cx, int cy)
 {
-    char delta;
-    const char *src8;
-    char *dst8;
+    uint8 delta;
+    const uint8 *src8;
+    uint8 *dst8;
+    uint64 bits;
     int index;
     int jndex;
 
@@ -68,53 +72,30 @@ fdelta(const char *in_plane, char *out_plane, int cx, int cy)
             dst8++;
         }
     }
+    dst8 = out_plane;
+    for (jndex = 0; jndex < cy; jndex++)
+    {
+        bits = 0;
+        for (index = 0; index < cx - 1; index++)
+        {
+            if (dst8[index] == dst8[index + 1])
+            {
+                bits |= ((uint64) 1) << index;
+            }
+        }
+        runs[jndex] = bits;
+        dst8 += cx;
+    }
     return 0;
 }
-#endif
-
-#if 0
-/*****************************************************************************/
-#define DELTA_ONE \
-do { \
-    delta = src8[cx] - src8[0]; \
-    is_neg = (delta >> 7) & 1; \
-    dst8[cx] = (((delta ^ -is_neg) + is_neg) << 1) - is_neg; \
-    src8++; \
-    dst8++; \
-} while (0)
 
 /*****************************************************************************/
-static int
-fdelta(char *in_plane, char *out_plane, int cx, int cy)
+/* 64x64, the rfx_alpha_delta C function */
+int
+rfx_alpha_delta(const uint8 *plane, uint8 *delta_plane, uint64 *runs)
 {
-    char delta;
-    char is_neg;
-    char *src8;
-    char *dst8;
-    char *src8_end;
-
-    memcpy(out_plane, in_plane, cx);
-    src8 = in_plane;
-    dst8 = out_plane;
-    src8_end = src8 + (cx * cy - cx);
-    while (src8 + 8 <= src8_end)
-    {
-        DELTA_ONE;
-        DELTA_ONE;
-        DELTA_ONE;
-        DELTA_ONE;
-        DELTA_ONE;
-        DELTA_ONE;
-        DELTA_ONE;
-        DELTA_ONE;
-    }
-    while (src8 < src8_end)
-    {
-        DELTA_ONE;
-    }
-    return 0;
+    return fdelta(plane, delta_plane, runs, 64, 64);
 }
-#endif
 
 /*****************************************************************************/
 static int
@@ -184,14 +165,18 @@ fout(int collen, int replen, char *colptr, STREAM *s)
 }
 
 /*****************************************************************************/
+/* runs from fdelta, a set bit is a byte the same as the next one, so a
+   run of set or clear bits is done at once */
 static int
-fpack(char *plane, int cx, int cy, STREAM *s)
+fpack(char *plane, const uint64 *runs, int cx, int cy, STREAM *s)
 {
     char *ptr8;
     char *colptr;
-    char *lend;
     uint8 *holdp;
+    uint64 bits;
     int jndex;
+    int index;
+    int count;
     int collen;
     int replen;
 
@@ -201,7 +186,6 @@ fpack(char *plane, int cx, int cy, STREAM *s)
     {
         LLOGLN(10, ("line start line %d cx %d cy %d", jndex, cx, cy));
         ptr8 = (char *) (plane + jndex * cx);
-        lend = ptr8 + (cx - 1);
         colptr = ptr8;
         if (colptr[0] == 0)
         {
@@ -213,14 +197,29 @@ fpack(char *plane, int cx, int cy, STREAM *s)
             collen = 1;
             replen = 0;
         }
-        while (ptr8 < lend)
+        index = 0;
+        while (index < cx - 1)
         {
-            if (ptr8[0] == ptr8[1])
+            bits = runs[jndex] >> index;
+            if (bits & 1)
             {
-                replen++;
+                /* bytes the same as the next one */
+                GBSF64(~bits, count);
+                count = MIN(count, cx - 1 - index);
+                replen += count;
             }
             else
             {
+                if (bits == 0)
+                {
+                    count = cx - 1 - index;
+                }
+                else
+                {
+                    GBSF64(bits, count);
+                    count = MIN(count, cx - 1 - index);
+                }
+                /* the first byte not the same as the next one ends a run */
                 if (replen > 0)
                 {
                     if (replen < 3)
@@ -231,7 +230,7 @@ fpack(char *plane, int cx, int cy, STREAM *s)
                     else
                     {
                         fout(collen, replen, colptr, s);
-                        colptr = ptr8 + 1;
+                        colptr = ptr8 + index + 1;
                         replen = 0;
                         collen = 1;
                     }
@@ -240,8 +239,9 @@ fpack(char *plane, int cx, int cy, STREAM *s)
                 {
                     collen++;
                 }
+                collen += count - 1;
             }
-            ptr8++;
+            index += count;
         }
         /* end of line */
         fout(collen, replen, colptr, s);
@@ -250,25 +250,58 @@ fpack(char *plane, int cx, int cy, STREAM *s)
 }
 
 /*****************************************************************************/
-int
-rfx_encode_plane(struct rfxencode *enc, const uint8 *plane, int cx, int cy,
-                 STREAM *s)
+static int
+rfx_encode_plane_rle(struct rfxencode *enc, const uint8 *plane,
+                     int cx, int cy, STREAM *s)
 {
-    const char *org_plane;
     char *delta_plane;
     int bytes;
     uint8 *holdp;
+    uint64 runs[64];
+    STREAM side;
 
-    org_plane = (const char *) plane;
     delta_plane = (char *) (enc->dwt_buffer1);
-    fdelta(org_plane, delta_plane, cx, cy);
+    if ((cx == 64) && (cy == 64))
+    {
+        enc->rfx_alpha_delta(plane, (uint8 *) delta_plane, runs);
+    }
+    else
+    {
+        fdelta(plane, (uint8 *) delta_plane, runs, cx, cy);
+    }
     holdp = s->p;
-    stream_write_uint8(s, 0x10); /* flags, RLE */
-    bytes = fpack(delta_plane, cx, cy, s);
+    /* fpack does not check the size, see RFX_MAX_ALPHA_BYTES */
+    if (stream_get_left(s) >= 1 + cy * (cx + (cx + 14) / 15))
+    {
+        stream_write_uint8(s, 0x10); /* flags, RLE */
+        bytes = fpack(delta_plane, runs, cx, cy, s);
+    }
+    else
+    {
+        /* near the end of s, pack to the side and copy if it fits */
+        side.data = (uint8 *) (enc->dwt_buffer2);
+        side.p = side.data;
+        side.size = 4096 * sizeof(sint16);
+        bytes = fpack(delta_plane, runs, cx, cy, &side);
+        if (bytes <= cx * cy)
+        {
+            if (stream_get_left(s) < 1 + bytes)
+            {
+                return -1;
+            }
+            stream_write_uint8(s, 0x10); /* flags, RLE */
+            memcpy(s->p, side.data, bytes);
+            s->p += bytes;
+        }
+    }
     if (bytes > cx * cy)
     {
         LLOGLN(10, ("rfx_encode_plane: too big bytes %d", bytes));
         s->p = holdp;
+        if (stream_get_left(s) < cx * cy + 2)
+        {
+            return -1;
+        }
         stream_write_uint8(s, 0); /* flags */
         memcpy(s->p, plane, cx * cy);
         s->p += cx * cy;
@@ -281,3 +314,80 @@ rfx_encode_plane(struct rfxencode *enc, const uint8 *plane, int cx, int cy,
     }
     return bytes;
 }
+
+/*****************************************************************************/
+/* 1 if all 4096 bytes are the same as the first */
+static int
+rfx_plane_flat(const uint8 *plane)
+{
+    const uint64 *src64;
+    uint64 first;
+    uint64 diff;
+    int index;
+
+    src64 = (const uint64 *) plane;
+    first = plane[0] * 0x0101010101010101ULL;
+    for (index = 0; index < 512; index += 8)
+    {
+        diff = (src64[0] ^ first) | (src64[1] ^ first) |
+               (src64[2] ^ first) | (src64[3] ^ first) |
+               (src64[4] ^ first) | (src64[5] ^ first) |
+               (src64[6] ^ first) | (src64[7] ^ first);
+        if (diff != 0)
+        {
+            return 0;
+        }
+        src64 += 8;
+    }
+    return 1;
+}
+
+/*****************************************************************************/
+/* 64x64 of 0 or 255, transparent or opaque, the same every time so it is
+   packed once and copied after that */
+int
+rfx_encode_plane_flat(struct rfxencode *enc, int value, STREAM *s)
+{
+    int index;
+    int bytes;
+    STREAM flat;
+
+    index = value == 0 ? 0 : 1;
+    bytes = enc->alpha_flat_size[index];
+    if (bytes == 0)
+    {
+        memset(enc->a_buffer, value, 4096);
+        flat.data = enc->alpha_flat_bytes[index];
+        flat.p = flat.data;
+        flat.size = RFX_ALPHA_FLAT_BYTES;
+        if (rfx_encode_plane_rle(enc, enc->a_buffer, 64, 64, &flat) < 0)
+        {
+            return -1;
+        }
+        bytes = (int) (flat.p - flat.data);
+        LLOGLN(10, ("rfx_encode_plane_flat: value %d bytes %d",
+               value, bytes));
+        enc->alpha_flat_size[index] = bytes;
+    }
+    if (stream_get_left(s) < bytes)
+    {
+        return -1;
+    }
+    memcpy(s->p, enc->alpha_flat_bytes[index], bytes);
+    s->p += bytes;
+    /* the flags byte is not counted, as in rfx_encode_plane_rle */
+    return bytes - 1;
+}
+
+/*****************************************************************************/
+int
+rfx_encode_plane(struct rfxencode *enc, const uint8 *plane, int cx, int cy,
+                 STREAM *s)
+{
+    if ((cx == 64) && (cy == 64) &&
+        ((plane[0] == 0) || (plane[0] == 0xFF)) && rfx_plane_flat(plane))
+    {
+        return rfx_encode_plane_flat(enc, plane[0], s);
+    }
+    return rfx_encode_plane_rle(enc, plane, cx, cy, s);
+}
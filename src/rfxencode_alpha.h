@@ -20,9 +20,20 @@
 #ifndef __RFXCODEC_ENCODE_ALPHA_H
 #define __RFXCODEC_ENCODE_ALPHA_H
 
+/* most bytes rfx_encode_plane can write for a 64x64 plane, the RLE is
+   written out before it is checked against the raw size, a line is
+   its 64 bytes and 5 codes at worst, plus the flags byte
+   it returns -1 if what it keeps does not fit */
+#define RFX_MAX_ALPHA_BYTES (1 + 64 * (64 + 5))
+
+/* 64x64, the SIMD ones read one byte past the 4096 of delta_plane */
+int
+rfx_alpha_delta(const uint8 *plane, uint8 *delta_plane, uint64 *runs);
 int
 rfx_encode_plane(struct rfxencode *enc, const uint8 *plane, int cx, int cy,
                  STREAM *s);
+int
+rfx_encode_plane_flat(struct rfxencode *enc, int value, STREAM *s);
 
 #endif
 
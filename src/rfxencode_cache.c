@@ -0,0 +1,392 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Encoded tile cache
+ *
+ * Scrolling and window moves bring back tile contents that were already
+ * encoded, often at another tile position.  The cache keeps the whole
+ * CBT_TILE block of recently encoded tiles, keyed by a CRC32C of the
+ * pixels, the tile size, the quant values and the alpha flag.  The
+ * pixels are kept too and a hit must have the same ones, a CRC32C
+ * collision is a miss.  A hit is copied into the tileset and only the quant indices and xIdx / yIdx in
+ * the copy are rewritten.  The least recently used tiles are dropped to
+ * stay under max_bytes.  One cache is shared by all the tile workers so
+ * it has its own lock.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxencode_cache.h"
+#include "rfxencode_hash.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+/* used to size the hash table, a typical encoded tile */
+#define RFX_CACHE_AVG_TILE_BYTES 4096
+
+struct rfx_cache_entry
+{
+    struct rfx_cache_entry *hash_next;
+    struct rfx_cache_entry *lru_prev; /* more recently used */
+    struct rfx_cache_entry *lru_next; /* less recently used */
+    struct rfx_cache_key key;
+    int bytes;
+    int pixel_bytes;
+    /* bytes of CBT_TILE block follow, then pixel_bytes of pixels */
+};
+
+struct rfx_tile_cache
+{
+    pthread_mutex_t mutex;
+    struct rfx_cache_entry **buckets;
+    int num_buckets;
+    int max_bytes;
+    int bytes;
+    int num_entries;
+    struct rfx_cache_entry *lru_first;
+    struct rfx_cache_entry *lru_last;
+    int hits;
+    int misses;
+    int evictions;
+};
+
+/******************************************************************************/
+static int
+rfx_cache_key_equal(const struct rfx_cache_key *key1,
+                    const struct rfx_cache_key *key2)
+{
+    return (key1->hash == key2->hash) && (key1->cx == key2->cx) &&
+           (key1->cy == key2->cy) && (key1->alpha == key2->alpha) &&
+           (memcmp(key1->quants, key2->quants, 15) == 0);
+}
+
+/******************************************************************************/
+static int
+rfx_cache_pixel_bytes(const struct rfx_tile_pixels *pixels)
+{
+    int bytes;
+    int plane;
+
+    bytes = 0;
+    for (plane = 0; plane < pixels->num_planes; plane++)
+    {
+        bytes += pixels->row_bytes[plane] * pixels->rows[plane];
+    }
+    return bytes;
+}
+
+/******************************************************************************/
+/* 1 if entry is of the same key and pixels */
+static int
+rfx_cache_entry_equal(const struct rfx_cache_entry *entry,
+                      const struct rfx_cache_key *key,
+                      const struct rfx_tile_pixels *pixels, int pixel_bytes)
+{
+    const uint8 *src;
+    const char *row;
+    int plane;
+    int index;
+
+    if ((entry->pixel_bytes != pixel_bytes) ||
+        !rfx_cache_key_equal(&(entry->key), key))
+    {
+        return 0;
+    }
+    src = ((const uint8 *) (entry + 1)) + entry->bytes;
+    for (plane = 0; plane < pixels->num_planes; plane++)
+    {
+        row = pixels->data[plane];
+        for (index = 0; index < pixels->rows[plane]; index++)
+        {
+            if (memcmp(src, row, pixels->row_bytes[plane]) != 0)
+            {
+                return 0;
+            }
+            src += pixels->row_bytes[plane];
+            row += pixels->stride_bytes[plane];
+        }
+    }
+    return 1;
+}
+
+/******************************************************************************/
+static struct rfx_cache_entry **
+rfx_cache_bucket(struct rfx_tile_cache *cache, const struct rfx_cache_key *key)
+{
+    uint32 index;
+
+    index = key->hash ^ (key->hash >> 16) ^ (key->cx << 6) ^ key->cy;
+    return cache->buckets + (index & (cache->num_buckets - 1));
+}
+
+/******************************************************************************/
+static void
+rfx_cache_lru_remove(struct rfx_tile_cache *cache,
+                     struct rfx_cache_entry *entry)
+{
+    if (entry->lru_prev == 0)
+    {
+        cache->lru_first = entry->lru_next;
+    }
+    else
+    {
+        entry->lru_prev->lru_next = entry->lru_next;
+    }
+    if (entry->lru_next == 0)
+    {
+        cache->lru_last = entry->lru_prev;
+    }
+    else
+    {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    }
+}
+
+/******************************************************************************/
+static void
+rfx_cache_lru_add(struct rfx_tile_cache *cache, struct rfx_cache_entry *entry)
+{
+    entry->lru_prev = 0;
+    entry->lru_next = cache->lru_first;
+    if (cache->lru_first == 0)
+    {
+        cache->lru_last = entry;
+    }
+    else
+    {
+        cache->lru_first->lru_prev = entry;
+    }
+    cache->lru_first = entry;
+}
+
+/******************************************************************************/
+/* drop the least recently used entry */
+static void
+rfx_cache_evict(struct rfx_tile_cache *cache)
+{
+    struct rfx_cache_entry *entry;
+    struct rfx_cache_entry **pentry;
+
+    entry = cache->lru_last;
+    pentry = rfx_cache_bucket(cache, &(entry->key));
+    while (*pentry != entry)
+    {
+        pentry = &((*pentry)->hash_next);
+    }
+    *pentry = entry->hash_next;
+    rfx_cache_lru_remove(cache, entry);
+    cache->bytes -= sizeof(struct rfx_cache_entry) + entry->bytes +
+                    entry->pixel_bytes;
+    cache->num_entries--;
+    cache->evictions++;
+    free(entry);
+}
+
+/******************************************************************************/
+int
+rfx_cache_create(struct rfxencode *enc, int max_bytes)
+{
+    struct rfx_tile_cache *cache;
+    int num_buckets;
+
+    cache = xnew(struct rfx_tile_cache);
+    if (cache == 0)
+    {
+        return 1;
+    }
+    num_buckets = 64;
+    while ((num_buckets < (1 << 20)) &&
+           (num_buckets < max_bytes / RFX_CACHE_AVG_TILE_BYTES))
+    {
+        num_buckets <<= 1;
+    }
+    cache->buckets = (struct rfx_cache_entry **)
+                     calloc(num_buckets, sizeof(struct rfx_cache_entry *));
+    if (cache->buckets == 0)
+    {
+        free(cache);
+        return 1;
+    }
+    cache->num_buckets = num_buckets;
+    cache->max_bytes = max_bytes;
+    pthread_mutex_init(&(cache->mutex), 0);
+    enc->tile_cache = cache;
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_cache_delete(struct rfxencode *enc)
+{
+    struct rfx_tile_cache *cache;
+    struct rfx_cache_entry *entry;
+    struct rfx_cache_entry *next;
+
+    cache = enc->tile_cache;
+    if (cache == 0)
+    {
+        return 0;
+    }
+    entry = cache->lru_first;
+    while (entry != 0)
+    {
+        next = entry->lru_next;
+        free(entry);
+        entry = next;
+    }
+    pthread_mutex_destroy(&(cache->mutex));
+    free(cache->buckets);
+    free(cache);
+    enc->tile_cache = 0;
+    return 0;
+}
+
+/******************************************************************************/
+/* on a hit the cached block is copied to s and 0 is returned */
+int
+rfx_cache_get(struct rfx_tile_cache *cache, const struct rfx_cache_key *key,
+              const struct rfx_tile_pixels *pixels, STREAM *s)
+{
+    struct rfx_cache_entry *entry;
+    int pixel_bytes;
+
+    pixel_bytes = rfx_cache_pixel_bytes(pixels);
+    pthread_mutex_lock(&(cache->mutex));
+    entry = *rfx_cache_bucket(cache, key);
+    while (entry != 0)
+    {
+        if (rfx_cache_entry_equal(entry, key, pixels, pixel_bytes))
+        {
+            break;
+        }
+        entry = entry->hash_next;
+    }
+    if ((entry == 0) || (stream_get_left(s) < entry->bytes))
+    {
+        cache->misses++;
+        pthread_mutex_unlock(&(cache->mutex));
+        return 1;
+    }
+    memcpy(s->p, entry + 1, entry->bytes);
+    s->p += entry->bytes;
+    if (entry != cache->lru_first)
+    {
+        rfx_cache_lru_remove(cache, entry);
+        rfx_cache_lru_add(cache, entry);
+    }
+    cache->hits++;
+    pthread_mutex_unlock(&(cache->mutex));
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_cache_put(struct rfx_tile_cache *cache, const struct rfx_cache_key *key,
+              const struct rfx_tile_pixels *pixels,
+              const uint8 *data, int bytes)
+{
+    struct rfx_cache_entry *entry;
+    struct rfx_cache_entry **pentry;
+    uint8 *dst;
+    const char *row;
+    int entry_bytes;
+    int pixel_bytes;
+    int plane;
+    int index;
+
+    pixel_bytes = rfx_cache_pixel_bytes(pixels);
+    entry_bytes = sizeof(struct rfx_cache_entry) + bytes + pixel_bytes;
+    if (entry_bytes > cache->max_bytes)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&(cache->mutex));
+    /* another worker may have put the same tile */
+    pentry = rfx_cache_bucket(cache, key);
+    for (entry = *pentry; entry != 0; entry = entry->hash_next)
+    {
+        if (rfx_cache_entry_equal(entry, key, pixels, pixel_bytes))
+        {
+            pthread_mutex_unlock(&(cache->mutex));
+            return 0;
+        }
+    }
+    while (cache->bytes + entry_bytes > cache->max_bytes)
+    {
+        rfx_cache_evict(cache);
+    }
+    entry = (struct rfx_cache_entry *) malloc(entry_bytes);
+    if (entry == 0)
+    {
+        pthread_mutex_unlock(&(cache->mutex));
+        return 1;
+    }
+    entry->key = *key;
+    entry->bytes = bytes;
+    entry->pixel_bytes = pixel_bytes;
+    memcpy(entry + 1, data, bytes);
+    dst = ((uint8 *) (entry + 1)) + bytes;
+    for (plane = 0; plane < pixels->num_planes; plane++)
+    {
+        row = pixels->data[plane];
+        for (index = 0; index < pixels->rows[plane]; index++)
+        {
+            memcpy(dst, row, pixels->row_bytes[plane]);
+            dst += pixels->row_bytes[plane];
+            row += pixels->stride_bytes[plane];
+        }
+    }
+    entry->hash_next = *pentry;
+    *pentry = entry;
+    rfx_cache_lru_add(cache, entry);
+    cache->bytes += entry_bytes;
+    cache->num_entries++;
+    LLOGLN(10, ("rfx_cache_put: %d entries %d bytes",
+           cache->num_entries, cache->bytes));
+    pthread_mutex_unlock(&(cache->mutex));
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_cache_get_stats(struct rfx_tile_cache *cache,
+                    struct rfx_tile_cache_stats *stats)
+{
+    pthread_mutex_lock(&(cache->mutex));
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->num_entries = cache->num_entries;
+    stats->bytes = cache->bytes;
+    pthread_mutex_unlock(&(cache->mutex));
+    return 0;
+}
@@ -0,0 +1,51 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_CACHE_H
+#define __RFXENCODE_CACHE_H
+
+#include "rfxcommon.h"
+
+struct rfx_tile_pixels;
+
+struct rfx_cache_key
+{
+    uint32 hash; /* CRC32C of the tile pixels */
+    int cx;
+    int cy;
+    int alpha;
+    uint8 quants[15]; /* the y, cb and cr quant values */
+    uint8 pad0[1];
+};
+
+int
+rfx_cache_create(struct rfxencode *enc, int max_bytes);
+int
+rfx_cache_delete(struct rfxencode *enc);
+int
+rfx_cache_get(struct rfx_tile_cache *cache, const struct rfx_cache_key *key,
+              const struct rfx_tile_pixels *pixels, STREAM *s);
+int
+rfx_cache_put(struct rfx_tile_cache *cache, const struct rfx_cache_key *key,
+              const struct rfx_tile_pixels *pixels,
+              const uint8 *data, int bytes);
+int
+rfx_cache_get_stats(struct rfx_tile_cache *cache,
+                    struct rfx_tile_cache_stats *stats);
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * The cpuid probe of rfxcodec_encode_create, done by the first create
+ * of the process under pthread_once and kept for the rest.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "rfxencode_cpu.h"
+
+#ifdef RFX_USE_ACCEL_X86
+#include "x86/funcs_x86.h"
+#endif
+
+#ifdef RFX_USE_ACCEL_AMD64
+#include "amd64/funcs_amd64.h"
+#endif
+
+static struct rfx_cpu g_cpu;
+static pthread_once_t g_cpu_once = PTHREAD_ONCE_INIT;
+
+/******************************************************************************/
+static void
+rfx_cpu_probe(void)
+{
+    int ax;
+    int bx;
+    int cx;
+    int dx;
+#if defined(RFX_USE_ACCEL_AMD64)
+    int xcr0;
+#endif
+
+#if defined(RFX_USE_ACCEL_X86)
+    cpuid_x86(1, 0, &ax, &bx, &cx, &dx);
+#elif defined(RFX_USE_ACCEL_AMD64)
+    cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
+#else
+    ax = 0;
+    bx = 0;
+    cx = 0;
+    dx = 0;
+#endif
+    g_cpu.got_sse2 = (dx & (1 << 26)) != 0; /* SSE 2 */
+    g_cpu.got_sse3 = (cx & (1 << 0)) != 0; /* SSE 3 */
+    g_cpu.got_ssse3 = (cx & (1 << 9)) != 0; /* SSSE 3 */
+    g_cpu.got_sse41 = (cx & (1 << 19)) != 0; /* SSE 4.1 */
+    g_cpu.got_sse42 = (cx & (1 << 20)) != 0; /* SSE 4.2 */
+    g_cpu.got_popcnt = (cx & (1 << 23)) != 0; /* popcnt */
+#if defined(RFX_USE_ACCEL_X86)
+    cpuid_x86(0x80000001, 0, &ax, &bx, &cx, &dx);
+#elif defined(RFX_USE_ACCEL_AMD64)
+    cpuid_amd64(0x80000001, 0, &ax, &bx, &cx, &dx);
+#else
+    ax = 0;
+    bx = 0;
+    cx = 0;
+    dx = 0;
+#endif
+    g_cpu.got_lzcnt = (cx & (1 << 5)) != 0; /* lzcnt */
+    g_cpu.got_sse4a = (cx & (1 << 6)) != 0; /* SSE 4.a */
+#if defined(RFX_USE_ACCEL_AMD64)
+    /* AVX2 needs the OS to save the ymm registers */
+    cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
+    if ((cx & (1 << 27)) && (cx & (1 << 28))) /* OSXSAVE and AVX */
+    {
+        xgetbv_amd64(0, &ax, &dx);
+        xcr0 = ax;
+        if ((xcr0 & 6) == 6) /* xmm and ymm state */
+        {
+            cpuid_amd64(7, 0, &ax, &bx, &cx, &dx);
+            g_cpu.got_avx2 = (bx & (1 << 5)) != 0; /* AVX2 */
+            /* AVX-512 also needs the opmask and zmm state */
+            g_cpu.got_avx512bw = ((xcr0 & 0xE0) == 0xE0) &&
+                                 (bx & (1 << 16)) &&
+                                 (bx & (1 << 30)); /* AVX512F and BW */
+        }
+    }
+#endif
+    if ((ax == 0) && (bx == 0))
+    {
+    }
+}
+
+/******************************************************************************/
+const struct rfx_cpu *
+rfx_cpu_get(void)
+{
+    pthread_once(&g_cpu_once, rfx_cpu_probe);
+    return &g_cpu;
+}
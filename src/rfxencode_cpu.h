@@ -0,0 +1,40 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_CPU_H
+#define __RFXENCODE_CPU_H
+
+/* what the cpu can run, found once for the process */
+struct rfx_cpu
+{
+    int got_sse2;
+    int got_sse3;
+    int got_ssse3;
+    int got_sse41;
+    int got_sse42;
+    int got_sse4a;
+    int got_popcnt;
+    int got_lzcnt;
+    int got_avx2;
+    int got_avx512bw;
+};
+
+const struct rfx_cpu *
+rfx_cpu_get(void);
+
+#endif
@@ -0,0 +1,448 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Damage to tiles, rfxcodec_encode_damage
+ *
+ * Each rect sets the bits of the 64x64 tiles it touches in a bitmap of
+ * one bit per tile, a row of words per tile row, so overlapping rects
+ * cost nothing more.  The set bits are then read out row by row, in
+ * runs, as the tiles.
+ *
+ * The regions are the union of the clipped rects, in bands.  The rects
+ * are sorted by top, the band edges are every top and bottom, and for
+ * each band the rects that cover it, kept in x order as they start and
+ * end, are merged into runs.  A band with the same runs as the one right
+ * above grows those rects down instead, so a block of damage is one
+ * rect.  Where the bands need more rects than there are damage rects,
+ * crossing bars for one, the clipped damage rects are the regions, they
+ * can overlap but their union is the same.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxencode_damage.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+struct rfx_damage
+{
+    int tiles_x;
+    int tiles_y;
+    int words; /* per tile row */
+    uint32 *bits;
+    /* clipped damage rects by top, band edges and the rects of a band */
+    int rects_alloc;
+    int num_rects;
+    struct rfx_rect *rects;
+    int *edges;
+    int *active;
+};
+
+/******************************************************************************/
+static int
+rfx_damage_create(struct rfxencode *enc)
+{
+    struct rfx_damage *damage;
+
+    damage = (struct rfx_damage *) calloc(1, sizeof(struct rfx_damage));
+    if (damage == 0)
+    {
+        return 1;
+    }
+    damage->tiles_x = (enc->width + 63) / 64;
+    damage->tiles_y = (enc->height + 63) / 64;
+    damage->words = (damage->tiles_x + 31) / 32;
+    damage->bits = (uint32 *) calloc(damage->words * damage->tiles_y,
+                                     sizeof(uint32));
+    enc->damage = damage;
+    if (damage->bits == 0)
+    {
+        rfx_damage_delete(enc);
+        return 1;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_damage_delete(struct rfxencode *enc)
+{
+    if (enc->damage == 0)
+    {
+        return 0;
+    }
+    free(enc->damage->bits);
+    free(enc->damage->rects);
+    free(enc->damage->edges);
+    free(enc->damage->active);
+    free(enc->damage);
+    enc->damage = 0;
+    return 0;
+}
+
+/******************************************************************************/
+/* room for num_rects rects and 2 edges each */
+static int
+rfx_damage_alloc(struct rfx_damage *damage, int num_rects)
+{
+    struct rfx_rect *rects;
+    int *edges;
+    int *active;
+
+    if (num_rects <= damage->rects_alloc)
+    {
+        return 0;
+    }
+    rects = (struct rfx_rect *)
+            realloc(damage->rects, num_rects * sizeof(struct rfx_rect));
+    if (rects == 0)
+    {
+        return 1;
+    }
+    damage->rects = rects;
+    edges = (int *) realloc(damage->edges, 2 * num_rects * sizeof(int));
+    if (edges == 0)
+    {
+        return 1;
+    }
+    damage->edges = edges;
+    active = (int *) realloc(damage->active, num_rects * sizeof(int));
+    if (active == 0)
+    {
+        return 1;
+    }
+    damage->active = active;
+    damage->rects_alloc = num_rects;
+    return 0;
+}
+
+/******************************************************************************/
+/* qsort, by top then left */
+static int
+rfx_damage_rect_cmp(const void *a, const void *b)
+{
+    const struct rfx_rect *ra = (const struct rfx_rect *) a;
+    const struct rfx_rect *rb = (const struct rfx_rect *) b;
+
+    if (ra->y != rb->y)
+    {
+        return ra->y < rb->y ? -1 : 1;
+    }
+    if (ra->x != rb->x)
+    {
+        return ra->x < rb->x ? -1 : 1;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* qsort */
+static int
+rfx_damage_int_cmp(const void *a, const void *b)
+{
+    int ia = *((const int *) a);
+    int ib = *((const int *) b);
+
+    return ia < ib ? -1 : (ia > ib ? 1 : 0);
+}
+
+/******************************************************************************/
+/* set bits first to last of row */
+static void
+rfx_damage_set_bits(uint32 *row, int first, int last)
+{
+    uint32 mask;
+    int word;
+    int last_word;
+
+    word = first >> 5;
+    last_word = last >> 5;
+    mask = 0xFFFFFFFF << (first & 31);
+    while (word < last_word)
+    {
+        row[word] |= mask;
+        mask = 0xFFFFFFFF;
+        word++;
+    }
+    row[word] |= mask & (0xFFFFFFFF >> (31 - (last & 31)));
+}
+
+/******************************************************************************/
+/* the tiles rect touches, and rect clipped to the surface */
+static void
+rfx_damage_add(struct rfxencode *enc, const struct rfx_rect *rect)
+{
+    struct rfx_damage *damage;
+    struct rfx_rect *clip;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+    int tile_y;
+
+    damage = enc->damage;
+    x1 = MAX(rect->x, 0);
+    y1 = MAX(rect->y, 0);
+    x2 = MIN(rect->x + rect->cx, enc->width);
+    y2 = MIN(rect->y + rect->cy, enc->height);
+    if ((x1 >= x2) || (y1 >= y2))
+    {
+        return;
+    }
+    clip = damage->rects + damage->num_rects;
+    clip->x = x1;
+    clip->y = y1;
+    clip->cx = x2 - x1;
+    clip->cy = y2 - y1;
+    damage->num_rects++;
+    for (tile_y = y1 / 64; tile_y <= (y2 - 1) / 64; tile_y++)
+    {
+        rfx_damage_set_bits(damage->bits + tile_y * damage->words,
+                            x1 / 64, (x2 - 1) / 64);
+    }
+}
+
+/******************************************************************************/
+/* the union of the clipped rects as bands, 1 if it needs more than
+   damage->num_rects rects */
+static int
+rfx_damage_bands(struct rfx_damage *damage,
+                 struct rfx_rect *regions, int *num_regions)
+{
+    const struct rfx_rect *rect;
+    struct rfx_rect *region;
+    int num_edges;
+    int num_active;
+    int next;
+    int edge;
+    int index;
+    int count;
+    int above;
+    int num_above;
+    int y1;
+    int y2;
+    int x1;
+    int x2;
+
+    qsort(damage->rects, damage->num_rects, sizeof(struct rfx_rect),
+          rfx_damage_rect_cmp);
+    num_edges = 0;
+    for (index = 0; index < damage->num_rects; index++)
+    {
+        rect = damage->rects + index;
+        damage->edges[num_edges++] = rect->y;
+        damage->edges[num_edges++] = rect->y + rect->cy;
+    }
+    qsort(damage->edges, num_edges, sizeof(int), rfx_damage_int_cmp);
+    *num_regions = 0;
+    num_active = 0;
+    next = 0;
+    above = 0;
+    num_above = 0;
+    for (edge = 0; edge + 1 < num_edges; edge++)
+    {
+        y1 = damage->edges[edge];
+        y2 = damage->edges[edge + 1];
+        if (y1 == y2)
+        {
+            continue;
+        }
+        /* drop the rects that end above the band */
+        count = 0;
+        for (index = 0; index < num_active; index++)
+        {
+            rect = damage->rects + damage->active[index];
+            if (rect->y + rect->cy > y1)
+            {
+                damage->active[count++] = damage->active[index];
+            }
+        }
+        num_active = count;
+        /* add the ones that start at its top, in x order */
+        while ((next < damage->num_rects) && (damage->rects[next].y == y1))
+        {
+            index = num_active;
+            while ((index > 0) &&
+                   (damage->rects[damage->active[index - 1]].x >
+                    damage->rects[next].x))
+            {
+                damage->active[index] = damage->active[index - 1];
+                index--;
+            }
+            damage->active[index] = next;
+            num_active++;
+            next++;
+        }
+        if (num_active < 1)
+        {
+            num_above = 0;
+            continue;
+        }
+        /* merge the runs */
+        count = *num_regions;
+        rect = damage->rects + damage->active[0];
+        x1 = rect->x;
+        x2 = rect->x + rect->cx;
+        for (index = 1; index <= num_active; index++)
+        {
+            if (index < num_active)
+            {
+                rect = damage->rects + damage->active[index];
+                if (rect->x <= x2)
+                {
+                    x2 = MAX(x2, rect->x + rect->cx);
+                    continue;
+                }
+            }
+            if (*num_regions >= damage->num_rects)
+            {
+                return 1;
+            }
+            region = regions + *num_regions;
+            region->x = x1;
+            region->y = y1;
+            region->cx = x2 - x1;
+            region->cy = y2 - y1;
+            (*num_regions)++;
+            if (index < num_active)
+            {
+                x1 = rect->x;
+                x2 = rect->x + rect->cx;
+            }
+        }
+        /* the same runs right above grow down */
+        count = *num_regions - count;
+        if ((count == num_above) &&
+            (regions[above].y + regions[above].cy == y1))
+        {
+            region = regions + above;
+            for (index = 0; index < count; index++)
+            {
+                if ((region[index].x != region[count + index].x) ||
+                    (region[index].cx != region[count + index].cx))
+                {
+                    break;
+                }
+            }
+            if (index == count)
+            {
+                for (index = 0; index < count; index++)
+                {
+                    regions[above + index].cy += y2 - y1;
+                }
+                *num_regions -= count;
+                continue;
+            }
+        }
+        above = *num_regions - count;
+        num_above = count;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_damage_tiles(struct rfxencode *enc,
+                 const struct rfx_rect *damage_rects, int num_damage,
+                 struct rfx_rect *regions, int *num_regions,
+                 struct rfx_tile *tiles, int *num_tiles)
+{
+    struct rfx_damage *damage;
+    struct rfx_tile *tile;
+    const uint32 *row;
+    uint32 word;
+    int tile_x;
+    int tile_y;
+    int y;
+    int cy;
+    int index;
+
+    if (enc->damage == 0)
+    {
+        if (rfx_damage_create(enc) != 0)
+        {
+            return 1;
+        }
+    }
+    damage = enc->damage;
+    if (rfx_damage_alloc(damage, num_damage) != 0)
+    {
+        return 1;
+    }
+    memset(damage->bits, 0,
+           damage->words * damage->tiles_y * sizeof(uint32));
+    damage->num_rects = 0;
+    for (index = 0; index < num_damage; index++)
+    {
+        rfx_damage_add(enc, damage_rects + index);
+    }
+    *num_tiles = 0;
+    for (tile_y = 0; tile_y < damage->tiles_y; tile_y++)
+    {
+        row = damage->bits + tile_y * damage->words;
+        y = tile_y * 64;
+        cy = MIN(64, enc->height - y);
+        tile_x = 0;
+        while (tile_x < damage->tiles_x)
+        {
+            word = row[tile_x >> 5] >> (tile_x & 31);
+            if (word == 0)
+            {
+                /* none left in this word */
+                tile_x = (tile_x | 31) + 1;
+                continue;
+            }
+            if (word & 1)
+            {
+                tile = tiles + *num_tiles;
+                tile->x = tile_x * 64;
+                tile->y = y;
+                tile->cx = MIN(64, enc->width - tile->x);
+                tile->cy = cy;
+                tile->quant_y = 0;
+                tile->quant_cb = 0;
+                tile->quant_cr = 0;
+                (*num_tiles)++;
+            }
+            tile_x++;
+        }
+    }
+    if (rfx_damage_bands(damage, regions, num_regions) != 0)
+    {
+        /* too many bands, the clipped rects have the same union */
+        memcpy(regions, damage->rects,
+               damage->num_rects * sizeof(struct rfx_rect));
+        *num_regions = damage->num_rects;
+    }
+    LLOGLN(10, ("rfx_damage_tiles: num_damage %d num_regions %d num_tiles %d",
+           num_damage, *num_regions, *num_tiles));
+    return 0;
+}
@@ -0,0 +1,32 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_DAMAGE_H
+#define __RFXENCODE_DAMAGE_H
+
+#include "rfxcommon.h"
+
+int
+rfx_damage_delete(struct rfxencode *enc);
+int
+rfx_damage_tiles(struct rfxencode *enc,
+                 const struct rfx_rect *damage, int num_damage,
+                 struct rfx_rect *regions, int *num_regions,
+                 struct rfx_tile *tiles, int *num_tiles);
+
+#endif
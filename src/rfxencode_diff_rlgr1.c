@@ -21,6 +21,12 @@
 /**
  * This implementation of RLGR refers to
  * [MS-RDPRFX] 3.1.8.1.7.3 RLGR1/RLGR3 Pseudocode
+ *
+ * The bits are collected in a 64 bit accumulator and written out 32 bits
+ * at a time, zero runs are skipped 4 coefficients at a time, 8 with SSE2
+ * where the zeros before the first nonzero come from the compare mask.
+ * Output is the same as rfx_rlgr1_encode after rfx_differential_encode,
+ * -1 is returned if it does not fit in cdata_size bytes.
  */
 
 #if defined(HAVE_CONFIG_H)
@@ -33,6 +39,10 @@
 
 #include "rfxcommon.h"
 
+#if defined(RFX_USE_ACCEL_AMD64)
+#include <emmintrin.h>
+#endif
+
 #define PIXELS_IN_TILE 4096
 
 /* Constants used within the RLGR1/RLGR3 algorithm */
@@ -49,12 +59,38 @@
     coef_size--; \
 } while (0)
 
+#if defined(__GNUC__) && (defined(__x86__) || defined(__x86_64__) || \
+    defined(__AMD64__) || defined(__i386__))
+#define WriteBits32(_p, _v) do { \
+    uint32 lv = __builtin_bswap32(_v); \
+    memcpy(_p, &lv, 4); \
+} while (0)
+#else
+#define WriteBits32(_p, _v) do { \
+    (_p)[0] = (uint8) ((_v) >> 24); \
+    (_p)[1] = (uint8) ((_v) >> 16); \
+    (_p)[2] = (uint8) ((_v) >> 8); \
+    (_p)[3] = (uint8) (_v); \
+} while (0)
+#endif
+
+/* _n must be 32 or less and bit_count less than 32 */
+#define PutBits(_n, _v) do { \
+    bits = (bits << (_n)) | (_v); \
+    bit_count += (_n); \
+} while (0)
+
+/* keeps bit_count less than 32 */
 #define CheckWrite do { \
-    while (bit_count >= 8) \
+    if (bit_count >= 32) \
     { \
-        bit_count -= 8; \
-        *cdata = bits >> bit_count; \
-        cdata++; \
+        if (cdata + 4 > cdata_end) \
+        { \
+            return -1; \
+        } \
+        bit_count -= 32; \
+        WriteBits32(cdata, (uint32) (bits >> bit_count)); \
+        cdata += 4; \
     } \
 } while (0)
 
@@ -64,27 +100,18 @@
     /* unary part of GR code */ \
     int lvk = _lmag >> lkr; \
     int llvk = lvk; \
-    while (llvk >= 8) \
+    while (llvk >= 32) \
     { \
-        bits <<= 8; \
-        bits |= 0xFF; \
-        llvk -= 8; \
-        *cdata = bits >> bit_count; \
-        cdata++; \
+        PutBits(32, 0xFFFFFFFF); \
+        CheckWrite; \
+        llvk -= 32; \
     } \
-    bits <<= llvk; \
-    bits |= (1 << llvk) - 1; \
-    bit_count += llvk; \
-    bits <<= 1; \
-    bit_count++; \
+    /* llvk 1s and a 0 */ \
+    PutBits(llvk + 1, (((uint64) 1) << (llvk + 1)) - 2); \
+    CheckWrite; \
+    /* remainder part of GR code, lkr can be 0 */ \
+    PutBits(lkr, _lmag & ((1 << lkr) - 1)); \
     CheckWrite; \
-    /* remainder part of GR code, if needed */ \
-    if (lkr) \
-    { \
-        bits <<= lkr; \
-        bits |= _lmag & ((1 << lkr) - 1); \
-        bit_count += lkr; \
-    } \
     /* update _krp, only if it is not equal to 1 */ \
     if (lvk == 0) \
     { \
@@ -114,8 +141,14 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
     int y;
 
     int bit_count;
-    unsigned int bits;
+    uint64 bits;
+    uint64 word;
+#if defined(RFX_USE_ACCEL_AMD64)
+    int mask;
+    int zeros;
+#endif
     uint8 *cdata_org;
+    uint8 *cdata_end;
 
     uint32 twoMs;
 
@@ -133,6 +166,7 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
     bit_count = 0;
     bits = 0;
     cdata_org = cdata;
+    cdata_end = cdata + cdata_size;
 
     /* process all the input coefficients */
     coef_size = PIXELS_IN_TILE;
@@ -143,8 +177,41 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
 
             /* RUN-LENGTH MODE */
 
-            /* collect the run of zeros in the input stream */
+            /* collect the run of zeros in the input stream, 4 at a time
+               while at least one is left after them */
             numZeros = 0;
+#if defined(RFX_USE_ACCEL_AMD64)
+            while (coef_size > 8)
+            {
+                /* 2 bits for each zero coefficient */
+                mask = _mm_movemask_epi8(_mm_cmpeq_epi16(
+                           _mm_loadu_si128((const __m128i *) coef),
+                           _mm_setzero_si128()));
+                if (mask != 0xFFFF)
+                {
+                    GBSF64((uint64) (~mask & 0xFFFF), zeros);
+                    zeros >>= 1;
+                    coef += zeros;
+                    coef_size -= zeros;
+                    numZeros += zeros;
+                    break;
+                }
+                coef += 8;
+                coef_size -= 8;
+                numZeros += 8;
+            }
+#endif
+            while (coef_size > 4)
+            {
+                memcpy(&word, coef, 8);
+                if (word != 0)
+                {
+                    break;
+                }
+                coef += 4;
+                coef_size -= 4;
+                numZeros += 4;
+            }
 
             GetNextInput;
             while (input == 0 && coef_size > 0)
@@ -171,18 +238,6 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
                 runmax = 1 << k;
             }
 
-            /* output a 1 to terminate runs */
-            bits <<= 1;
-            bits |= 1;
-            bit_count++;
-
-            /* output the remaining run length using k bits */
-            bits <<= k;
-            bits |= numZeros;
-            bit_count += k;
-
-            CheckWrite;
-
             /* encode the nonzero value using GR coding */
             if (input < 0)
             {
@@ -195,14 +250,14 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
                 sign = 0;
             }
 
-            bits <<= 1;
-            bits |= sign;
-            bit_count++;
+            /* output a 1 to terminate runs, the remaining run length
+               using k bits and the sign */
+            PutBits(k + 2, (((1 << k) | numZeros) << 1) | sign);
+            CheckWrite;
 
             lmag = mag ? mag - 1 : 0;
 
             CodeGR(krp, lmag); /* output GR code for (mag - 1) */
-            CheckWrite;
 
             kp = MAX(0, kp - DN_GR);
             k = kp >> LSGR;
@@ -220,7 +275,6 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
             y = input >> 15;
             twoMs = (((input ^ y) - y) << 1) + y;
             CodeGR(krp, twoMs);
-            CheckWrite;
 
             /* update k, kp */
             if (twoMs)
@@ -237,6 +291,17 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
         }
     }
 
+    /* what is left, less than 32 bits, padded to a byte */
+    if (cdata + ((bit_count + 7) >> 3) > cdata_end)
+    {
+        return -1;
+    }
+    while (bit_count >= 8)
+    {
+        bit_count -= 8;
+        *cdata = bits >> bit_count;
+        cdata++;
+    }
     if (bit_count > 0)
     {
         bits <<= 8 - bit_count;
@@ -249,4 +314,3 @@ rfx_encode_diff_rlgr1(sint16 *coef, uint8 *cdata, int cdata_size)
 
     return processed_size;
 }
-
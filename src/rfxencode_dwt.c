@@ -220,3 +220,111 @@ rfx_dwt_2d_encode(const uint8 *in_buffer, sint16 *buffer, sint16 *dwt_buffer)
     rfx_dwt_2d_encode_block(buffer + 3840, dwt_buffer, 8);
     return 0;
 }
+
+/******************************************************************************/
+/* reduce extrapolate DWT of count values src_step apart, the count / 2 + 1
+   L values go in l and the rest, the H values, in h, dst_step apart
+   an even count has one more value, 2 * src[count - 1] - src[count - 2],
+   so the last H is 0 and not kept */
+static void
+rfx_dwt_rem_1d(const sint16 *src, int src_step, sint16 *l, sint16 *h,
+               int dst_step, int count)
+{
+    int half;
+    int num_h;
+    int n;
+    int x0, x1, x2;
+    int h0, h1;
+
+    half = count >> 1;
+    num_h = count - half - 1;
+    x0 = src[0];
+    h0 = 0;
+    for (n = 0; n < half; n++)
+    {
+        x1 = src[(2 * n + 1) * src_step];
+        if (2 * n + 2 < count)
+        {
+            x2 = src[(2 * n + 2) * src_step];
+        }
+        else
+        {
+            x2 = 2 * x1 - x0;
+        }
+        h1 = (x1 - ((x0 + x2) >> 1)) >> 1;
+        if (n == 0)
+        {
+            h0 = h1;
+        }
+        l[n * dst_step] = x0 + ((h0 + h1) >> 1);
+        if (n < num_h)
+        {
+            h[n * dst_step] = h1;
+        }
+        h0 = h1;
+        x0 = x2;
+    }
+    l[half * dst_step] = x0 + h0;
+}
+
+/******************************************************************************/
+/* count x count values in src to 4 sub-bands in HL, LH, HH, LL order in
+   buffer, count / 2 + 1 L and the rest H in each direction */
+static int
+rfx_dwt_rem_block(const sint16 *src, sint16 *buffer, sint16 *dwt, int count)
+{
+    sint16 *hl, *lh, *hh, *ll;
+    int num_l;
+    int num_h;
+    int x, y;
+
+    num_l = (count >> 1) + 1;
+    num_h = count - num_l;
+
+    /* DWT in vertical direction, results in L rows then H rows in tmp
+     * buffer dwt. */
+    for (x = 0; x < count; x++)
+    {
+        rfx_dwt_rem_1d(src + x, count, dwt + x, dwt + num_l * count + x,
+                       count, count);
+    }
+
+    /* DWT in horizontal direction, L rows give LL and HL, H rows LH
+     * and HH. */
+    hl = buffer;
+    lh = hl + num_l * num_h;
+    hh = lh + num_h * num_l;
+    ll = hh + num_h * num_h;
+    for (y = 0; y < num_l; y++)
+    {
+        rfx_dwt_rem_1d(dwt + y * count, 1, ll + y * num_l, hl + y * num_h,
+                       1, count);
+    }
+    for (y = 0; y < num_h; y++)
+    {
+        rfx_dwt_rem_1d(dwt + (num_l + y) * count, 1, lh + y * num_l,
+                       hh + y * num_h, 1, count);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* reduce extrapolate DWT, the MS-RDPEGFX RFX_DWT_REDUCE_EXTRAPOLATE
+   transform, HL1, LH1, HH1 at 0, 1023, 2046, HL2, LH2, HH2 at 3007, 3279,
+   3551 and HL3, LH3, HH3, LL3 at 3807, 3879, 3951, 4015 in buffer
+   dwt_buffer2 is not used, the SIMD versions need it */
+int
+rfx_dwt_2d_encode_rem(const uint8 *in_buffer, sint16 *buffer,
+                      sint16 *dwt_buffer, sint16 *dwt_buffer2)
+{
+    int index;
+
+    for (index = 0; index < 4096; index++)
+    {
+        buffer[index] = (in_buffer[index] - 128) << DWT_FACTOR;
+    }
+    rfx_dwt_rem_block(buffer, buffer, dwt_buffer, 64);
+    rfx_dwt_rem_block(buffer + 3007, buffer + 3007, dwt_buffer, 33);
+    rfx_dwt_rem_block(buffer + 3807, buffer + 3807, dwt_buffer, 17);
+    return 0;
+}
@@ -21,5 +21,8 @@
 
 int
 rfx_dwt_2d_encode(const uint8 *in_buffer, sint16 *buffer, sint16 *dwt_buffer);
+int
+rfx_dwt_2d_encode_rem(const uint8 *in_buffer, sint16 *buffer,
+                      sint16 *dwt_buffer, sint16 *dwt_buffer2);
 
 #endif
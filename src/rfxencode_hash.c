@@ -0,0 +1,500 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Unchanged tile detection
+ *
+ * With RFX_FLAGS_TILE_HASH, a CRC32C of each 64x64 tile of the surface is
+ * kept and tiles with the same CRC as the last frame are dropped before
+ * any colour conversion or transform.  With rate control the level each
+ * tile was sent at is kept too, the unchanged tiles that were sent at a
+ * coarser level than the finest are kept aside and rate control sends
+ * them again, rfx_hash_refine, when it has room at a finer level.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxencode_hash.h"
+#include "rfxencode_tile.h"
+#include "rfxencode_rate.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+/* CRC32C, reflected 0x1EDC6F41, same as the sse4.2 crc32 instruction */
+static const uint32 g_crc32c_table[256] =
+{
+    0x00000000, 0xF26B8303, 0xE13B70F7, 0x1350F3F4,
+    0xC79A971F, 0x35F1141C, 0x26A1E7E8, 0xD4CA64EB,
+    0x8AD958CF, 0x78B2DBCC, 0x6BE22838, 0x9989AB3B,
+    0x4D43CFD0, 0xBF284CD3, 0xAC78BF27, 0x5E133C24,
+    0x105EC76F, 0xE235446C, 0xF165B798, 0x030E349B,
+    0xD7C45070, 0x25AFD373, 0x36FF2087, 0xC494A384,
+    0x9A879FA0, 0x68EC1CA3, 0x7BBCEF57, 0x89D76C54,
+    0x5D1D08BF, 0xAF768BBC, 0xBC267848, 0x4E4DFB4B,
+    0x20BD8EDE, 0xD2D60DDD, 0xC186FE29, 0x33ED7D2A,
+    0xE72719C1, 0x154C9AC2, 0x061C6936, 0xF477EA35,
+    0xAA64D611, 0x580F5512, 0x4B5FA6E6, 0xB93425E5,
+    0x6DFE410E, 0x9F95C20D, 0x8CC531F9, 0x7EAEB2FA,
+    0x30E349B1, 0xC288CAB2, 0xD1D83946, 0x23B3BA45,
+    0xF779DEAE, 0x05125DAD, 0x1642AE59, 0xE4292D5A,
+    0xBA3A117E, 0x4851927D, 0x5B016189, 0xA96AE28A,
+    0x7DA08661, 0x8FCB0562, 0x9C9BF696, 0x6EF07595,
+    0x417B1DBC, 0xB3109EBF, 0xA0406D4B, 0x522BEE48,
+    0x86E18AA3, 0x748A09A0, 0x67DAFA54, 0x95B17957,
+    0xCBA24573, 0x39C9C670, 0x2A993584, 0xD8F2B687,
+    0x0C38D26C, 0xFE53516F, 0xED03A29B, 0x1F682198,
+    0x5125DAD3, 0xA34E59D0, 0xB01EAA24, 0x42752927,
+    0x96BF4DCC, 0x64D4CECF, 0x77843D3B, 0x85EFBE38,
+    0xDBFC821C, 0x2997011F, 0x3AC7F2EB, 0xC8AC71E8,
+    0x1C661503, 0xEE0D9600, 0xFD5D65F4, 0x0F36E6F7,
+    0x61C69362, 0x93AD1061, 0x80FDE395, 0x72966096,
+    0xA65C047D, 0x5437877E, 0x4767748A, 0xB50CF789,
+    0xEB1FCBAD, 0x197448AE, 0x0A24BB5A, 0xF84F3859,
+    0x2C855CB2, 0xDEEEDFB1, 0xCDBE2C45, 0x3FD5AF46,
+    0x7198540D, 0x83F3D70E, 0x90A324FA, 0x62C8A7F9,
+    0xB602C312, 0x44694011, 0x5739B3E5, 0xA55230E6,
+    0xFB410CC2, 0x092A8FC1, 0x1A7A7C35, 0xE811FF36,
+    0x3CDB9BDD, 0xCEB018DE, 0xDDE0EB2A, 0x2F8B6829,
+    0x82F63B78, 0x709DB87B, 0x63CD4B8F, 0x91A6C88C,
+    0x456CAC67, 0xB7072F64, 0xA457DC90, 0x563C5F93,
+    0x082F63B7, 0xFA44E0B4, 0xE9141340, 0x1B7F9043,
+    0xCFB5F4A8, 0x3DDE77AB, 0x2E8E845F, 0xDCE5075C,
+    0x92A8FC17, 0x60C37F14, 0x73938CE0, 0x81F80FE3,
+    0x55326B08, 0xA759E80B, 0xB4091BFF, 0x466298FC,
+    0x1871A4D8, 0xEA1A27DB, 0xF94AD42F, 0x0B21572C,
+    0xDFEB33C7, 0x2D80B0C4, 0x3ED04330, 0xCCBBC033,
+    0xA24BB5A6, 0x502036A5, 0x4370C551, 0xB11B4652,
+    0x65D122B9, 0x97BAA1BA, 0x84EA524E, 0x7681D14D,
+    0x2892ED69, 0xDAF96E6A, 0xC9A99D9E, 0x3BC21E9D,
+    0xEF087A76, 0x1D63F975, 0x0E330A81, 0xFC588982,
+    0xB21572C9, 0x407EF1CA, 0x532E023E, 0xA145813D,
+    0x758FE5D6, 0x87E466D5, 0x94B49521, 0x66DF1622,
+    0x38CC2A06, 0xCAA7A905, 0xD9F75AF1, 0x2B9CD9F2,
+    0xFF56BD19, 0x0D3D3E1A, 0x1E6DCDEE, 0xEC064EED,
+    0xC38D26C4, 0x31E6A5C7, 0x22B65633, 0xD0DDD530,
+    0x0417B1DB, 0xF67C32D8, 0xE52CC12C, 0x1747422F,
+    0x49547E0B, 0xBB3FFD08, 0xA86F0EFC, 0x5A048DFF,
+    0x8ECEE914, 0x7CA56A17, 0x6FF599E3, 0x9D9E1AE0,
+    0xD3D3E1AB, 0x21B862A8, 0x32E8915C, 0xC083125F,
+    0x144976B4, 0xE622F5B7, 0xF5720643, 0x07198540,
+    0x590AB964, 0xAB613A67, 0xB831C993, 0x4A5A4A90,
+    0x9E902E7B, 0x6CFBAD78, 0x7FAB5E8C, 0x8DC0DD8F,
+    0xE330A81A, 0x115B2B19, 0x020BD8ED, 0xF0605BEE,
+    0x24AA3F05, 0xD6C1BC06, 0xC5914FF2, 0x37FACCF1,
+    0x69E9F0D5, 0x9B8273D6, 0x88D28022, 0x7AB90321,
+    0xAE7367CA, 0x5C18E4C9, 0x4F48173D, 0xBD23943E,
+    0xF36E6F75, 0x0105EC76, 0x12551F82, 0xE03E9C81,
+    0x34F4F86A, 0xC69F7B69, 0xD5CF889D, 0x27A40B9E,
+    0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E,
+    0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351
+};
+
+#define CRC32C_BYTE(_crc, _b) \
+    _crc = g_crc32c_table[((_crc) ^ (_b)) & 0xFF] ^ ((_crc) >> 8)
+
+#define CRC32C_8(_crc, _p) \
+do { \
+    CRC32C_BYTE(_crc, (_p)[0]); \
+    CRC32C_BYTE(_crc, (_p)[1]); \
+    CRC32C_BYTE(_crc, (_p)[2]); \
+    CRC32C_BYTE(_crc, (_p)[3]); \
+    CRC32C_BYTE(_crc, (_p)[4]); \
+    CRC32C_BYTE(_crc, (_p)[5]); \
+    CRC32C_BYTE(_crc, (_p)[6]); \
+    CRC32C_BYTE(_crc, (_p)[7]); \
+} while (0)
+
+#define CRC32C_32(_crc, _v) \
+do { \
+    CRC32C_BYTE(_crc, (_v) >> 0); \
+    CRC32C_BYTE(_crc, (_v) >> 8); \
+    CRC32C_BYTE(_crc, (_v) >> 16); \
+    CRC32C_BYTE(_crc, (_v) >> 24); \
+} while (0)
+
+/******************************************************************************/
+/* each 32 bytes of a row are split over 4 CRCs so the asm versions do not
+   wait on the crc32 latency, what is left of a row goes in the first one,
+   the 4 are folded together at the end */
+int
+rfx_tile_hash(const char *data, int row_bytes, int rows, int stride_bytes,
+              uint32 *hash)
+{
+    const uint8 *src8;
+    uint32 crc1;
+    uint32 crc2;
+    uint32 crc3;
+    uint32 crc4;
+    int index;
+    int jndex;
+
+    crc1 = 0xFFFFFFFF;
+    crc2 = 0xFFFFFFFF;
+    crc3 = 0xFFFFFFFF;
+    crc4 = 0xFFFFFFFF;
+    for (jndex = 0; jndex < rows; jndex++)
+    {
+        src8 = (const uint8 *) (data + jndex * stride_bytes);
+        for (index = 0; index + 32 <= row_bytes; index += 32)
+        {
+            CRC32C_8(crc1, src8);
+            CRC32C_8(crc2, src8 + 8);
+            CRC32C_8(crc3, src8 + 16);
+            CRC32C_8(crc4, src8 + 24);
+            src8 += 32;
+        }
+        for (; index < row_bytes; index++)
+        {
+            CRC32C_BYTE(crc1, *src8);
+            src8++;
+        }
+    }
+    CRC32C_32(crc1, crc2);
+    CRC32C_32(crc1, crc3);
+    CRC32C_32(crc1, crc4);
+    *hash = crc1;
+    return 0;
+}
+
+/******************************************************************************/
+/* hash of the y, u and v rows tile covers in a RFX_FORMAT_NV12 or
+   RFX_FORMAT_I420 buf */
+static int
+rfx_hash_tile_yuv420(struct rfxencode *enc, const char *buf, int stride_bytes,
+                     const struct rfx_tile *tile, uint32 *hash)
+{
+    const char *y_data;
+    const char *u_data;
+    const char *v_data;
+    uint32 u_hash;
+    uint32 v_hash;
+    int uv_rows;
+
+    rfx_encode_yuv420_data(enc, buf, stride_bytes, tile->x, tile->y,
+                           &y_data, &u_data, &v_data);
+    uv_rows = (tile->cy + 1) / 2;
+    rfx_tile_hash(y_data, tile->cx, tile->cy, stride_bytes, hash);
+    if (enc->format == RFX_FORMAT_NV12)
+    {
+        /* u and v are in the same rows */
+        rfx_tile_hash(u_data, ((tile->cx + 1) / 2) * 2, uv_rows,
+                      stride_bytes, &u_hash);
+        CRC32C_32(*hash, u_hash);
+        return 0;
+    }
+    rfx_tile_hash(u_data, (tile->cx + 1) / 2, uv_rows, stride_bytes / 2,
+                  &u_hash);
+    rfx_tile_hash(v_data, (tile->cx + 1) / 2, uv_rows, stride_bytes / 2,
+                  &v_hash);
+    CRC32C_32(*hash, u_hash);
+    CRC32C_32(*hash, v_hash);
+    return 0;
+}
+
+/******************************************************************************/
+/* hash of the pixels tile covers in buf */
+int
+rfx_hash_tile(struct rfxencode *enc, const char *buf, int stride_bytes,
+              const struct rfx_tile *tile, uint32 *hash)
+{
+    const char *tile_data;
+    int row_bytes;
+
+    if (enc->format == RFX_FORMAT_YUV)
+    {
+        /* 4 planes of 64x64 in one block */
+        tile_data = buf + (tile->y << 8) * (stride_bytes >> 8) +
+                    (tile->x << 8);
+        row_bytes = 64 * 64 * 4;
+        return enc->rfx_tile_hash(tile_data, row_bytes, 1, row_bytes, hash);
+    }
+    if ((enc->format == RFX_FORMAT_NV12) || (enc->format == RFX_FORMAT_I420))
+    {
+        return rfx_hash_tile_yuv420(enc, buf, stride_bytes, tile, hash);
+    }
+    tile_data = buf + tile->y * stride_bytes +
+                tile->x * (enc->bits_per_pixel / 8);
+    row_bytes = tile->cx * (enc->bits_per_pixel / 8);
+    if ((row_bytes & 31) == 0)
+    {
+        return enc->rfx_tile_hash(tile_data, row_bytes, tile->cy,
+                                  stride_bytes, hash);
+    }
+    return rfx_tile_hash(tile_data, row_bytes, tile->cy, stride_bytes, hash);
+}
+
+/******************************************************************************/
+/* the rows of pixels tile covers in buf */
+int
+rfx_hash_tile_pixels(struct rfxencode *enc, const char *buf, int stride_bytes,
+                     const struct rfx_tile *tile,
+                     struct rfx_tile_pixels *pixels)
+{
+    const char *y_data;
+    const char *u_data;
+    const char *v_data;
+    int uv_rows;
+
+    if (enc->format == RFX_FORMAT_YUV)
+    {
+        /* 4 planes of 64x64 in one block */
+        pixels->num_planes = 1;
+        pixels->data[0] = buf + (tile->y << 8) * (stride_bytes >> 8) +
+                          (tile->x << 8);
+        pixels->row_bytes[0] = 64 * 64 * 4;
+        pixels->rows[0] = 1;
+        pixels->stride_bytes[0] = 64 * 64 * 4;
+        return 0;
+    }
+    if ((enc->format == RFX_FORMAT_NV12) || (enc->format == RFX_FORMAT_I420))
+    {
+        rfx_encode_yuv420_data(enc, buf, stride_bytes, tile->x, tile->y,
+                               &y_data, &u_data, &v_data);
+        uv_rows = (tile->cy + 1) / 2;
+        pixels->data[0] = y_data;
+        pixels->row_bytes[0] = tile->cx;
+        pixels->rows[0] = tile->cy;
+        pixels->stride_bytes[0] = stride_bytes;
+        if (enc->format == RFX_FORMAT_NV12)
+        {
+            /* u and v are in the same rows */
+            pixels->num_planes = 2;
+            pixels->data[1] = u_data;
+            pixels->row_bytes[1] = ((tile->cx + 1) / 2) * 2;
+            pixels->rows[1] = uv_rows;
+            pixels->stride_bytes[1] = stride_bytes;
+            return 0;
+        }
+        pixels->num_planes = 3;
+        pixels->data[1] = u_data;
+        pixels->data[2] = v_data;
+        pixels->row_bytes[1] = (tile->cx + 1) / 2;
+        pixels->row_bytes[2] = (tile->cx + 1) / 2;
+        pixels->rows[1] = uv_rows;
+        pixels->rows[2] = uv_rows;
+        pixels->stride_bytes[1] = stride_bytes / 2;
+        pixels->stride_bytes[2] = stride_bytes / 2;
+        return 0;
+    }
+    pixels->num_planes = 1;
+    pixels->data[0] = buf + tile->y * stride_bytes +
+                      tile->x * (enc->bits_per_pixel / 8);
+    pixels->row_bytes[0] = tile->cx * (enc->bits_per_pixel / 8);
+    pixels->rows[0] = tile->cy;
+    pixels->stride_bytes[0] = stride_bytes;
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_hash_create(struct rfxencode *enc)
+{
+    enc->hash_width = (enc->width + 63) / 64;
+    enc->hash_height = (enc->height + 63) / 64;
+    enc->hashes = (struct rfx_tile_hash *)
+                  calloc(enc->hash_width * enc->hash_height,
+                         sizeof(struct rfx_tile_hash));
+    if (enc->hashes == 0)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_hash_delete(struct rfxencode *enc)
+{
+    free(enc->hashes);
+    free(enc->hash_tiles);
+    free(enc->hash_pending);
+    free(enc->hash_refine);
+    return 0;
+}
+
+/******************************************************************************/
+/* forget what was sent, every tile is changed on the next call */
+int
+rfx_hash_reset(struct rfxencode *enc)
+{
+    memset(enc->hashes, 0, enc->hash_width * enc->hash_height *
+           sizeof(struct rfx_tile_hash));
+    enc->num_hash_tiles = 0;
+    enc->num_hash_refine = 0;
+    return 0;
+}
+
+/******************************************************************************/
+/* index of the tile in enc->hashes or -1 if it is not on the surface */
+static int
+rfx_hash_index(struct rfxencode *enc, const struct rfx_tile *tile)
+{
+    int x;
+    int y;
+
+    if ((tile->x < 0) || (tile->y < 0) ||
+        ((tile->x & 63) != 0) || ((tile->y & 63) != 0))
+    {
+        return -1;
+    }
+    x = tile->x / 64;
+    y = tile->y / 64;
+    if ((x >= enc->hash_width) || (y >= enc->hash_height))
+    {
+        return -1;
+    }
+    return y * enc->hash_width + x;
+}
+
+/******************************************************************************/
+int
+rfx_hash_tiles(struct rfxencode *enc, const char *buf, int stride_bytes,
+               const struct rfx_tile *tiles, int num_tiles)
+{
+    const struct rfx_tile *tile;
+    struct rfx_tile *hash_tiles;
+    struct rfx_tile *hash_refine;
+    uint32 *hash_pending;
+    uint32 hash;
+    int index;
+    int hindex;
+
+    if (num_tiles > enc->hash_tiles_alloc)
+    {
+        hash_tiles = (struct rfx_tile *)
+                     realloc(enc->hash_tiles,
+                             num_tiles * sizeof(struct rfx_tile));
+        if (hash_tiles == 0)
+        {
+            return 1;
+        }
+        enc->hash_tiles = hash_tiles;
+        hash_pending = (uint32 *)
+                       realloc(enc->hash_pending, num_tiles * sizeof(uint32));
+        if (hash_pending == 0)
+        {
+            return 1;
+        }
+        enc->hash_pending = hash_pending;
+        hash_refine = (struct rfx_tile *)
+                      realloc(enc->hash_refine,
+                              num_tiles * sizeof(struct rfx_tile));
+        if (hash_refine == 0)
+        {
+            return 1;
+        }
+        enc->hash_refine = hash_refine;
+        enc->hash_tiles_alloc = num_tiles;
+    }
+    enc->num_hash_tiles = 0;
+    enc->num_hash_refine = 0;
+    for (index = 0; index < num_tiles; index++)
+    {
+        tile = tiles + index;
+        hindex = rfx_hash_index(enc, tile);
+        hash = 0;
+        if (hindex >= 0)
+        {
+            rfx_hash_tile(enc, buf, stride_bytes, tile, &hash);
+            if (enc->hashes[hindex].valid &&
+                (enc->hashes[hindex].hash == hash))
+            {
+                LLOGLN(10, ("rfx_hash_tiles: tile x %d y %d unchanged",
+                       tile->x, tile->y));
+                if ((enc->rate != 0) && (enc->hashes[hindex].level > 0))
+                {
+                    enc->hash_refine[enc->num_hash_refine] = *tile;
+                    enc->num_hash_refine++;
+                }
+                continue;
+            }
+        }
+        enc->hash_tiles[enc->num_hash_tiles] = *tile;
+        enc->hash_pending[enc->num_hash_tiles] = hash;
+        enc->num_hash_tiles++;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* add up to num_tiles of the unchanged tiles sent at a coarser level than
+   level to the tiles of the call, returns how many */
+int
+rfx_hash_refine(struct rfxencode *enc, int level, int num_tiles)
+{
+    const struct rfx_tile *tile;
+    int count;
+    int index;
+    int hindex;
+
+    count = 0;
+    for (index = 0; index < enc->num_hash_refine; index++)
+    {
+        if (count >= num_tiles)
+        {
+            break;
+        }
+        tile = enc->hash_refine + index;
+        hindex = rfx_hash_index(enc, tile);
+        if (enc->hashes[hindex].level > level)
+        {
+            enc->hash_tiles[enc->num_hash_tiles] = *tile;
+            enc->hash_pending[enc->num_hash_tiles] = enc->hashes[hindex].hash;
+            enc->num_hash_tiles++;
+            count++;
+        }
+    }
+    return count;
+}
+
+/******************************************************************************/
+/* the first num_tiles tiles of the call were sent, only called for
+   tiles that went out, a failed frame must not mark its tiles as sent */
+int
+rfx_hash_commit(struct rfxencode *enc, int num_tiles)
+{
+    int index;
+    int hindex;
+    int level;
+
+    level = enc->rate == 0 ? 0 : rfx_rate_level(enc);
+    num_tiles = MIN(num_tiles, enc->num_hash_tiles);
+    for (index = 0; index < num_tiles; index++)
+    {
+        hindex = rfx_hash_index(enc, enc->hash_tiles + index);
+        if (hindex >= 0)
+        {
+            enc->hashes[hindex].hash = enc->hash_pending[index];
+            enc->hashes[hindex].valid = 1;
+            enc->hashes[hindex].level = level;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_HASH_H
+#define __RFXENCODE_HASH_H
+
+#include "rfxcommon.h"
+
+/* the rows of pixels a tile covers, the ones rfx_hash_tile hashes */
+struct rfx_tile_pixels
+{
+    int num_planes;
+    const char *data[3];
+    int row_bytes[3];
+    int rows[3];
+    int stride_bytes[3];
+};
+
+int
+rfx_tile_hash(const char *data, int row_bytes, int rows, int stride_bytes,
+              uint32 *hash);
+int
+rfx_hash_tile(struct rfxencode *enc, const char *buf, int stride_bytes,
+              const struct rfx_tile *tile, uint32 *hash);
+int
+rfx_hash_tile_pixels(struct rfxencode *enc, const char *buf, int stride_bytes,
+                     const struct rfx_tile *tile,
+                     struct rfx_tile_pixels *pixels);
+int
+rfx_hash_create(struct rfxencode *enc);
+int
+rfx_hash_delete(struct rfxencode *enc);
+int
+rfx_hash_reset(struct rfxencode *enc);
+int
+rfx_hash_tiles(struct rfxencode *enc, const char *buf, int stride_bytes,
+               const struct rfx_tile *tiles, int num_tiles);
+int
+rfx_hash_refine(struct rfxencode *enc, int level, int num_tiles);
+int
+rfx_hash_commit(struct rfxencode *enc, int num_tiles);
+
+#endif
@@ -0,0 +1,239 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Encoder contexts for rfxcodec_encode_create and the tile workers.
+ *
+ * A context and its scratch, RFX_ENCODE_SCRATCH_BYTES, are separate 64
+ * byte aligned blocks.  Up to rfxcodec_encode_set_pool of them are kept
+ * when let go, the set makes them all at once, so creating an encoder is
+ * a clear of memory already there instead of a new one.  Contexts of
+ * rfxcodec_encode_create_with_allocator come from and go back to its
+ * allocator, never the pool.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxencode_pool.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+static pthread_mutex_t g_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct rfxencode **g_pool = 0; /* g_pool_max, the first g_pool_count
+                                         are free contexts */
+static int g_pool_max = 0;
+static int g_pool_count = 0;
+
+/******************************************************************************/
+/* clear enc, keeping scratch as its tile buffers */
+static void
+rfx_pool_clear(struct rfxencode *enc, uint8 *scratch)
+{
+    memset(enc, 0, sizeof(struct rfxencode));
+    enc->scratch = scratch;
+    enc->a_buffer = scratch;
+    enc->y_r_buffer = scratch + 4096;
+    enc->u_g_buffer = scratch + 2 * 4096;
+    enc->v_b_buffer = scratch + 3 * 4096;
+    enc->dwt_buffer = (sint16 *) (scratch + 4 * 4096);
+    enc->dwt_buffer1 = (sint16 *) (scratch + 6 * 4096);
+    enc->dwt_buffer2 = (sint16 *) (scratch + 8 * 4096);
+}
+
+/******************************************************************************/
+static struct rfxencode *
+rfx_pool_alloc(void)
+{
+    void *mem;
+    void *scratch;
+
+    if (posix_memalign(&mem, 64, sizeof(struct rfxencode)) != 0)
+    {
+        return 0;
+    }
+    if (posix_memalign(&scratch, 64, RFX_ENCODE_SCRATCH_BYTES) != 0)
+    {
+        free(mem);
+        return 0;
+    }
+    memset(scratch, 0, RFX_ENCODE_SCRATCH_BYTES);
+    rfx_pool_clear((struct rfxencode *) mem, (uint8 *) scratch);
+    return (struct rfxencode *) mem;
+}
+
+/******************************************************************************/
+static void
+rfx_pool_free(struct rfxencode *enc)
+{
+    free(enc->scratch);
+    free(enc);
+}
+
+/******************************************************************************/
+static struct rfxencode *
+rfx_pool_alloc_with(const struct rfxcodec_allocator *allocator)
+{
+    struct rfxencode *enc;
+    uint8 *scratch;
+
+    enc = (struct rfxencode *)
+          allocator->malloc_proc(allocator->user, sizeof(struct rfxencode));
+    if (enc == 0)
+    {
+        return 0;
+    }
+    scratch = (uint8 *)
+              allocator->aligned_alloc_proc(allocator->user, 64,
+                                            RFX_ENCODE_SCRATCH_BYTES);
+    if (scratch == 0)
+    {
+        allocator->free_proc(allocator->user, enc);
+        return 0;
+    }
+    memset(scratch, 0, RFX_ENCODE_SCRATCH_BYTES);
+    rfx_pool_clear(enc, scratch);
+    enc->with_allocator = 1;
+    enc->allocator = *allocator;
+    return enc;
+}
+
+/******************************************************************************/
+/* a cleared context, from allocator if not 0, else the pool */
+struct rfxencode *
+rfx_pool_get(const struct rfxcodec_allocator *allocator)
+{
+    struct rfxencode *enc;
+
+    if (allocator != 0)
+    {
+        return rfx_pool_alloc_with(allocator);
+    }
+    enc = 0;
+    pthread_mutex_lock(&g_pool_mutex);
+    if (g_pool_count > 0)
+    {
+        g_pool_count--;
+        enc = g_pool[g_pool_count];
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    if (enc == 0)
+    {
+        return rfx_pool_alloc();
+    }
+    rfx_pool_clear(enc, enc->scratch);
+    return enc;
+}
+
+/******************************************************************************/
+/* give enc back to its allocator, else keep it if the pool has room */
+int
+rfx_pool_put(struct rfxencode *enc)
+{
+    struct rfxcodec_allocator allocator;
+
+    if (enc == 0)
+    {
+        return 0;
+    }
+    if (enc->with_allocator)
+    {
+        allocator = enc->allocator;
+        allocator.free_proc(allocator.user, enc->scratch);
+        allocator.free_proc(allocator.user, enc);
+        return 0;
+    }
+    pthread_mutex_lock(&g_pool_mutex);
+    if (g_pool_count < g_pool_max)
+    {
+        g_pool[g_pool_count] = enc;
+        g_pool_count++;
+        enc = 0;
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    if (enc != 0)
+    {
+        rfx_pool_free(enc);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* keep up to max_contexts, made now and cleared so their pages are in */
+int
+rfx_pool_set_max(int max_contexts)
+{
+    struct rfxencode **pool;
+    struct rfxencode *enc;
+    int error;
+
+    if (max_contexts < 0)
+    {
+        return 1;
+    }
+    error = 0;
+    pthread_mutex_lock(&g_pool_mutex);
+    while (g_pool_count > max_contexts)
+    {
+        g_pool_count--;
+        rfx_pool_free(g_pool[g_pool_count]);
+    }
+    if (max_contexts == 0)
+    {
+        free(g_pool);
+        g_pool = 0;
+    }
+    else
+    {
+        pool = (struct rfxencode **)
+               realloc(g_pool, max_contexts * sizeof(struct rfxencode *));
+        if (pool == 0)
+        {
+            pthread_mutex_unlock(&g_pool_mutex);
+            return 1;
+        }
+        g_pool = pool;
+    }
+    g_pool_max = max_contexts;
+    while (g_pool_count < g_pool_max)
+    {
+        enc = rfx_pool_alloc();
+        if (enc == 0)
+        {
+            error = 1;
+            break;
+        }
+        g_pool[g_pool_count] = enc;
+        g_pool_count++;
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    LLOGLN(10, ("rfx_pool_set_max: %d contexts", g_pool_count));
+    return error;
+}
@@ -0,0 +1,31 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_POOL_H
+#define __RFXENCODE_POOL_H
+
+#include "rfxcommon.h"
+
+struct rfxencode *
+rfx_pool_get(const struct rfxcodec_allocator *allocator);
+int
+rfx_pool_put(struct rfxencode *enc);
+int
+rfx_pool_set_max(int max_contexts);
+
+#endif
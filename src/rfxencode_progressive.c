@@ -0,0 +1,1102 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * RemoteFX progressive, rfxcodec_encode_progressive
+ *
+ * The output is the RFX_PROGRESSIVE_BITMAP_STREAM of MS-RDPEGFX.  A tile
+ * in the call's tiles is sent as RFX_PROGRESSIVE_TILE_FIRST, quantized at
+ * the first, coarsest, progressive level, and its coefficients quantized
+ * at full quality are kept.  Each later call that does not have the tile
+ * sends it one level better as RFX_PROGRESSIVE_TILE_UPGRADE, only the
+ * bits the client is missing, until it is at full quality and the
+ * coefficients are let go.  Without levels tiles are sent at full quality
+ * as RFX_PROGRESSIVE_TILE_SIMPLE.
+ *
+ * Outside of LL3 the coefficients are quantized as a sign and magnitude,
+ * so a level is the full quality magnitude shifted right by its
+ * progressive quant value and an upgrade is the bits that shift dropped.
+ * The upgrade bits of a coefficient the client has as 0, so has no sign
+ * for, are in the SRL stream, the others and all of LL3, which is
+ * shifted with its sign, are in the raw stream.
+ *
+ * With RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE the tiles go through the reduce
+ * extrapolate DWT, its 33, 17 and 9 wide L bands change where the bands
+ * are and how many coefficients they have, and the regions are flagged
+ * RFX_DWT_REDUCE_EXTRAPOLATE.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxconstants.h"
+#include "rfx_bitstream.h"
+#include "rfxcompose.h"
+#include "rfxencode_tile.h"
+#include "rfxencode_dwt.h"
+#include "rfxencode_differential.h"
+#include "rfxencode_rlgr1.h"
+#include "rfxencode_stats.h"
+#include "rfxencode_progressive.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+/* 3 components of 4096 coefficients */
+#define RFX_PROGRESSIVE_COEFS (3 * 4096)
+/* bytes of the raw stream of a component, 15 bits a coefficient at most */
+#define RFX_PROGRESSIVE_RAW_BYTES (4096 * 15 / 8)
+
+/* the bands of a component in the order of the upgrade bits, where they
+   are in its coefficients and which of the 10 values of a
+   RFX_COMPONENT_CODEC_QUANT, LL3, HL3, LH3, HH3, HL2, LH2, HH2, HL1, LH1,
+   HH1, is theirs, LL3 is last */
+#define RFX_PROGRESSIVE_BANDS 10
+#define RFX_PROGRESSIVE_LL3 9
+static const int g_band_offset[RFX_PROGRESSIVE_BANDS] =
+{
+    0, 1024, 2048, 3072, 3328, 3584, 3840, 3904, 3968, 4032
+};
+static const int g_band_count[RFX_PROGRESSIVE_BANDS] =
+{
+    1024, 1024, 1024, 256, 256, 256, 64, 64, 64, 64
+};
+/* the same with RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE, rfx_dwt_2d_encode_rem */
+static const int g_rem_band_offset[RFX_PROGRESSIVE_BANDS] =
+{
+    0, 1023, 2046, 3007, 3279, 3551, 3807, 3879, 3951, 4015
+};
+static const int g_rem_band_count[RFX_PROGRESSIVE_BANDS] =
+{
+    1023, 1023, 961, 272, 272, 256, 72, 72, 64, 81
+};
+static const int g_band_quant[RFX_PROGRESSIVE_BANDS] =
+{
+    7, 8, 9, 4, 5, 6, 1, 2, 3, 0
+};
+
+/* value n of 5 quant bytes, 2 a byte, low nibble first */
+#define QUANT_VAL(_vals, _n) \
+    ((((const uint8 *) (_vals))[(_n) >> 1] >> (((_n) & 1) * 4)) & 0xf)
+
+struct rfx_progressive_tile
+{
+    sint16 *coefs; /* y, cb and cr at full quality, 0 when not sending */
+    int level; /* the level the client has */
+    char quants[15]; /* y, cb and cr quant values of the tile */
+};
+
+struct rfx_progressive
+{
+    int tiles_x;
+    int tiles_y;
+    int reduce_extrapolate;
+    const int *band_offset;
+    const int *band_count;
+    int num_levels;
+    uint8 levels[RFX_PROGRESSIVE_MAX_LEVELS][16];
+    struct rfx_progressive_tile *tiles;
+    /* work space for a call, one per tile of the surface */
+    uint8 *listed; /* 1 if in the call's tiles */
+    sint16 **first_coefs; /* of the call's tiles, kept if it works */
+    int *upgrades; /* tile indexes */
+    uint8 *upgrade_quants; /* 3 quant indexes each */
+    char quants[RFX_PROGRESSIVE_MAX_QUANTS * 5];
+};
+
+/******************************************************************************/
+static int
+rfx_progressive_create(struct rfxencode *enc)
+{
+    struct rfx_progressive *prog;
+    int num_tiles;
+
+    prog = (struct rfx_progressive *) calloc(1, sizeof(struct rfx_progressive));
+    if (prog == 0)
+    {
+        return 1;
+    }
+    prog->tiles_x = (enc->width + 63) / 64;
+    prog->tiles_y = (enc->height + 63) / 64;
+    if (enc->reduce_extrapolate)
+    {
+        prog->reduce_extrapolate = 1;
+        prog->band_offset = g_rem_band_offset;
+        prog->band_count = g_rem_band_count;
+    }
+    else
+    {
+        prog->band_offset = g_band_offset;
+        prog->band_count = g_band_count;
+    }
+    num_tiles = prog->tiles_x * prog->tiles_y;
+    prog->tiles = (struct rfx_progressive_tile *)
+                  calloc(num_tiles, sizeof(struct rfx_progressive_tile));
+    prog->listed = (uint8 *) calloc(num_tiles, sizeof(uint8));
+    prog->first_coefs = (sint16 **) calloc(num_tiles, sizeof(sint16 *));
+    prog->upgrades = (int *) calloc(num_tiles, sizeof(int));
+    prog->upgrade_quants = (uint8 *) calloc(num_tiles, 3 * sizeof(uint8));
+    enc->progressive = prog;
+    if ((prog->tiles == 0) || (prog->listed == 0) ||
+        (prog->first_coefs == 0) || (prog->upgrades == 0) ||
+        (prog->upgrade_quants == 0))
+    {
+        rfx_progressive_delete(enc);
+        return 1;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* the client has none of the tiles */
+int
+rfx_progressive_reset(struct rfxencode *enc)
+{
+    struct rfx_progressive *prog;
+    int index;
+
+    prog = enc->progressive;
+    if (prog == 0)
+    {
+        return 0;
+    }
+    for (index = 0; index < prog->tiles_x * prog->tiles_y; index++)
+    {
+        free(prog->tiles[index].coefs);
+        prog->tiles[index].coefs = 0;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_progressive_delete(struct rfxencode *enc)
+{
+    struct rfx_progressive *prog;
+
+    prog = enc->progressive;
+    if (prog == 0)
+    {
+        return 0;
+    }
+    if (prog->tiles != 0)
+    {
+        rfx_progressive_reset(enc);
+    }
+    free(prog->tiles);
+    free(prog->listed);
+    free(prog->first_coefs);
+    free(prog->upgrades);
+    free(prog->upgrade_quants);
+    free(prog);
+    enc->progressive = 0;
+    return 0;
+}
+
+/******************************************************************************/
+/* each level no finer than the one before it in any band */
+int
+rfx_progressive_set_levels(struct rfxencode *enc, const char *levels,
+                           int num_levels)
+{
+    struct rfx_progressive *prog;
+    int level;
+    int band;
+
+    if ((num_levels < 0) || (num_levels > RFX_PROGRESSIVE_MAX_LEVELS) ||
+        ((num_levels > 0) && (levels == 0)))
+    {
+        return 1;
+    }
+    for (level = 1; level < num_levels; level++)
+    {
+        for (band = 0; band < 30; band++)
+        {
+            if (QUANT_VAL(levels + level * 16 + 1, band) >
+                QUANT_VAL(levels + (level - 1) * 16 + 1, band))
+            {
+                return 1;
+            }
+        }
+    }
+    if (enc->progressive == 0)
+    {
+        if (rfx_progressive_create(enc) != 0)
+        {
+            return 1;
+        }
+    }
+    prog = enc->progressive;
+    /* upgrades of tiles sent at the old levels would not add up */
+    rfx_progressive_reset(enc);
+    memcpy(prog->levels, levels, num_levels * 16);
+    prog->num_levels = num_levels;
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_progressive_pending(struct rfxencode *enc)
+{
+    struct rfx_progressive *prog;
+    int index;
+    int count;
+
+    prog = enc->progressive;
+    if (prog == 0)
+    {
+        return 0;
+    }
+    count = 0;
+    for (index = 0; index < prog->tiles_x * prog->tiles_y; index++)
+    {
+        if (prog->tiles[index].coefs != 0)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+/******************************************************************************/
+/* the DWT of a component quantized at full quality, rounded, outside of
+   LL3 as a magnitude so coarser levels are it shifted */
+static int
+rfx_progressive_quantize(struct rfxencode *enc, const uint8 *data,
+                         const char *quant_vals, sint16 *coefs)
+{
+    struct rfx_progressive *prog;
+    sint16 *src;
+    int band;
+    int factor;
+    int half;
+    int index;
+    int value;
+    int error;
+
+    prog = enc->progressive;
+    if (prog->reduce_extrapolate)
+    {
+        error = enc->rfx_dwt_rem(data, enc->dwt_buffer1, enc->dwt_buffer,
+                                 enc->dwt_buffer2);
+    }
+    else
+    {
+        error = rfx_dwt_2d_encode(data, enc->dwt_buffer1, enc->dwt_buffer);
+    }
+    if (error != 0)
+    {
+        return 1;
+    }
+    for (band = 0; band < RFX_PROGRESSIVE_BANDS; band++)
+    {
+        factor = QUANT_VAL(quant_vals, g_band_quant[band]) - 6 + DWT_FACTOR;
+        if (factor < 1)
+        {
+            return 1;
+        }
+        half = 1 << (factor - 1);
+        src = enc->dwt_buffer1 + prog->band_offset[band];
+        for (index = 0; index < prog->band_count[band]; index++)
+        {
+            value = src[index];
+            if (band == RFX_PROGRESSIVE_LL3)
+            {
+                value = (value + half) >> factor;
+            }
+            else if (value < 0)
+            {
+                value = -((half - value) >> factor);
+            }
+            else
+            {
+                value = (value + half) >> factor;
+            }
+            coefs[prog->band_offset[band] + index] = value;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* coefs at a level, prog_vals its 5 progressive quant bytes */
+static int
+rfx_progressive_level(const struct rfx_progressive *prog,
+                      const sint16 *coefs, const char *prog_vals,
+                      sint16 *buffer)
+{
+    const sint16 *src;
+    sint16 *dst;
+    int band;
+    int shift;
+    int index;
+    int value;
+
+    for (band = 0; band < RFX_PROGRESSIVE_BANDS; band++)
+    {
+        shift = QUANT_VAL(prog_vals, g_band_quant[band]);
+        src = coefs + prog->band_offset[band];
+        dst = buffer + prog->band_offset[band];
+        for (index = 0; index < prog->band_count[band]; index++)
+        {
+            value = src[index];
+            if ((band == RFX_PROGRESSIVE_LL3) || (value >= 0))
+            {
+                dst[index] = value >> shift;
+            }
+            else
+            {
+                dst[index] = -((-value) >> shift);
+            }
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_TILE_SIMPLE or TILE_FIRST data of a component, coefs at
+   full quality, prog_vals 0 is full quality */
+static int
+rfx_progressive_encode_component(struct rfxencode *enc, const sint16 *coefs,
+                                 const char *prog_vals, STREAM *s, int *size)
+{
+    struct rfx_progressive *prog;
+    int left;
+
+    prog = enc->progressive;
+    if (prog_vals == 0)
+    {
+        memcpy(enc->dwt_buffer1, coefs, 4096 * sizeof(sint16));
+    }
+    else
+    {
+        rfx_progressive_level(prog, coefs, prog_vals, enc->dwt_buffer1);
+    }
+    rfx_differential_encode(enc->dwt_buffer1 +
+                            prog->band_offset[RFX_PROGRESSIVE_LL3],
+                            prog->band_count[RFX_PROGRESSIVE_LL3]);
+    left = stream_get_left(s);
+    left = MIN(left, 0xFFFF);
+    *size = rfx_rlgr1_encode(enc->dwt_buffer1, stream_get_tail(s), left);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    stream_seek(s, *size);
+    return 0;
+}
+
+/******************************************************************************/
+/* the SRL of an upgrade value the client has no sign for yet, RLGR like
+   runs of 0s with kp as in MS-RDPEGFX 3.2.8.1.3 */
+static int
+rfx_progressive_srl(RFX_BITSTREAM *srl, int *kp, int *zeros,
+                    int value, int num_bits)
+{
+    int k;
+    int mag;
+
+    if (value == 0)
+    {
+        *zeros += 1;
+        k = *kp / 8;
+        if (*zeros == (1 << k))
+        {
+            /* a full run */
+            rfx_bitstream_put_bits((*srl), 0, 1);
+            *kp = MIN(*kp + 4, 80);
+            *zeros = 0;
+        }
+        return 0;
+    }
+    /* a short run, then the value */
+    k = *kp / 8;
+    rfx_bitstream_put_bits((*srl), 1, 1);
+    rfx_bitstream_put_bits((*srl), *zeros, k);
+    *zeros = 0;
+    rfx_bitstream_put_bits((*srl), value < 0 ? 1 : 0, 1);
+    *kp = *kp < 6 ? 0 : *kp - 6;
+    if (num_bits > 1)
+    {
+        /* magnitude - 1 in unary, no end bit for the most there can be */
+        mag = value < 0 ? -value : value;
+        if (mag < (1 << num_bits) - 1)
+        {
+            mag--;
+            while (mag > 15)
+            {
+                rfx_bitstream_put_bits((*srl), 0, 16);
+                mag -= 16;
+            }
+            rfx_bitstream_put_bits((*srl), 1, mag + 1);
+        }
+        else
+        {
+            mag--;
+            while (mag > 16)
+            {
+                rfx_bitstream_put_bits((*srl), 0, 16);
+                mag -= 16;
+            }
+            rfx_bitstream_put_bits((*srl), 0, mag);
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_TILE_UPGRADE SRL and raw data of a component from level
+   old_vals to new_vals, new_vals 0 is full quality, the SRL goes in s,
+   the raw in raw_data */
+static int
+rfx_progressive_upgrade_component(const struct rfx_progressive *prog,
+                                  const sint16 *coefs, const char *old_vals,
+                                  const char *new_vals, STREAM *s,
+                                  uint8 *raw_data, int *srl_size,
+                                  int *raw_size)
+{
+    RFX_BITSTREAM srl;
+    RFX_BITSTREAM raw;
+    const sint16 *src;
+    int band;
+    int index;
+    int old_shift;
+    int new_shift;
+    int num_bits;
+    int value;
+    int mag;
+    int old_mag;
+    int kp;
+    int zeros;
+    int left;
+
+    left = stream_get_left(s);
+    rfx_bitstream_attach(srl, stream_get_tail(s), MIN(left, 0xFFFF));
+    rfx_bitstream_attach(raw, raw_data, RFX_PROGRESSIVE_RAW_BYTES);
+    kp = 8;
+    zeros = 0;
+    for (band = 0; band < RFX_PROGRESSIVE_BANDS; band++)
+    {
+        old_shift = QUANT_VAL(old_vals, g_band_quant[band]);
+        new_shift = new_vals == 0 ? 0 : QUANT_VAL(new_vals,
+                                                  g_band_quant[band]);
+        num_bits = old_shift - new_shift;
+        if (num_bits < 1)
+        {
+            /* the client reads nothing for the band */
+            continue;
+        }
+        src = coefs + prog->band_offset[band];
+        if (band == RFX_PROGRESSIVE_LL3)
+        {
+            for (index = 0; index < prog->band_count[band]; index++)
+            {
+                value = src[index];
+                value = (value >> new_shift) -
+                        ((value >> old_shift) << num_bits);
+                rfx_bitstream_put_bits(raw, value, num_bits);
+            }
+            break;
+        }
+        for (index = 0; index < prog->band_count[band]; index++)
+        {
+            value = src[index];
+            mag = value < 0 ? -value : value;
+            old_mag = mag >> old_shift;
+            mag >>= new_shift;
+            if (old_mag != 0)
+            {
+                rfx_bitstream_put_bits(raw, mag - (old_mag << num_bits),
+                                       num_bits);
+            }
+            else
+            {
+                rfx_progressive_srl(&srl, &kp, &zeros,
+                                    value < 0 ? -mag : mag, num_bits);
+            }
+        }
+    }
+    if (zeros > 0)
+    {
+        /* a full run covers the rest */
+        rfx_bitstream_put_bits(srl, 0, 1);
+    }
+    if (srl.overflow)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    *srl_size = rfx_bitstream_get_processed_bytes(srl);
+    *raw_size = rfx_bitstream_get_processed_bytes(raw);
+    stream_seek(s, *srl_size);
+    return 0;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_TILE_SIMPLE, or TILE_FIRST at level 0, of the tile at
+   tile->x, tile->y, its full quality coefficients go in coefs */
+static int
+rfx_progressive_tile_first(struct rfxencode *enc, STREAM *s,
+                           const char *buf, int stride_bytes,
+                           const struct rfx_tile *tile,
+                           const char *quants, sint16 *coefs)
+{
+    struct rfx_progressive *prog;
+    const uint8 *planes[3];
+    const char *prog_vals;
+    int start_pos;
+    int end_pos;
+    int header_bytes;
+    int sizes[3];
+    int quant_idx[3];
+    int index;
+    int error;
+
+    prog = enc->progressive;
+    quant_idx[0] = tile->quant_y;
+    quant_idx[1] = tile->quant_cb;
+    quant_idx[2] = tile->quant_cr;
+    header_bytes = prog->num_levels > 0 ? 23 : 22;
+    if (stream_get_left(s) < header_bytes)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    if (rfx_encode_tile_yuv(enc, buf, tile->x, tile->y, tile->cx, tile->cy,
+                            stride_bytes, planes, planes + 1,
+                            planes + 2) != 0)
+    {
+        return 1;
+    }
+    start_pos = stream_get_pos(s);
+    stream_seek(s, header_bytes);
+    for (index = 0; index < 3; index++)
+    {
+        error = rfx_progressive_quantize(enc, planes[index],
+                                         quants + quant_idx[index] * 5,
+                                         coefs + index * 4096);
+        if (error != 0)
+        {
+            return error;
+        }
+        prog_vals = 0;
+        if (prog->num_levels > 0)
+        {
+            prog_vals = (const char *) (prog->levels[0] + 1 + index * 5);
+        }
+        error = rfx_progressive_encode_component(enc, coefs + index * 4096,
+                                                 prog_vals, s,
+                                                 sizes + index);
+        if (error != 0)
+        {
+            return error;
+        }
+    }
+    end_pos = stream_get_pos(s);
+    stream_set_pos(s, start_pos);
+    if (prog->num_levels > 0)
+    {
+        stream_write_uint16(s, PROGRESSIVE_WBT_TILE_FIRST);
+    }
+    else
+    {
+        stream_write_uint16(s, PROGRESSIVE_WBT_TILE_SIMPLE);
+    }
+    stream_write_uint32(s, end_pos - start_pos); /* blockLen */
+    stream_write_uint8(s, tile->quant_y);
+    stream_write_uint8(s, tile->quant_cb);
+    stream_write_uint8(s, tile->quant_cr);
+    stream_write_uint16(s, tile->x / 64); /* xIdx */
+    stream_write_uint16(s, tile->y / 64); /* yIdx */
+    stream_write_uint8(s, 0); /* flags */
+    if (prog->num_levels > 0)
+    {
+        stream_write_uint8(s, 0); /* quality */
+    }
+    stream_write_uint16(s, sizes[0]); /* yLen */
+    stream_write_uint16(s, sizes[1]); /* cbLen */
+    stream_write_uint16(s, sizes[2]); /* crLen */
+    stream_write_uint16(s, 0); /* tailLen */
+    stream_set_pos(s, end_pos);
+    STATS_ADD(enc, tiles, 1);
+    STATS_ADD(enc, y_bytes, sizes[0]);
+    STATS_ADD(enc, u_bytes, sizes[1]);
+    STATS_ADD(enc, v_bytes, sizes[2]);
+    return 0;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_TILE_UPGRADE of a tile to the level after the one the
+   client has */
+static int
+rfx_progressive_tile_upgrade(struct rfxencode *enc, STREAM *s,
+                             int tile_index, const uint8 *quant_idx)
+{
+    struct rfx_progressive *prog;
+    struct rfx_progressive_tile *ptile;
+    const char *old_vals;
+    const char *new_vals;
+    uint8 *raw_data;
+    int start_pos;
+    int end_pos;
+    int sizes[6];
+    int index;
+    int error;
+    int quality;
+
+    prog = enc->progressive;
+    ptile = prog->tiles + tile_index;
+    if (stream_get_left(s) < 26)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    start_pos = stream_get_pos(s);
+    stream_seek(s, 26);
+    raw_data = (uint8 *) (enc->dwt_buffer2);
+    quality = ptile->level + 1;
+    for (index = 0; index < 3; index++)
+    {
+        old_vals = (const char *) (prog->levels[ptile->level] + 1 +
+                                   index * 5);
+        new_vals = 0;
+        if (quality < prog->num_levels)
+        {
+            new_vals = (const char *) (prog->levels[quality] + 1 +
+                                       index * 5);
+        }
+        error = rfx_progressive_upgrade_component(prog, ptile->coefs +
+                                                  index * 4096,
+                                                  old_vals, new_vals, s,
+                                                  raw_data,
+                                                  sizes + index * 2,
+                                                  sizes + index * 2 + 1);
+        if (error != 0)
+        {
+            return error;
+        }
+        if (stream_get_left(s) < sizes[index * 2 + 1])
+        {
+            return RFX_ERROR_OVERFLOW;
+        }
+        memcpy(stream_get_tail(s), raw_data, sizes[index * 2 + 1]);
+        stream_seek(s, sizes[index * 2 + 1]);
+    }
+    end_pos = stream_get_pos(s);
+    stream_set_pos(s, start_pos);
+    stream_write_uint16(s, PROGRESSIVE_WBT_TILE_UPGRADE);
+    stream_write_uint32(s, end_pos - start_pos); /* blockLen */
+    stream_write_uint8(s, quant_idx[0]);
+    stream_write_uint8(s, quant_idx[1]);
+    stream_write_uint8(s, quant_idx[2]);
+    stream_write_uint16(s, tile_index % prog->tiles_x); /* xIdx */
+    stream_write_uint16(s, tile_index / prog->tiles_x); /* yIdx */
+    /* quality, 0xFF is full */
+    stream_write_uint8(s, quality < prog->num_levels ? quality : 0xFF);
+    for (index = 0; index < 6; index++)
+    {
+        /* ySrlLen, yRawLen, cbSrlLen, cbRawLen, crSrlLen, crRawLen */
+        stream_write_uint16(s, sizes[index]);
+    }
+    stream_set_pos(s, end_pos);
+    return 0;
+}
+
+/******************************************************************************/
+/* index in quants of the 5 quant values vals, added if not there,
+   -1 if there is no room */
+static int
+rfx_progressive_quant_idx(char *quants, int *num_quants, const char *vals)
+{
+    int index;
+
+    for (index = 0; index < *num_quants; index++)
+    {
+        if (memcmp(quants + index * 5, vals, 5) == 0)
+        {
+            return index;
+        }
+    }
+    if (*num_quants >= RFX_PROGRESSIVE_MAX_QUANTS)
+    {
+        return -1;
+    }
+    memcpy(quants + index * 5, vals, 5);
+    *num_quants += 1;
+    return index;
+}
+
+/******************************************************************************/
+/* the tiles not in the call that are still to get better, as many as the
+   quant values and the region rects have room for */
+static int
+rfx_progressive_get_upgrades(struct rfxencode *enc, int *num_quants,
+                             int max_upgrades)
+{
+    struct rfx_progressive *prog;
+    struct rfx_progressive_tile *ptile;
+    int num_upgrades;
+    int index;
+    int jndex;
+    int quant_idx;
+
+    prog = enc->progressive;
+    num_upgrades = 0;
+    for (index = 0; index < prog->tiles_x * prog->tiles_y; index++)
+    {
+        ptile = prog->tiles + index;
+        if ((ptile->coefs == 0) || prog->listed[index])
+        {
+            continue;
+        }
+        if (num_upgrades >= max_upgrades)
+        {
+            break;
+        }
+        for (jndex = 0; jndex < 3; jndex++)
+        {
+            quant_idx = rfx_progressive_quant_idx(prog->quants, num_quants,
+                                                  ptile->quants + jndex * 5);
+            if (quant_idx < 0)
+            {
+                break;
+            }
+            prog->upgrade_quants[num_upgrades * 3 + jndex] = quant_idx;
+        }
+        if (jndex < 3)
+        {
+            /* next call */
+            continue;
+        }
+        prog->upgrades[num_upgrades] = index;
+        num_upgrades++;
+    }
+    return num_upgrades;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_REGION of the tiles and the upgrades */
+static int
+rfx_progressive_region(struct rfxencode *enc, STREAM *s,
+                       const struct rfx_rect *regions, int num_regions,
+                       const char *buf, int stride_bytes,
+                       const struct rfx_tile *tiles, int num_tiles,
+                       int num_quants, int num_upgrades)
+{
+    struct rfx_progressive *prog;
+    int start_pos;
+    int tiles_pos;
+    int end_pos;
+    int index;
+    int tile_index;
+    int x;
+    int y;
+    int error;
+
+    prog = enc->progressive;
+    if (stream_get_left(s) < 18 + (num_regions + num_upgrades) * 8 +
+                             num_quants * 5 + prog->num_levels * 16)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    start_pos = stream_get_pos(s);
+    stream_seek(s, 6);
+    stream_write_uint8(s, 64); /* tileSize */
+    stream_write_uint16(s, num_regions + num_upgrades); /* numRects */
+    stream_write_uint8(s, num_quants); /* numQuant */
+    stream_write_uint8(s, prog->num_levels); /* numProgQuant */
+    stream_write_uint8(s, prog->reduce_extrapolate ?
+                       RFX_DWT_REDUCE_EXTRAPOLATE : 0); /* flags */
+    stream_write_uint16(s, num_tiles + num_upgrades); /* numTiles */
+    stream_seek(s, 4); /* tileDataSize */
+    for (index = 0; index < num_regions; index++)
+    {
+        stream_write_uint16(s, regions[index].x);
+        stream_write_uint16(s, regions[index].y);
+        stream_write_uint16(s, regions[index].cx);
+        stream_write_uint16(s, regions[index].cy);
+    }
+    for (index = 0; index < num_upgrades; index++)
+    {
+        /* the client only draws the tiles in the rects */
+        tile_index = prog->upgrades[index];
+        x = (tile_index % prog->tiles_x) * 64;
+        y = (tile_index / prog->tiles_x) * 64;
+        stream_write_uint16(s, x);
+        stream_write_uint16(s, y);
+        stream_write_uint16(s, MIN(64, enc->width - x));
+        stream_write_uint16(s, MIN(64, enc->height - y));
+    }
+    memcpy(stream_get_tail(s), prog->quants, num_quants * 5);
+    stream_seek(s, num_quants * 5);
+    memcpy(stream_get_tail(s), prog->levels, prog->num_levels * 16);
+    stream_seek(s, prog->num_levels * 16);
+    tiles_pos = stream_get_pos(s);
+    for (index = 0; index < num_tiles; index++)
+    {
+        error = rfx_progressive_tile_first(enc, s, buf, stride_bytes,
+                                           tiles + index, prog->quants,
+                                           prog->first_coefs[index]);
+        if (error != 0)
+        {
+            return error;
+        }
+    }
+    for (index = 0; index < num_upgrades; index++)
+    {
+        error = rfx_progressive_tile_upgrade(enc, s, prog->upgrades[index],
+                                             prog->upgrade_quants +
+                                             index * 3);
+        if (error != 0)
+        {
+            return error;
+        }
+    }
+    end_pos = stream_get_pos(s);
+    stream_set_pos(s, start_pos);
+    stream_write_uint16(s, PROGRESSIVE_WBT_REGION);
+    stream_write_uint32(s, end_pos - start_pos); /* blockLen */
+    stream_set_pos(s, tiles_pos - num_quants * 5 - prog->num_levels * 16 -
+                      (num_regions + num_upgrades) * 8 - 4);
+    stream_write_uint32(s, end_pos - tiles_pos); /* tileDataSize */
+    stream_set_pos(s, end_pos);
+    return 0;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_SYNC and RFX_PROGRESSIVE_CONTEXT */
+static int
+rfx_progressive_header(struct rfxencode *enc, STREAM *s)
+{
+    if (stream_get_left(s) < 12 + 10)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    stream_write_uint16(s, PROGRESSIVE_WBT_SYNC); /* blockType */
+    stream_write_uint32(s, 12); /* blockLen */
+    stream_write_uint32(s, WF_MAGIC); /* magic */
+    stream_write_uint16(s, WF_VERSION_1_0); /* version */
+    stream_write_uint16(s, PROGRESSIVE_WBT_CONTEXT); /* blockType */
+    stream_write_uint32(s, 10); /* blockLen */
+    stream_write_uint8(s, 0); /* ctxId */
+    stream_write_uint16(s, CT_TILE_64x64); /* tileSize */
+    stream_write_uint8(s, 0); /* flags */
+    return 0;
+}
+
+/******************************************************************************/
+/* 1 if the tiles are not whole tiles of the surface or a tile is in them
+   twice, else marks them in prog->listed */
+static int
+rfx_progressive_list(struct rfxencode *enc, const struct rfx_tile *tiles,
+                     int num_tiles)
+{
+    struct rfx_progressive *prog;
+    const struct rfx_tile *tile;
+    int tile_index;
+    int index;
+
+    prog = enc->progressive;
+    for (index = 0; index < num_tiles; index++)
+    {
+        tile = tiles + index;
+        if ((tile->x < 0) || (tile->y < 0) || ((tile->x & 63) != 0) ||
+            ((tile->y & 63) != 0) || (tile->x >= enc->width) ||
+            (tile->y >= enc->height) || (tile->cx < 1) || (tile->cx > 64) ||
+            (tile->cy < 1) || (tile->cy > 64))
+        {
+            return 1;
+        }
+        tile_index = (tile->y / 64) * prog->tiles_x + tile->x / 64;
+        if (prog->listed[tile_index])
+        {
+            return 1;
+        }
+        prog->listed[tile_index] = 1;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* the client has the tiles of a call, put them in prog->tiles */
+static int
+rfx_progressive_commit(struct rfxencode *enc, const struct rfx_tile *tiles,
+                       int num_tiles, const char *quants, int num_upgrades)
+{
+    struct rfx_progressive *prog;
+    struct rfx_progressive_tile *ptile;
+    const struct rfx_tile *tile;
+    int index;
+
+    prog = enc->progressive;
+    for (index = 0; index < num_tiles; index++)
+    {
+        tile = tiles + index;
+        ptile = prog->tiles + (tile->y / 64) * prog->tiles_x + tile->x / 64;
+        free(ptile->coefs);
+        ptile->coefs = 0;
+        if (prog->num_levels > 0)
+        {
+            ptile->coefs = prog->first_coefs[index];
+            prog->first_coefs[index] = 0;
+            ptile->level = 0;
+            memcpy(ptile->quants, quants + tile->quant_y * 5, 5);
+            memcpy(ptile->quants + 5, quants + tile->quant_cb * 5, 5);
+            memcpy(ptile->quants + 10, quants + tile->quant_cr * 5, 5);
+        }
+    }
+    for (index = 0; index < num_upgrades; index++)
+    {
+        ptile = prog->tiles + prog->upgrades[index];
+        ptile->level++;
+        if (ptile->level >= prog->num_levels)
+        {
+            /* full quality, done */
+            free(ptile->coefs);
+            ptile->coefs = 0;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_progressive_encode(struct rfxencode *enc, STREAM *s,
+                       const char *buf, int stride_bytes,
+                       const struct rfx_rect *regions, int num_regions,
+                       const struct rfx_tile *tiles, int num_tiles,
+                       const char *quants, int num_quants, int flags)
+{
+    struct rfx_progressive *prog;
+    const struct rfx_tile *tile;
+    int num_upgrades;
+    int num_region_quants;
+    int index;
+    int error;
+
+    if ((flags & ~RFX_FLAGS_HEADER) || (num_regions < 0) || (num_tiles < 0))
+    {
+        return 1;
+    }
+    if (enc->progressive == 0)
+    {
+        if (rfx_progressive_create(enc) != 0)
+        {
+            return 1;
+        }
+    }
+    prog = enc->progressive;
+    if (quants == 0)
+    {
+        quants = rfx_compose_quant_vals(quants, 0);
+        num_quants = 1;
+    }
+    if ((num_quants < 1) || (num_quants > RFX_PROGRESSIVE_MAX_QUANTS) ||
+        (num_tiles > prog->tiles_x * prog->tiles_y) ||
+        (num_regions > 0xFFFF - num_tiles))
+    {
+        return 1;
+    }
+    for (index = 0; index < num_tiles; index++)
+    {
+        tile = tiles + index;
+        if ((tile->quant_y < 0) || (tile->quant_y >= num_quants) ||
+            (tile->quant_cb < 0) || (tile->quant_cb >= num_quants) ||
+            (tile->quant_cr < 0) || (tile->quant_cr >= num_quants))
+        {
+            return 1;
+        }
+    }
+    error = rfx_progressive_list(enc, tiles, num_tiles);
+    if (error == 0)
+    {
+        for (index = 0; index < num_tiles; index++)
+        {
+            prog->first_coefs[index] = (sint16 *)
+                malloc(RFX_PROGRESSIVE_COEFS * sizeof(sint16));
+            if (prog->first_coefs[index] == 0)
+            {
+                error = 1;
+                break;
+            }
+        }
+    }
+    num_upgrades = 0;
+    if (error == 0)
+    {
+        memcpy(prog->quants, quants, num_quants * 5);
+        num_region_quants = num_quants;
+        num_upgrades = rfx_progressive_get_upgrades(enc, &num_region_quants,
+                                                    0xFFFF - num_regions -
+                                                    num_tiles);
+        if ((enc->header_processed == 0) || (flags & RFX_FLAGS_HEADER))
+        {
+            error = rfx_progressive_header(enc, s);
+        }
+    }
+    if ((error == 0) && (stream_get_left(s) < 12 + 6))
+    {
+        error = RFX_ERROR_OVERFLOW;
+    }
+    if (error == 0)
+    {
+        stream_write_uint16(s, PROGRESSIVE_WBT_FRAME_BEGIN); /* blockType */
+        stream_write_uint32(s, 12); /* blockLen */
+        stream_write_uint32(s, enc->frame_idx); /* frameIndex */
+        /* regionCount, no region when there is nothing to send */
+        stream_write_uint16(s, num_tiles + num_upgrades > 0 ? 1 : 0);
+        if (num_tiles + num_upgrades > 0)
+        {
+            error = rfx_progressive_region(enc, s, regions, num_regions,
+                                           buf, stride_bytes,
+                                           tiles, num_tiles,
+                                           num_region_quants, num_upgrades);
+        }
+    }
+    if ((error == 0) && (stream_get_left(s) < 6))
+    {
+        error = RFX_ERROR_OVERFLOW;
+    }
+    if (error == 0)
+    {
+        stream_write_uint16(s, PROGRESSIVE_WBT_FRAME_END); /* blockType */
+        stream_write_uint32(s, 6); /* blockLen */
+        rfx_progressive_commit(enc, tiles, num_tiles, quants, num_upgrades);
+        enc->frame_idx++;
+        enc->header_processed = 1;
+    }
+    for (index = 0; index < num_tiles; index++)
+    {
+        tile = tiles + index;
+        if ((tile->x >= 0) && (tile->y >= 0) && (tile->x < enc->width) &&
+            (tile->y < enc->height))
+        {
+            prog->listed[(tile->y / 64) * prog->tiles_x + tile->x / 64] = 0;
+        }
+        free(prog->first_coefs[index]);
+        prog->first_coefs[index] = 0;
+    }
+    return error;
+}
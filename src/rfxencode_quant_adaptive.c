@@ -0,0 +1,141 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Per tile quant selection
+ *
+ * With RFX_FLAGS_QUANT_ADAPTIVE the tileset carries the quant sets in
+ * g_rfx_adaptive_quantization_values instead of the ones from the caller
+ * and each tile picks its own from the y plane, after colour conversion
+ * and before the DWT.  The differences between each pixel and the one
+ * below it say what the tile is:
+ * flat, no edges and about 1 or less on average, coarse quants only take
+ *     out noise
+ * text, half or more of the differences are 0, the flat background
+ *     around glyphs, lines and icons, fine quants keep the edges sharp
+ * photo, everything else, coarse quants, the loss is hard to see there
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxencode_quant_adaptive.h"
+
+/* differences in a tile, 63 rows of 64 */
+#define RFX_TILE_DIFFS (63 * 64)
+
+/*
+ * LL3, LH3, HL3, HH3, LH2, HL2, HH2, LH1, HL1, HH1
+ */
+const unsigned char g_rfx_adaptive_quantization_values[] =
+{
+    0x66, 0x66, 0x77, 0x77, 0x87, /* 0, finer than the default */
+    0x66, 0x66, 0x77, 0x88, 0x98, /* 1, the default */
+    0x76, 0x87, 0x88, 0x99, 0xA9, /* 2 */
+    0x86, 0x98, 0xAA, 0xCB, 0xDC  /* 3 */
+};
+
+/* y, cb and cr quant sets for each tile class */
+static const int g_rfx_adaptive_quant_idx[3][3] =
+{
+    { 0, 1, 1 }, /* RFX_TILE_TEXT */
+    { 2, 3, 3 }, /* RFX_TILE_PHOTO */
+    { 3, 3, 3 }  /* RFX_TILE_FLAT */
+};
+
+/******************************************************************************/
+/* vertical differences of a 64x64 y plane */
+int
+rfx_tile_stats(const uint8 *y_buffer, int *stats)
+{
+    int x;
+    int y;
+    int diff;
+    int sad;
+    int zero;
+    int edge;
+
+    sad = 0;
+    zero = 0;
+    edge = 0;
+    for (y = 0; y < 63; y++)
+    {
+        for (x = 0; x < 64; x++)
+        {
+            diff = y_buffer[x + 64] - y_buffer[x];
+            if (diff < 0)
+            {
+                diff = -diff;
+            }
+            sad += diff;
+            zero += diff == 0;
+            edge += diff >= RFX_TILE_EDGE;
+        }
+        y_buffer += 64;
+    }
+    stats[RFX_TILE_STATS_SAD] = sad;
+    stats[RFX_TILE_STATS_ZERO] = zero;
+    stats[RFX_TILE_STATS_EDGE] = edge;
+    return 0;
+}
+
+/******************************************************************************/
+/* set the y, cb and cr quant indices for the tile, returns the class */
+int
+rfx_quant_adaptive(struct rfxencode *enc, const uint8 *y_buffer,
+                   int *quant_idx)
+{
+    int stats[RFX_TILE_STATS_COUNT];
+    int class;
+
+    enc->rfx_tile_stats(y_buffer, stats);
+    if ((stats[RFX_TILE_STATS_EDGE] == 0) &&
+        (stats[RFX_TILE_STATS_SAD] <= RFX_TILE_DIFFS))
+    {
+        class = RFX_TILE_FLAT;
+    }
+    else if (stats[RFX_TILE_STATS_ZERO] * 2 >= RFX_TILE_DIFFS)
+    {
+        class = RFX_TILE_TEXT;
+    }
+    else
+    {
+        class = RFX_TILE_PHOTO;
+    }
+    return rfx_quant_adaptive_class(class, quant_idx);
+}
+
+/******************************************************************************/
+/* set the y, cb and cr quant indices for a tile of class */
+int
+rfx_quant_adaptive_class(int class, int *quant_idx)
+{
+    quant_idx[0] = g_rfx_adaptive_quant_idx[class][0];
+    quant_idx[1] = g_rfx_adaptive_quant_idx[class][1];
+    quant_idx[2] = g_rfx_adaptive_quant_idx[class][2];
+    return class;
+}
@@ -0,0 +1,50 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_QUANT_ADAPTIVE_H
+#define __RFXENCODE_QUANT_ADAPTIVE_H
+
+#include "rfxcommon.h"
+
+/* quant sets in the tileset with RFX_FLAGS_QUANT_ADAPTIVE */
+#define RFX_ADAPTIVE_NUM_QUANTS 4
+
+/* tile classes */
+#define RFX_TILE_TEXT  0 /* sharp edges on a flat background */
+#define RFX_TILE_PHOTO 1
+#define RFX_TILE_FLAT  2
+
+/* rfx_tile_stats output */
+#define RFX_TILE_STATS_SAD   0 /* sum of the differences */
+#define RFX_TILE_STATS_ZERO  1 /* differences that are 0 */
+#define RFX_TILE_STATS_EDGE  2 /* differences of RFX_TILE_EDGE or more */
+#define RFX_TILE_STATS_COUNT 3
+
+#define RFX_TILE_EDGE 32
+
+extern const unsigned char g_rfx_adaptive_quantization_values[];
+
+int
+rfx_tile_stats(const uint8 *y_buffer, int *stats);
+int
+rfx_quant_adaptive(struct rfxencode *enc, const uint8 *y_buffer,
+                   int *quant_idx);
+int
+rfx_quant_adaptive_class(int class, int *quant_idx);
+
+#endif
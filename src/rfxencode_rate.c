@@ -0,0 +1,483 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Rate control, rfxcodec_encode_set_rate
+ *
+ * A bucket fills by bytes_per_second / frames_per_second after each frame
+ * and each call gets that plus half of what is saved up, never more than
+ * the bucket or max_frame_bytes.  The finest level of
+ * g_rfx_rate_quantization_values that the model says fits in that is used
+ * for all the tiles of the call, luma at that level and chroma one level
+ * coarser.  It goes one level finer at most per call, coarser at once.
+ *
+ * The model is the bytes per RFX_RATE_ACTIVITY of tile activity at each
+ * level, it starts from g_rfx_rate_ratio.  The activity of a tile is the
+ * square root of the rfx_tile_stats SAD of its y plane, which the bytes
+ * follow much better than the SAD itself, plus RFX_RATE_ACTIVITY_MIN for
+ * what even a flat tile costs.  Each call takes it from up to
+ * RFX_RATE_SAMPLES of its tiles before it picks the level.  The size of
+ * each frame sets the level it was encoded at.  When the last frame was
+ * at the same level the others are scaled by the same amount, the
+ * content changed, when it was at another level only this one is set, so
+ * the steps between the levels are learnt as they are used.  It follows
+ * bigger frames at once and smaller ones at half speed.
+ *
+ * What is learnt from flat or text tiles is far too little for busy
+ * ones, so when the activity per tile of a call is more than twice or
+ * less than half that of the last one the call goes by g_rfx_rate_bytes
+ * where that is more, and the steps between the levels start over from
+ * g_rfx_rate_ratio.  The activity does not tell text from a photo as
+ * busy, the first frame after such a change can still be over.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxcompose.h"
+#include "rfxencode_rate.h"
+#include "rfxencode_tile.h"
+#include "rfxencode_quant_adaptive.h"
+#include "rfxencode_hash.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+#define RFX_RATE_LEVELS 10
+#define RFX_RATE_START_LEVEL 2 /* g_rfx_default_quantization_values */
+#define RFX_RATE_START_BYTES 2048 /* at RFX_RATE_START_LEVEL */
+#define RFX_RATE_ACTIVITY 256 /* the activity the model is for */
+#define RFX_RATE_ACTIVITY_MIN 16 /* of a flat tile */
+#define RFX_RATE_SAMPLES 16 /* tiles a call takes the activity from */
+
+struct rfx_rate_call
+{
+    int level;
+    int changed; /* the activity is far from the last call */
+    int num_tiles;
+    sint64 activity; /* of all the tiles */
+    int overhead; /* bytes that are not tiles */
+    int tile_max; /* rfx_compose_tile_bound per RFX_RATE_ACTIVITY_MIN */
+};
+
+struct rfx_rate
+{
+    int bytes_per_frame;
+    int max_frame_bytes;
+    int bucket; /* can go below 0 after a frame over budget */
+    int bucket_max;
+    int tile_bytes[RFX_RATE_LEVELS]; /* the model, per RFX_RATE_ACTIVITY */
+    int tile_activity; /* per tile of the last call, 0 for none */
+    int last_level;
+    int level; /* of the last call */
+    /* the current call, only rfx_rate_commit takes it in so a call that
+       fails leaves the state as it was */
+    struct rfx_rate_call pending;
+    char quants[10];
+    struct rfx_tile *tiles;
+    int tiles_alloc;
+};
+
+/*
+ * LL3, LH3, HL3, HH3, LH2, HL2, HH2, LH1, HL1, HH1
+ * fine to coarse, level 2 is the default
+ */
+static const unsigned char g_rfx_rate_quantization_values[] =
+{
+    0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x77, 0x77, 0x87,
+    0x66, 0x66, 0x77, 0x88, 0x98,
+    0x76, 0x87, 0x88, 0x99, 0xA9,
+    0x86, 0x98, 0x99, 0xAA, 0xBA,
+    0x97, 0xA9, 0xAA, 0xBB, 0xCB,
+    0xA7, 0xBA, 0xBB, 0xCC, 0xDC,
+    0xB8, 0xCB, 0xCC, 0xDD, 0xED,
+    0xC8, 0xDC, 0xDD, 0xEE, 0xFE,
+    0xD9, 0xED, 0xEE, 0xFF, 0xFF
+};
+
+/* bytes at each level to start with, 256 is RFX_RATE_START_LEVEL,
+ * the geometric mean of what text, photo and noise tiles give */
+static const int g_rfx_rate_ratio[RFX_RATE_LEVELS] =
+{
+    392, 316, 256, 180, 92, 52, 38, 17, 10, 6
+};
+
+/* bytes per RFX_RATE_ACTIVITY at each level of photo tiles, the most of
+ * text, photo and noise tiles at nearly all levels */
+static const int g_rfx_rate_bytes[RFX_RATE_LEVELS] =
+{
+    8192, 5888, 4352, 3174, 2304, 1331, 819, 180, 128, 90
+};
+
+/******************************************************************************/
+int
+rfx_rate_create(struct rfxencode *enc, int bytes_per_second,
+                int frames_per_second, int max_frame_bytes)
+{
+    struct rfx_rate *rate;
+    int level;
+
+    rfx_rate_delete(enc);
+    if (bytes_per_second < 1)
+    {
+        return 0;
+    }
+    if ((frames_per_second < 1) || (max_frame_bytes < 0))
+    {
+        return 1;
+    }
+    rate = (struct rfx_rate *) calloc(1, sizeof(struct rfx_rate));
+    if (rate == 0)
+    {
+        return 1;
+    }
+    rate->bytes_per_frame = bytes_per_second / frames_per_second;
+    if (max_frame_bytes == 0)
+    {
+        /* no cap, up to a second worth */
+        rate->max_frame_bytes = bytes_per_second;
+    }
+    else
+    {
+        rate->max_frame_bytes = max_frame_bytes;
+    }
+    rate->bucket = rate->bytes_per_frame;
+    rate->bucket_max = MAX(rate->max_frame_bytes, rate->bytes_per_frame);
+    for (level = 0; level < RFX_RATE_LEVELS; level++)
+    {
+        rate->tile_bytes[level] = RFX_RATE_START_BYTES *
+                                  g_rfx_rate_ratio[level] / 256;
+    }
+    rate->level = RFX_RATE_START_LEVEL;
+    rate->pending.level = RFX_RATE_START_LEVEL;
+    enc->rate = rate;
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_rate_delete(struct rfxencode *enc)
+{
+    if (enc->rate == 0)
+    {
+        return 0;
+    }
+    free(enc->rate->tiles);
+    free(enc->rate);
+    enc->rate = 0;
+    return 0;
+}
+
+/******************************************************************************/
+/* a full bucket, the model stays */
+int
+rfx_rate_reset(struct rfxencode *enc)
+{
+    enc->rate->bucket = enc->rate->bytes_per_frame;
+    return 0;
+}
+
+/******************************************************************************/
+/* the level of the call, the one the tiles it sends are at */
+int
+rfx_rate_level(struct rfxencode *enc)
+{
+    return enc->rate->pending.level;
+}
+
+/******************************************************************************/
+static int
+rfx_rate_isqrt(int value)
+{
+    int root;
+    int bit;
+
+    root = 0;
+    for (bit = 1 << 15; bit > 0; bit >>= 1)
+    {
+        if ((root + bit) * (root + bit) <= value)
+        {
+            root += bit;
+        }
+    }
+    return root;
+}
+
+/******************************************************************************/
+/* the activity of num_tiles tiles from up to RFX_RATE_SAMPLES of them,
+   spread over the call */
+static int
+rfx_rate_activity(struct rfxencode *enc, const char *buf, int stride_bytes,
+                  const struct rfx_tile *tiles, int num_tiles,
+                  sint64 *activity)
+{
+    const struct rfx_tile *tile;
+    const uint8 *y_buffer;
+    const uint8 *u_buffer;
+    const uint8 *v_buffer;
+    int stats[RFX_TILE_STATS_COUNT];
+    int num_samples;
+    int index;
+
+    *activity = 0;
+    if (num_tiles < 1)
+    {
+        return 0;
+    }
+    num_samples = MIN(num_tiles, RFX_RATE_SAMPLES);
+    for (index = 0; index < num_samples; index++)
+    {
+        tile = tiles + (sint64) index * num_tiles / num_samples;
+        if (rfx_encode_tile_yuv(enc, buf, tile->x, tile->y, tile->cx,
+                                tile->cy, stride_bytes, &y_buffer,
+                                &u_buffer, &v_buffer) != 0)
+        {
+            return 1;
+        }
+        enc->rfx_tile_stats(y_buffer, stats);
+        *activity += rfx_rate_isqrt(stats[RFX_TILE_STATS_SAD]) +
+                     RFX_RATE_ACTIVITY_MIN;
+    }
+    *activity = *activity * num_tiles / num_samples;
+    return 0;
+}
+
+/******************************************************************************/
+/* bytes per RFX_RATE_ACTIVITY at level for this call */
+static int
+rfx_rate_bytes(struct rfx_rate *rate, int level)
+{
+    if (rate->pending.changed)
+    {
+        return MAX(rate->tile_bytes[level], g_rfx_rate_bytes[level]);
+    }
+    return rate->tile_bytes[level];
+}
+
+/******************************************************************************/
+/* pick the level for num_tiles tiles, tiles, num_tiles, quants, num_quants
+ * and flags are changed to what rfx_compose_message_data should use, with
+ * RFX_FLAGS_TILE_HASH tiles is enc->hash_tiles and unchanged tiles from
+ * rfx_hash_refine can be added to it
+ * the level and what the model needs go in rate->pending, the model and
+ * the level the next call starts from only change in rfx_rate_commit */
+int
+rfx_rate_tiles(struct rfxencode *enc, const char *buf, int stride_bytes,
+               const struct rfx_tile **tiles, int *num_tiles, int num_regions,
+               const char **quants, int *num_quants, int *flags)
+{
+    struct rfx_rate *rate;
+    struct rfx_rate_call *call;
+    struct rfx_tile *rate_tiles;
+    sint64 bytes;
+    sint64 activity;
+    sint64 refine_activity;
+    sint64 refine_bytes;
+    int tile_activity;
+    int num_refine;
+    int frames;
+    int avail;
+    int level;
+    int index;
+
+    rate = enc->rate;
+    call = &(rate->pending);
+    if (rfx_rate_activity(enc, buf, stride_bytes, *tiles, *num_tiles,
+                          &activity) != 0)
+    {
+        return 1;
+    }
+    *flags &= ~RFX_FLAGS_QUANT_ADAPTIVE;
+    /* the unchanged tiles that can be sent again are counted in */
+    num_refine = enc->hashes == 0 ? 0 : enc->num_hash_refine;
+    frames = 1;
+    if ((enc->sink != 0) && (*num_tiles + num_refine > enc->sink_tiles))
+    {
+        frames = (*num_tiles + num_refine + enc->sink_tiles - 1) /
+                 enc->sink_tiles;
+    }
+    call->overhead = rfx_compose_message_bound(enc, 0, num_regions, 2,
+                                               *flags) +
+                     (frames - 1) * rfx_compose_frame_bound(enc, num_regions, 2,
+                                                            *flags);
+    /* the most RFX_RATE_ACTIVITY can be is a flat tile at the bound */
+    call->tile_max = rfx_compose_tile_bound(enc, *flags) *
+                     (RFX_RATE_ACTIVITY / RFX_RATE_ACTIVITY_MIN);
+    avail = rate->bucket;
+    if (avail > rate->bytes_per_frame)
+    {
+        /* spread what was saved over the next frames */
+        avail = rate->bytes_per_frame + (avail - rate->bytes_per_frame) / 2;
+    }
+    avail = MIN(avail, rate->max_frame_bytes);
+    avail -= call->overhead;
+    avail -= avail / 8; /* the model is not exact */
+    call->changed = 0;
+    if (*num_tiles > 0)
+    {
+        tile_activity = (int) (activity / *num_tiles);
+        call->changed = (tile_activity > rate->tile_activity * 2) ||
+                        (tile_activity * 2 < rate->tile_activity);
+    }
+    for (level = MAX(rate->level - 1, 0); level < RFX_RATE_LEVELS - 1; level++)
+    {
+        bytes = activity * rfx_rate_bytes(rate, level) / RFX_RATE_ACTIVITY;
+        if (bytes <= avail)
+        {
+            break;
+        }
+    }
+    bytes = activity * rfx_rate_bytes(rate, level) / RFX_RATE_ACTIVITY;
+    if ((num_refine > 0) && (bytes < avail))
+    {
+        /* what is left goes to the unchanged tiles sent at a coarser
+           level, they are added after the changed ones */
+        if (rfx_rate_activity(enc, buf, stride_bytes, enc->hash_refine,
+                              num_refine, &refine_activity) != 0)
+        {
+            return 1;
+        }
+        refine_bytes = refine_activity * rfx_rate_bytes(rate, level) /
+                       RFX_RATE_ACTIVITY / num_refine;
+        num_refine = (int) MIN((avail - bytes) / MAX(refine_bytes, 1),
+                               num_refine);
+        num_refine = rfx_hash_refine(enc, level, num_refine);
+        activity += refine_activity * num_refine / enc->num_hash_refine;
+        *num_tiles += num_refine;
+    }
+    LLOGLN(10, ("rfx_rate_tiles: bucket %d avail %d activity %d level %d",
+           rate->bucket, avail, (int) activity, level));
+    call->level = level;
+    call->num_tiles = *num_tiles;
+    call->activity = activity;
+    memcpy(rate->quants, g_rfx_rate_quantization_values + level * 5, 5);
+    level = MIN(level + 1, RFX_RATE_LEVELS - 1);
+    memcpy(rate->quants + 5, g_rfx_rate_quantization_values + level * 5, 5);
+    if (*num_tiles > rate->tiles_alloc)
+    {
+        rate_tiles = (struct rfx_tile *)
+                     realloc(rate->tiles, *num_tiles * sizeof(struct rfx_tile));
+        if (rate_tiles == 0)
+        {
+            return 1;
+        }
+        rate->tiles = rate_tiles;
+        rate->tiles_alloc = *num_tiles;
+    }
+    for (index = 0; index < *num_tiles; index++)
+    {
+        rate->tiles[index] = (*tiles)[index];
+        rate->tiles[index].quant_y = 0;
+        rate->tiles[index].quant_cb = 1;
+        rate->tiles[index].quant_cr = 1;
+    }
+    *tiles = rate->tiles;
+    *quants = rate->quants;
+    *num_quants = 2;
+    return 0;
+}
+
+/******************************************************************************/
+/* the call encoded to bytes, update the bucket and the model */
+int
+rfx_rate_commit(struct rfxencode *enc, int bytes)
+{
+    struct rfx_rate *rate;
+    struct rfx_rate_call *call;
+    int tile_bytes;
+    int old_bytes;
+    int level;
+
+    rate = enc->rate;
+    call = &(rate->pending);
+    rate->last_level = rate->level;
+    rate->level = call->level;
+    rate->bucket += rate->bytes_per_frame - bytes;
+    if (rate->bucket > rate->bucket_max)
+    {
+        rate->bucket = rate->bucket_max;
+    }
+    if ((call->num_tiles < 1) || (call->activity < 1))
+    {
+        return 0;
+    }
+    tile_bytes = (int) ((sint64) (bytes - call->overhead) *
+                        RFX_RATE_ACTIVITY / call->activity);
+    rate->tile_activity = (int) (call->activity / call->num_tiles);
+    tile_bytes = MAX(tile_bytes, 1);
+    old_bytes = rate->tile_bytes[rate->level];
+    if (call->changed)
+    {
+        /* new content, the steps between the levels start over */
+        for (level = 0; level < RFX_RATE_LEVELS; level++)
+        {
+            rate->tile_bytes[level] = (int)
+                ((sint64) tile_bytes * g_rfx_rate_ratio[level] /
+                 g_rfx_rate_ratio[rate->level]);
+        }
+    }
+    else
+    {
+        if (tile_bytes < old_bytes)
+        {
+            tile_bytes = (old_bytes + tile_bytes) / 2;
+        }
+        if (rate->level == rate->last_level)
+        {
+            /* the content changed by this much, the other levels with it */
+            for (level = 0; level < RFX_RATE_LEVELS; level++)
+            {
+                rate->tile_bytes[level] = (int)
+                    ((sint64) rate->tile_bytes[level] * tile_bytes /
+                     old_bytes);
+            }
+        }
+    }
+    rate->tile_bytes[rate->level] = tile_bytes;
+    for (level = 0; level < RFX_RATE_LEVELS; level++)
+    {
+        rate->tile_bytes[level] = MIN(rate->tile_bytes[level],
+                                      call->tile_max);
+    }
+    /* a finer level is never less */
+    for (level = rate->level + 1; level < RFX_RATE_LEVELS; level++)
+    {
+        rate->tile_bytes[level] = MIN(rate->tile_bytes[level],
+                                      rate->tile_bytes[level - 1]);
+        rate->tile_bytes[level] = MAX(rate->tile_bytes[level], 1);
+    }
+    for (level = rate->level - 1; level >= 0; level--)
+    {
+        rate->tile_bytes[level] = MAX(rate->tile_bytes[level],
+                                      rate->tile_bytes[level + 1]);
+    }
+    LLOGLN(10, ("rfx_rate_commit: bytes %d bucket %d level %d tile_bytes %d",
+           bytes, rate->bucket, rate->level, tile_bytes));
+    return 0;
+}
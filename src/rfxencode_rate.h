@@ -0,0 +1,40 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_RATE_H
+#define __RFXENCODE_RATE_H
+
+#include "rfxcommon.h"
+
+int
+rfx_rate_create(struct rfxencode *enc, int bytes_per_second,
+                int frames_per_second, int max_frame_bytes);
+int
+rfx_rate_delete(struct rfxencode *enc);
+int
+rfx_rate_reset(struct rfxencode *enc);
+int
+rfx_rate_level(struct rfxencode *enc);
+int
+rfx_rate_tiles(struct rfxencode *enc, const char *buf, int stride_bytes,
+               const struct rfx_tile **tiles, int *num_tiles, int num_regions,
+               const char **quants, int *num_quants, int *flags);
+int
+rfx_rate_commit(struct rfxencode *enc, int bytes);
+
+#endif
@@ -226,6 +226,19 @@ rfx_rlgr1_encode(const sint16 *data, uint8 *buffer, int buffer_size)
         }
     }
 
+    /* zero the unused bits of the last byte, the output buffer is not
+       cleared before encoding */
+    if (bs.bits_left < 8)
+    {
+        rfx_bitstream_put_bits(bs, 0, bs.bits_left);
+    }
+
+    if (bs.overflow)
+    {
+        /* buffer_size too small */
+        return -1;
+    }
+
     processed_size = rfx_bitstream_get_processed_bytes(bs);
 
     return processed_size;
@@ -22,6 +22,12 @@
 
 #include "rfxcommon.h"
 
+/* most bytes RLGR1 makes from a 64x64 component with quant values 6
+   to 15, found by limiting each coefficient to the largest its subband
+   can hold after quantization and searching the kp and krp states for
+   the longest code */
+#define RFX_MAX_RLGR1_BYTES 9020
+
 int
 rfx_rlgr1_encode(const sint16 *data, uint8 *buffer, int buffer_size);
 
@@ -0,0 +1,257 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Solid colour tiles
+ *
+ * A tile of one colour converts to a y, u and v plane of one value each.
+ * The DWT of a flat plane is 0 everywhere but in LL3, where every
+ * coefficient is the value, and after the differential only the first
+ * LL3 coefficient is left.  The RLGR output of each component then only
+ * depends on that one quantized DC value, so it is encoded once, the
+ * first time it is seen, and copied from enc->solid_bytes after that.
+ * The output is the same as the full encode.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rfxcodec_encode.h>
+#include <rfxcodec_common.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxconstants.h"
+#include "rfxencode_rlgr1.h"
+#include "rfxencode_rlgr3.h"
+#include "rfxencode_solid.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+/* where LL3 starts in dwt_buffer1 */
+#define RFX_SOLID_LL3 4032
+
+/******************************************************************************/
+/* 1 if every pixel has the same colour, and alpha if with_alpha, as the
+   first one */
+static int
+rfx_tile_solid_rect(const char *data, int width, int height,
+                    int stride_bytes, int bytes_per_pixel, int with_alpha)
+{
+    const uint8 *src;
+    const uint8 *first;
+    int x;
+    int y;
+
+    first = (const uint8 *) data;
+    for (y = 0; y < height; y++)
+    {
+        src = (const uint8 *) (data + y * stride_bytes);
+        for (x = 0; x < width; x++)
+        {
+            if ((src[0] != first[0]) || (src[1] != first[1]) ||
+                (src[2] != first[2]))
+            {
+                return 0;
+            }
+            if (with_alpha && (src[3] != first[3]))
+            {
+                return 0;
+            }
+            src += bytes_per_pixel;
+        }
+    }
+    return 1;
+}
+
+/******************************************************************************/
+/* 64x64, 32 bpp */
+int
+rfx_tile_solid(const char *data, int stride_bytes, int with_alpha)
+{
+    return rfx_tile_solid_rect(data, 64, 64, stride_bytes, 4, with_alpha);
+}
+
+/******************************************************************************/
+/* 1 if the tile is solid, rgba is then its colour */
+int
+rfx_encode_tile_solid(struct rfxencode *enc, const char *data,
+                      int width, int height, int stride_bytes,
+                      int with_alpha, uint8 *rgba)
+{
+    const uint8 *src;
+    int solid;
+
+    switch (enc->format)
+    {
+        case RFX_FORMAT_BGRA:
+        case RFX_FORMAT_RGBA:
+            if ((width == 64) && (height == 64))
+            {
+                solid = enc->rfx_tile_solid(data, stride_bytes, with_alpha);
+            }
+            else
+            {
+                solid = rfx_tile_solid_rect(data, width, height,
+                                            stride_bytes, 4, with_alpha);
+            }
+            break;
+        case RFX_FORMAT_BGR:
+        case RFX_FORMAT_RGB:
+            solid = rfx_tile_solid_rect(data, width, height,
+                                        stride_bytes, 3, 0);
+            break;
+        default:
+            return 0;
+    }
+    if (solid == 0)
+    {
+        return 0;
+    }
+    src = (const uint8 *) data;
+    if ((enc->format == RFX_FORMAT_BGRA) || (enc->format == RFX_FORMAT_BGR))
+    {
+        rgba[0] = src[2];
+        rgba[2] = src[0];
+    }
+    else
+    {
+        rgba[0] = src[0];
+        rgba[2] = src[2];
+    }
+    rgba[1] = src[1];
+    rgba[3] = enc->bits_per_pixel == 32 ? src[3] : 0xFF;
+    return 1;
+}
+
+/******************************************************************************/
+/* one component of value, same as enc->rfx_encode on a plane of value */
+static int
+rfx_encode_solid_component(struct rfxencode *enc, const char *qtable,
+                           int value, STREAM *data_out, int *size)
+{
+    int factor;
+    int dc;
+    int bytes;
+
+    /* rfx_quantization_encode on (value - 128) << DWT_FACTOR */
+    factor = (qtable[0] & 0xf) - 6 + DWT_FACTOR;
+    dc = (((value - 128) << DWT_FACTOR) + (1 << (factor - 1))) >> factor;
+    dc += RFX_SOLID_DCS / 2;
+    if (enc->solid_mode != enc->mode)
+    {
+        /* the table is for the other RLGR */
+        memset(enc->solid_size, 0, sizeof(enc->solid_size));
+        enc->solid_mode = enc->mode;
+    }
+    bytes = enc->solid_size[dc];
+    if (bytes == 0)
+    {
+        memset(enc->dwt_buffer1, 0, 4096 * sizeof(sint16));
+        enc->dwt_buffer1[RFX_SOLID_LL3] = dc - RFX_SOLID_DCS / 2;
+        if (enc->mode == RLGR3)
+        {
+            bytes = rfx_rlgr3_encode(enc->dwt_buffer1, enc->solid_bytes[dc],
+                                     RFX_SOLID_BYTES);
+        }
+        else
+        {
+            bytes = rfx_rlgr1_encode(enc->dwt_buffer1, enc->solid_bytes[dc],
+                                     RFX_SOLID_BYTES);
+        }
+        if (bytes < 1)
+        {
+            return 1;
+        }
+        LLOGLN(10, ("rfx_encode_solid_component: dc %d bytes %d",
+               dc - RFX_SOLID_DCS / 2, bytes));
+        enc->solid_size[dc] = bytes;
+    }
+    if (stream_get_left(data_out) < bytes)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    memcpy(stream_get_tail(data_out), enc->solid_bytes[dc], bytes);
+    stream_seek(data_out, bytes);
+    *size = bytes;
+    return 0;
+}
+
+/******************************************************************************/
+/* 1 if the LL3 quants of y, u and v are 6 to 15, as the spec says, the DC
+   of a solid component then fits in solid_size and solid_bytes, else the
+   tile has to go through the DWT */
+int
+rfx_encode_solid_quants(const char *quant_vals, const int *quant_idx)
+{
+    int index;
+    int quant;
+
+    for (index = 0; index < 3; index++)
+    {
+        quant = quant_vals[quant_idx[index] * 5] & 0xf;
+        if (quant < 6)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/******************************************************************************/
+/* y, u and v of a tile of colour rgba, see rfx_encode_rgb_to_yuv */
+int
+rfx_encode_solid(struct rfxencode *enc, const uint8 *rgba,
+                 const char *quant_vals, const int *quant_idx,
+                 STREAM *data_out, int *y_size, int *u_size, int *v_size)
+{
+    sint32 r, g, b;
+    sint32 y, u, v;
+    int error;
+
+    r = rgba[0];
+    g = rgba[1];
+    b = rgba[2];
+    y = (r *  19595 + g *  38470 + b *   7471) >> 16;
+    u = (r * -11071 + g * -21736 + b *  32807) >> 16;
+    v = (r *  32756 + g * -27429 + b *  -5327) >> 16;
+    y = MINMAX(y, 0, 255);
+    u = MINMAX(u + 128, 0, 255);
+    v = MINMAX(v + 128, 0, 255);
+    error = rfx_encode_solid_component(enc, quant_vals + quant_idx[0] * 5,
+                                       y, data_out, y_size);
+    if (error != 0)
+    {
+        return error;
+    }
+    error = rfx_encode_solid_component(enc, quant_vals + quant_idx[1] * 5,
+                                       u, data_out, u_size);
+    if (error != 0)
+    {
+        return error;
+    }
+    return rfx_encode_solid_component(enc, quant_vals + quant_idx[2] * 5,
+                                      v, data_out, v_size);
+}
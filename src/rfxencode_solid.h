@@ -0,0 +1,37 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_SOLID_H
+#define __RFXENCODE_SOLID_H
+
+#include "rfxcommon.h"
+
+int
+rfx_tile_solid(const char *data, int stride_bytes, int with_alpha);
+int
+rfx_encode_tile_solid(struct rfxencode *enc, const char *data,
+                      int width, int height, int stride_bytes,
+                      int with_alpha, uint8 *rgba);
+int
+rfx_encode_solid_quants(const char *quant_vals, const int *quant_idx);
+int
+rfx_encode_solid(struct rfxencode *enc, const uint8 *rgba,
+                 const char *quant_vals, const int *quant_idx,
+                 STREAM *data_out, int *y_size, int *u_size, int *v_size);
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode_stats.h"
+
+/******************************************************************************/
+/* add the counters of src to dst, not the names */
+int
+rfx_stats_add(struct rfx_encode_stats *dst,
+              const struct rfx_encode_stats *src)
+{
+    int index;
+
+    for (index = 0; index < RFX_STATS_STAGES; index++)
+    {
+        dst->stage_ns[index] += src->stage_ns[index];
+        dst->stage_calls[index] += src->stage_calls[index];
+    }
+    dst->tiles += src->tiles;
+    dst->y_bytes += src->y_bytes;
+    dst->u_bytes += src->u_bytes;
+    dst->v_bytes += src->v_bytes;
+    dst->a_bytes += src->a_bytes;
+    dst->solid_tiles += src->solid_tiles;
+    return 0;
+}
+
+#if defined(RFX_USE_STATS)
+
+/******************************************************************************/
+sint64
+rfx_stats_get_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((sint64) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_STATS_H
+#define __RFXENCODE_STATS_H
+
+#include "rfxcommon.h"
+
+struct rfx_encode_stats;
+
+int
+rfx_stats_add(struct rfx_encode_stats *dst,
+              const struct rfx_encode_stats *src);
+
+#if defined(RFX_USE_STATS)
+
+sint64
+rfx_stats_get_ns(void);
+
+/* STATS_DECLARE goes after the other declarations */
+#define STATS_DECLARE sint64 stats_ns
+#define STATS_START do { stats_ns = rfx_stats_get_ns(); } while (0)
+/* add the time since STATS_START or the last STATS_LAP to _stage */
+#define STATS_LAP(_enc, _stage) do { \
+    sint64 lns = rfx_stats_get_ns(); \
+    (_enc)->stats.stage_ns[_stage] += lns - stats_ns; \
+    (_enc)->stats.stage_calls[_stage]++; \
+    stats_ns = lns; \
+} while (0)
+#define STATS_ADD(_enc, _field, _val) do { \
+    (_enc)->stats._field += _val; \
+} while (0)
+
+#else
+
+#define STATS_DECLARE
+#define STATS_START do { } while (0)
+#define STATS_LAP(_enc, _stage) do { } while (0)
+#define STATS_ADD(_enc, _field, _val) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,676 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Tile parallel encoding
+ *
+ * The tiles of a tileset are split into chunks.  Each worker, the calling
+ * thread is worker 0, takes chunks in turn and encodes them with its own
+ * struct rfxencode, so its own scratch buffers, into its own output buffer.
+ * When all chunks are done they are copied into the tileset in tile order,
+ * so the output is the same as the single threaded path.
+ *
+ * rfxcodec_encode_batch puts the tiles of many encoders in one run, each
+ * chunk has the tiles of one of them and a worker copies the settings of
+ * that encoder before it starts on the chunk.  The tilesets are then made
+ * one encoder at a time from the chunks of that encoder.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <rfxcodec_encode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxcompose.h"
+#include "rfxencode_threads.h"
+#include "rfxencode_stats.h"
+#include "rfxencode_pool.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+/* chunks per worker, more chunks balance better when some tiles
+ * are much harder to encode than others */
+#define RFX_THREAD_CHUNKS 4
+
+struct rfx_thread_chunk
+{
+    /* the job, from rfx_threads_compose_tiles or rfx_threads_batch */
+    struct rfxencode *enc;
+    const char *buf;
+    int stride_bytes;
+    const struct rfx_tile *tiles;
+    const char *quant_vals;
+    int flags;
+    int start;
+    int count;
+    /* set by the worker */
+    int worker;
+    int offset;
+    int bytes;
+    int error;
+};
+
+struct rfx_thread_worker
+{
+    struct rfx_thread_pool *pool;
+    struct rfxencode *enc;
+    pthread_t thread;
+    int started;
+    const struct rfxencode *synced;
+    uint8 *out_data;
+    int out_size;
+    int out_bytes;
+};
+
+struct rfx_thread_pool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    int num_workers;
+    struct rfx_thread_worker *workers;
+    int generation;
+    int busy;
+    int shutdown;
+
+    /* current run */
+    struct rfx_thread_chunk *chunks;
+    int num_chunks;
+    int chunks_size;
+    int next_chunk;
+    int error;
+    int batch; /* a failed chunk does not stop the others */
+};
+
+/******************************************************************************/
+/* copy what the tile encoders need from the main encoder */
+static void
+rfx_threads_sync_enc(struct rfxencode *dst, const struct rfxencode *src)
+{
+    dst->width = src->width;
+    dst->height = src->height;
+    dst->mode = src->mode;
+    dst->properties = src->properties;
+    dst->flags = src->flags;
+    dst->bits_per_pixel = src->bits_per_pixel;
+    dst->format = src->format;
+    dst->rfx_encode = src->rfx_encode;
+    dst->rfx_rgb_to_yuv = src->rfx_rgb_to_yuv;
+    dst->rfx_yuv420_to_yuv = src->rfx_yuv420_to_yuv;
+    dst->rfx_tile_hash = src->rfx_tile_hash;
+    dst->rfx_tile_stats = src->rfx_tile_stats;
+    dst->rfx_tile_solid = src->rfx_tile_solid;
+    dst->rfx_alpha_delta = src->rfx_alpha_delta;
+    dst->rfx_dwt_rem = src->rfx_dwt_rem;
+    dst->tile_cache = src->tile_cache;
+    dst->got_sse2 = src->got_sse2;
+    dst->got_sse3 = src->got_sse3;
+    dst->got_ssse3 = src->got_ssse3;
+    dst->got_sse41 = src->got_sse41;
+    dst->got_sse42 = src->got_sse42;
+    dst->got_sse4a = src->got_sse4a;
+    dst->got_popcnt = src->got_popcnt;
+    dst->got_lzcnt = src->got_lzcnt;
+    dst->got_avx2 = src->got_avx2;
+    dst->got_avx512bw = src->got_avx512bw;
+    dst->got_neon = src->got_neon;
+}
+
+/******************************************************************************/
+/* make room for the largest tile block so the tiles never overflow */
+static int
+rfx_threads_check_out(struct rfx_thread_worker *worker, int tile_bytes)
+{
+    uint8 *out_data;
+    int out_size;
+
+    if (worker->out_size - worker->out_bytes >= tile_bytes)
+    {
+        return 0;
+    }
+    out_size = worker->out_size * 2;
+    if (out_size < worker->out_bytes + tile_bytes)
+    {
+        out_size = worker->out_bytes + tile_bytes;
+    }
+    out_data = (uint8 *) realloc(worker->out_data, out_size);
+    if (out_data == 0)
+    {
+        return 1;
+    }
+    worker->out_data = out_data;
+    worker->out_size = out_size;
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rfx_threads_do_chunk(struct rfx_thread_worker *worker,
+                     struct rfx_thread_chunk *chunk)
+{
+    struct rfx_thread_pool *pool;
+    struct rfxencode *enc;
+    STREAM s;
+    int index;
+    int tile_bytes;
+    int error;
+
+    pool = worker->pool;
+    if (worker == pool->workers)
+    {
+        /* the calling thread uses the encoder of the job */
+        enc = chunk->enc;
+    }
+    else
+    {
+        enc = worker->enc;
+        if (worker->synced != chunk->enc)
+        {
+            rfx_threads_sync_enc(enc, chunk->enc);
+            worker->synced = chunk->enc;
+        }
+    }
+    tile_bytes = rfx_compose_tile_bound(enc, chunk->flags);
+    chunk->offset = worker->out_bytes;
+    for (index = chunk->start; index < chunk->start + chunk->count; index++)
+    {
+        if (rfx_threads_check_out(worker, tile_bytes) != 0)
+        {
+            return 1;
+        }
+        s.data = worker->out_data + worker->out_bytes;
+        s.p = s.data;
+        s.size = worker->out_size - worker->out_bytes;
+        error = rfx_compose_message_tiles(enc, &s, chunk->buf,
+                                          chunk->stride_bytes,
+                                          chunk->tiles + index, 1,
+                                          chunk->quant_vals, chunk->flags);
+        if (error != 0)
+        {
+            return error;
+        }
+        worker->out_bytes += stream_get_pos(&s);
+    }
+    chunk->bytes = worker->out_bytes - chunk->offset;
+    return 0;
+}
+
+/******************************************************************************/
+static void
+rfx_threads_do_chunks(struct rfx_thread_worker *worker)
+{
+    struct rfx_thread_pool *pool;
+    struct rfx_thread_chunk *chunk;
+    int index;
+    int error;
+
+    pool = worker->pool;
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        index = pool->next_chunk;
+        if ((index >= pool->num_chunks) || pool->error)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        pool->next_chunk++;
+        pthread_mutex_unlock(&pool->mutex);
+        chunk = pool->chunks + index;
+        chunk->worker = worker - pool->workers;
+        error = rfx_threads_do_chunk(worker, chunk);
+        chunk->error = error;
+        if ((error != 0) && !pool->batch)
+        {
+            LLOGLN(0, ("rfx_threads_do_chunks: rfx_threads_do_chunk failed"));
+            pthread_mutex_lock(&pool->mutex);
+            pool->error = error;
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+    }
+}
+
+/******************************************************************************/
+static void *
+rfx_threads_loop(void *arg)
+{
+    struct rfx_thread_worker *worker;
+    struct rfx_thread_pool *pool;
+    int generation;
+
+    worker = (struct rfx_thread_worker *) arg;
+    pool = worker->pool;
+    generation = 0;
+    pthread_mutex_lock(&pool->mutex);
+    for (;;)
+    {
+        while ((pool->generation == generation) && !pool->shutdown)
+        {
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        }
+        if (pool->shutdown)
+        {
+            break;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+        rfx_threads_do_chunks(worker);
+        pthread_mutex_lock(&pool->mutex);
+        pool->busy--;
+        if (pool->busy == 0)
+        {
+            pthread_cond_signal(&pool->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_threads_create(struct rfxencode *enc, int num_threads)
+{
+    struct rfx_thread_pool *pool;
+    struct rfx_thread_worker *worker;
+    struct rfxencode *wenc;
+    int index;
+
+    pool = xnew(struct rfx_thread_pool);
+    if (pool == 0)
+    {
+        return 1;
+    }
+    pool->workers = (struct rfx_thread_worker *)
+                    calloc(num_threads, sizeof(struct rfx_thread_worker));
+    if (pool->workers == 0)
+    {
+        free(pool);
+        return 1;
+    }
+    pthread_mutex_init(&pool->mutex, 0);
+    pthread_cond_init(&pool->work_cond, 0);
+    pthread_cond_init(&pool->done_cond, 0);
+    pool->num_workers = num_threads;
+    enc->threads = pool;
+    enc->num_threads = num_threads;
+    /* worker 0 is the calling thread and uses the main encoder */
+    pool->workers[0].pool = pool;
+    pool->workers[0].enc = enc;
+    for (index = 1; index < num_threads; index++)
+    {
+        worker = pool->workers + index;
+        worker->pool = pool;
+        wenc = rfx_pool_get(enc->with_allocator ? &(enc->allocator) : 0);
+        if (wenc == 0)
+        {
+            rfx_threads_delete(enc);
+            return 1;
+        }
+        rfx_threads_sync_enc(wenc, enc);
+        worker->enc = wenc;
+        if (pthread_create(&(worker->thread), 0, rfx_threads_loop,
+                           worker) != 0)
+        {
+            rfx_threads_delete(enc);
+            return 1;
+        }
+        worker->started = 1;
+    }
+    LLOGLN(10, ("rfx_threads_create: %d threads", num_threads));
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_threads_delete(struct rfxencode *enc)
+{
+    struct rfx_thread_pool *pool;
+    struct rfx_thread_worker *worker;
+    int index;
+
+    pool = enc->threads;
+    if (pool == 0)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (index = 0; index < pool->num_workers; index++)
+    {
+        worker = pool->workers + index;
+        if (worker->started)
+        {
+            pthread_join(worker->thread, 0);
+        }
+        if ((index > 0) && (worker->enc != 0))
+        {
+            /* keep what the worker counted */
+            rfx_stats_add(&(enc->stats), &(worker->enc->stats));
+            rfx_pool_put(worker->enc);
+        }
+        free(worker->out_data);
+    }
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->chunks);
+    free(pool->workers);
+    free(pool);
+    enc->threads = 0;
+    enc->num_threads = 0;
+    return 0;
+}
+
+/******************************************************************************/
+/* add the counters of the workers, worker 0 is the main encoder */
+int
+rfx_threads_add_stats(struct rfxencode *enc, struct rfx_encode_stats *stats)
+{
+    struct rfx_thread_pool *pool;
+    int index;
+
+    pool = enc->threads;
+    if (pool == 0)
+    {
+        return 0;
+    }
+    for (index = 1; index < pool->num_workers; index++)
+    {
+        if (pool->workers[index].enc != 0)
+        {
+            rfx_stats_add(stats, &(pool->workers[index].enc->stats));
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_threads_reset_stats(struct rfxencode *enc)
+{
+    struct rfx_thread_pool *pool;
+    int index;
+
+    pool = enc->threads;
+    if (pool == 0)
+    {
+        return 0;
+    }
+    for (index = 1; index < pool->num_workers; index++)
+    {
+        if (pool->workers[index].enc != 0)
+        {
+            memset(&(pool->workers[index].enc->stats), 0,
+                   sizeof(struct rfx_encode_stats));
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* make room for num_chunks chunks */
+static int
+rfx_threads_alloc_chunks(struct rfx_thread_pool *pool, int num_chunks)
+{
+    if (num_chunks > pool->chunks_size)
+    {
+        free(pool->chunks);
+        pool->chunks = (struct rfx_thread_chunk *)
+                       calloc(num_chunks, sizeof(struct rfx_thread_chunk));
+        if (pool->chunks == 0)
+        {
+            pool->chunks_size = 0;
+            return 1;
+        }
+        pool->chunks_size = num_chunks;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* tiles per chunk for a job of num_tiles tiles, a few chunks per worker so
+ * the workers that finish early can take more */
+static int
+rfx_threads_chunk_tiles(struct rfx_thread_pool *pool, int num_tiles)
+{
+    int chunk_tiles;
+
+    chunk_tiles = num_tiles / (pool->num_workers * RFX_THREAD_CHUNKS);
+    if (chunk_tiles < 1)
+    {
+        chunk_tiles = 1;
+    }
+    return chunk_tiles;
+}
+
+/******************************************************************************/
+/* chunks for a job of num_tiles tiles */
+static int
+rfx_threads_count_chunks(struct rfx_thread_pool *pool, int num_tiles)
+{
+    int chunk_tiles;
+
+    chunk_tiles = rfx_threads_chunk_tiles(pool, num_tiles);
+    return (num_tiles + chunk_tiles - 1) / chunk_tiles;
+}
+
+/******************************************************************************/
+/* split num_tiles tiles of one job into chunks starting at first_chunk,
+ * returns the number of chunks */
+static int
+rfx_threads_add_chunks(struct rfx_thread_pool *pool, int first_chunk,
+                       struct rfxencode *enc,
+                       const char *buf, int stride_bytes,
+                       const struct rfx_tile *tiles, int num_tiles,
+                       const char *quant_vals, int flags)
+{
+    struct rfx_thread_chunk *chunk;
+    int num_chunks;
+    int chunk_tiles;
+    int index;
+
+    chunk_tiles = rfx_threads_chunk_tiles(pool, num_tiles);
+    num_chunks = (num_tiles + chunk_tiles - 1) / chunk_tiles;
+    for (index = 0; index < num_chunks; index++)
+    {
+        chunk = pool->chunks + first_chunk + index;
+        memset(chunk, 0, sizeof(struct rfx_thread_chunk));
+        chunk->enc = enc;
+        chunk->buf = buf;
+        chunk->stride_bytes = stride_bytes;
+        chunk->tiles = tiles;
+        chunk->quant_vals = quant_vals;
+        chunk->flags = flags;
+        chunk->start = index * chunk_tiles;
+        chunk->count = MIN(chunk_tiles, num_tiles - chunk->start);
+    }
+    return num_chunks;
+}
+
+/******************************************************************************/
+/* encode the chunks on all the workers and wait for them */
+static int
+rfx_threads_run(struct rfx_thread_pool *pool, int num_chunks, int batch)
+{
+    int index;
+
+    for (index = 0; index < pool->num_workers; index++)
+    {
+        pool->workers[index].out_bytes = 0;
+        pool->workers[index].synced = 0;
+    }
+
+    /* start the workers */
+    pthread_mutex_lock(&pool->mutex);
+    pool->num_chunks = num_chunks;
+    pool->next_chunk = 0;
+    pool->error = 0;
+    pool->batch = batch;
+    pool->busy = pool->num_workers - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    /* the calling thread is worker 0 */
+    rfx_threads_do_chunks(pool->workers);
+
+    /* wait for the others */
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->busy > 0)
+    {
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return pool->error;
+}
+
+/******************************************************************************/
+/* stitch num_chunks chunks starting at first_chunk into s in tile order */
+static int
+rfx_threads_copy_chunks(struct rfx_thread_pool *pool, STREAM *s,
+                        int first_chunk, int num_chunks)
+{
+    struct rfx_thread_chunk *chunk;
+    int total;
+    int index;
+
+    total = 0;
+    for (index = first_chunk; index < first_chunk + num_chunks; index++)
+    {
+        chunk = pool->chunks + index;
+        if (chunk->error != 0)
+        {
+            return chunk->error;
+        }
+        total += chunk->bytes;
+    }
+    if (stream_get_left(s) < total)
+    {
+        LLOGLN(10, ("rfx_threads_copy_chunks: output too small, need %d",
+               total));
+        return RFX_ERROR_OVERFLOW;
+    }
+    for (index = first_chunk; index < first_chunk + num_chunks; index++)
+    {
+        chunk = pool->chunks + index;
+        memcpy(s->p, pool->workers[chunk->worker].out_data + chunk->offset,
+               chunk->bytes);
+        s->p += chunk->bytes;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_threads_compose_tiles(struct rfxencode *enc, STREAM *s,
+                          const char *buf, int stride_bytes,
+                          const struct rfx_tile *tiles, int num_tiles,
+                          const char *quantVals, int flags)
+{
+    struct rfx_thread_pool *pool;
+    int num_chunks;
+    int error;
+
+    pool = enc->threads;
+    num_chunks = rfx_threads_count_chunks(pool, num_tiles);
+    if (rfx_threads_alloc_chunks(pool, num_chunks) != 0)
+    {
+        return 1;
+    }
+    rfx_threads_add_chunks(pool, 0, enc, buf, stride_bytes,
+                           tiles, num_tiles, quantVals, flags);
+    error = rfx_threads_run(pool, num_chunks, 0);
+    if (error != 0)
+    {
+        return error;
+    }
+    return rfx_threads_copy_chunks(pool, s, 0, num_chunks);
+}
+
+/******************************************************************************/
+/* encode the tiles of all the jobs with a batch_pool on the workers of enc,
+ * each job enc->last_tiles are its tiles, its tileset then gets them
+ * from rfx_threads_batch_copy */
+int
+rfx_threads_batch(struct rfxencode *enc, struct rfx_encode_job *jobs,
+                  int num_jobs)
+{
+    struct rfx_thread_pool *pool;
+    struct rfx_encode_job *job;
+    struct rfxencode *jenc;
+    const char *quant_vals;
+    int num_chunks;
+    int index;
+
+    pool = enc->threads;
+    num_chunks = 0;
+    for (index = 0; index < num_jobs; index++)
+    {
+        jenc = (struct rfxencode *) (jobs[index].handle);
+        if (jenc->batch_pool == pool)
+        {
+            num_chunks += rfx_threads_count_chunks(pool, jenc->last_num_tiles);
+        }
+    }
+    if (rfx_threads_alloc_chunks(pool, num_chunks) != 0)
+    {
+        return 1;
+    }
+    num_chunks = 0;
+    for (index = 0; index < num_jobs; index++)
+    {
+        job = jobs + index;
+        jenc = (struct rfxencode *) (job->handle);
+        if (jenc->batch_pool != pool)
+        {
+            continue;
+        }
+        quant_vals = rfx_compose_quant_vals(jenc->last_quants,
+                                            jenc->last_flags);
+        jenc->batch_chunk = num_chunks;
+        jenc->batch_num_chunks =
+            rfx_threads_add_chunks(pool, num_chunks, jenc,
+                                   job->buf, job->stride_bytes,
+                                   jenc->last_tiles, jenc->last_num_tiles,
+                                   quant_vals, jenc->last_flags);
+        num_chunks += jenc->batch_num_chunks;
+    }
+    return rfx_threads_run(pool, num_chunks, 1);
+}
+
+/******************************************************************************/
+/* the tiles of enc from the last rfx_threads_batch */
+int
+rfx_threads_batch_copy(struct rfxencode *enc, STREAM *s)
+{
+    return rfx_threads_copy_chunks(enc->batch_pool, s, enc->batch_chunk,
+                                   enc->batch_num_chunks);
+}
@@ -0,0 +1,43 @@
+/**
+ * RFX codec encoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFXENCODE_THREADS_H
+#define __RFXENCODE_THREADS_H
+
+#include "rfxcommon.h"
+
+int
+rfx_threads_create(struct rfxencode *enc, int num_threads);
+int
+rfx_threads_delete(struct rfxencode *enc);
+int
+rfx_threads_add_stats(struct rfxencode *enc, struct rfx_encode_stats *stats);
+int
+rfx_threads_reset_stats(struct rfxencode *enc);
+int
+rfx_threads_compose_tiles(struct rfxencode *enc, STREAM *s,
+                          const char *buf, int stride_bytes,
+                          const struct rfx_tile *tiles, int num_tiles,
+                          const char *quantVals, int flags);
+int
+rfx_threads_batch(struct rfxencode *enc, struct rfx_encode_job *jobs,
+                  int num_jobs);
+int
+rfx_threads_batch_copy(struct rfxencode *enc, STREAM *s);
+
+#endif
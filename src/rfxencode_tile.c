@@ -32,12 +32,15 @@
 #include "rfxencode.h"
 #include "rfxconstants.h"
 #include "rfxencode_tile.h"
+#include "rfxencode_stats.h"
 #include "rfxencode_dwt.h"
 #include "rfxencode_quantization.h"
 #include "rfxencode_differential.h"
 #include "rfxencode_rlgr1.h"
 #include "rfxencode_rlgr3.h"
 #include "rfxencode_alpha.h"
+#include "rfxencode_quant_adaptive.h"
+#include "rfxencode_solid.h"
 
 #ifdef RFX_USE_ACCEL_X86
 #include "x86/funcs_x86.h"
@@ -94,7 +97,7 @@ rfx_encode_format_rgb(const char *rgb_data, int width, int height,
                 {
                     *lr_buf++ = r;
                     *lg_buf++ = g;
-                    *lb_buf++ = r;
+                    *lb_buf++ = b;
                     x++;
                 }
             }
@@ -268,7 +271,7 @@ rfx_encode_format_argb(const char *argb_data, int width, int height,
                     *la_buf++ = a;
                     *lr_buf++ = r;
                     *lg_buf++ = g;
-                    *lb_buf++ = r;
+                    *lb_buf++ = b;
                     x++;
                 }
             }
@@ -400,6 +403,72 @@ rfx_encode_format_argb(const char *argb_data, int width, int height,
     return 0;
 }
 
+/******************************************************************************/
+/* 4:2:0 to 4:4:4, each chroma sample is used for 2x2 pixels
+   u_data is the interleaved uv for RFX_FORMAT_NV12 */
+static int
+rfx_encode_format_yuv420(const char *y_data, const char *u_data,
+                         const char *v_data, int width, int height,
+                         int stride_bytes, int pixel_format,
+                         uint8 *y_buf, uint8 *u_buf, uint8 *v_buf)
+{
+    int x;
+    int y;
+    int uv_stride_bytes;
+    int uv_step;
+    const uint8 *ysrc;
+    const uint8 *usrc;
+    const uint8 *vsrc;
+    uint8 *ly_buf;
+    uint8 *lu_buf;
+    uint8 *lv_buf;
+
+    LLOGLN(10, ("rfx_encode_format_yuv420: pixel_format %d", pixel_format));
+    if (pixel_format == RFX_FORMAT_NV12)
+    {
+        uv_stride_bytes = stride_bytes;
+        uv_step = 2;
+    }
+    else
+    {
+        uv_stride_bytes = stride_bytes / 2;
+        uv_step = 1;
+    }
+    for (y = 0; y < height; y++)
+    {
+        ysrc = (const uint8 *) (y_data + y * stride_bytes);
+        usrc = (const uint8 *) (u_data + (y >> 1) * uv_stride_bytes);
+        vsrc = (const uint8 *) (v_data + (y >> 1) * uv_stride_bytes);
+        ly_buf = y_buf + y * 64;
+        lu_buf = u_buf + y * 64;
+        lv_buf = v_buf + y * 64;
+        memcpy(ly_buf, ysrc, width);
+        for (x = 0; x < width; x++)
+        {
+            lu_buf[x] = usrc[(x >> 1) * uv_step];
+            lv_buf[x] = vsrc[(x >> 1) * uv_step];
+        }
+        while (x < 64)
+        {
+            ly_buf[x] = ly_buf[x - 1];
+            lu_buf[x] = lu_buf[x - 1];
+            lv_buf[x] = lv_buf[x - 1];
+            x++;
+        }
+    }
+    while (y < 64)
+    {
+        ly_buf = y_buf + y * 64;
+        lu_buf = u_buf + y * 64;
+        lv_buf = v_buf + y * 64;
+        memcpy(ly_buf, ly_buf - 64, 64);
+        memcpy(lu_buf, lu_buf - 64, 64);
+        memcpy(lv_buf, lv_buf - 64, 64);
+        y++;
+    }
+    return 0;
+}
+
 /******************************************************************************/
 /* http://msdn.microsoft.com/en-us/library/ff635643.aspx
  * 0.299   -0.168935    0.499813
@@ -442,7 +511,10 @@ rfx_encode_component_rlgr1(struct rfxencode *enc, const char *qtable,
                            const uint8 *data,
                            uint8 *buffer, int buffer_size, int *size)
 {
+    STATS_DECLARE;
+
     LLOGLN(10, ("rfx_encode_component_rlgr1:"));
+    STATS_START;
     if (rfx_dwt_2d_encode(data, enc->dwt_buffer1, enc->dwt_buffer) != 0)
     {
         return 1;
@@ -451,11 +523,18 @@ rfx_encode_component_rlgr1(struct rfxencode *enc, const char *qtable,
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DWT);
     if (rfx_differential_encode(enc->dwt_buffer1 + 4032, 64) != 0)
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DIFF);
     *size = rfx_rlgr1_encode(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
     return 0;
 }
 
@@ -465,7 +544,10 @@ rfx_encode_component_rlgr3(struct rfxencode *enc, const char *qtable,
                            const uint8 *data,
                            uint8 *buffer, int buffer_size, int *size)
 {
+    STATS_DECLARE;
+
     LLOGLN(10, ("rfx_encode_component_rlgr3:"));
+    STATS_START;
     if (rfx_dwt_2d_encode(data, enc->dwt_buffer1, enc->dwt_buffer) != 0)
     {
         return 1;
@@ -474,11 +556,18 @@ rfx_encode_component_rlgr3(struct rfxencode *enc, const char *qtable,
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DWT);
     if (rfx_differential_encode(enc->dwt_buffer1 + 4032, 64) != 0)
     {
         return 1;
     }
+    STATS_LAP(enc, RFX_STATS_DIFF);
     *size = rfx_rlgr3_encode(enc->dwt_buffer1, buffer, buffer_size);
+    STATS_LAP(enc, RFX_STATS_RLGR);
+    if (*size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
     return 0;
 }
 
@@ -486,54 +575,105 @@ rfx_encode_component_rlgr3(struct rfxencode *enc, const char *qtable,
 int
 rfx_encode_rgb(struct rfxencode *enc, const char *rgb_data,
                int width, int height, int stride_bytes,
-               const char *y_quants, const char *u_quants,
-               const char *v_quants,
+               const char *quant_vals, int *quant_idx, int flags,
                STREAM *data_out, int *y_size, int *u_size, int *v_size)
 {
     uint8 *y_r_buffer;
     uint8 *u_g_buffer;
     uint8 *v_b_buffer;
+    uint8 rgba[4];
+    int solid;
+    int error;
+    STATS_DECLARE;
 
     y_r_buffer = enc->y_r_buffer;
     u_g_buffer = enc->u_g_buffer;
     v_b_buffer = enc->v_b_buffer;
-    if (rfx_encode_format_rgb(rgb_data, width, height, stride_bytes,
-                              enc->format,
-                              y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+    STATS_START;
+    solid = rfx_encode_tile_solid(enc, rgb_data, width, height,
+                                  stride_bytes, 0, rgba);
+    if (solid && (flags & RFX_FLAGS_QUANT_ADAPTIVE))
     {
-        return 1;
+        rfx_quant_adaptive_class(RFX_TILE_FLAT, quant_idx);
     }
-    if (rfx_encode_rgb_to_yuv(y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+    if (solid && rfx_encode_solid_quants(quant_vals, quant_idx))
     {
-        return 1;
+        /* one colour, no DWT or RLGR */
+        error = rfx_encode_solid(enc, rgba, quant_vals, quant_idx, data_out,
+                                 y_size, u_size, v_size);
+        STATS_LAP(enc, RFX_STATS_FORMAT);
+        if (error != 0)
+        {
+            return error;
+        }
+        STATS_ADD(enc, tiles, 1);
+        STATS_ADD(enc, solid_tiles, 1);
+        STATS_ADD(enc, y_bytes, *y_size);
+        STATS_ADD(enc, u_bytes, *u_size);
+        STATS_ADD(enc, v_bytes, *v_size);
+        return 0;
     }
-    if (enc->rfx_encode(enc, y_quants, y_r_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        y_size) != 0)
+    if ((width == 64) && (height == 64) && (enc->rfx_rgb_to_yuv != 0))
     {
-        return 1;
+        /* full tile, deinterleave and convert in one pass */
+        if (enc->rfx_rgb_to_yuv(rgb_data, stride_bytes,
+                                y_r_buffer, u_g_buffer, v_b_buffer, 0) != 0)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        if (rfx_encode_format_rgb(rgb_data, width, height, stride_bytes,
+                                  enc->format,
+                                  y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+        {
+            return 1;
+        }
+        if (rfx_encode_rgb_to_yuv(y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+        {
+            return 1;
+        }
+    }
+    if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
+    {
+        rfx_quant_adaptive(enc, y_r_buffer, quant_idx);
+    }
+    STATS_LAP(enc, RFX_STATS_FORMAT);
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[0] * 5, y_r_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            y_size);
+    if (error != 0)
+    {
+        return error;
     }
     LLOGLN(10, ("rfx_encode_rgb: y_size %d", *y_size));
     stream_seek(data_out, *y_size);
-    if (enc->rfx_encode(enc, u_quants, u_g_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        u_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[1] * 5, u_g_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            u_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     LLOGLN(10, ("rfx_encode_rgb: u_size %d", *u_size));
     stream_seek(data_out, *u_size);
-    if (enc->rfx_encode(enc, v_quants, v_b_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        v_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[2] * 5, v_b_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            v_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     LLOGLN(10, ("rfx_encode_rgb: v_size %d", *v_size));
     stream_seek(data_out, *v_size);
+    STATS_ADD(enc, tiles, 1);
+    STATS_ADD(enc, y_bytes, *y_size);
+    STATS_ADD(enc, u_bytes, *u_size);
+    STATS_ADD(enc, v_bytes, *v_size);
     return 0;
 }
 
@@ -541,8 +681,7 @@ rfx_encode_rgb(struct rfxencode *enc, const char *rgb_data,
 int
 rfx_encode_argb(struct rfxencode *enc, const char *rgb_data,
                 int width, int height, int stride_bytes,
-                const char *y_quants, const char *u_quants,
-                const char *v_quants,
+                const char *quant_vals, int *quant_idx, int flags,
                 STREAM *data_out, int *y_size, int *u_size,
                 int *v_size, int *a_size)
 {
@@ -550,51 +689,125 @@ rfx_encode_argb(struct rfxencode *enc, const char *rgb_data,
     uint8 *y_r_buffer;
     uint8 *u_g_buffer;
     uint8 *v_b_buffer;
+    uint8 rgba[4];
+    int solid;
+    int error;
+    STATS_DECLARE;
 
     LLOGLN(10, ("rfx_encode_argb:"));
     a_buffer = enc->a_buffer;
     y_r_buffer = enc->y_r_buffer;
     u_g_buffer = enc->u_g_buffer;
     v_b_buffer = enc->v_b_buffer;
-    if (rfx_encode_format_argb(rgb_data, width, height, stride_bytes,
-                               enc->format,
-                               a_buffer, y_r_buffer,
-                               u_g_buffer, v_b_buffer) != 0)
+    STATS_START;
+    solid = rfx_encode_tile_solid(enc, rgb_data, width, height,
+                                  stride_bytes, 1, rgba);
+    if (solid && (flags & RFX_FLAGS_QUANT_ADAPTIVE))
     {
-        return 1;
+        rfx_quant_adaptive_class(RFX_TILE_FLAT, quant_idx);
     }
-    if (rfx_encode_rgb_to_yuv(y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+    if (solid && rfx_encode_solid_quants(quant_vals, quant_idx))
     {
-        return 1;
+        /* one colour and alpha, no DWT or RLGR */
+        error = rfx_encode_solid(enc, rgba, quant_vals, quant_idx, data_out,
+                                 y_size, u_size, v_size);
+        STATS_LAP(enc, RFX_STATS_FORMAT);
+        if (error != 0)
+        {
+            return error;
+        }
+        memset(a_buffer, rgba[3], 4096);
+        *a_size = rfx_encode_plane(enc, a_buffer, 64, 64, data_out);
+        STATS_LAP(enc, RFX_STATS_ALPHA);
+        if (*a_size < 0)
+        {
+            return RFX_ERROR_OVERFLOW;
+        }
+        STATS_ADD(enc, tiles, 1);
+        STATS_ADD(enc, solid_tiles, 1);
+        STATS_ADD(enc, y_bytes, *y_size);
+        STATS_ADD(enc, u_bytes, *u_size);
+        STATS_ADD(enc, v_bytes, *v_size);
+        STATS_ADD(enc, a_bytes, *a_size);
+        return 0;
     }
-    if (enc->rfx_encode(enc, y_quants, y_r_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        y_size) != 0)
+    if ((width == 64) && (height == 64) && (enc->rfx_rgb_to_yuv != 0))
     {
-        return 1;
+        /* full tile, deinterleave and convert in one pass */
+        if (enc->rfx_rgb_to_yuv(rgb_data, stride_bytes,
+                                y_r_buffer, u_g_buffer, v_b_buffer,
+                                a_buffer) != 0)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        if (rfx_encode_format_argb(rgb_data, width, height, stride_bytes,
+                                   enc->format,
+                                   a_buffer, y_r_buffer,
+                                   u_g_buffer, v_b_buffer) != 0)
+        {
+            return 1;
+        }
+        if (rfx_encode_rgb_to_yuv(y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+        {
+            return 1;
+        }
+    }
+    if (enc->bits_per_pixel != 32)
+    {
+        /* BGR and RGB have no alpha, opaque as for a solid tile, not what
+           the last tile on this encoder or worker left */
+        memset(a_buffer, 0xFF, 4096);
+    }
+    if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
+    {
+        rfx_quant_adaptive(enc, y_r_buffer, quant_idx);
+    }
+    STATS_LAP(enc, RFX_STATS_FORMAT);
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[0] * 5, y_r_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            y_size);
+    if (error != 0)
+    {
+        return error;
     }
     LLOGLN(10, ("rfx_encode_rgb: y_size %d", *y_size));
     stream_seek(data_out, *y_size);
-    if (enc->rfx_encode(enc, u_quants, u_g_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        u_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[1] * 5, u_g_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            u_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     LLOGLN(10, ("rfx_encode_rgb: u_size %d", *u_size));
     stream_seek(data_out, *u_size);
-    if (enc->rfx_encode(enc, v_quants, v_b_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        v_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[2] * 5, v_b_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            v_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     LLOGLN(10, ("rfx_encode_rgb: v_size %d", *v_size));
     stream_seek(data_out, *v_size);
+    STATS_START;
     *a_size = rfx_encode_plane(enc, a_buffer, 64, 64, data_out);
+    STATS_LAP(enc, RFX_STATS_ALPHA);
+    if (*a_size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    STATS_ADD(enc, tiles, 1);
+    STATS_ADD(enc, y_bytes, *y_size);
+    STATS_ADD(enc, u_bytes, *u_size);
+    STATS_ADD(enc, v_bytes, *v_size);
+    STATS_ADD(enc, a_bytes, *a_size);
     return 0;
 }
 
@@ -602,41 +815,52 @@ rfx_encode_argb(struct rfxencode *enc, const char *rgb_data,
 int
 rfx_encode_yuv(struct rfxencode *enc, const char *yuv_data,
                int width, int height, int stride_bytes,
-               const char *y_quants, const char *u_quants,
-               const char *v_quants,
+               const char *quant_vals, int *quant_idx, int flags,
                STREAM *data_out, int *y_size, int *u_size, int *v_size)
 {
     const uint8 *y_buffer;
     const uint8 *u_buffer;
     const uint8 *v_buffer;
+    int error;
 
     y_buffer = (const uint8 *) yuv_data;
     u_buffer = (const uint8 *) (yuv_data + RFX_YUV_BTES);
     v_buffer = (const uint8 *) (yuv_data + RFX_YUV_BTES * 2);
-    if (enc->rfx_encode(enc, y_quants, y_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        y_size) != 0)
+    if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
     {
-        return 1;
+        rfx_quant_adaptive(enc, y_buffer, quant_idx);
+    }
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[0] * 5, y_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            y_size);
+    if (error != 0)
+    {
+        return error;
     }
     stream_seek(data_out, *y_size);
-    if (enc->rfx_encode(enc, u_quants, u_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        u_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[1] * 5, u_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            u_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     stream_seek(data_out, *u_size);
-    if (enc->rfx_encode(enc, v_quants, v_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        v_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[2] * 5, v_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            v_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     stream_seek(data_out, *v_size);
+    STATS_ADD(enc, tiles, 1);
+    STATS_ADD(enc, y_bytes, *y_size);
+    STATS_ADD(enc, u_bytes, *u_size);
+    STATS_ADD(enc, v_bytes, *v_size);
     return 0;
 }
 
@@ -644,8 +868,7 @@ rfx_encode_yuv(struct rfxencode *enc, const char *yuv_data,
 int
 rfx_encode_yuva(struct rfxencode *enc, const char *yuva_data,
                 int width, int height, int stride_bytes,
-                const char *y_quants, const char *u_quants,
-                const char *v_quants,
+                const char *quant_vals, int *quant_idx, int flags,
                 STREAM *data_out, int *y_size, int *u_size,
                 int *v_size, int *a_size)
 {
@@ -653,36 +876,255 @@ rfx_encode_yuva(struct rfxencode *enc, const char *yuva_data,
     const uint8 *u_buffer;
     const uint8 *v_buffer;
     const uint8 *a_buffer;
+    int error;
+    STATS_DECLARE;
 
     y_buffer = (const uint8 *) yuva_data;
     u_buffer = (const uint8 *) (yuva_data + RFX_YUV_BTES);
     v_buffer = (const uint8 *) (yuva_data + RFX_YUV_BTES * 2);
     a_buffer = (const uint8 *) (yuva_data + RFX_YUV_BTES * 3);
-    if (enc->rfx_encode(enc, y_quants, y_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        y_size) != 0)
+    if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
     {
-        return 1;
+        rfx_quant_adaptive(enc, y_buffer, quant_idx);
+    }
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[0] * 5, y_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            y_size);
+    if (error != 0)
+    {
+        return error;
     }
     stream_seek(data_out, *y_size);
-    if (enc->rfx_encode(enc, u_quants, u_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        u_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[1] * 5, u_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            u_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     stream_seek(data_out, *u_size);
-    if (enc->rfx_encode(enc, v_quants, v_buffer,
-                        stream_get_tail(data_out),
-                        stream_get_left(data_out),
-                        v_size) != 0)
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[2] * 5, v_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            v_size);
+    if (error != 0)
     {
-        return 1;
+        return error;
     }
     stream_seek(data_out, *v_size);
+    STATS_START;
     *a_size = rfx_encode_plane(enc, a_buffer, 64, 64, data_out);
+    STATS_LAP(enc, RFX_STATS_ALPHA);
+    if (*a_size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    STATS_ADD(enc, tiles, 1);
+    STATS_ADD(enc, y_bytes, *y_size);
+    STATS_ADD(enc, u_bytes, *u_size);
+    STATS_ADD(enc, v_bytes, *v_size);
+    STATS_ADD(enc, a_bytes, *a_size);
     return 0;
 }
 
+
+/******************************************************************************/
+/* where the pixels of the tile at x, y are in a RFX_FORMAT_NV12 or
+   RFX_FORMAT_I420 buf, u_data and v_data are in the same uv row for
+   RFX_FORMAT_NV12 */
+int
+rfx_encode_yuv420_data(struct rfxencode *enc, const char *buf,
+                       int stride_bytes, int x, int y,
+                       const char **y_data, const char **u_data,
+                       const char **v_data)
+{
+    const char *uv_plane;
+    int uv_stride_bytes;
+
+    uv_plane = buf + stride_bytes * enc->height;
+    *y_data = buf + y * stride_bytes + x;
+    if (enc->format == RFX_FORMAT_NV12)
+    {
+        *u_data = uv_plane + (y >> 1) * stride_bytes + x;
+        *v_data = *u_data + 1;
+    }
+    else
+    {
+        uv_stride_bytes = stride_bytes / 2;
+        *u_data = uv_plane + (y >> 1) * uv_stride_bytes + (x >> 1);
+        *v_data = uv_plane + uv_stride_bytes * ((enc->height + 1) / 2) +
+                  (y >> 1) * uv_stride_bytes + (x >> 1);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_encode_yuv420(struct rfxencode *enc, const char *y_data,
+                  const char *u_data, const char *v_data,
+                  int width, int height, int stride_bytes,
+                  const char *quant_vals, int *quant_idx, int flags,
+                  STREAM *data_out, int *y_size, int *u_size, int *v_size)
+{
+    uint8 *y_r_buffer;
+    uint8 *u_g_buffer;
+    uint8 *v_b_buffer;
+    int error;
+    STATS_DECLARE;
+
+    y_r_buffer = enc->y_r_buffer;
+    u_g_buffer = enc->u_g_buffer;
+    v_b_buffer = enc->v_b_buffer;
+    STATS_START;
+    if ((width == 64) && (height == 64) && (enc->rfx_yuv420_to_yuv != 0))
+    {
+        /* full tile, copy y and upsample u and v in one pass */
+        if (enc->rfx_yuv420_to_yuv(y_data, u_data, v_data, stride_bytes,
+                                   y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        if (rfx_encode_format_yuv420(y_data, u_data, v_data,
+                                     width, height, stride_bytes,
+                                     enc->format,
+                                     y_r_buffer, u_g_buffer, v_b_buffer) != 0)
+        {
+            return 1;
+        }
+    }
+    if (flags & RFX_FLAGS_QUANT_ADAPTIVE)
+    {
+        rfx_quant_adaptive(enc, y_r_buffer, quant_idx);
+    }
+    STATS_LAP(enc, RFX_STATS_FORMAT);
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[0] * 5, y_r_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            y_size);
+    if (error != 0)
+    {
+        return error;
+    }
+    stream_seek(data_out, *y_size);
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[1] * 5, u_g_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            u_size);
+    if (error != 0)
+    {
+        return error;
+    }
+    stream_seek(data_out, *u_size);
+    error = enc->rfx_encode(enc, quant_vals + quant_idx[2] * 5, v_b_buffer,
+                            stream_get_tail(data_out),
+                            stream_get_left(data_out),
+                            v_size);
+    if (error != 0)
+    {
+        return error;
+    }
+    stream_seek(data_out, *v_size);
+    STATS_ADD(enc, tiles, 1);
+    STATS_ADD(enc, y_bytes, *y_size);
+    STATS_ADD(enc, u_bytes, *u_size);
+    STATS_ADD(enc, v_bytes, *v_size);
+    return 0;
+}
+
+/******************************************************************************/
+/* 4:2:0 has no alpha, the tile is opaque */
+int
+rfx_encode_yuv420a(struct rfxencode *enc, const char *y_data,
+                   const char *u_data, const char *v_data,
+                   int width, int height, int stride_bytes,
+                   const char *quant_vals, int *quant_idx, int flags,
+                   STREAM *data_out, int *y_size, int *u_size,
+                   int *v_size, int *a_size)
+{
+    int error;
+    STATS_DECLARE;
+
+    error = rfx_encode_yuv420(enc, y_data, u_data, v_data,
+                              width, height, stride_bytes,
+                              quant_vals, quant_idx, flags,
+                              data_out, y_size, u_size, v_size);
+    if (error != 0)
+    {
+        return error;
+    }
+    STATS_START;
+    *a_size = rfx_encode_plane_flat(enc, 0xFF, data_out);
+    STATS_LAP(enc, RFX_STATS_ALPHA);
+    if (*a_size < 0)
+    {
+        return RFX_ERROR_OVERFLOW;
+    }
+    STATS_ADD(enc, a_bytes, *a_size);
+    return 0;
+}
+
+/******************************************************************************/
+/* the y, u and v planes of the width x height tile at x, y of buf, without
+   encoding them, they are in enc->y_r_buffer, u_g_buffer and v_b_buffer,
+   or in buf for RFX_FORMAT_YUV */
+int
+rfx_encode_tile_yuv(struct rfxencode *enc, const char *buf,
+                    int x, int y, int width, int height, int stride_bytes,
+                    const uint8 **y_buffer, const uint8 **u_buffer,
+                    const uint8 **v_buffer)
+{
+    const char *tile_data;
+    const char *y_data;
+    const char *u_data;
+    const char *v_data;
+
+    *y_buffer = enc->y_r_buffer;
+    *u_buffer = enc->u_g_buffer;
+    *v_buffer = enc->v_b_buffer;
+    switch (enc->format)
+    {
+        case RFX_FORMAT_YUV:
+            tile_data = buf + (y << 8) * (stride_bytes >> 8) + (x << 8);
+            *y_buffer = (const uint8 *) tile_data;
+            *u_buffer = (const uint8 *) (tile_data + RFX_YUV_BTES);
+            *v_buffer = (const uint8 *) (tile_data + RFX_YUV_BTES * 2);
+            return 0;
+        case RFX_FORMAT_NV12:
+        case RFX_FORMAT_I420:
+            rfx_encode_yuv420_data(enc, buf, stride_bytes, x, y,
+                                   &y_data, &u_data, &v_data);
+            if ((width == 64) && (height == 64) &&
+                (enc->rfx_yuv420_to_yuv != 0))
+            {
+                return enc->rfx_yuv420_to_yuv(y_data, u_data, v_data,
+                                              stride_bytes, enc->y_r_buffer,
+                                              enc->u_g_buffer,
+                                              enc->v_b_buffer);
+            }
+            return rfx_encode_format_yuv420(y_data, u_data, v_data,
+                                            width, height, stride_bytes,
+                                            enc->format, enc->y_r_buffer,
+                                            enc->u_g_buffer, enc->v_b_buffer);
+        default:
+            break;
+    }
+    tile_data = buf + y * stride_bytes + x * (enc->bits_per_pixel / 8);
+    if ((width == 64) && (height == 64) && (enc->rfx_rgb_to_yuv != 0))
+    {
+        return enc->rfx_rgb_to_yuv(tile_data, stride_bytes, enc->y_r_buffer,
+                                   enc->u_g_buffer, enc->v_b_buffer, 0);
+    }
+    if (rfx_encode_format_rgb(tile_data, width, height, stride_bytes,
+                              enc->format, enc->y_r_buffer,
+                              enc->u_g_buffer, enc->v_b_buffer) != 0)
+    {
+        return 1;
+    }
+    return rfx_encode_rgb_to_yuv(enc->y_r_buffer, enc->u_g_buffer,
+                                 enc->v_b_buffer);
+}
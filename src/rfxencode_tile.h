@@ -37,29 +37,49 @@ rfx_encode_component_rlgr3(struct rfxencode *enc, const char *qtable,
 int
 rfx_encode_rgb(struct rfxencode *enc, const char *rgb_data,
                int width, int height, int stride_bytes,
-               const char *y_quants, const char *u_quants,
-               const char *v_quants,
+               const char *quant_vals, int *quant_idx, int flags,
                STREAM *data_out, int *y_size, int *cb_size, int *cr_size);
 int
 rfx_encode_argb(struct rfxencode *enc, const char *argb_data,
                 int width, int height, int stride_bytes,
-                const char *y_quants, const char *cb_quants,
-                const char *cr_quants,
+                const char *quant_vals, int *quant_idx, int flags,
                 STREAM *data_out, int *y_size, int *u_size,
                 int *v_size, int *a_size);
 int
 rfx_encode_yuv(struct rfxencode *enc, const char *yuv_data,
                int width, int height, int stride_bytes,
-               const char *y_quants, const char *u_quants,
-               const char *v_quants,
+               const char *quant_vals, int *quant_idx, int flags,
                STREAM *data_out, int *y_size, int *u_size, int *v_size);
 int
 rfx_encode_yuva(struct rfxencode *enc, const char *yuv_data,
                 int width, int height, int stride_bytes,
-                const char *y_quants, const char *u_quants,
-                const char *v_quants,
+                const char *quant_vals, int *quant_idx, int flags,
                 STREAM *data_out, int *y_size, int *u_size,
                 int *v_size, int *a_size);
+int
+rfx_encode_yuv420_data(struct rfxencode *enc, const char *buf,
+                       int stride_bytes, int x, int y,
+                       const char **y_data, const char **u_data,
+                       const char **v_data);
+int
+rfx_encode_yuv420(struct rfxencode *enc, const char *y_data,
+                  const char *u_data, const char *v_data,
+                  int width, int height, int stride_bytes,
+                  const char *quant_vals, int *quant_idx, int flags,
+                  STREAM *data_out, int *y_size, int *u_size, int *v_size);
+int
+rfx_encode_yuv420a(struct rfxencode *enc, const char *y_data,
+                   const char *u_data, const char *v_data,
+                   int width, int height, int stride_bytes,
+                   const char *quant_vals, int *quant_idx, int flags,
+                   STREAM *data_out, int *y_size, int *u_size,
+                   int *v_size, int *a_size);
+
+int
+rfx_encode_tile_yuv(struct rfxencode *enc, const char *buf,
+                    int x, int y, int width, int height, int stride_bytes,
+                    const uint8 **y_buffer, const uint8 **u_buffer,
+                    const uint8 **v_buffer);
 
 int
 rfx_encode_component_rlgr1_x86_sse2(struct rfxencode *enc, const char *qtable,
@@ -93,5 +113,25 @@ int
 rfx_encode_component_rlgr3_amd64_sse41(struct rfxencode *enc, const char *qtable,
                                        const uint8 *data,
                                        uint8 *buffer, int buffer_size, int *size);
+int
+rfx_encode_component_rlgr1_amd64_avx2(struct rfxencode *enc, const char *qtable,
+                                      const uint8 *data,
+                                      uint8 *buffer, int buffer_size, int *size);
+int
+rfx_encode_component_rlgr3_amd64_avx2(struct rfxencode *enc, const char *qtable,
+                                      const uint8 *data,
+                                      uint8 *buffer, int buffer_size, int *size);
+int
+rfx_encode_component_rlgr1_amd64_avx512bw(struct rfxencode *enc,
+                                          const char *qtable,
+                                          const uint8 *data,
+                                          uint8 *buffer, int buffer_size,
+                                          int *size);
+int
+rfx_encode_component_rlgr3_amd64_avx512bw(struct rfxencode *enc,
+                                          const char *qtable,
+                                          const uint8 *data,
+                                          uint8 *buffer, int buffer_size,
+                                          int *size);
 
 #endif
@@ -0,0 +1,371 @@
+/**
+ * RFX codec decoder
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfxcommon.h"
+
+#include <rfxcodec_encode.h>
+#include <rfxcodec_decode.h>
+
+#include "rfxconstants.h"
+#include "rfxdecode.h"
+#include "rfxparse.h"
+#include "rfxdecode_tile.h"
+#include "rfxdecode_alpha.h"
+
+#define LLOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LLOG_LEVEL) { printf _args ; printf("\n"); } } while (0)
+
+/******************************************************************************/
+static int
+rfx_parse_set_mode(struct rfxdecode *dec, int et)
+{
+    if (et == CLW_ENTROPY_RLGR1)
+    {
+        dec->mode = RLGR1;
+    }
+    else if (et == CLW_ENTROPY_RLGR3)
+    {
+        dec->mode = RLGR3;
+    }
+    else
+    {
+        LLOGLN(10, ("rfx_parse_set_mode: bad entropy %d", et));
+        return 1;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rfx_parse_message_context(struct rfxdecode *dec, STREAM *s)
+{
+    int properties;
+
+    if (stream_get_left(s) < 7)
+    {
+        return 1;
+    }
+    stream_seek(s, 3); /* codecId, channelId, ctxId */
+    stream_seek_uint16(s); /* tileSize */
+    stream_read_uint16(s, properties);
+    return rfx_parse_set_mode(dec, (properties >> 9) & 0xF); /* et */
+}
+
+/******************************************************************************/
+static int
+rfx_parse_message_region(struct rfxdecode *dec, STREAM *s)
+{
+    int index;
+    int num_rects;
+    struct rfx_rect *rects;
+
+    if (stream_get_left(s) < 5)
+    {
+        return 1;
+    }
+    stream_seek(s, 3); /* codecId, channelId, regionFlags */
+    stream_read_uint16(s, num_rects); /* numRects */
+    if (stream_get_left(s) < num_rects * 8)
+    {
+        return 1;
+    }
+    if (num_rects > dec->max_rects)
+    {
+        rects = (struct rfx_rect *)
+                realloc(dec->rects, num_rects * sizeof(struct rfx_rect));
+        if (rects == 0)
+        {
+            return 1;
+        }
+        dec->rects = rects;
+        dec->max_rects = num_rects;
+    }
+    rects = dec->rects;
+    for (index = 0; index < num_rects; index++)
+    {
+        stream_read_uint16(s, rects[index].x);
+        stream_read_uint16(s, rects[index].y);
+        stream_read_uint16(s, rects[index].cx);
+        stream_read_uint16(s, rects[index].cy);
+    }
+    dec->num_rects = num_rects;
+    return 0;
+}
+
+/******************************************************************************/
+/* write the decoded tile clipped to the region rects and the destination */
+static int
+rfx_parse_tile_out(struct rfxdecode *dec, const uint8 *a_buffer,
+                   int x, int y, char *data, int width, int height,
+                   int stride_bytes)
+{
+    struct rfx_rect all;
+    const struct rfx_rect *rect;
+    int num_rects;
+    int index;
+    int bpp;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+    int decoded;
+    const char *src8;
+    char *dst8;
+
+    bpp = dec->bits_per_pixel / 8;
+    num_rects = dec->num_rects;
+    rect = dec->rects;
+    if (num_rects < 1)
+    {
+        all.x = 0;
+        all.y = 0;
+        all.cx = width;
+        all.cy = height;
+        num_rects = 1;
+        rect = &all;
+    }
+    decoded = 0;
+    for (index = 0; index < num_rects; index++, rect++)
+    {
+        x1 = MAX(MAX(rect->x, x), 0);
+        y1 = MAX(MAX(rect->y, y), 0);
+        x2 = MIN(MIN(rect->x + rect->cx, x + 64), width);
+        y2 = MIN(MIN(rect->y + rect->cy, y + 64), height);
+        if ((x2 <= x1) || (y2 <= y1))
+        {
+            continue;
+        }
+        if ((x2 - x1 == 64) && (y2 - y1 == 64))
+        {
+            /* whole tile, no need for the tmp buffer */
+            dec->rfx_yuv_to_rgb(dec->y_buffer, dec->u_buffer, dec->v_buffer,
+                                a_buffer,
+                                data + y * stride_bytes + x * bpp,
+                                stride_bytes);
+            continue;
+        }
+        if (!decoded)
+        {
+            dec->rfx_yuv_to_rgb(dec->y_buffer, dec->u_buffer, dec->v_buffer,
+                                a_buffer, dec->rgb_buffer, 64 * bpp);
+            decoded = 1;
+        }
+        src8 = dec->rgb_buffer + (y1 - y) * 64 * bpp + (x1 - x) * bpp;
+        dst8 = data + y1 * stride_bytes + x1 * bpp;
+        while (y1 < y2)
+        {
+            memcpy(dst8, src8, (x2 - x1) * bpp);
+            src8 += 64 * bpp;
+            dst8 += stride_bytes;
+            y1++;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rfx_parse_message_tileset(struct rfxdecode *dec, STREAM *s, int alpha,
+                          char *data, int width, int height,
+                          int stride_bytes)
+{
+    int subtype;
+    int properties;
+    int numQuants;
+    int numTiles;
+    int index;
+    int blockType;
+    int blockLen;
+    int quantIdxY;
+    int quantIdxCb;
+    int quantIdxCr;
+    int xIdx;
+    int yIdx;
+    int YLen;
+    int CbLen;
+    int CrLen;
+    int header_bytes;
+    const char *quantVals;
+    const uint8 *a_buffer;
+    uint8 *tile_start;
+    uint8 *tile_data;
+
+    if (stream_get_left(s) < 16)
+    {
+        return 1;
+    }
+    stream_seek_uint16(s); /* codecId, channelId */
+    stream_read_uint16(s, subtype);
+    if (subtype != CBT_TILESET)
+    {
+        LLOGLN(10, ("rfx_parse_message_tileset: not a tileset, skipping"));
+        return 0;
+    }
+    stream_seek_uint16(s); /* idx */
+    stream_read_uint16(s, properties);
+    if (rfx_parse_set_mode(dec, (properties >> 10) & 0xF) != 0) /* et */
+    {
+        return 1;
+    }
+    stream_read_uint8(s, numQuants);
+    stream_seek_uint8(s); /* tileSize */
+    stream_read_uint16(s, numTiles);
+    stream_seek_uint32(s); /* tilesDataSize */
+    if (stream_get_left(s) < numQuants * 5)
+    {
+        return 1;
+    }
+    quantVals = (const char *) (s->p);
+    stream_seek(s, numQuants * 5);
+    /* blockLen of a WBT_EXTENSION_PLUS tile does not count the ALen
+     * field or all of the alpha plane, the alpha plane is walked instead */
+    header_bytes = alpha ? 21 : 19;
+    for (index = 0; index < numTiles; index++)
+    {
+        tile_start = s->p;
+        if (stream_get_left(s) < header_bytes)
+        {
+            return 1;
+        }
+        stream_read_uint16(s, blockType);
+        stream_read_uint32(s, blockLen);
+        if ((blockType != CBT_TILE) || (blockLen < 19) ||
+            (blockLen > stream_get_left(s) + 6))
+        {
+            return 1;
+        }
+        stream_read_uint8(s, quantIdxY);
+        stream_read_uint8(s, quantIdxCb);
+        stream_read_uint8(s, quantIdxCr);
+        stream_read_uint16(s, xIdx);
+        stream_read_uint16(s, yIdx);
+        stream_read_uint16(s, YLen);
+        stream_read_uint16(s, CbLen);
+        stream_read_uint16(s, CrLen);
+        if (alpha)
+        {
+            stream_seek_uint16(s); /* ALen */
+        }
+        if ((quantIdxY >= numQuants) || (quantIdxCb >= numQuants) ||
+            (quantIdxCr >= numQuants) ||
+            (stream_get_left(s) < YLen + CbLen + CrLen))
+        {
+            return 1;
+        }
+        tile_data = s->p;
+        if (rfx_decode_yuv(dec,
+                           quantVals + quantIdxY * 5,
+                           quantVals + quantIdxCb * 5,
+                           quantVals + quantIdxCr * 5,
+                           tile_data, YLen,
+                           tile_data + YLen, CbLen,
+                           tile_data + YLen + CbLen, CrLen) != 0)
+        {
+            return 1;
+        }
+        a_buffer = 0;
+        if (alpha)
+        {
+            stream_seek(s, YLen + CbLen + CrLen);
+            if (rfx_decode_plane(dec, s, 64, 64, dec->a_buffer) != 0)
+            {
+                return 1;
+            }
+            a_buffer = dec->a_buffer;
+        }
+        else
+        {
+            s->p = tile_start + blockLen;
+        }
+        rfx_parse_tile_out(dec, a_buffer, xIdx * 64, yIdx * 64,
+                           data, width, height, stride_bytes);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+int
+rfx_parse_message(struct rfxdecode *dec, STREAM *s,
+                  char *data, int width, int height, int stride_bytes)
+{
+    STREAM ls;
+    int blockType;
+    int blockLen;
+    int error;
+
+    while (stream_get_left(s) >= 6)
+    {
+        ls.data = s->p;
+        stream_read_uint16(s, blockType);
+        stream_read_uint32(s, blockLen);
+        if ((blockLen < 6) || (blockLen > stream_get_left(s) + 6))
+        {
+            LLOGLN(10, ("rfx_parse_message: bad blockLen %d", blockLen));
+            return 1;
+        }
+        ls.p = s->p;
+        ls.size = blockLen;
+        LLOGLN(10, ("rfx_parse_message: blockType 0x%4.4x blockLen %d",
+               blockType, blockLen));
+        switch (blockType)
+        {
+            case WBT_FRAME_BEGIN:
+                dec->num_rects = 0;
+                error = 0;
+                break;
+            case WBT_CONTEXT:
+                error = rfx_parse_message_context(dec, &ls);
+                break;
+            case WBT_REGION:
+                error = rfx_parse_message_region(dec, &ls);
+                break;
+            case WBT_EXTENSION:
+                error = rfx_parse_message_tileset(dec, &ls, 0, data,
+                                                  width, height,
+                                                  stride_bytes);
+                break;
+            case WBT_EXTENSION_PLUS:
+                error = rfx_parse_message_tileset(dec, &ls, 1, data,
+                                                  width, height,
+                                                  stride_bytes);
+                break;
+            default:
+                /* WBT_SYNC, WBT_CODEC_VERSIONS, WBT_CHANNELS and
+                   WBT_FRAME_END need nothing */
+                error = 0;
+                break;
+        }
+        if (error != 0)
+        {
+            LLOGLN(10, ("rfx_parse_message: error parsing blockType 0x%4.4x",
+                   blockType));
+            return error;
+        }
+        s->p = ls.data + blockLen;
+    }
+    return 0;
+}
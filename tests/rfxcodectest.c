@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 
 #include <rfxcodec_encode.h>
+#include <rfxcodec_decode.h>
 
 static const unsigned char g_rfx_default_quantization_values[] =
 {
@@ -50,12 +51,43 @@ get_mstime(void)
 
 /******************************************************************************/
 static int
-speed_random(int count, const char *quants)
+print_stats(void *han)
+{
+    struct rfx_encode_stats stats;
+    static const char *stage_names[RFX_STATS_STAGES] =
+    {
+        "format", "dwt", "diff", "rlgr", "alpha"
+    };
+    int index;
+
+    if (rfxcodec_encode_get_stats(han, &stats) != 0)
+    {
+        printf("print_stats: no stats\n");
+        return 1;
+    }
+    printf("print_stats: rfx_encode %s rfx_rgb_to_yuv %s\n",
+           stats.rfx_encode_name, stats.rfx_rgb_to_yuv_name);
+    for (index = 0; index < RFX_STATS_STAGES; index++)
+    {
+        printf("print_stats: %-6s calls %lld us %lld\n", stage_names[index],
+               stats.stage_calls[index], stats.stage_ns[index] / 1000);
+    }
+    printf("print_stats: tiles %lld bytes y %lld u %lld v %lld a %lld\n",
+           stats.tiles, stats.y_bytes, stats.u_bytes, stats.v_bytes,
+           stats.a_bytes);
+    printf("print_stats: solid tiles %lld\n", stats.solid_tiles);
+    return 0;
+}
+
+/******************************************************************************/
+static int
+speed_random(int count, const char *quants, int threads)
 {
     void *han;
     int error;
     int index;
     int cdata_bytes;
+    int bound;
     int fd;
     char *cdata;
     char *buf;
@@ -81,8 +113,10 @@ speed_random(int count, const char *quants)
         return 1;
     }
     printf("speed_random: rfxcodec_encode_create_ex ok\n");
-    cdata = (char *) malloc(128 * 64 * 4);
-    cdata_bytes = 128 * 64 * 4;
+    if (rfxcodec_encode_set_threads(han, threads) != 0)
+    {
+        printf("speed_random: rfxcodec_encode_set_threads failed\n");
+    }
     buf = (char *) malloc(128 * 64 * 4);
 #if 1
     fd = open("/dev/urandom", O_RDONLY);
@@ -120,8 +154,13 @@ speed_random(int count, const char *quants)
     stime = get_mstime();
     flags = 0;
     //flags = RFX_FLAGS_ALPHAV1;
+    bound = rfxcodec_encode_bound(han, num_tiles, num_regions, num_quants,
+                                  flags);
+    printf("speed_random: bound %d\n", bound);
+    cdata = (char *) malloc(bound);
     for (index = 0; index < count; index++)
     {
+        cdata_bytes = bound;
         error = rfxcodec_encode_ex(han, cdata, &cdata_bytes, buf, 64, 64, 64 * 4,
                                    regions, num_regions, tiles, num_tiles,
                                    quants, num_quants, flags);
@@ -135,12 +174,213 @@ speed_random(int count, const char *quants)
     printf("speed_random: cdata_bytes %d count %d ms time %d "
            "tiles_per_second %d\n",
            cdata_bytes, count, etime - stime, tiles_per_second);
+    print_stats(han);
     rfxcodec_encode_destroy(han);
     free(buf);
     free(cdata);
     return 0;
 }
 
+/******************************************************************************/
+/* num_surfaces 256x64 surfaces, 4 tiles each, with rfxcodec_encode_batch */
+static int
+speed_batch(int count, const char *quants, int threads, int num_surfaces)
+{
+    void **hans;
+    struct rfx_encode_job *jobs;
+    struct rfx_encode_job *job;
+    int error;
+    int index;
+    int jndex;
+    int bound;
+    int fd;
+    char *cdata;
+    char *buf;
+    struct rfx_rect regions[1];
+    struct rfx_tile tiles[4];
+    int stime;
+    int etime;
+    int tiles_per_second;
+
+    printf("speed_batch:\n");
+    hans = (void **) calloc(num_surfaces, sizeof(void *));
+    jobs = (struct rfx_encode_job *)
+           calloc(num_surfaces, sizeof(struct rfx_encode_job));
+    buf = (char *) malloc(256 * 64 * 4);
+    fd = open("/dev/urandom", O_RDONLY);
+    if (read(fd, buf, 256 * 64 * 4) != 256 * 64 * 4)
+    {
+        printf("speed_batch: read error\n");
+    }
+    close(fd);
+    regions[0].x = 0;
+    regions[0].y = 0;
+    regions[0].cx = 256;
+    regions[0].cy = 64;
+    for (index = 0; index < 4; index++)
+    {
+        tiles[index].x = index * 64;
+        tiles[index].y = 0;
+        tiles[index].cx = 64;
+        tiles[index].cy = 64;
+        tiles[index].quant_y = 0;
+        tiles[index].quant_cb = 0;
+        tiles[index].quant_cr = 0;
+    }
+    bound = 0;
+    cdata = 0;
+    error = 0;
+    for (index = 0; index < num_surfaces; index++)
+    {
+        error = rfxcodec_encode_create_ex(256, 64, RFX_FORMAT_BGRA,
+                                          RFX_FLAGS_RLGR1, &(hans[index]));
+        if (error != 0)
+        {
+            printf("speed_batch: rfxcodec_encode_create_ex failed\n");
+            num_surfaces = index;
+            break;
+        }
+        if (index == 0)
+        {
+            bound = rfxcodec_encode_bound(hans[0], 4, 1, 1, 0);
+            cdata = (char *) malloc(bound * num_surfaces);
+        }
+        job = jobs + index;
+        job->handle = hans[index];
+        job->cdata = cdata + bound * index;
+        job->buf = buf;
+        job->width = 256;
+        job->height = 64;
+        job->stride_bytes = 256 * 4;
+        job->regions = regions;
+        job->num_regions = 1;
+        job->tiles = tiles;
+        job->num_tiles = 4;
+        job->quants = quants;
+        job->num_quants = 1;
+    }
+    if ((error == 0) &&
+        (rfxcodec_encode_set_threads(hans[0], threads) != 0))
+    {
+        printf("speed_batch: rfxcodec_encode_set_threads failed\n");
+    }
+    stime = get_mstime();
+    for (index = 0; (error == 0) && (index < count); index++)
+    {
+        for (jndex = 0; jndex < num_surfaces; jndex++)
+        {
+            jobs[jndex].cdata_bytes = bound;
+        }
+        error = rfxcodec_encode_batch(hans[0], jobs, num_surfaces);
+        for (jndex = 0; jndex < num_surfaces; jndex++)
+        {
+            if (jobs[jndex].error != 0)
+            {
+                printf("speed_batch: job %d error %d\n", jndex,
+                       jobs[jndex].error);
+                error = 1;
+            }
+        }
+    }
+    etime = get_mstime();
+    tiles_per_second = count * num_surfaces * 4 * 1000 / (etime - stime + 1);
+    printf("speed_batch: surfaces %d count %d ms time %d "
+           "tiles_per_second %d\n",
+           num_surfaces, count, etime - stime, tiles_per_second);
+    for (index = 0; index < num_surfaces; index++)
+    {
+        rfxcodec_encode_destroy(hans[index]);
+    }
+    free(hans);
+    free(jobs);
+    free(buf);
+    free(cdata);
+    return error;
+}
+
+/******************************************************************************/
+static int
+speed_decode(int count, const char *quants)
+{
+    void *enc_han;
+    void *dec_han;
+    int error;
+    int index;
+    int cdata_bytes;
+    int fd;
+    char *cdata;
+    char *buf;
+    char *out_buf;
+    struct rfx_rect regions[1];
+    struct rfx_tile tiles[1];
+    int stime;
+    int etime;
+    int tiles_per_second;
+
+    printf("speed_decode:\n");
+    error = rfxcodec_encode_create_ex(64, 64, RFX_FORMAT_BGRA, 0, &enc_han);
+    if (error != 0)
+    {
+        printf("speed_decode: rfxcodec_encode_create_ex failed\n");
+        return 1;
+    }
+    error = rfxcodec_decode_create(64, 64, RFX_FORMAT_BGRA, 0, &dec_han);
+    if (error != 0)
+    {
+        printf("speed_decode: rfxcodec_decode_create failed\n");
+        rfxcodec_encode_destroy(enc_han);
+        return 1;
+    }
+    cdata = (char *) malloc(64 * 64 * 4);
+    cdata_bytes = 64 * 64 * 4;
+    buf = (char *) malloc(64 * 64 * 4);
+    out_buf = (char *) malloc(64 * 64 * 4);
+    fd = open("/dev/urandom", O_RDONLY);
+    if (read(fd, buf, 64 * 64 * 4) != 64 * 64 * 4)
+    {
+        printf("speed_decode: read error\n");
+    }
+    close(fd);
+    regions[0].x = 0;
+    regions[0].y = 0;
+    regions[0].cx = 64;
+    regions[0].cy = 64;
+    tiles[0].x = 0;
+    tiles[0].y = 0;
+    tiles[0].cx = 64;
+    tiles[0].cy = 64;
+    tiles[0].quant_y = 0;
+    tiles[0].quant_cb = 0;
+    tiles[0].quant_cr = 0;
+    error = rfxcodec_encode(enc_han, cdata, &cdata_bytes, buf, 64, 64, 64 * 4,
+                            regions, 1, tiles, 1, quants, 1);
+    if (error != 0)
+    {
+        printf("speed_decode: rfxcodec_encode failed\n");
+    }
+    stime = get_mstime();
+    for (index = 0; index < count && error == 0; index++)
+    {
+        error = rfxcodec_decode(dec_han, cdata, cdata_bytes, out_buf,
+                                64, 64, 64 * 4);
+    }
+    etime = get_mstime();
+    if (error != 0)
+    {
+        printf("speed_decode: rfxcodec_decode failed\n");
+    }
+    tiles_per_second = count * 1000 / (etime - stime + 1);
+    printf("speed_decode: cdata_bytes %d count %d ms time %d "
+           "tiles_per_second %d\n",
+           cdata_bytes, count, etime - stime, tiles_per_second);
+    rfxcodec_decode_destroy(dec_han);
+    rfxcodec_encode_destroy(enc_han);
+    free(out_buf);
+    free(buf);
+    free(cdata);
+    return 0;
+}
+
 struct bmp_magic
 {
     char magic[2];
@@ -244,7 +484,7 @@ load_bmp_file(int in_fd, char **data, int *width, int *height)
 /******************************************************************************/
 static int
 encode_file(char *data, int width, int height, char *cdata, int *cdata_bytes,
-            const char *quants, int num_quants)
+            const char *quants, int num_quants, int threads)
 {
     int awidth;
     int aheight;
@@ -264,6 +504,10 @@ encode_file(char *data, int width, int height, char *cdata, int *cdata_bytes,
         printf("encode_file: rfxcodec_encode_create_ex failed\n");
         return 1;
     }
+    if (rfxcodec_encode_set_threads(han, threads) != 0)
+    {
+        printf("encode_file: rfxcodec_encode_set_threads failed\n");
+    }
 
     awidth = (width + 63) & ~63;
     aheight = (height + 63) & ~63;
@@ -311,7 +555,7 @@ encode_file(char *data, int width, int height, char *cdata, int *cdata_bytes,
 /******************************************************************************/
 static int
 read_file(int count, const char *quants, int num_quants,
-          const char *in_file, const char *out_file)
+          const char *in_file, const char *out_file, int threads)
 {
     int in_fd;
     int out_fd;
@@ -354,7 +598,8 @@ read_file(int count, const char *quants, int num_quants,
     printf("loaded file ok width %d height %d\n", width, height);
     cdata_bytes = (width + 64) * (height + 64);
     cdata = (char *) malloc(cdata_bytes);
-    if (encode_file(data, width, height, cdata, &cdata_bytes, quants, num_quants) != 0)
+    if (encode_file(data, width, height, cdata, &cdata_bytes, quants,
+                    num_quants, threads) != 0)
     {
         printf("encode_file failed\n");
         return 1;
@@ -388,7 +633,10 @@ out_usage(void)
            "and integrity\n");
     printf("examples\n");
     printf("  ./rfxcodectest --speed --count 1000\n");
+    printf("  ./rfxcodectest --batch 16 --count 1000 --threads 4\n");
+    printf("  ./rfxcodectest --decode --count 1000\n");
     printf("  ./rfxcodectest -i infile.bmp -o outfile.rfx\n");
+    printf("  ./rfxcodectest -i infile.bmp -o outfile.rfx --threads 4\n");
     printf("\n");
     return 0;
 }
@@ -399,17 +647,23 @@ main(int argc, char **argv)
 {
     int index;
     int do_speed;
+    int do_decode;
     int do_read;
     int count;
+    int threads;
+    int batch;
     char in_file[256];
     char out_file[256];
     const char *quants = (const char *) g_rfx_default_quantization_values;
 
     do_speed = 0;
+    do_decode = 0;
     do_read = 0;
     in_file[0] = 0;
     out_file[0] = 0;
     count = 1;
+    threads = 0;
+    batch = 0;
     if (argc < 2)
     {
         return out_usage();
@@ -420,11 +674,25 @@ main(int argc, char **argv)
         {
             do_speed = 1;
         }
+        else if (strcmp("--decode", argv[index]) == 0)
+        {
+            do_decode = 1;
+        }
         else if (strcmp("--count", argv[index]) == 0)
         {
             index++;
             count = atoi(argv[index]);
         }
+        else if (strcmp("--batch", argv[index]) == 0)
+        {
+            index++;
+            batch = atoi(argv[index]);
+        }
+        else if (strcmp("--threads", argv[index]) == 0)
+        {
+            index++;
+            threads = atoi(argv[index]);
+        }
         else if (strcmp("-i", argv[index]) == 0)
         {
             index++;
@@ -443,11 +711,19 @@ main(int argc, char **argv)
     }
     if (do_speed)
     {
-        speed_random(count, quants);
+        speed_random(count, quants, threads);
+    }
+    if (batch > 0)
+    {
+        speed_batch(count, quants, threads, batch);
+    }
+    if (do_decode)
+    {
+        speed_decode(count, quants);
     }
     if (do_read)
     {
-        read_file(count, quants, 2, in_file, out_file);
+        read_file(count, quants, 2, in_file, out_file, threads);
     }
     return 0;
 }
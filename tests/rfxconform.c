@@ -0,0 +1,4032 @@
+/**
+ * RFX codec encoder conformance test
+ *
+ * Copyright 2014-2015 Jay Sorg <jay.sorg@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Every rfx_encode function this cpu can run, every rgb to yuv function,
+ * every alpha delta function and every reduce extrapolate DWT function,
+ * must give the same bytes as the C ones.
+ *
+ * Each component of each tile of the corpus is encoded by each
+ * rfx_encode function with a few quant sets, each channel goes through
+ * each alpha delta and reduce extrapolate DWT function, solid tiles go
+ * through the solid path and the DWT, then a surface of the
+ * corpus is encoded in each pixel format, with and without alpha,
+ * with each rfx_encode and rgb to yuv pair, and through a tile cache
+ * where every tile hashes the same.  Both RLGR modes.  The
+ * reference is an encoder made with RFX_FLAGS_NOACCEL.  On a difference
+ * the components are decoded and the first coefficient that differs is
+ * printed.
+ *
+ * Components that end in zeros are RLGR coded by the library and by an
+ * encoder of the MS-RDPRFX pseudocode in the test, which must agree, and
+ * decoded with rfx_rlgr1_decode and rfx_rlgr3_decode.  A last zero in run
+ * length mode must decode as 1, as it is sent, and put in the run, the
+ * form a fix would send, exactly.
+ *
+ * The surface also goes through rfxcodec_encode_progressive, with the
+ * DWT and the reduce extrapolate DWT, at full quality and in levels,
+ * each call is parsed and decoded, RLGR1 then the SRL and raw upgrade
+ * bits, and the tiles must be at the level they were sent at and at
+ * full quality after the last upgrade.
+ *
+ * Rate control must keep each call under max_frame_bytes when flat
+ * surfaces change to noise, and with RFX_FLAGS_TILE_HASH send a surface
+ * that does not change again until it is at the finest level.
+ *
+ * The same surfaces on 2 and 4 threads, and on 4 with the tile cache,
+ * must give the same bytes as single threaded.
+ *
+ * A call into one byte less than it needs must give RFX_ERROR_OVERFLOW
+ * and, done again into rfxcodec_encode_bound bytes, the same output as an
+ * encoder that did not fail, with the tile hash and rate control on and
+ * off.
+ *
+ * Each job of rfxcodec_encode_batch, on 0 and 4 threads, must give the
+ * same bytes as rfxcodec_encode_ex on an encoder made the same way, a
+ * job handle with a sink too, and jobs with a handle twice or a handle of
+ * 0 must be turned away.
+ *
+ * With a sink each chunk must be a whole frame with the next frame_idx,
+ * and the chunks must decode to the same picture as the output without
+ * it.  After a sink that fails the next call must go on from the last
+ * chunk it got, and with the tile hash put back the tiles it changed.
+ *
+ * The surface, and surfaces of solid tiles, are encoded with both RLGR
+ * modes and with alpha and decoded with rfxcodec_decode.  Solid tiles
+ * must give the colour their YCbCr decodes to, exactly but for the corner
+ * the last LL3 coefficient reaches, and the corpus a PSNR of at least
+ * DECODE_MIN_PSNR.
+ *
+ * rfxcodec_encode_damage must give regions with the same pixels as the
+ * damage rects and the tiles with a damaged pixel, for random damage.
+ *
+ * The corpus is synthetic tiles and, with -i, 64x64 BGRA tiles from a
+ * raw file.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include <config_ac.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <rfxcodec_encode.h>
+#include <rfxcodec_decode.h>
+
+#include "rfxcommon.h"
+#include "rfxencode.h"
+#include "rfxconstants.h"
+#include "rfxencode_tile.h"
+#include "rfxencode_alpha.h"
+#include "rfxencode_dwt.h"
+#include "rfxdecode_rlgr.h"
+#include "rfxencode_rlgr1.h"
+#include "rfxencode_rlgr3.h"
+#include "rfxencode_diff_rlgr1.h"
+#include "rfxencode_diff_rlgr3.h"
+#include "rfxencode_differential.h"
+#include "rfx_bitstream.h"
+
+#if defined(RFX_USE_ACCEL_AMD64)
+#include "amd64/funcs_amd64.h"
+#endif
+
+#define TILE_BYTES (64 * 64 * 4)
+#define NUM_SYNTHETIC 12
+#define MAX_VARIANTS 16
+
+/* 4 by 3 tiles, the right and bottom ones partial */
+#define SURFACE_WIDTH (3 * 64 + 40)
+#define SURFACE_HEIGHT (2 * 64 + 42)
+#define SURFACE_TILES_X 4
+#define SURFACE_TILES_Y 3
+#define SURFACE_TILES (SURFACE_TILES_X * SURFACE_TILES_Y)
+
+#define CDATA_BYTES (1024 * 1024)
+
+/* rfxcodec_encode_damage, 16 by 11 tiles, the right and bottom ones
+   partial */
+#define DAMAGE_WIDTH 1000
+#define DAMAGE_HEIGHT 700
+#define DAMAGE_TILES (16 * 11)
+#define DAMAGE_RECTS 2000
+
+/* tenths of a dB, rfxcodec_decode of the corpus at the default quant is
+   about 39 */
+#define DECODE_MIN_PSNR 350
+
+struct variant
+{
+    void *proc;
+    const char *name;
+};
+
+#define ADD_VARIANT(_v, _n, _proc) \
+    do { (_v)[_n].proc = (void *) (_proc); (_v)[_n].name = #_proc; \
+         (_n)++; } while (0)
+
+static const unsigned char g_quants[] =
+{
+    /* LL3 LH3 HL3 HH3 LH2 HL2 HH2 LH1 HL1 HH1 */
+    0x66, 0x66, 0x77, 0x88, 0x98, /* default */
+    0x66, 0x66, 0x66, 0x66, 0x66, /* finest */
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, /* coarsest */
+    0x76, 0x87, 0x88, 0x99, 0xA9,
+    0xA7, 0xBA, 0xBB, 0xCC, 0xDC,
+    0x6F, 0xF6, 0x6F, 0xF6, 0x6F
+};
+#define NUM_QUANTS ((int) (sizeof(g_quants) / 5))
+
+/* solid tiles, LL3 below 6 is out of spec and must take the DWT */
+static const unsigned char g_solid_quants[] =
+{
+    0x66, 0x66, 0x77, 0x88, 0x98,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x55, 0x55, 0x55, 0x55, 0x55,
+    0x65, 0x66, 0x77, 0x88, 0x98,
+    0x8F, 0x66, 0x66, 0x66, 0x66
+};
+#define NUM_SOLID_QUANTS ((int) (sizeof(g_solid_quants) / 5))
+
+/* BGRA */
+static const unsigned int g_solid_colours[] =
+{
+    0xFF000000, 0xFFFFFFFF, 0x80FF0000, 0x0000FF00, 0xFF0000FF,
+    0x40808080, 0xFF123456, 0xC0FEDCBA
+};
+#define NUM_SOLID_COLOURS \
+    ((int) (sizeof(g_solid_colours) / sizeof(g_solid_colours[0])))
+
+static const int g_formats[] =
+{
+    RFX_FORMAT_BGRA, RFX_FORMAT_RGBA, RFX_FORMAT_BGR, RFX_FORMAT_RGB,
+    RFX_FORMAT_YUV, RFX_FORMAT_NV12, RFX_FORMAT_I420
+};
+static const char *g_format_names[] =
+{
+    "BGRA", "RGBA", "BGR", "RGB", "YUV", "NV12", "I420"
+};
+#define NUM_FORMATS ((int) (sizeof(g_formats) / sizeof(g_formats[0])))
+
+
+/* RemoteFX progressive, where the bands of a component are in the order
+   of the upgrade bits, LL3 last, for the DWT and the reduce extrapolate
+   DWT, and which of the 10 RFX_COMPONENT_CODEC_QUANT values, LL3, HL3,
+   LH3, HH3, HL2, LH2, HH2, HL1, LH1, HH1, is theirs */
+static const int g_prog_band_offset[2][10] =
+{
+    { 0, 1024, 2048, 3072, 3328, 3584, 3840, 3904, 3968, 4032 },
+    { 0, 1023, 2046, 3007, 3279, 3551, 3807, 3879, 3951, 4015 }
+};
+static const int g_prog_band_count[2][10] =
+{
+    { 1024, 1024, 1024, 256, 256, 256, 64, 64, 64, 64 },
+    { 1023, 1023, 961, 272, 272, 256, 72, 72, 64, 81 }
+};
+static const int g_prog_band_quant[10] = { 7, 8, 9, 4, 5, 6, 1, 2, 3, 0 };
+#define PROG_LL3 9
+#define PROG_QUANT(_vals, _index) \
+    ((((const unsigned char *) (_vals))[(_index) >> 1] >> \
+      (((_index) & 1) * 4)) & 0xF)
+
+/* RFX_PROGRESSIVE_CODEC_QUANT levels, progressive quant 4, then 2, then
+   1, LL3 less */
+static const unsigned char g_prog_levels[3 * 16] =
+{
+    25, 0x42, 0x44, 0x44, 0x44, 0x44, 0x42, 0x44, 0x44, 0x44, 0x44,
+    0x42, 0x44, 0x44, 0x44, 0x44,
+    50, 0x21, 0x22, 0x22, 0x22, 0x22, 0x21, 0x22, 0x22, 0x22, 0x22,
+    0x21, 0x22, 0x22, 0x22, 0x22,
+    75, 0x10, 0x11, 0x11, 0x11, 0x01, 0x10, 0x11, 0x11, 0x11, 0x01,
+    0x10, 0x11, 0x11, 0x11, 0x01
+};
+#define PROG_NUM_LEVELS 3
+
+/* what a client has of a tile, coefs at the full quality scale */
+struct prog_tile
+{
+    int valid;
+    sint16 coefs[3][4096];
+    sint16 signs[3][4096];
+    int shift[3][10]; /* progressive quant of each band */
+    int first_shift[3][10]; /* and of the first pass */
+};
+
+/* MSB first */
+struct prog_bits
+{
+    const unsigned char *data;
+    int bytes;
+    int pos;
+};
+
+struct prog_srl
+{
+    struct prog_bits bits;
+    int kp;
+    int zeros;
+    int mode;
+};
+
+static int g_checks = 0;
+static int g_fails = 0;
+
+/******************************************************************************/
+static unsigned int
+next_rand(unsigned int *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+/******************************************************************************/
+/* BGRA 64x64 tiles that take the encoder down different paths */
+static void
+make_synthetic(unsigned char *tiles)
+{
+    unsigned char *p;
+    unsigned int seed;
+    int index;
+    int x;
+    int y;
+    int v;
+
+    seed = 1;
+    for (index = 0; index < NUM_SYNTHETIC; index++)
+    {
+        p = tiles + index * TILE_BYTES;
+        for (y = 0; y < 64; y++)
+        {
+            for (x = 0; x < 64; x++)
+            {
+                switch (index)
+                {
+                    case 0: /* solid */
+                        p[0] = 0x20; p[1] = 0x80; p[2] = 0xE0; p[3] = 0xFF;
+                        break;
+                    case 1: /* solid colour, not alpha */
+                        p[0] = 0x10; p[1] = 0x10; p[2] = 0x10;
+                        p[3] = x * 4;
+                        break;
+                    case 2: /* gradients */
+                        p[0] = x * 4; p[1] = y * 4; p[2] = (x + y) * 2;
+                        p[3] = 0xFF;
+                        break;
+                    case 3: /* noise */
+                        p[0] = next_rand(&seed); p[1] = next_rand(&seed);
+                        p[2] = next_rand(&seed); p[3] = next_rand(&seed);
+                        break;
+                    case 4: /* low level noise */
+                        p[0] = 128 + (next_rand(&seed) & 7) - 4;
+                        p[1] = 128 + (next_rand(&seed) & 7) - 4;
+                        p[2] = 128 + (next_rand(&seed) & 7) - 4;
+                        p[3] = 0xFF;
+                        break;
+                    case 5: /* one pixel checkerboard */
+                        v = ((x ^ y) & 1) ? 0xFF : 0;
+                        p[0] = v; p[1] = v; p[2] = v; p[3] = 0xFF;
+                        break;
+                    case 6: /* text like, dark strokes on white */
+                        v = ((y % 12) < 9) && ((x % 7) < 2) &&
+                            (((x / 7 + y / 12) % 3) != 0);
+                        p[0] = v ? 0x00 : 0xFF; p[1] = v ? 0x00 : 0xFF;
+                        p[2] = v ? 0x40 : 0xFF; p[3] = 0xFF;
+                        break;
+                    case 7: /* 0 and 255 blocks */
+                        v = (((x / 3) * 7 + (y / 5) * 3) & 4) ? 0xFF : 0;
+                        p[0] = v; p[1] = 0xFF - v; p[2] = v; p[3] = v;
+                        break;
+                    case 8: /* stripes */
+                        v = ((x + 2 * y) / 3) & 1 ? 0xE0 : 0x10;
+                        p[0] = v; p[1] = v / 2; p[2] = 0xFF - v; p[3] = 0xFF;
+                        break;
+                    case 9: /* smooth colour */
+                        p[0] = 128 + ((x * x) >> 5) - ((y * y) >> 5);
+                        p[1] = (x * y) >> 4;
+                        p[2] = 255 - ((x * y) >> 4);
+                        p[3] = 0xFF;
+                        break;
+                    case 10: /* one pixel in flat */
+                        v = (x == 37) && (y == 21);
+                        p[0] = v ? 0xFF : 0x40; p[1] = v ? 0x00 : 0x40;
+                        p[2] = 0x40; p[3] = 0xFF;
+                        break;
+                    default: /* noise, 0 or 255 */
+                        v = next_rand(&seed) & 1 ? 0xFF : 0;
+                        p[0] = v; p[1] = next_rand(&seed) & 1 ? 0xFF : 0;
+                        p[2] = v; p[3] = 0xFF;
+                        break;
+                }
+                p += 4;
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/* the synthetic tiles and the 64x64 BGRA tiles in filename */
+static unsigned char *
+make_corpus(const char *filename, int *num_tiles)
+{
+    unsigned char *tiles;
+    FILE *fp;
+    long bytes;
+    int num_file;
+
+    num_file = 0;
+    fp = 0;
+    if (filename != 0)
+    {
+        fp = fopen(filename, "rb");
+        if (fp == 0)
+        {
+            printf("make_corpus: can not open %s\n", filename);
+            return 0;
+        }
+        fseek(fp, 0, SEEK_END);
+        bytes = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        num_file = (int) (bytes / TILE_BYTES);
+    }
+    tiles = (unsigned char *) malloc((NUM_SYNTHETIC + num_file) * TILE_BYTES);
+    if (tiles == 0)
+    {
+        if (fp != 0)
+        {
+            fclose(fp);
+        }
+        return 0;
+    }
+    make_synthetic(tiles);
+    if (fp != 0)
+    {
+        if (fread(tiles + NUM_SYNTHETIC * TILE_BYTES, TILE_BYTES, num_file,
+                  fp) != (size_t) num_file)
+        {
+            printf("make_corpus: read error\n");
+            num_file = 0;
+        }
+        fclose(fp);
+    }
+    *num_tiles = NUM_SYNTHETIC + num_file;
+    return tiles;
+}
+
+/******************************************************************************/
+/* the rfx_encode functions this cpu can run, the C one first */
+static int
+get_encode_variants(struct rfxencode *enc, struct variant *v)
+{
+    int n;
+
+    n = 0;
+    if (enc->mode == RLGR3)
+    {
+        ADD_VARIANT(v, n, rfx_encode_component_rlgr3);
+#if defined(RFX_USE_ACCEL_X86)
+        if (enc->got_sse2)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr3_x86_sse2);
+        }
+        if (enc->got_sse41)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr3_x86_sse41);
+        }
+#elif defined(RFX_USE_ACCEL_AMD64)
+        if (enc->got_sse2)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr3_amd64_sse2);
+        }
+        if (enc->got_sse41)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr3_amd64_sse41);
+        }
+        if (enc->got_avx2)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr3_amd64_avx2);
+        }
+        if (enc->got_avx512bw)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr3_amd64_avx512bw);
+        }
+#endif
+    }
+    else
+    {
+        ADD_VARIANT(v, n, rfx_encode_component_rlgr1);
+#if defined(RFX_USE_ACCEL_X86)
+        if (enc->got_sse2)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr1_x86_sse2);
+        }
+        if (enc->got_sse41)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr1_x86_sse41);
+        }
+#elif defined(RFX_USE_ACCEL_AMD64)
+        if (enc->got_sse2)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr1_amd64_sse2);
+        }
+        if (enc->got_sse41)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr1_amd64_sse41);
+        }
+        if (enc->got_avx2)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr1_amd64_avx2);
+        }
+        if (enc->got_avx512bw)
+        {
+            ADD_VARIANT(v, n, rfx_encode_component_rlgr1_amd64_avx512bw);
+        }
+#endif
+    }
+    return n;
+}
+
+/******************************************************************************/
+/* the rgb to yuv or 4:2:0 to yuv functions for format this cpu can run,
+   0, the C one, first */
+static int
+get_format_variants(struct rfxencode *enc, int format, struct variant *v)
+{
+    int n;
+
+    n = 0;
+    v[n].proc = 0;
+    v[n].name = "C";
+    n++;
+#if defined(RFX_USE_ACCEL_AMD64)
+    switch (format)
+    {
+        case RFX_FORMAT_BGRA:
+            if (enc->got_sse2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_bgra_to_yuv_amd64_sse2);
+            }
+            if (enc->got_avx2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_bgra_to_yuv_amd64_avx2);
+            }
+            break;
+        case RFX_FORMAT_RGBA:
+            if (enc->got_sse2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_rgba_to_yuv_amd64_sse2);
+            }
+            if (enc->got_avx2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_rgba_to_yuv_amd64_avx2);
+            }
+            break;
+        case RFX_FORMAT_BGR:
+            if (enc->got_ssse3)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_bgr_to_yuv_amd64_ssse3);
+            }
+            if (enc->got_avx2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_bgr_to_yuv_amd64_avx2);
+            }
+            break;
+        case RFX_FORMAT_RGB:
+            if (enc->got_ssse3)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_rgb_to_yuv_amd64_ssse3);
+            }
+            if (enc->got_avx2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_rgb_to_yuv_amd64_avx2);
+            }
+            break;
+        case RFX_FORMAT_NV12:
+            if (enc->got_sse2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_nv12_to_yuv_amd64_sse2);
+            }
+            break;
+        case RFX_FORMAT_I420:
+            if (enc->got_sse2)
+            {
+                ADD_VARIANT(v, n, rfxcodec_encode_i420_to_yuv_amd64_sse2);
+            }
+            break;
+    }
+#endif
+    if (n == 0)
+    {
+        /* nothing for this cpu or format */
+    }
+    return n;
+}
+
+/******************************************************************************/
+/* the alpha delta functions this cpu can run, the C one first */
+static int
+get_alpha_variants(struct rfxencode *enc, struct variant *v)
+{
+    int n;
+
+    n = 0;
+    ADD_VARIANT(v, n, rfx_alpha_delta);
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (enc->got_sse2)
+    {
+        ADD_VARIANT(v, n, rfxcodec_encode_alpha_delta_amd64_sse2);
+    }
+#endif
+    return n;
+}
+
+/******************************************************************************/
+/* the reduce extrapolate DWT functions this cpu can run, the C one first */
+static int
+get_dwt_rem_variants(struct rfxencode *enc, struct variant *v)
+{
+    int n;
+
+    n = 0;
+    ADD_VARIANT(v, n, rfx_dwt_2d_encode_rem);
+#if defined(RFX_USE_ACCEL_AMD64)
+    if (enc->got_sse2)
+    {
+        ADD_VARIANT(v, n, rfxcodec_encode_dwt_rem_amd64_sse2);
+    }
+    if (enc->got_avx2)
+    {
+        ADD_VARIANT(v, n, rfxcodec_encode_dwt_rem_amd64_avx2);
+    }
+#endif
+    return n;
+}
+
+/******************************************************************************/
+static const char *
+band_name(int index)
+{
+    if (index < 1024)
+    {
+        return "HL1";
+    }
+    if (index < 2048)
+    {
+        return "LH1";
+    }
+    if (index < 3072)
+    {
+        return "HH1";
+    }
+    if (index < 3328)
+    {
+        return "HL2";
+    }
+    if (index < 3584)
+    {
+        return "LH2";
+    }
+    if (index < 3840)
+    {
+        return "HH2";
+    }
+    if (index < 3904)
+    {
+        return "HL3";
+    }
+    if (index < 3968)
+    {
+        return "LH3";
+    }
+    if (index < 4032)
+    {
+        return "HH3";
+    }
+    return "LL3"; /* differential */
+}
+
+/******************************************************************************/
+/* decode both and print the first coefficient that differs */
+static void
+report_component(int mode, const unsigned char *ref, int ref_bytes,
+                 const unsigned char *got, int got_bytes)
+{
+    sint16 ref_coef[4096];
+    sint16 got_coef[4096];
+    int index;
+
+    memset(ref_coef, 0, sizeof(ref_coef));
+    memset(got_coef, 0, sizeof(got_coef));
+    if (mode == RLGR3)
+    {
+        rfx_rlgr3_decode(ref, ref_bytes, ref_coef);
+        rfx_rlgr3_decode(got, got_bytes, got_coef);
+    }
+    else
+    {
+        rfx_rlgr1_decode(ref, ref_bytes, ref_coef);
+        rfx_rlgr1_decode(got, got_bytes, got_coef);
+    }
+    for (index = 0; index < 4096; index++)
+    {
+        if (ref_coef[index] != got_coef[index])
+        {
+            printf("    first differing coefficient %d %s, %d, should be "
+                   "%d\n", index, band_name(index), got_coef[index],
+                   ref_coef[index]);
+            return;
+        }
+    }
+    for (index = 0; (index < ref_bytes) && (index < got_bytes); index++)
+    {
+        if (ref[index] != got[index])
+        {
+            break;
+        }
+    }
+    printf("    same coefficients, first differing byte %d, bytes %d, "
+           "should be %d\n", index, got_bytes, ref_bytes);
+}
+
+/******************************************************************************/
+/* each component of each tile through each rfx_encode function */
+static int
+check_components(const unsigned char *corpus, int num_corpus, int flags)
+{
+    struct rfxencode *ref_enc;
+    struct rfxencode *enc;
+    struct variant variants[MAX_VARIANTS];
+    unsigned char planes[3][4096];
+    unsigned char *ref_out;
+    unsigned char *out;
+    const unsigned char *src;
+    int num_variants;
+    int variant;
+    int tile;
+    int quant;
+    int comp;
+    int index;
+    int ref_bytes;
+    int bytes;
+    int ref_error;
+    int error;
+    rfx_encode_proc ref_proc;
+    rfx_encode_proc proc;
+
+    ref_enc = (struct rfxencode *)
+              rfxcodec_encode_create(64, 64, RFX_FORMAT_BGRA,
+                                     flags | RFX_FLAGS_NOACCEL);
+    enc = (struct rfxencode *)
+          rfxcodec_encode_create(64, 64, RFX_FORMAT_BGRA, flags);
+    ref_out = (unsigned char *) malloc(CDATA_BYTES);
+    out = (unsigned char *) malloc(CDATA_BYTES);
+    if ((ref_enc == 0) || (enc == 0) || (ref_out == 0) || (out == 0))
+    {
+        printf("check_components: create failed\n");
+        g_fails++;
+        rfxcodec_encode_destroy(ref_enc);
+        rfxcodec_encode_destroy(enc);
+        free(ref_out);
+        free(out);
+        return 1;
+    }
+    num_variants = get_encode_variants(enc, variants);
+    ref_proc = (rfx_encode_proc) (variants[0].proc);
+    for (tile = 0; tile < num_corpus; tile++)
+    {
+        /* the raw channels, the encode functions do not care */
+        src = corpus + tile * TILE_BYTES;
+        for (index = 0; index < 4096; index++)
+        {
+            planes[0][index] = src[index * 4 + 0];
+            planes[1][index] = src[index * 4 + 1];
+            planes[2][index] = src[index * 4 + 2];
+        }
+        for (quant = 0; quant < NUM_QUANTS; quant++)
+        {
+            for (comp = 0; comp < 3; comp++)
+            {
+                ref_bytes = 0;
+                ref_error = ref_proc(ref_enc, (const char *) g_quants + quant * 5,
+                                     planes[comp], ref_out, CDATA_BYTES,
+                                     &ref_bytes);
+                for (variant = 1; variant < num_variants; variant++)
+                {
+                    proc = (rfx_encode_proc) (variants[variant].proc);
+                    bytes = 0;
+                    error = proc(enc, (const char *) g_quants + quant * 5,
+                                 planes[comp], out, CDATA_BYTES, &bytes);
+                    g_checks++;
+                    if ((error == ref_error) && (bytes == ref_bytes) &&
+                        (memcmp(out, ref_out, bytes) == 0))
+                    {
+                        continue;
+                    }
+                    g_fails++;
+                    printf("  %s: tile %d quant %d component %d differs, "
+                           "error %d should be %d\n", variants[variant].name,
+                           tile, quant, comp, error, ref_error);
+                    report_component(enc->mode, ref_out, ref_bytes,
+                                     out, bytes);
+                }
+            }
+        }
+    }
+    printf("check_components: %s, %d functions\n",
+           enc->mode == RLGR3 ? "RLGR3" : "RLGR1", num_variants);
+    rfxcodec_encode_destroy(ref_enc);
+    rfxcodec_encode_destroy(enc);
+    free(ref_out);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+static int
+never_solid(const char *data, int stride_bytes, int with_alpha)
+{
+    return 0;
+}
+
+/******************************************************************************/
+/* solid tiles through the solid path and, as the reference, the DWT,
+   with and without alpha */
+static int
+check_solid(int flags)
+{
+    struct rfxencode *ref_enc;
+    struct rfxencode *enc;
+    unsigned int *tile;
+    unsigned char *ref_out;
+    unsigned char *out;
+    STREAM ref_s;
+    STREAM s;
+    int quant_idx[3];
+    int ref_sizes[4];
+    int sizes[4];
+    int colour;
+    int quant;
+    int alpha;
+    int index;
+    int ref_bytes;
+    int bytes;
+    int ref_error;
+    int error;
+
+    ref_enc = (struct rfxencode *)
+              rfxcodec_encode_create(64, 64, RFX_FORMAT_BGRA,
+                                     flags | RFX_FLAGS_NOACCEL |
+                                     RFX_FLAGS_QUIET);
+    enc = (struct rfxencode *)
+          rfxcodec_encode_create(64, 64, RFX_FORMAT_BGRA,
+                                 flags | RFX_FLAGS_QUIET);
+    tile = (unsigned int *) malloc(TILE_BYTES);
+    ref_out = (unsigned char *) malloc(CDATA_BYTES);
+    out = (unsigned char *) malloc(CDATA_BYTES);
+    if ((ref_enc == 0) || (enc == 0) || (tile == 0) || (ref_out == 0) ||
+        (out == 0))
+    {
+        printf("check_solid: create failed\n");
+        g_fails++;
+        rfxcodec_encode_destroy(ref_enc);
+        rfxcodec_encode_destroy(enc);
+        free(tile);
+        free(ref_out);
+        free(out);
+        return 1;
+    }
+    ref_enc->rfx_tile_solid = never_solid;
+    for (colour = 0; colour < NUM_SOLID_COLOURS; colour++)
+    {
+        for (index = 0; index < 4096; index++)
+        {
+            tile[index] = g_solid_colours[colour];
+        }
+        for (quant = 0; quant < NUM_SOLID_QUANTS; quant++)
+        {
+            for (alpha = 0; alpha < 2; alpha++)
+            {
+                ref_s.data = ref_out;
+                ref_s.p = ref_out;
+                ref_s.size = CDATA_BYTES;
+                s.data = out;
+                s.p = out;
+                s.size = CDATA_BYTES;
+                memset(ref_sizes, 0, sizeof(ref_sizes));
+                memset(sizes, 0, sizeof(sizes));
+                quant_idx[0] = 0;
+                quant_idx[1] = 0;
+                quant_idx[2] = 0;
+                if (alpha)
+                {
+                    ref_error = rfx_encode_argb(ref_enc, (const char *) tile,
+                                                64, 64, 64 * 4,
+                                                (const char *) g_solid_quants +
+                                                quant * 5, quant_idx, 0,
+                                                &ref_s, ref_sizes,
+                                                ref_sizes + 1, ref_sizes + 2,
+                                                ref_sizes + 3);
+                    error = rfx_encode_argb(enc, (const char *) tile,
+                                            64, 64, 64 * 4,
+                                            (const char *) g_solid_quants +
+                                            quant * 5, quant_idx, 0,
+                                            &s, sizes, sizes + 1, sizes + 2,
+                                            sizes + 3);
+                }
+                else
+                {
+                    ref_error = rfx_encode_rgb(ref_enc, (const char *) tile,
+                                               64, 64, 64 * 4,
+                                               (const char *) g_solid_quants +
+                                               quant * 5, quant_idx, 0,
+                                               &ref_s, ref_sizes,
+                                               ref_sizes + 1, ref_sizes + 2);
+                    error = rfx_encode_rgb(enc, (const char *) tile,
+                                           64, 64, 64 * 4,
+                                           (const char *) g_solid_quants +
+                                           quant * 5, quant_idx, 0,
+                                           &s, sizes, sizes + 1, sizes + 2);
+                }
+                ref_bytes = (int) (ref_s.p - ref_s.data);
+                bytes = (int) (s.p - s.data);
+                g_checks++;
+                if ((error == ref_error) && (bytes == ref_bytes) &&
+                    (bytes >= 0) &&
+                    (memcmp(sizes, ref_sizes, sizeof(sizes)) == 0) &&
+                    (memcmp(out, ref_out, bytes) == 0))
+                {
+                    continue;
+                }
+                g_fails++;
+                printf("  colour 0x%8.8x quant %d alpha %d differs, "
+                       "error %d should be %d\n", g_solid_colours[colour],
+                       quant, alpha, error, ref_error);
+            }
+        }
+    }
+    printf("check_solid: %s, %d colours\n",
+           enc->mode == RLGR3 ? "RLGR3" : "RLGR1", NUM_SOLID_COLOURS);
+    rfxcodec_encode_destroy(ref_enc);
+    rfxcodec_encode_destroy(enc);
+    free(tile);
+    free(ref_out);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+/* each channel of each tile through each alpha delta function */
+static int
+check_alpha(const unsigned char *corpus, int num_corpus)
+{
+    struct rfxencode *enc;
+    struct variant variants[MAX_VARIANTS];
+    unsigned char plane[4096];
+    unsigned char ref_delta[4096 + 16];
+    unsigned char delta[4096 + 16];
+    uint64 ref_runs[64];
+    uint64 runs[64];
+    const unsigned char *src;
+    int num_variants;
+    int variant;
+    int tile;
+    int chan;
+    int index;
+    rfx_alpha_delta_proc proc;
+
+    enc = (struct rfxencode *)
+          rfxcodec_encode_create(64, 64, RFX_FORMAT_BGRA, 0);
+    if (enc == 0)
+    {
+        printf("check_alpha: create failed\n");
+        g_fails++;
+        return 1;
+    }
+    num_variants = get_alpha_variants(enc, variants);
+    for (tile = 0; tile < num_corpus; tile++)
+    {
+        src = corpus + tile * TILE_BYTES;
+        for (chan = 0; chan < 4; chan++)
+        {
+            for (index = 0; index < 4096; index++)
+            {
+                plane[index] = src[index * 4 + chan];
+            }
+            memset(ref_delta, 0, sizeof(ref_delta));
+            rfx_alpha_delta(plane, ref_delta, ref_runs);
+            for (variant = 1; variant < num_variants; variant++)
+            {
+                proc = (rfx_alpha_delta_proc) (variants[variant].proc);
+                memset(delta, 0, sizeof(delta));
+                proc(plane, delta, runs);
+                g_checks++;
+                if ((memcmp(delta, ref_delta, 4096) == 0) &&
+                    (memcmp(runs, ref_runs, sizeof(runs)) == 0))
+                {
+                    continue;
+                }
+                g_fails++;
+                printf("  %s: tile %d channel %d differs\n",
+                       variants[variant].name, tile, chan);
+                for (index = 0; index < 4096; index++)
+                {
+                    if (delta[index] != ref_delta[index])
+                    {
+                        printf("    first differing delta %d, %d, should "
+                               "be %d\n", index, delta[index],
+                               ref_delta[index]);
+                        break;
+                    }
+                }
+                for (index = 0; index < 64; index++)
+                {
+                    if (runs[index] != ref_runs[index])
+                    {
+                        printf("    first differing runs line %d\n", index);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    printf("check_alpha: %d functions\n", num_variants);
+    rfxcodec_encode_destroy(enc);
+    return 0;
+}
+
+/******************************************************************************/
+/* each channel of each tile through each reduce extrapolate DWT function */
+static int
+check_dwt_rem(const unsigned char *corpus, int num_corpus)
+{
+    struct rfxencode *enc;
+    struct variant variants[MAX_VARIANTS];
+    unsigned char plane[4096];
+    sint16 ref_coefs[4096];
+    sint16 coefs[4096];
+    const unsigned char *src;
+    int num_variants;
+    int variant;
+    int tile;
+    int chan;
+    int index;
+    rfx_dwt_rem_proc proc;
+
+    enc = (struct rfxencode *)
+          rfxcodec_encode_create(64, 64, RFX_FORMAT_BGRA, 0);
+    if (enc == 0)
+    {
+        printf("check_dwt_rem: create failed\n");
+        g_fails++;
+        return 1;
+    }
+    num_variants = get_dwt_rem_variants(enc, variants);
+    for (tile = 0; tile < num_corpus; tile++)
+    {
+        src = corpus + tile * TILE_BYTES;
+        for (chan = 0; chan < 4; chan++)
+        {
+            for (index = 0; index < 4096; index++)
+            {
+                plane[index] = src[index * 4 + chan];
+            }
+            rfx_dwt_2d_encode_rem(plane, ref_coefs, enc->dwt_buffer,
+                                  enc->dwt_buffer2);
+            for (variant = 1; variant < num_variants; variant++)
+            {
+                proc = (rfx_dwt_rem_proc) (variants[variant].proc);
+                memset(coefs, 0, sizeof(coefs));
+                proc(plane, coefs, enc->dwt_buffer, enc->dwt_buffer2);
+                g_checks++;
+                if (memcmp(coefs, ref_coefs, sizeof(coefs)) == 0)
+                {
+                    continue;
+                }
+                g_fails++;
+                printf("  %s: tile %d channel %d differs\n",
+                       variants[variant].name, tile, chan);
+                for (index = 0; index < 4096; index++)
+                {
+                    if (coefs[index] != ref_coefs[index])
+                    {
+                        printf("    first differing coefficient %d, %d, "
+                               "should be %d\n", index, coefs[index],
+                               ref_coefs[index]);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    printf("check_dwt_rem: %d functions\n", num_variants);
+    rfxcodec_encode_destroy(enc);
+    return 0;
+}
+
+/******************************************************************************/
+/* corpus tiles first to first + SURFACE_TILES in format */
+static int
+make_surface(const unsigned char *corpus, int num_corpus, int first,
+             int format, char *buf, int *stride_bytes)
+{
+    const unsigned char *src;
+    unsigned char *dst;
+    unsigned char *uv;
+    int uv_stride_bytes;
+    int x;
+    int y;
+
+    switch (format)
+    {
+        case RFX_FORMAT_BGR:
+        case RFX_FORMAT_RGB:
+            *stride_bytes = SURFACE_WIDTH * 3;
+            break;
+        case RFX_FORMAT_YUV:
+            /* a row of tiles is 64 rows */
+            *stride_bytes = SURFACE_TILES_X * TILE_BYTES / 64;
+            break;
+        case RFX_FORMAT_NV12:
+        case RFX_FORMAT_I420:
+            *stride_bytes = SURFACE_WIDTH + 24;
+            break;
+        default:
+            *stride_bytes = SURFACE_WIDTH * 4;
+            break;
+    }
+    uv = (unsigned char *) buf + *stride_bytes * SURFACE_HEIGHT;
+    uv_stride_bytes = format == RFX_FORMAT_NV12 ? *stride_bytes :
+                      *stride_bytes / 2;
+    for (y = 0; y < SURFACE_TILES_Y * 64; y++)
+    {
+        for (x = 0; x < SURFACE_TILES_X * 64; x++)
+        {
+            src = corpus + ((first + (y / 64) * SURFACE_TILES_X + x / 64) %
+                            num_corpus) * TILE_BYTES +
+                  ((y % 64) * 64 + (x % 64)) * 4;
+            if (format == RFX_FORMAT_YUV)
+            {
+                /* 4 planes of 64x64 for each tile */
+                dst = (unsigned char *) buf +
+                      (y / 64) * 64 * *stride_bytes + (x / 64) * TILE_BYTES +
+                      (y % 64) * 64 + (x % 64);
+                dst[0] = src[0];
+                dst[4096] = src[1];
+                dst[8192] = src[2];
+                dst[12288] = src[3];
+                continue;
+            }
+            if ((x >= SURFACE_WIDTH) || (y >= SURFACE_HEIGHT))
+            {
+                continue;
+            }
+            switch (format)
+            {
+                case RFX_FORMAT_BGRA:
+                    dst = (unsigned char *) buf + y * *stride_bytes + x * 4;
+                    memcpy(dst, src, 4);
+                    break;
+                case RFX_FORMAT_RGBA:
+                    dst = (unsigned char *) buf + y * *stride_bytes + x * 4;
+                    dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0];
+                    dst[3] = src[3];
+                    break;
+                case RFX_FORMAT_BGR:
+                    dst = (unsigned char *) buf + y * *stride_bytes + x * 3;
+                    memcpy(dst, src, 3);
+                    break;
+                case RFX_FORMAT_RGB:
+                    dst = (unsigned char *) buf + y * *stride_bytes + x * 3;
+                    dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0];
+                    break;
+                case RFX_FORMAT_NV12:
+                case RFX_FORMAT_I420:
+                    dst = (unsigned char *) buf + y * *stride_bytes + x;
+                    dst[0] = src[1];
+                    if ((x & 1) || (y & 1))
+                    {
+                        break;
+                    }
+                    if (format == RFX_FORMAT_NV12)
+                    {
+                        dst = uv + (y / 2) * uv_stride_bytes + x;
+                        dst[0] = src[0];
+                        dst[1] = src[2];
+                    }
+                    else
+                    {
+                        dst = uv + (y / 2) * uv_stride_bytes + x / 2;
+                        dst[0] = src[0];
+                        dst[uv_stride_bytes * ((SURFACE_HEIGHT + 1) / 2)] =
+                            src[2];
+                    }
+                    break;
+            }
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+static int
+get_uint16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/******************************************************************************/
+static int
+get_uint32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+/******************************************************************************/
+/* the first tile in got that is not the same as in ref */
+static void
+report_stream(int mode, const unsigned char *ref, int ref_bytes,
+              const unsigned char *got, int got_bytes)
+{
+    int ref_pos;
+    int got_pos;
+    int block_type;
+    int num_quants;
+    int num_tiles;
+    int header_bytes;
+    int tile;
+    int comp;
+    int ref_len;
+    int got_len;
+    int ref_data;
+    int got_data;
+
+    /* same header, frame begin and region */
+    ref_pos = 0;
+    while (ref_pos + 6 <= ref_bytes)
+    {
+        block_type = get_uint16(ref + ref_pos);
+        if ((block_type == WBT_EXTENSION) || (block_type == WBT_EXTENSION_PLUS))
+        {
+            break;
+        }
+        ref_pos += get_uint32(ref + ref_pos + 2);
+    }
+    if ((ref_pos + 22 > ref_bytes) || (ref_pos + 22 > got_bytes) ||
+        (memcmp(ref, got, ref_pos) != 0))
+    {
+        printf("    differs before the tiles\n");
+        return;
+    }
+    /* the tileset lengths can differ, not the quants or number of tiles */
+    header_bytes = block_type == WBT_EXTENSION_PLUS ? 21 : 19;
+    num_quants = ref[ref_pos + 14];
+    num_tiles = get_uint16(ref + ref_pos + 16);
+    if ((got[ref_pos + 14] != num_quants) ||
+        (get_uint16(got + ref_pos + 16) != num_tiles) ||
+        (ref_pos + 22 + num_quants * 5 > got_bytes) ||
+        (memcmp(ref + ref_pos + 22, got + ref_pos + 22, num_quants * 5) != 0))
+    {
+        printf("    tileset quants or number of tiles differ\n");
+        return;
+    }
+    ref_pos += 22 + num_quants * 5;
+    got_pos = ref_pos;
+    for (tile = 0; tile < num_tiles; tile++)
+    {
+        if ((ref_pos + header_bytes > ref_bytes) ||
+            (got_pos + header_bytes > got_bytes))
+        {
+            break;
+        }
+        ref_data = ref_pos + header_bytes;
+        got_data = got_pos + header_bytes;
+        for (comp = 0; comp < 3; comp++)
+        {
+            ref_len = get_uint16(ref + ref_pos + 13 + comp * 2);
+            got_len = get_uint16(got + got_pos + 13 + comp * 2);
+            if ((ref_data + ref_len > ref_bytes) ||
+                (got_data + got_len > got_bytes))
+            {
+                printf("    tile %d bad length\n", tile);
+                return;
+            }
+            if ((ref_len != got_len) ||
+                (memcmp(ref + ref_data, got + got_data, ref_len) != 0))
+            {
+                printf("    tile %d component %d\n", tile, comp);
+                report_component(mode, ref + ref_data, ref_len,
+                                 got + got_data, got_len);
+                return;
+            }
+            ref_data += ref_len;
+            got_data += got_len;
+        }
+        ref_len = get_uint32(ref + ref_pos + 2);
+        got_len = get_uint32(got + got_pos + 2);
+        if ((ref_len != got_len) ||
+            (memcmp(ref + ref_pos, got + got_pos, ref_len) != 0))
+        {
+            printf("    tile %d header or alpha\n", tile);
+            return;
+        }
+        ref_pos += ref_len;
+        got_pos += got_len;
+    }
+    printf("    differs after the tiles\n");
+}
+
+/******************************************************************************/
+static int
+encode_surface(void *han, const char *buf, int stride_bytes, int flags,
+               char *cdata, int *cdata_bytes)
+{
+    struct rfx_rect region;
+    struct rfx_tile tiles[SURFACE_TILES];
+    int num_regions;
+    int num_tiles;
+
+    region.x = 0;
+    region.y = 0;
+    region.cx = SURFACE_WIDTH;
+    region.cy = SURFACE_HEIGHT;
+    /* the header and frame 0 every time */
+    if (rfxcodec_encode_reset(han, RFX_RESET_FRAME_IDX) != 0)
+    {
+        return 1;
+    }
+    if (rfxcodec_encode_damage(han, &region, 1, &region, &num_regions,
+                               tiles, &num_tiles) != 0)
+    {
+        return 1;
+    }
+    *cdata_bytes = CDATA_BYTES;
+    return rfxcodec_encode_ex(han, cdata, cdata_bytes, buf,
+                              SURFACE_WIDTH, SURFACE_HEIGHT, stride_bytes,
+                              &region, num_regions, tiles, num_tiles,
+                              0, 0, flags);
+}
+
+/******************************************************************************/
+/* every tile has the same hash, each cache lookup is a CRC32C collision */
+static int
+same_hash(const char *data, int row_bytes, int rows, int stride_bytes,
+          uint32 *hash)
+{
+    *hash = 0x12345678;
+    return 0;
+}
+
+/******************************************************************************/
+/* the corpus as surfaces, twice, through a tile cache where every tile
+   hashes the same, must be the same as without the cache */
+static int
+check_cache(const unsigned char *corpus, int num_corpus, int flags)
+{
+    static const int formats[] = { 0, 2, 4 }; /* BGRA, BGR and YUV */
+    struct rfx_tile_cache_stats stats;
+    struct rfxencode *enc;
+    void *ref_han;
+    char *buf;
+    char *ref_out;
+    char *out;
+    int format;
+    int index;
+    int pass;
+    int first;
+    int stride_bytes;
+    int ref_bytes;
+    int bytes;
+    int ref_error;
+    int error;
+
+    buf = (char *) calloc(1, SURFACE_TILES * TILE_BYTES * 2);
+    ref_out = (char *) malloc(CDATA_BYTES);
+    out = (char *) malloc(CDATA_BYTES);
+    if ((buf == 0) || (ref_out == 0) || (out == 0))
+    {
+        g_fails++;
+        free(buf);
+        free(ref_out);
+        free(out);
+        return 1;
+    }
+    for (index = 0; index < 3; index++)
+    {
+        format = formats[index];
+        ref_han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                         g_formats[format],
+                                         flags | RFX_FLAGS_QUIET);
+        enc = (struct rfxencode *)
+              rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                     g_formats[format],
+                                     flags | RFX_FLAGS_QUIET);
+        if ((ref_han == 0) || (enc == 0) ||
+            (rfxcodec_encode_set_tile_cache(enc, 64 * 1024 * 1024) != 0))
+        {
+            printf("check_cache: create failed\n");
+            g_fails++;
+            rfxcodec_encode_destroy(ref_han);
+            rfxcodec_encode_destroy(enc);
+            continue;
+        }
+        enc->rfx_tile_hash = same_hash;
+        for (pass = 0; pass < 2; pass++)
+        {
+            for (first = 0; first < num_corpus; first += SURFACE_TILES)
+            {
+                make_surface(corpus, num_corpus, first, g_formats[format],
+                             buf, &stride_bytes);
+                ref_error = encode_surface(ref_han, buf, stride_bytes, 0,
+                                           ref_out, &ref_bytes);
+                error = encode_surface(enc, buf, stride_bytes, 0,
+                                       out, &bytes);
+                g_checks++;
+                if ((error == ref_error) && (bytes == ref_bytes) &&
+                    (memcmp(out, ref_out, bytes) == 0))
+                {
+                    continue;
+                }
+                g_fails++;
+                printf("  %s pass %d: surface %d differs, error %d "
+                       "should be %d\n", g_format_names[format], pass,
+                       first, error, ref_error);
+                report_stream(enc->mode, (const unsigned char *) ref_out,
+                              ref_bytes, (const unsigned char *) out, bytes);
+            }
+        }
+        /* the second pass must have come from the cache */
+        rfxcodec_encode_get_tile_cache_stats(enc, &stats);
+        g_checks++;
+        if (stats.hits < 1)
+        {
+            g_fails++;
+            printf("  %s: no cache hits\n", g_format_names[format]);
+        }
+        printf("check_cache: %s %s, %d hits %d misses\n",
+               g_format_names[format],
+               enc->mode == RLGR3 ? "RLGR3" : "RLGR1",
+               stats.hits, stats.misses);
+        rfxcodec_encode_destroy(ref_han);
+        rfxcodec_encode_destroy(enc);
+    }
+    free(buf);
+    free(ref_out);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+/* the corpus as surfaces in each format, with each rfx_encode and rgb to
+   yuv function */
+static int
+check_streams(const unsigned char *corpus, int num_corpus, int flags)
+{
+    struct rfxencode *enc;
+    void *ref_han;
+    struct variant encode_variants[MAX_VARIANTS];
+    struct variant format_variants[MAX_VARIANTS];
+    char *buf;
+    char *ref_out;
+    char *out;
+    int num_encode_variants;
+    int num_format_variants;
+    int encode_variant;
+    int format_variant;
+    int format;
+    int alpha;
+    int first;
+    int stride_bytes;
+    int ref_bytes;
+    int bytes;
+    int ref_error;
+    int error;
+
+    buf = (char *) calloc(1, SURFACE_TILES * TILE_BYTES * 2);
+    ref_out = (char *) malloc(CDATA_BYTES);
+    out = (char *) malloc(CDATA_BYTES);
+    if ((buf == 0) || (ref_out == 0) || (out == 0))
+    {
+        g_fails++;
+        free(buf);
+        free(ref_out);
+        free(out);
+        return 1;
+    }
+    for (format = 0; format < NUM_FORMATS; format++)
+    {
+        ref_han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                         g_formats[format],
+                                         flags | RFX_FLAGS_NOACCEL);
+        enc = (struct rfxencode *)
+              rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                     g_formats[format], flags);
+        if ((ref_han == 0) || (enc == 0))
+        {
+            printf("check_streams: create failed\n");
+            g_fails++;
+            rfxcodec_encode_destroy(ref_han);
+            rfxcodec_encode_destroy(enc);
+            continue;
+        }
+        num_encode_variants = get_encode_variants(enc, encode_variants);
+        num_format_variants = get_format_variants(enc, g_formats[format],
+                                                  format_variants);
+        if (g_formats[format] == RFX_FORMAT_YUV)
+        {
+            /* nothing to convert */
+            num_format_variants = 1;
+        }
+        for (first = 0; first < num_corpus; first += SURFACE_TILES)
+        {
+            make_surface(corpus, num_corpus, first, g_formats[format],
+                         buf, &stride_bytes);
+            for (alpha = 0; alpha < 2; alpha++)
+            {
+                ref_error = encode_surface(ref_han, buf, stride_bytes,
+                                           alpha ? RFX_FLAGS_ALPHAV1 : 0,
+                                           ref_out, &ref_bytes);
+                for (encode_variant = 0;
+                     encode_variant < num_encode_variants; encode_variant++)
+                {
+                    for (format_variant = 0;
+                         format_variant < num_format_variants;
+                         format_variant++)
+                    {
+                        enc->rfx_encode = (rfx_encode_proc)
+                            (encode_variants[encode_variant].proc);
+                        if ((g_formats[format] == RFX_FORMAT_NV12) ||
+                            (g_formats[format] == RFX_FORMAT_I420))
+                        {
+                            enc->rfx_yuv420_to_yuv = (rfx_yuv420_to_yuv_proc)
+                                (format_variants[format_variant].proc);
+                        }
+                        else
+                        {
+                            enc->rfx_rgb_to_yuv = (rfx_rgb_to_yuv_proc)
+                                (format_variants[format_variant].proc);
+                        }
+                        error = encode_surface(enc, buf, stride_bytes,
+                                               alpha ? RFX_FLAGS_ALPHAV1 : 0,
+                                               out, &bytes);
+                        g_checks++;
+                        if ((error == ref_error) && (bytes == ref_bytes) &&
+                            (memcmp(out, ref_out, bytes) == 0))
+                        {
+                            continue;
+                        }
+                        g_fails++;
+                        printf("  %s %s %s%s: surface %d differs, error %d "
+                               "should be %d\n", g_format_names[format],
+                               encode_variants[encode_variant].name,
+                               format_variants[format_variant].name,
+                               alpha ? " alpha" : "", first, error,
+                               ref_error);
+                        report_stream(enc->mode,
+                                      (const unsigned char *) ref_out,
+                                      ref_bytes,
+                                      (const unsigned char *) out, bytes);
+                    }
+                }
+            }
+        }
+        printf("check_streams: %s %s, %d rfx_encode and %d format "
+               "functions\n", g_format_names[format],
+               enc->mode == RLGR3 ? "RLGR3" : "RLGR1",
+               num_encode_variants, num_format_variants);
+        rfxcodec_encode_destroy(ref_han);
+        rfxcodec_encode_destroy(enc);
+    }
+    free(buf);
+    free(ref_out);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+/* the corpus as surfaces in each format on 2 and 4 threads, and on 4 with
+   the tile cache, twice so the second time hits it, must give the same
+   bytes as single threaded */
+static int
+check_threads(const unsigned char *corpus, int num_corpus, int flags)
+{
+    static const int threads[] = { 2, 4, 4 };
+    void *ref_han;
+    void *han;
+    char *buf;
+    char *ref_out;
+    char *out;
+    int config;
+    int format;
+    int alpha;
+    int pass;
+    int first;
+    int stride_bytes;
+    int ref_bytes;
+    int bytes;
+    int ref_error;
+    int error;
+    int fails;
+
+    buf = (char *) calloc(1, SURFACE_TILES * TILE_BYTES * 2);
+    ref_out = (char *) malloc(CDATA_BYTES);
+    out = (char *) malloc(CDATA_BYTES);
+    if ((buf == 0) || (ref_out == 0) || (out == 0))
+    {
+        g_fails++;
+        free(buf);
+        free(ref_out);
+        free(out);
+        return 1;
+    }
+    for (config = 0; config < 3; config++)
+    {
+        fails = 0;
+        for (format = 0; format < NUM_FORMATS; format++)
+        {
+            ref_han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                             g_formats[format],
+                                             flags | RFX_FLAGS_QUIET);
+            han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                         g_formats[format],
+                                         flags | RFX_FLAGS_QUIET);
+            if ((ref_han == 0) || (han == 0) ||
+                (rfxcodec_encode_set_threads(han, threads[config]) != 0) ||
+                ((config == 2) &&
+                 (rfxcodec_encode_set_tile_cache(han,
+                                                 64 * 1024 * 1024) != 0)))
+            {
+                printf("check_threads: create failed\n");
+                g_fails++;
+                rfxcodec_encode_destroy(ref_han);
+                rfxcodec_encode_destroy(han);
+                continue;
+            }
+            for (pass = 0; pass < 2; pass++)
+            {
+                for (first = 0; first < num_corpus; first += SURFACE_TILES)
+                {
+                    make_surface(corpus, num_corpus, first,
+                                 g_formats[format], buf, &stride_bytes);
+                    for (alpha = 0; alpha < 2; alpha++)
+                    {
+                        ref_error = encode_surface(ref_han, buf,
+                                                   stride_bytes,
+                                                   alpha ?
+                                                   RFX_FLAGS_ALPHAV1 : 0,
+                                                   ref_out, &ref_bytes);
+                        error = encode_surface(han, buf, stride_bytes,
+                                               alpha ? RFX_FLAGS_ALPHAV1 : 0,
+                                               out, &bytes);
+                        g_checks++;
+                        if ((error == ref_error) && (bytes == ref_bytes) &&
+                            (memcmp(out, ref_out, bytes) == 0))
+                        {
+                            continue;
+                        }
+                        fails++;
+                        printf("  %s %d threads%s%s: surface %d differs, "
+                               "error %d should be %d\n",
+                               g_format_names[format], threads[config],
+                               config == 2 ? " tile cache" : "",
+                               alpha ? " alpha" : "", first, error,
+                               ref_error);
+                        report_stream((flags & RFX_FLAGS_RLGR1) ?
+                                      RLGR1 : RLGR3,
+                                      (const unsigned char *) ref_out,
+                                      ref_bytes,
+                                      (const unsigned char *) out, bytes);
+                    }
+                }
+            }
+            rfxcodec_encode_destroy(ref_han);
+            rfxcodec_encode_destroy(han);
+        }
+        g_fails += fails;
+        printf("check_threads: %s %d threads%s, %d failed\n",
+               (flags & RFX_FLAGS_RLGR1) ? "RLGR1" : "RLGR3",
+               threads[config], config == 2 ? " and the tile cache" : "",
+               fails);
+    }
+    free(buf);
+    free(ref_out);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+/* 1 if an RLGR encoder of the MS-RDPRFX 3.1.8.1.7.3 pseudocode, as
+   rfx_rlgr1_encode and rfx_rlgr3_encode are, ends data in run length mode
+   with a zero, it sends that zero as the value that ends the run, mag - 1
+   of 0, so decoders read a 1 in the last coefficient */
+static int
+rlgr_tail_one(int mode, const sint16 *data)
+{
+    int index;
+    int input;
+    int num_zeros;
+    int runmax;
+    int two_ms1;
+    int two_ms2;
+    int kp;
+    int k;
+
+    kp = 8;
+    k = 1;
+    index = 0;
+    while (index < 4096)
+    {
+        if (k)
+        {
+            num_zeros = 0;
+            input = data[index++];
+            while ((input == 0) && (index < 4096))
+            {
+                num_zeros++;
+                input = data[index++];
+            }
+            if (input == 0)
+            {
+                return 1;
+            }
+            runmax = 1 << k;
+            while (num_zeros >= runmax)
+            {
+                num_zeros -= runmax;
+                kp = MIN(kp + 4, 80);
+                k = kp >> 3;
+                runmax = 1 << k;
+            }
+            kp = MAX(kp - 6, 0);
+        }
+        else if (mode == RLGR1)
+        {
+            two_ms1 = data[index++];
+            kp = two_ms1 != 0 ? MAX(kp - 3, 0) : MIN(kp + 3, 80);
+        }
+        else
+        {
+            two_ms1 = data[index++];
+            two_ms2 = index < 4096 ? data[index++] : 0;
+            if ((two_ms1 != 0) && (two_ms2 != 0))
+            {
+                kp = MAX(kp - 6, 0);
+            }
+            else if ((two_ms1 == 0) && (two_ms2 == 0))
+            {
+                kp = MIN(kp + 6, 80);
+            }
+        }
+        k = kp >> 3;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* MSB first, as rfx_bitstream_put_bits, any number of bits */
+static void
+tail_put(RFX_BITSTREAM *bs, unsigned int value, int num_bits)
+{
+    while (num_bits > 0)
+    {
+        num_bits--;
+        rfx_bitstream_put_bits((*bs), (value >> num_bits) & 1, 1);
+    }
+}
+
+/******************************************************************************/
+/* Golomb Rice code of value, krp as CodeGR updates it */
+static void
+tail_gr(RFX_BITSTREAM *bs, int *krp, unsigned int value)
+{
+    unsigned int vk;
+    int kr;
+
+    kr = *krp >> 3;
+    vk = value >> kr;
+    for (; vk > 0; vk--)
+    {
+        tail_put(bs, 1, 1);
+    }
+    tail_put(bs, 0, 1);
+    tail_put(bs, value & ((1 << kr) - 1), kr);
+    vk = value >> kr;
+    if (vk == 0)
+    {
+        *krp = MAX(*krp - 2, 0);
+    }
+    else if (vk > 1)
+    {
+        *krp = MIN(*krp + (int) vk, 80);
+    }
+}
+
+/******************************************************************************/
+/* RLGR of num_data coefficients from the MS-RDPRFX 3.1.8.1.7.3 pseudocode,
+   for 4096 it must be the same as rfx_rlgr1_encode and rfx_rlgr3_encode,
+   4097 with a 1 after a last zero that is in a run puts the zero in the
+   run and the 1 past the end where decoders drop it */
+static int
+tail_rlgr_encode(int mode, const sint16 *data, int num_data,
+                 uint8 *buffer, int buffer_size)
+{
+    RFX_BITSTREAM bs;
+    unsigned int two_ms1;
+    unsigned int two_ms2;
+    unsigned int sum;
+    int num_bits;
+    int num_zeros;
+    int runmax;
+    int input;
+    int index;
+    int krp;
+    int kp;
+    int k;
+
+    rfx_bitstream_attach(bs, buffer, buffer_size);
+    k = 1;
+    kp = 8;
+    krp = 8;
+    index = 0;
+    while (index < num_data)
+    {
+        if (k)
+        {
+            num_zeros = 0;
+            input = data[index++];
+            while ((input == 0) && (index < num_data))
+            {
+                num_zeros++;
+                input = data[index++];
+            }
+            runmax = 1 << k;
+            while (num_zeros >= runmax)
+            {
+                tail_put(&bs, 0, 1);
+                num_zeros -= runmax;
+                kp = MIN(kp + 4, 80);
+                k = kp >> 3;
+                runmax = 1 << k;
+            }
+            tail_put(&bs, 1, 1);
+            tail_put(&bs, num_zeros, k);
+            tail_put(&bs, input < 0, 1);
+            input = input < 0 ? -input : input;
+            tail_gr(&bs, &krp, input ? input - 1 : 0);
+            kp = MAX(kp - 6, 0);
+        }
+        else if (mode == RLGR1)
+        {
+            input = data[index++];
+            two_ms1 = input >= 0 ? 2 * input : -2 * input - 1;
+            tail_gr(&bs, &krp, two_ms1);
+            kp = two_ms1 != 0 ? MAX(kp - 3, 0) : MIN(kp + 3, 80);
+        }
+        else
+        {
+            input = data[index++];
+            two_ms1 = input >= 0 ? 2 * input : -2 * input - 1;
+            input = index < num_data ? data[index++] : 0;
+            two_ms2 = input >= 0 ? 2 * input : -2 * input - 1;
+            sum = two_ms1 + two_ms2;
+            tail_gr(&bs, &krp, sum);
+            for (num_bits = 0; (sum >> num_bits) != 0; num_bits++)
+            {
+            }
+            tail_put(&bs, two_ms1, num_bits);
+            if ((two_ms1 != 0) && (two_ms2 != 0))
+            {
+                kp = MAX(kp - 6, 0);
+            }
+            else if ((two_ms1 == 0) && (two_ms2 == 0))
+            {
+                kp = MIN(kp + 6, 80);
+            }
+        }
+        k = kp >> 3;
+    }
+    if (bs.bits_left < 8)
+    {
+        rfx_bitstream_put_bits(bs, 0, bs.bits_left);
+    }
+    if (bs.overflow)
+    {
+        return -1;
+    }
+    return rfx_bitstream_get_processed_bytes(bs);
+}
+
+/******************************************************************************/
+/* components that end in zeros, sparse and dense, as the library sends
+   them, a last zero in a run decodes as the 1 rlgr_tail_one says, and with
+   that zero put in the run, the form a fix would send, decode exactly,
+   both with rfx_rlgr1_decode and rfx_rlgr3_decode */
+static int
+check_rlgr_tail(int mode)
+{
+    sint16 data[4097];
+    sint16 diff[4096];
+    sint16 coefs[4096];
+    uint8 *ref_out;
+    uint8 *out;
+    unsigned int seed;
+    int component;
+    int density;
+    int tail_zeros;
+    int index;
+    int ref_bytes;
+    int bytes;
+    int tail_one;
+    int num_tail;
+    int fails;
+
+    ref_out = (uint8 *) malloc(CDATA_BYTES);
+    out = (uint8 *) malloc(CDATA_BYTES);
+    if ((ref_out == 0) || (out == 0))
+    {
+        g_fails++;
+        free(ref_out);
+        free(out);
+        return 1;
+    }
+    seed = 0x7A11;
+    fails = 0;
+    num_tail = 0;
+    for (component = 0; component < 400; component++)
+    {
+        /* percent of nonzero coefficients, then how many zeros end it */
+        density = component < 2 ? 0 : 1 + (component % 50) * 2;
+        tail_zeros = (component / 50) % 4 == 3 ? (component % 5) * 500 :
+                     component % 17;
+        for (index = 0; index < 4096; index++)
+        {
+            data[index] = 0;
+            if ((int) (next_rand(&seed) % 100) < density)
+            {
+                data[index] = (sint16) ((int) (next_rand(&seed) % 41) - 20);
+                data[index] = data[index] == 0 ? 1 : data[index];
+            }
+        }
+        data[0] = component == 1 ? 5 : data[0];
+        for (index = 4096 - tail_zeros; index < 4096; index++)
+        {
+            data[index] = 0;
+        }
+        tail_one = rlgr_tail_one(mode, data);
+        num_tail += tail_one;
+
+        /* the library, plain and diff, and this encoder are the same */
+        if (mode == RLGR1)
+        {
+            ref_bytes = rfx_rlgr1_encode(data, ref_out, CDATA_BYTES);
+        }
+        else
+        {
+            ref_bytes = rfx_rlgr3_encode(data, ref_out, CDATA_BYTES);
+        }
+        bytes = tail_rlgr_encode(mode, data, 4096, out, CDATA_BYTES);
+        g_checks++;
+        if ((ref_bytes < 1) || (bytes != ref_bytes) ||
+            (memcmp(out, ref_out, bytes) != 0))
+        {
+            fails++;
+            printf("  component %d: %d bytes, the library %d\n", component,
+                   bytes, ref_bytes);
+            report_component(mode, ref_out, ref_bytes, out, bytes);
+            continue;
+        }
+        memcpy(diff, data, sizeof(diff));
+        if (mode == RLGR1)
+        {
+            bytes = rfx_encode_diff_rlgr1(diff, out, CDATA_BYTES);
+        }
+        else
+        {
+            bytes = rfx_encode_diff_rlgr3(diff, out, CDATA_BYTES);
+        }
+        memcpy(coefs, data, sizeof(coefs));
+        rfx_differential_encode(coefs + 4032, 64);
+        ref_bytes = tail_rlgr_encode(mode, coefs, 4096, ref_out,
+                                     CDATA_BYTES);
+        g_checks++;
+        if ((bytes != ref_bytes) || (memcmp(out, ref_out, bytes) != 0))
+        {
+            fails++;
+            printf("  component %d: diff %d bytes, should be %d\n",
+                   component, bytes, ref_bytes);
+            continue;
+        }
+
+        /* as sent, the last zero of a run is a 1 */
+        ref_bytes = tail_rlgr_encode(mode, data, 4096, ref_out, CDATA_BYTES);
+        memset(coefs, 0x55, sizeof(coefs));
+        if (mode == RLGR1)
+        {
+            rfx_rlgr1_decode(ref_out, ref_bytes, coefs);
+        }
+        else
+        {
+            rfx_rlgr3_decode(ref_out, ref_bytes, coefs);
+        }
+        g_checks++;
+        if ((memcmp(coefs, data, 4095 * sizeof(sint16)) != 0) ||
+            (coefs[4095] != (tail_one ? 1 : data[4095])))
+        {
+            fails++;
+            printf("  component %d: does not decode as sent, last %d, "
+                   "tail %d\n", component, coefs[4095], tail_one);
+        }
+
+        /* the zero in the run, the 1 that ends it is dropped */
+        data[4096] = 1;
+        bytes = tail_rlgr_encode(mode, data, tail_one ? 4097 : 4096, out,
+                                 CDATA_BYTES);
+        memset(coefs, 0x55, sizeof(coefs));
+        if (mode == RLGR1)
+        {
+            rfx_rlgr1_decode(out, bytes, coefs);
+        }
+        else
+        {
+            rfx_rlgr3_decode(out, bytes, coefs);
+        }
+        g_checks++;
+        if ((bytes < 1) || (memcmp(coefs, data, sizeof(coefs)) != 0) ||
+            (tail_one && (bytes == ref_bytes) &&
+             (memcmp(out, ref_out, bytes) == 0)))
+        {
+            fails++;
+            printf("  component %d: the zero in the run does not decode "
+                   "exactly, %d bytes, as sent %d\n", component, bytes,
+                   ref_bytes);
+        }
+    }
+    /* both ends must have come up */
+    g_checks++;
+    if ((num_tail == 0) || (num_tail == component))
+    {
+        fails++;
+        printf("  %d of %d components end in a run\n", num_tail, component);
+    }
+    g_fails += fails;
+    printf("check_rlgr_tail: %s, %d of %d components end in a run, %d "
+           "failed\n", mode == RLGR1 ? "RLGR1" : "RLGR3", num_tail,
+           component, fails);
+    free(ref_out);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+static int
+prog_get_bits(struct prog_bits *bits, int num_bits)
+{
+    int value;
+    int byte;
+
+    value = 0;
+    while (num_bits > 0)
+    {
+        byte = bits->pos >> 3;
+        value <<= 1;
+        if (byte < bits->bytes)
+        {
+            value |= (bits->data[byte] >> (7 - (bits->pos & 7))) & 1;
+        }
+        bits->pos++;
+        num_bits--;
+    }
+    return value;
+}
+
+/******************************************************************************/
+/* an upgrade value of a coefficient with no sign yet, MS-RDPEGFX
+   3.1.8.1.7.3 SRL */
+static int
+prog_srl_read(struct prog_srl *srl, int num_bits)
+{
+    int k;
+    int sign;
+    int mag;
+    int max;
+
+    if (srl->zeros > 0)
+    {
+        srl->zeros--;
+        return 0;
+    }
+    k = srl->kp / 8;
+    if (srl->mode == 0)
+    {
+        if (prog_get_bits(&(srl->bits), 1) == 0)
+        {
+            /* a full run of 1 << k zeros */
+            srl->zeros = (1 << k) - 1;
+            srl->kp = MIN(srl->kp + 4, 80);
+            return 0;
+        }
+        srl->mode = 1;
+        srl->zeros = k > 0 ? prog_get_bits(&(srl->bits), k) : 0;
+        if (srl->zeros > 0)
+        {
+            srl->zeros--;
+            return 0;
+        }
+    }
+    srl->mode = 0;
+    sign = prog_get_bits(&(srl->bits), 1);
+    srl->kp = MAX(srl->kp - 6, 0);
+    if (num_bits == 1)
+    {
+        return sign ? -1 : 1;
+    }
+    mag = 1;
+    max = (1 << num_bits) - 1;
+    while (mag < max)
+    {
+        if (prog_get_bits(&(srl->bits), 1))
+        {
+            break;
+        }
+        mag++;
+    }
+    return sign ? -mag : mag;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_TILE_SIMPLE or TILE_FIRST */
+static int
+prog_decode_first(const unsigned char *block, int block_bytes, int simple,
+                  const unsigned char *quants, int num_quants,
+                  const unsigned char *prog_quants, int num_prog_quants,
+                  int rem, struct prog_tile *ptile)
+{
+    const unsigned char *data;
+    const unsigned char *prog_vals;
+    sint16 coefs[4096];
+    int header_bytes;
+    int quality;
+    int comp;
+    int band;
+    int index;
+    int offset;
+    int len;
+    int used;
+
+    header_bytes = simple ? 22 : 23;
+    quality = simple ? 0xFF : block[14];
+    if ((block_bytes < header_bytes) ||
+        ((quality != 0xFF) && (quality >= num_prog_quants)))
+    {
+        printf("    bad tile header\n");
+        return 1;
+    }
+    data = block + header_bytes;
+    used = header_bytes;
+    for (comp = 0; comp < 3; comp++)
+    {
+        if (block[6 + comp] >= num_quants)
+        {
+            printf("    bad quant index\n");
+            return 1;
+        }
+        prog_vals = quality == 0xFF ? 0 :
+                    prog_quants + quality * 16 + 1 + comp * 5;
+        len = get_uint16(block + header_bytes - 8 + comp * 2);
+        used += len;
+        if (used > block_bytes)
+        {
+            printf("    component %d longer than its tile\n", comp);
+            return 1;
+        }
+        memset(coefs, 0, sizeof(coefs));
+        rfx_rlgr1_decode(data, len, coefs);
+        data += len;
+        memcpy(ptile->signs[comp], coefs, sizeof(coefs));
+        offset = g_prog_band_offset[rem][PROG_LL3];
+        for (index = 1; index < g_prog_band_count[rem][PROG_LL3]; index++)
+        {
+            coefs[offset + index] += coefs[offset + index - 1];
+        }
+        for (band = 0; band < 10; band++)
+        {
+            ptile->shift[comp][band] = prog_vals == 0 ? 0 :
+                PROG_QUANT(prog_vals, g_prog_band_quant[band]);
+            ptile->first_shift[comp][band] = ptile->shift[comp][band];
+            offset = g_prog_band_offset[rem][band];
+            for (index = 0; index < g_prog_band_count[rem][band]; index++)
+            {
+                ptile->coefs[comp][offset + index] = coefs[offset + index] *
+                    (1 << ptile->shift[comp][band]);
+            }
+        }
+    }
+    ptile->valid = 1;
+    return 0;
+}
+
+/******************************************************************************/
+/* RFX_PROGRESSIVE_TILE_UPGRADE, MS-RDPEGFX 3.1.8.1.7.3 */
+static int
+prog_decode_upgrade(const unsigned char *block, int block_bytes,
+                    const unsigned char *prog_quants, int num_prog_quants,
+                    int rem, struct prog_tile *ptile)
+{
+    const unsigned char *data;
+    const unsigned char *prog_vals;
+    struct prog_srl srl;
+    struct prog_bits raw;
+    sint16 *coefs;
+    sint16 *signs;
+    int quality;
+    int comp;
+    int band;
+    int index;
+    int shift;
+    int num_bits;
+    int srl_len;
+    int raw_len;
+    int used;
+    int value;
+
+    quality = block[13];
+    if ((block_bytes < 26) ||
+        ((quality != 0xFF) && (quality >= num_prog_quants)))
+    {
+        printf("    bad upgrade header\n");
+        return 1;
+    }
+    if (!ptile->valid)
+    {
+        printf("    upgrade of a tile the client does not have\n");
+        return 1;
+    }
+    data = block + 26;
+    used = 26;
+    for (comp = 0; comp < 3; comp++)
+    {
+        prog_vals = quality == 0xFF ? 0 :
+                    prog_quants + quality * 16 + 1 + comp * 5;
+        srl_len = get_uint16(block + 14 + comp * 4);
+        raw_len = get_uint16(block + 14 + comp * 4 + 2);
+        used += srl_len + raw_len;
+        if (used > block_bytes)
+        {
+            printf("    component %d longer than its upgrade\n", comp);
+            return 1;
+        }
+        memset(&srl, 0, sizeof(srl));
+        srl.bits.data = data;
+        srl.bits.bytes = srl_len;
+        srl.kp = 8;
+        raw.data = data + srl_len;
+        raw.bytes = raw_len;
+        raw.pos = 0;
+        data += srl_len + raw_len;
+        for (band = 0; band < 10; band++)
+        {
+            shift = prog_vals == 0 ? 0 :
+                    PROG_QUANT(prog_vals, g_prog_band_quant[band]);
+            num_bits = ptile->shift[comp][band] - shift;
+            ptile->shift[comp][band] = shift;
+            if (num_bits < 0)
+            {
+                printf("    upgrade to a coarser level\n");
+                return 1;
+            }
+            if (num_bits == 0)
+            {
+                continue;
+            }
+            coefs = ptile->coefs[comp] + g_prog_band_offset[rem][band];
+            signs = ptile->signs[comp] + g_prog_band_offset[rem][band];
+            for (index = 0; index < g_prog_band_count[rem][band]; index++)
+            {
+                if ((band == PROG_LL3) || (signs[index] > 0))
+                {
+                    value = prog_get_bits(&raw, num_bits);
+                }
+                else if (signs[index] < 0)
+                {
+                    value = -prog_get_bits(&raw, num_bits);
+                }
+                else
+                {
+                    value = prog_srl_read(&srl, num_bits);
+                    signs[index] = value;
+                }
+                coefs[index] += value * (1 << shift);
+            }
+        }
+        if ((raw.pos + 7) / 8 != raw_len)
+        {
+            printf("    component %d raw is %d bytes, %d used\n", comp,
+                   raw_len, (raw.pos + 7) / 8);
+            return 1;
+        }
+        if ((srl.bits.pos + 7) / 8 > srl_len)
+        {
+            printf("    component %d SRL is %d bytes, %d read\n", comp,
+                   srl_len, (srl.bits.pos + 7) / 8);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* the tiles of a RFX_PROGRESSIVE_REGION */
+static int
+prog_decode_region(const unsigned char *block, int block_len, int rem,
+                   struct prog_tile *tiles)
+{
+    const unsigned char *tile;
+    const unsigned char *quants;
+    const unsigned char *prog_quants;
+    int num_rects;
+    int num_quants;
+    int num_prog_quants;
+    int num_tiles;
+    int tile_data_size;
+    int tile_pos;
+    int tile_type;
+    int tile_len;
+    int x;
+    int y;
+    int count;
+    int error;
+
+    if (block_len < 18)
+    {
+        printf("    short region\n");
+        return 1;
+    }
+    num_rects = get_uint16(block + 7);
+    num_quants = block[9];
+    num_prog_quants = block[10];
+    num_tiles = get_uint16(block + 12);
+    tile_data_size = get_uint32(block + 14);
+    if ((block[6] != 64) || (block[11] != rem))
+    {
+        printf("    region tileSize %d flags %d\n", block[6], block[11]);
+        return 1;
+    }
+    tile_pos = 18 + num_rects * 8 + num_quants * 5 + num_prog_quants * 16;
+    if (tile_pos + tile_data_size != block_len)
+    {
+        printf("    region tileDataSize %d, %d bytes of tiles\n",
+               tile_data_size, block_len - tile_pos);
+        return 1;
+    }
+    quants = block + 18 + num_rects * 8;
+    prog_quants = quants + num_quants * 5;
+    count = 0;
+    while (tile_pos < block_len)
+    {
+        tile = block + tile_pos;
+        if (tile_pos + 13 > block_len)
+        {
+            printf("    short tile\n");
+            return 1;
+        }
+        tile_type = get_uint16(tile);
+        tile_len = get_uint32(tile + 2);
+        x = get_uint16(tile + 9);
+        y = get_uint16(tile + 11);
+        if ((tile_len < 13) || (tile_pos + tile_len > block_len) ||
+            (x >= SURFACE_TILES_X) || (y >= SURFACE_TILES_Y))
+        {
+            printf("    tile 0x%4.4x bad blockLen %d or index %d %d\n",
+                   tile_type, tile_len, x, y);
+            return 1;
+        }
+        tile_pos += tile_len;
+        count++;
+        switch (tile_type)
+        {
+            case PROGRESSIVE_WBT_TILE_SIMPLE:
+            case PROGRESSIVE_WBT_TILE_FIRST:
+                error = prog_decode_first(tile, tile_len,
+                                          tile_type ==
+                                          PROGRESSIVE_WBT_TILE_SIMPLE,
+                                          quants, num_quants, prog_quants,
+                                          num_prog_quants, rem,
+                                          tiles + y * SURFACE_TILES_X + x);
+                break;
+            case PROGRESSIVE_WBT_TILE_UPGRADE:
+                error = prog_decode_upgrade(tile, tile_len, prog_quants,
+                                            num_prog_quants, rem,
+                                            tiles + y * SURFACE_TILES_X + x);
+                break;
+            default:
+                printf("    bad tile 0x%4.4x\n", tile_type);
+                error = 1;
+                break;
+        }
+        if (error != 0)
+        {
+            return 1;
+        }
+    }
+    if (count != num_tiles)
+    {
+        printf("    region numTiles %d, %d tiles\n", num_tiles, count);
+        return 1;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* a RFX_PROGRESSIVE_BITMAP_STREAM into tiles, the block lengths and
+   tileDataSize must add up */
+static int
+prog_decode(const unsigned char *cdata, int bytes, int rem,
+            struct prog_tile *tiles)
+{
+    const unsigned char *block;
+    int pos;
+    int block_type;
+    int block_len;
+
+    pos = 0;
+    while (pos < bytes)
+    {
+        block = cdata + pos;
+        if (pos + 6 > bytes)
+        {
+            printf("    short block\n");
+            return 1;
+        }
+        block_type = get_uint16(block);
+        block_len = get_uint32(block + 2);
+        if ((block_len < 6) || (pos + block_len > bytes))
+        {
+            printf("    block 0x%4.4x bad blockLen %d\n", block_type,
+                   block_len);
+            return 1;
+        }
+        pos += block_len;
+        if (block_type == PROGRESSIVE_WBT_REGION)
+        {
+            if (prog_decode_region(block, block_len, rem, tiles) != 0)
+            {
+                return 1;
+            }
+        }
+        else if ((block_type < PROGRESSIVE_WBT_SYNC) ||
+                 (block_type > PROGRESSIVE_WBT_CONTEXT))
+        {
+            printf("    bad block 0x%4.4x\n", block_type);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* the coefficients of each tile quantized at full quality, what a client
+   has after the last upgrade */
+static int
+prog_reference(const char *buf, int stride_bytes, const char *quant_vals,
+               int rem, sint16 *ref_coefs)
+{
+    struct rfxencode *enc;
+    const uint8 *planes[3];
+    sint16 dwt[4096];
+    sint16 *dst;
+    int tile;
+    int comp;
+    int band;
+    int index;
+    int factor;
+    int half;
+    int value;
+    int x;
+    int y;
+
+    enc = (struct rfxencode *)
+          rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                 RFX_FORMAT_BGRA,
+                                 RFX_FLAGS_NOACCEL | RFX_FLAGS_QUIET);
+    if (enc == 0)
+    {
+        return 1;
+    }
+    for (tile = 0; tile < SURFACE_TILES; tile++)
+    {
+        x = (tile % SURFACE_TILES_X) * 64;
+        y = (tile / SURFACE_TILES_X) * 64;
+        rfx_encode_tile_yuv(enc, buf, x, y, MIN(64, SURFACE_WIDTH - x),
+                            MIN(64, SURFACE_HEIGHT - y), stride_bytes,
+                            planes, planes + 1, planes + 2);
+        for (comp = 0; comp < 3; comp++)
+        {
+            if (rem)
+            {
+                rfx_dwt_2d_encode_rem(planes[comp], dwt, enc->dwt_buffer,
+                                      enc->dwt_buffer2);
+            }
+            else
+            {
+                rfx_dwt_2d_encode(planes[comp], dwt, enc->dwt_buffer);
+            }
+            dst = ref_coefs + (tile * 3 + comp) * 4096;
+            memset(dst, 0, 4096 * sizeof(sint16));
+            for (band = 0; band < 10; band++)
+            {
+                factor = PROG_QUANT(quant_vals, g_prog_band_quant[band]) -
+                         6 + DWT_FACTOR;
+                half = 1 << (factor - 1);
+                for (index = 0; index < g_prog_band_count[rem][band]; index++)
+                {
+                    value = dwt[g_prog_band_offset[rem][band] + index];
+                    if ((band != PROG_LL3) && (value < 0))
+                    {
+                        value = -((half - value) >> factor);
+                    }
+                    else
+                    {
+                        value = (value + half) >> factor;
+                    }
+                    dst[g_prog_band_offset[rem][band] + index] = value;
+                }
+            }
+        }
+    }
+    rfxcodec_encode_destroy(enc);
+    return 0;
+}
+
+/******************************************************************************/
+/* a reference coefficient of band as it is sent at progressive quant
+   shift */
+static int
+prog_drop(int value, int band, int shift)
+{
+    if ((band == PROG_LL3) || (value >= 0))
+    {
+        return value >> shift;
+    }
+    return -((-value) >> shift);
+}
+
+/******************************************************************************/
+/* the tiles as the client has them, the reference is dropped to the level
+   each band is at, LL3 ends in the 1 rlgr_tail_one gives for the first
+   pass */
+static int
+prog_compare(const struct prog_tile *tiles, const sint16 *ref_coefs,
+             int rem, int num_levels, int call)
+{
+    const struct prog_tile *ptile;
+    const sint16 *ref;
+    sint16 first[4096];
+    int tile;
+    int comp;
+    int band;
+    int index;
+    int offset;
+    int shift;
+    int value;
+    int tail;
+
+    for (tile = 0; tile < SURFACE_TILES; tile++)
+    {
+        ptile = tiles + tile;
+        g_checks++;
+        if (!ptile->valid)
+        {
+            g_fails++;
+            printf("  %d levels call %d: tile %d not sent\n", num_levels,
+                   call, tile);
+            return 1;
+        }
+        for (comp = 0; comp < 3; comp++)
+        {
+            ref = ref_coefs + (tile * 3 + comp) * 4096;
+            /* the first pass, LL3 differential, as the encoder had it */
+            for (band = 0; band < 10; band++)
+            {
+                shift = ptile->first_shift[comp][band];
+                offset = g_prog_band_offset[rem][band];
+                for (index = 0; index < g_prog_band_count[rem][band]; index++)
+                {
+                    first[offset + index] = prog_drop(ref[offset + index],
+                                                      band, shift);
+                }
+            }
+            offset = g_prog_band_offset[rem][PROG_LL3];
+            for (index = g_prog_band_count[rem][PROG_LL3] - 1; index > 0;
+                 index--)
+            {
+                first[offset + index] -= first[offset + index - 1];
+            }
+            tail = rlgr_tail_one(RLGR1, first) ?
+                   1 << ptile->first_shift[comp][PROG_LL3] : 0;
+            for (band = 0; band < 10; band++)
+            {
+                shift = ptile->shift[comp][band];
+                offset = g_prog_band_offset[rem][band];
+                for (index = 0; index < g_prog_band_count[rem][band]; index++)
+                {
+                    value = prog_drop(ref[offset + index], band, shift) *
+                            (1 << shift);
+                    if (offset + index == 4095)
+                    {
+                        value += tail;
+                    }
+                    if (ptile->coefs[comp][offset + index] == value)
+                    {
+                        continue;
+                    }
+                    g_fails++;
+                    printf("  %d levels call %d: tile %d component %d "
+                           "coefficient %d, %d should be %d\n", num_levels,
+                           call, tile, comp, offset + index,
+                           ptile->coefs[comp][offset + index], value);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* a surface of the corpus through rfxcodec_encode_progressive, without
+   levels and with, decoded after each call, the tiles must be at the
+   level they were sent at and at full quality after the last upgrade */
+static int
+check_progressive(const unsigned char *corpus, int num_corpus, int flags)
+{
+    static const unsigned char quant_vals[5] =
+    {
+        0x66, 0x66, 0x77, 0x88, 0x98
+    };
+    struct prog_tile *tiles;
+    struct rfx_rect region;
+    struct rfx_rect regions[SURFACE_TILES];
+    struct rfx_tile rtiles[SURFACE_TILES];
+    void *han;
+    char *buf;
+    char *out;
+    sint16 *ref_coefs;
+    int rem;
+    int num_levels;
+    int num_regions;
+    int num_tiles;
+    int stride_bytes;
+    int bytes;
+    int call;
+    int error;
+
+    rem = (flags & RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE) ? 1 : 0;
+    buf = (char *) calloc(1, SURFACE_TILES * TILE_BYTES * 2);
+    out = (char *) malloc(CDATA_BYTES);
+    tiles = (struct prog_tile *)
+            malloc(SURFACE_TILES * sizeof(struct prog_tile));
+    ref_coefs = (sint16 *) malloc(SURFACE_TILES * 3 * 4096 * sizeof(sint16));
+    if ((buf == 0) || (out == 0) || (tiles == 0) || (ref_coefs == 0))
+    {
+        g_fails++;
+        free(buf);
+        free(out);
+        free(tiles);
+        free(ref_coefs);
+        return 1;
+    }
+    make_surface(corpus, num_corpus, 0, RFX_FORMAT_BGRA, buf, &stride_bytes);
+    prog_reference(buf, stride_bytes, (const char *) quant_vals, rem,
+                   ref_coefs);
+    for (num_levels = 0; num_levels <= PROG_NUM_LEVELS;
+         num_levels += PROG_NUM_LEVELS)
+    {
+        han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                     RFX_FORMAT_BGRA,
+                                     flags | RFX_FLAGS_QUIET);
+        if ((han == 0) ||
+            (rfxcodec_encode_set_progressive(han,
+                                             (const char *) g_prog_levels,
+                                             num_levels) != 0))
+        {
+            printf("check_progressive: create failed\n");
+            g_fails++;
+            rfxcodec_encode_destroy(han);
+            continue;
+        }
+        memset(tiles, 0, SURFACE_TILES * sizeof(struct prog_tile));
+        region.x = 0;
+        region.y = 0;
+        region.cx = SURFACE_WIDTH;
+        region.cy = SURFACE_HEIGHT;
+        rfxcodec_encode_damage(han, &region, 1, regions, &num_regions,
+                               rtiles, &num_tiles);
+        /* the tiles, then an upgrade for each level */
+        for (call = 0; call <= num_levels; call++)
+        {
+            bytes = CDATA_BYTES;
+            if (call == 0)
+            {
+                error = rfxcodec_encode_progressive(han, out, &bytes, buf,
+                                                    SURFACE_WIDTH,
+                                                    SURFACE_HEIGHT,
+                                                    stride_bytes,
+                                                    regions, num_regions,
+                                                    rtiles, num_tiles,
+                                                    (const char *) quant_vals,
+                                                    1, 0);
+            }
+            else
+            {
+                error = rfxcodec_encode_progressive(han, out, &bytes, buf,
+                                                    SURFACE_WIDTH,
+                                                    SURFACE_HEIGHT,
+                                                    stride_bytes, 0, 0, 0, 0,
+                                                    (const char *) quant_vals,
+                                                    1, 0);
+            }
+            g_checks++;
+            if ((error != 0) ||
+                (prog_decode((const unsigned char *) out, bytes, rem,
+                             tiles) != 0))
+            {
+                g_fails++;
+                printf("  %d levels call %d: error %d or bad stream\n",
+                       num_levels, call, error);
+                break;
+            }
+            if (prog_compare(tiles, ref_coefs, rem, num_levels, call) != 0)
+            {
+                break;
+            }
+        }
+        g_checks++;
+        if (rfxcodec_encode_progressive_pending(han) != 0)
+        {
+            g_fails++;
+            printf("  %d levels: tiles still to get better\n", num_levels);
+        }
+        rfxcodec_encode_destroy(han);
+    }
+    printf("check_progressive: %s, 0 and %d levels\n",
+           rem ? "reduce extrapolate DWT" : "DWT", PROG_NUM_LEVELS);
+    free(buf);
+    free(out);
+    free(tiles);
+    free(ref_coefs);
+    return 0;
+}
+
+/******************************************************************************/
+/* a BGRA surface, flat or noise */
+static void
+make_rate_surface(int noise, unsigned int *seed, char *buf)
+{
+    int index;
+
+    for (index = 0; index < SURFACE_WIDTH * SURFACE_HEIGHT * 4; index++)
+    {
+        buf[index] = noise ? (char) next_rand(seed) : (char) 0x80;
+    }
+}
+
+/******************************************************************************/
+/* rate control, flat then noise surfaces must keep each call under
+   max_frame_bytes, the first noise one too, and with RFX_FLAGS_TILE_HASH
+   a surface that does not change is sent again as the rate allows until
+   it is at the finest level */
+static int
+check_rate(void)
+{
+    struct rfx_rect region;
+    struct rfx_tile tiles[SURFACE_TILES];
+    const struct rfx_tile *sent_tiles;
+    void *han;
+    char *buf;
+    char *out;
+    unsigned int seed;
+    int num_regions;
+    int num_tiles;
+    int num_sent;
+    int resent;
+    int call;
+    int bytes;
+    int max_bytes;
+    int error;
+
+    buf = (char *) malloc(SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+    out = (char *) malloc(CDATA_BYTES);
+    if ((buf == 0) || (out == 0))
+    {
+        g_fails++;
+        free(buf);
+        free(out);
+        return 1;
+    }
+    seed = 1;
+    region.x = 0;
+    region.y = 0;
+    region.cx = SURFACE_WIDTH;
+    region.cy = SURFACE_HEIGHT;
+    han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                 RFX_FORMAT_BGRA, RFX_FLAGS_QUIET);
+    if ((han == 0) ||
+        (rfxcodec_encode_set_rate(han, 30 * 6000, 30, 24000) != 0))
+    {
+        printf("check_rate: create failed\n");
+        g_fails++;
+        rfxcodec_encode_destroy(han);
+        free(buf);
+        free(out);
+        return 1;
+    }
+    rfxcodec_encode_damage(han, &region, 1, &region, &num_regions,
+                           tiles, &num_tiles);
+    max_bytes = 0;
+    for (call = 0; call < 40; call++)
+    {
+        /* flat, noise, flat, noise */
+        make_rate_surface((call / 10) & 1, &seed, buf);
+        bytes = CDATA_BYTES;
+        error = rfxcodec_encode(han, out, &bytes, buf, SURFACE_WIDTH,
+                                SURFACE_HEIGHT, SURFACE_WIDTH * 4,
+                                &region, num_regions, tiles, num_tiles,
+                                0, 0);
+        max_bytes = MAX(max_bytes, bytes);
+        g_checks++;
+        if ((error != 0) || (bytes > 24000))
+        {
+            g_fails++;
+            printf("  call %d: error %d, %d bytes, more than 24000\n", call,
+                   error, bytes);
+        }
+    }
+    rfxcodec_encode_destroy(han);
+    printf("check_rate: flat and noise, at most %d bytes of 24000\n",
+           max_bytes);
+    han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                 RFX_FORMAT_BGRA,
+                                 RFX_FLAGS_TILE_HASH | RFX_FLAGS_QUIET);
+    if ((han == 0) || (rfxcodec_encode_set_rate(han, 30 * 20000, 30, 0) != 0))
+    {
+        printf("check_rate: create failed\n");
+        g_fails++;
+        rfxcodec_encode_destroy(han);
+        free(buf);
+        free(out);
+        return 1;
+    }
+    make_rate_surface(1, &seed, buf);
+    resent = 0;
+    num_sent = 0;
+    for (call = 0; call < 100; call++)
+    {
+        bytes = CDATA_BYTES;
+        error = rfxcodec_encode(han, out, &bytes, buf, SURFACE_WIDTH,
+                                SURFACE_HEIGHT, SURFACE_WIDTH * 4,
+                                &region, num_regions, tiles, num_tiles,
+                                0, 0);
+        rfxcodec_encode_get_tiles(han, &sent_tiles, &num_sent);
+        if (call > 0)
+        {
+            resent += num_sent;
+        }
+        g_checks++;
+        if (error != 0)
+        {
+            g_fails++;
+            printf("  unchanged call %d: error %d\n", call, error);
+        }
+    }
+    /* the first call is too big for the finest level, the tiles must
+       have been sent again and be done by now */
+    g_checks++;
+    if ((resent < SURFACE_TILES) || (num_sent != 0))
+    {
+        g_fails++;
+        printf("  unchanged: %d tiles sent again, %d in the last call\n",
+               resent, num_sent);
+    }
+    printf("check_rate: unchanged noise with RFX_FLAGS_TILE_HASH, %d tiles "
+           "sent again\n", resent);
+    rfxcodec_encode_destroy(han);
+    free(buf);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+/* PSNR in tenths of a dB of the BGR, and A, of 2 BGRA surfaces */
+static int
+decode_psnr(const char *ref, const char *got, int channels)
+{
+    double sse;
+    double diff;
+    int index;
+    int chan;
+
+    sse = 0;
+    for (index = 0; index < SURFACE_WIDTH * SURFACE_HEIGHT; index++)
+    {
+        for (chan = 0; chan < channels; chan++)
+        {
+            diff = (unsigned char) ref[index * 4 + chan];
+            diff -= (unsigned char) got[index * 4 + chan];
+            sse += diff * diff;
+        }
+    }
+    if (sse == 0)
+    {
+        return 1000;
+    }
+    sse /= (double) SURFACE_WIDTH * SURFACE_HEIGHT * channels;
+    return (int) (100.0 * log10(255.0 * 255.0 / sse));
+}
+
+/******************************************************************************/
+/* what a solid tile of BGRA colour decodes to at the default quant, RGB to
+   YCbCr with 8 bit planes does not give every colour back */
+static unsigned int
+solid_decoded(unsigned int colour, int with_alpha)
+{
+    int r, g, b;
+    int y, u, v;
+    int yy;
+
+    r = (colour >> 16) & 0xFF;
+    g = (colour >> 8) & 0xFF;
+    b = colour & 0xFF;
+    /* rfx_encode_solid */
+    y = (r *  19595 + g *  38470 + b *   7471) >> 16;
+    u = (r * -11071 + g * -21736 + b *  32807) >> 16;
+    v = (r *  32756 + g * -27429 + b *  -5327) >> 16;
+    y = MINMAX(y, 0, 255) - 128;
+    u = MINMAX(u + 128, 0, 255) - 128;
+    v = MINMAX(v + 128, 0, 255) - 128;
+    /* LL3 quant 6, then rfx_decode_yuv_to_rgb */
+    yy = (y << DWT_FACTOR) * 16384 + (128 << (14 + DWT_FACTOR)) +
+         (1 << (13 + DWT_FACTOR));
+    r = (yy + (v << DWT_FACTOR) * 22979) >> (14 + DWT_FACTOR);
+    g = (yy + (u << DWT_FACTOR) * -5632 + (v << DWT_FACTOR) * -11704) >>
+        (14 + DWT_FACTOR);
+    b = (yy + (u << DWT_FACTOR) * 28998) >> (14 + DWT_FACTOR);
+    r = MINMAX(r, 0, 255);
+    g = MINMAX(g, 0, 255);
+    b = MINMAX(b, 0, 255);
+    return (with_alpha ? colour & 0xFF000000 : 0xFF000000) |
+           (r << 16) | (g << 8) | b;
+}
+
+/******************************************************************************/
+/* 0 if got is the solid_decoded surface ref, the differential LL3 of a
+   solid tile ends in zeros and run length mode, so decoders read a 1 in
+   the last LL3 coefficient, see rlgr_tail_one, the bottom right 16x16 of
+   a tile it reaches can be a level of Y, Cb and Cr off, at most 3 in B,
+   G and R */
+static int
+solid_compare(const char *ref, const char *got)
+{
+    int diff;
+    int index;
+    int limit;
+    int x;
+    int y;
+
+    for (y = 0; y < SURFACE_HEIGHT; y++)
+    {
+        for (x = 0; x < SURFACE_WIDTH; x++)
+        {
+            limit = ((x % 64) >= 48) && ((y % 64) >= 48) ? 3 : 0;
+            for (index = 0; index < 4; index++)
+            {
+                diff = (unsigned char) ref[(y * SURFACE_WIDTH + x) * 4 +
+                                           index];
+                diff -= (unsigned char) got[(y * SURFACE_WIDTH + x) * 4 +
+                                            index];
+                if ((diff < -limit) || (diff > limit) ||
+                    ((index == 3) && (diff != 0)))
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* encode a surface, decode it with rfxcodec_decode, solid tiles must come
+   back as solid_decoded gives, the corpus at least DECODE_MIN_PSNR */
+static int
+check_decode(const unsigned char *corpus, int num_corpus, int flags,
+             int encode_flags)
+{
+    void *enc;
+    void *dec;
+    char *buf;
+    char *ref;
+    char *out;
+    char *cdata;
+    unsigned int colour;
+    int with_alpha;
+    int stride_bytes;
+    int cdata_bytes;
+    int surface;
+    int psnr;
+    int error;
+    int x;
+    int y;
+
+    buf = (char *) malloc(SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+    ref = (char *) malloc(SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+    out = (char *) malloc(SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+    cdata = (char *) malloc(CDATA_BYTES);
+    enc = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                 RFX_FORMAT_BGRA, flags | RFX_FLAGS_QUIET);
+    dec = 0;
+    rfxcodec_decode_create(SURFACE_WIDTH, SURFACE_HEIGHT, RFX_FORMAT_BGRA,
+                           flags | RFX_FLAGS_QUIET, &dec);
+    if ((buf == 0) || (ref == 0) || (out == 0) || (cdata == 0) ||
+        (enc == 0) || (dec == 0))
+    {
+        printf("check_decode: create failed\n");
+        g_fails++;
+        rfxcodec_encode_destroy(enc);
+        rfxcodec_decode_destroy(dec);
+        free(buf);
+        free(ref);
+        free(out);
+        free(cdata);
+        return 1;
+    }
+    /* without alpha the decoder sets it to 0xFF */
+    with_alpha = (encode_flags & RFX_FLAGS_ALPHAV1) != 0;
+    /* the corpus, then solid tiles, a colour each */
+    for (surface = 0; surface < 2 + NUM_SOLID_COLOURS; surface++)
+    {
+        if (surface < 2)
+        {
+            make_surface(corpus, num_corpus, surface * 5,
+                         RFX_FORMAT_BGRA, buf, &stride_bytes);
+        }
+        else
+        {
+            stride_bytes = SURFACE_WIDTH * 4;
+            for (y = 0; y < SURFACE_HEIGHT; y++)
+            {
+                for (x = 0; x < SURFACE_WIDTH; x++)
+                {
+                    colour = g_solid_colours[(surface + (y / 64) *
+                                              SURFACE_TILES_X + x / 64) %
+                                             NUM_SOLID_COLOURS];
+                    ((unsigned int *) buf)[y * SURFACE_WIDTH + x] = colour;
+                    ((unsigned int *) ref)[y * SURFACE_WIDTH + x] =
+                        solid_decoded(colour, with_alpha);
+                }
+            }
+        }
+        memset(out, 0, SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+        error = encode_surface(enc, buf, stride_bytes, encode_flags,
+                               cdata, &cdata_bytes);
+        if (error == 0)
+        {
+            error = rfxcodec_decode(dec, cdata, cdata_bytes, out,
+                                    SURFACE_WIDTH, SURFACE_HEIGHT,
+                                    SURFACE_WIDTH * 4);
+        }
+        g_checks++;
+        if (surface < 2)
+        {
+            psnr = decode_psnr(buf, out, with_alpha ? 4 : 3);
+            if ((error != 0) || (psnr < DECODE_MIN_PSNR))
+            {
+                g_fails++;
+            }
+            printf("check_decode: %s%s corpus surface %d, error %d, "
+                   "psnr %d.%d\n",
+                   (flags & RFX_FLAGS_RLGR1) ? "RLGR1" : "RLGR3",
+                   with_alpha ? " alpha" : "", surface, error,
+                   psnr / 10, psnr % 10);
+        }
+        else if ((error != 0) || (solid_compare(ref, out) != 0))
+        {
+            g_fails++;
+            printf("  %s%s solid surface %d: error %d, not the colours of "
+                   "solid_decoded\n",
+                   (flags & RFX_FLAGS_RLGR1) ? "RLGR1" : "RLGR3",
+                   with_alpha ? " alpha" : "", surface, error);
+        }
+    }
+    rfxcodec_encode_destroy(enc);
+    rfxcodec_decode_destroy(dec);
+    free(buf);
+    free(ref);
+    free(out);
+    free(cdata);
+    return 0;
+}
+
+/******************************************************************************/
+/* 1 if a pixel of the tile at x, y is marked */
+static int
+damage_touched(const unsigned char *mask, int x, int y)
+{
+    int x1;
+    int y1;
+
+    for (y1 = y; y1 < (MIN(y + 64, DAMAGE_HEIGHT)); y1++)
+    {
+        for (x1 = x; x1 < (MIN(x + 64, DAMAGE_WIDTH)); x1++)
+        {
+            if (mask[y1 * DAMAGE_WIDTH + x1])
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* mark the pixels of rects clipped to the damage surface */
+static void
+damage_mark(const struct rfx_rect *rects, int num_rects, unsigned char *mask)
+{
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+    int y;
+
+    for (; num_rects > 0; rects++, num_rects--)
+    {
+        x1 = MAX(rects->x, 0);
+        y1 = MAX(rects->y, 0);
+        x2 = MIN(rects->x + rects->cx, DAMAGE_WIDTH);
+        y2 = MIN(rects->y + rects->cy, DAMAGE_HEIGHT);
+        for (y = y1; y < y2; y++)
+        {
+            if (x2 > x1)
+            {
+                memset(mask + y * DAMAGE_WIDTH + x1, 1, x2 - x1);
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/* random damage, overlapping and past the surface, small rects, bars that
+   cross, the regions of rfxcodec_encode_damage must cover the same pixels
+   and the tiles be each tile with a damaged pixel, in order */
+static int
+check_damage(void)
+{
+    struct rfx_rect *damage;
+    struct rfx_rect *regions;
+    struct rfx_tile *tiles;
+    const struct rfx_tile *tile;
+    unsigned char *ref;
+    unsigned char *got;
+    void *han;
+    unsigned int seed;
+    int num_damage;
+    int num_regions;
+    int num_tiles;
+    int test;
+    int index;
+    int fails;
+    int size;
+    int error;
+    int x;
+    int y;
+
+    damage = (struct rfx_rect *) malloc(DAMAGE_RECTS *
+                                        sizeof(struct rfx_rect));
+    regions = (struct rfx_rect *) malloc(DAMAGE_RECTS *
+                                         sizeof(struct rfx_rect));
+    tiles = (struct rfx_tile *) malloc(DAMAGE_TILES *
+                                       sizeof(struct rfx_tile));
+    ref = (unsigned char *) malloc(DAMAGE_WIDTH * DAMAGE_HEIGHT);
+    got = (unsigned char *) malloc(DAMAGE_WIDTH * DAMAGE_HEIGHT);
+    han = rfxcodec_encode_create(DAMAGE_WIDTH, DAMAGE_HEIGHT,
+                                 RFX_FORMAT_BGRA, RFX_FLAGS_QUIET);
+    if ((damage == 0) || (regions == 0) || (tiles == 0) || (ref == 0) ||
+        (got == 0) || (han == 0))
+    {
+        printf("check_damage: create failed\n");
+        g_fails++;
+        rfxcodec_encode_destroy(han);
+        free(damage);
+        free(regions);
+        free(tiles);
+        free(ref);
+        free(got);
+        return 1;
+    }
+    seed = 1;
+    fails = 0;
+    for (test = 0; test < 40; test++)
+    {
+        /* none, up to 300 of any size, up to DAMAGE_RECTS small ones,
+           then crossing bars */
+        num_damage = test == 0 ? 0 : next_rand(&seed) % 300 + 1;
+        size = 400;
+        if ((test % 4) == 1)
+        {
+            num_damage = next_rand(&seed) % DAMAGE_RECTS + 1;
+            size = 24;
+        }
+        for (index = 0; index < num_damage; index++)
+        {
+            damage[index].x = next_rand(&seed) % (DAMAGE_WIDTH + 200) - 100;
+            damage[index].y = next_rand(&seed) % (DAMAGE_HEIGHT + 200) - 100;
+            damage[index].cx = next_rand(&seed) % size;
+            damage[index].cy = next_rand(&seed) % size;
+        }
+        if ((test % 4) == 3)
+        {
+            num_damage = 2 * 20;
+            for (index = 0; index < 20; index++)
+            {
+                damage[index].x = -10;
+                damage[index].y = index * 33 + test;
+                damage[index].cx = DAMAGE_WIDTH + 20;
+                damage[index].cy = 5 + index % 3;
+                damage[20 + index].x = index * 47 + test;
+                damage[20 + index].y = -10;
+                damage[20 + index].cx = 3 + index % 4;
+                damage[20 + index].cy = DAMAGE_HEIGHT + 20;
+            }
+        }
+        error = rfxcodec_encode_damage(han, damage, num_damage,
+                                       regions, &num_regions,
+                                       tiles, &num_tiles);
+        memset(ref, 0, DAMAGE_WIDTH * DAMAGE_HEIGHT);
+        memset(got, 0, DAMAGE_WIDTH * DAMAGE_HEIGHT);
+        damage_mark(damage, num_damage, ref);
+        g_checks++;
+        if ((error != 0) || (num_regions < 0) ||
+            (num_regions > num_damage))
+        {
+            fails++;
+            printf("  test %d: error %d, %d regions for %d damage rects\n",
+                   test, error, num_regions, num_damage);
+            continue;
+        }
+        for (index = 0; index < num_regions; index++)
+        {
+            if ((regions[index].x < 0) || (regions[index].y < 0) ||
+                (regions[index].cx < 1) || (regions[index].cy < 1) ||
+                (regions[index].x + regions[index].cx > DAMAGE_WIDTH) ||
+                (regions[index].y + regions[index].cy > DAMAGE_HEIGHT))
+            {
+                break;
+            }
+        }
+        damage_mark(regions, num_regions, got);
+        if ((index < num_regions) ||
+            (memcmp(ref, got, DAMAGE_WIDTH * DAMAGE_HEIGHT) != 0))
+        {
+            fails++;
+            printf("  test %d: %d damage rects, the %d regions are not "
+                   "their union\n", test, num_damage, num_regions);
+            continue;
+        }
+        /* the tiles with a damaged pixel, top to bottom, left to right */
+        index = 0;
+        for (y = 0; y < DAMAGE_HEIGHT; y += 64)
+        {
+            for (x = 0; x < DAMAGE_WIDTH; x += 64)
+            {
+                if (damage_touched(ref, x, y) == 0)
+                {
+                    continue;
+                }
+                tile = tiles + index;
+                if ((index >= num_tiles) || (tile->x != x) ||
+                    (tile->y != y) ||
+                    (tile->cx != (MIN(64, DAMAGE_WIDTH - x))) ||
+                    (tile->cy != (MIN(64, DAMAGE_HEIGHT - y))) ||
+                    (tile->quant_y != 0) || (tile->quant_cb != 0) ||
+                    (tile->quant_cr != 0))
+                {
+                    index = -1;
+                    break;
+                }
+                index++;
+            }
+            if (index < 0)
+            {
+                break;
+            }
+        }
+        if (index != num_tiles)
+        {
+            fails++;
+            printf("  test %d: %d damage rects, the %d tiles are not the "
+                   "damaged ones\n", test, num_damage, num_tiles);
+        }
+    }
+    g_fails += fails;
+    printf("check_damage: %d damage sets, %d failed\n", test, fails);
+    rfxcodec_encode_destroy(han);
+    free(damage);
+    free(regions);
+    free(tiles);
+    free(ref);
+    free(got);
+    return 0;
+}
+
+/******************************************************************************/
+/* each call into one byte less than a fresh encoder needs must give
+   RFX_ERROR_OVERFLOW and leave the encoder as it was, the call again
+   with rfxcodec_encode_bound bytes must give what the fresh one did, with
+   RFX_FLAGS_TILE_HASH and rate control on and off */
+static int
+check_overflow(const unsigned char *corpus, int num_corpus)
+{
+    static const int firsts[] = { 0, 0, 3, 3, 3, 7, 7, 7 };
+    struct rfx_rect region;
+    struct rfx_tile tiles[SURFACE_TILES];
+    void *ref_han;
+    void *han;
+    char *buf;
+    char *ref_out;
+    char *out;
+    int config;
+    int call;
+    int flags;
+    int stride_bytes;
+    int num_regions;
+    int num_tiles;
+    int ref_bytes;
+    int bytes;
+    int bound;
+    int ref_error;
+    int error;
+    int fails;
+
+    buf = (char *) calloc(1, SURFACE_TILES * TILE_BYTES * 2);
+    ref_out = (char *) malloc(CDATA_BYTES);
+    out = (char *) malloc(CDATA_BYTES);
+    if ((buf == 0) || (ref_out == 0) || (out == 0))
+    {
+        g_fails++;
+        free(buf);
+        free(ref_out);
+        free(out);
+        return 1;
+    }
+    region.x = 0;
+    region.y = 0;
+    region.cx = SURFACE_WIDTH;
+    region.cy = SURFACE_HEIGHT;
+    /* 1 is the tile hash, 2 rate control */
+    for (config = 0; config < 4; config++)
+    {
+        flags = RFX_FLAGS_QUIET | ((config & 1) ? RFX_FLAGS_TILE_HASH : 0);
+        ref_han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                         RFX_FORMAT_BGRA, flags);
+        han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                     RFX_FORMAT_BGRA, flags);
+        if ((ref_han == 0) || (han == 0) ||
+            ((config & 2) &&
+             ((rfxcodec_encode_set_rate(ref_han, 30 * 8000, 30, 0) != 0) ||
+              (rfxcodec_encode_set_rate(han, 30 * 8000, 30, 0) != 0))))
+        {
+            printf("check_overflow: create failed\n");
+            g_fails++;
+            rfxcodec_encode_destroy(ref_han);
+            rfxcodec_encode_destroy(han);
+            continue;
+        }
+        rfxcodec_encode_damage(han, &region, 1, &region, &num_regions,
+                               tiles, &num_tiles);
+        fails = 0;
+        for (call = 0; call < (int) (sizeof(firsts) / sizeof(firsts[0]));
+             call++)
+        {
+            make_surface(corpus, num_corpus, firsts[call], RFX_FORMAT_BGRA,
+                         buf, &stride_bytes);
+            ref_bytes = CDATA_BYTES;
+            ref_error = rfxcodec_encode(ref_han, ref_out, &ref_bytes, buf,
+                                        SURFACE_WIDTH, SURFACE_HEIGHT,
+                                        stride_bytes, &region, num_regions,
+                                        tiles, num_tiles, 0, 0);
+            bytes = ref_bytes - 1;
+            error = rfxcodec_encode(han, out, &bytes, buf,
+                                    SURFACE_WIDTH, SURFACE_HEIGHT,
+                                    stride_bytes, &region, num_regions,
+                                    tiles, num_tiles, 0, 0);
+            g_checks++;
+            if ((ref_error != 0) || (error != RFX_ERROR_OVERFLOW))
+            {
+                fails++;
+                printf("  config %d call %d: error %d, one byte short "
+                       "error %d\n", config, call, ref_error, error);
+            }
+            bound = rfxcodec_encode_bound(han, num_tiles, num_regions, 0, 0);
+            bytes = bound;
+            error = rfxcodec_encode(han, out, &bytes, buf,
+                                    SURFACE_WIDTH, SURFACE_HEIGHT,
+                                    stride_bytes, &region, num_regions,
+                                    tiles, num_tiles, 0, 0);
+            g_checks++;
+            if ((error == 0) && (bound >= ref_bytes) &&
+                (bytes == ref_bytes) &&
+                (memcmp(out, ref_out, bytes) == 0))
+            {
+                continue;
+            }
+            fails++;
+            printf("  config %d call %d: again into %d bytes, error %d, %d "
+                   "bytes, should be %d\n", config, call, bound, error,
+                   bytes, ref_bytes);
+            if (error == 0)
+            {
+                report_stream(RLGR3, (const unsigned char *) ref_out,
+                              ref_bytes, (const unsigned char *) out, bytes);
+            }
+        }
+        g_fails += fails;
+        printf("check_overflow:%s%s, %d failed\n",
+               (config & 1) ? " tile hash" : "",
+               (config & 2) ? " rate control" : " no rate control", fails);
+        rfxcodec_encode_destroy(ref_han);
+        rfxcodec_encode_destroy(han);
+    }
+    free(buf);
+    free(ref_out);
+    free(out);
+    return 0;
+}
+
+/******************************************************************************/
+#define SINK_CHUNKS (SURFACE_TILES + 1)
+
+/* what a sink got, the sink fails on chunk fail_chunk */
+struct sink_out
+{
+    char *data;
+    int bytes;
+    int max_bytes;
+    int chunks;
+    int fail_chunk;
+    int chunk_ends[SINK_CHUNKS];
+};
+
+/******************************************************************************/
+static int
+sink_proc(void *user, const char *data, int bytes)
+{
+    struct sink_out *so;
+
+    so = (struct sink_out *) user;
+    if ((so->chunks == so->fail_chunk) || (so->chunks >= SINK_CHUNKS) ||
+        (bytes < 1) || (so->bytes + bytes > so->max_bytes))
+    {
+        return 1;
+    }
+    memcpy(so->data + so->bytes, data, bytes);
+    so->bytes += bytes;
+    so->chunk_ends[so->chunks] = so->bytes;
+    so->chunks++;
+    return 0;
+}
+
+/******************************************************************************/
+#define BATCH_JOBS 4
+
+/* jobs of rfxcodec_encode_batch, handle itself is the first, must give the
+   same bytes as rfxcodec_encode_ex on encoders made the same way, handles
+   in jobs twice or 0 must be turned away without a change, the last job
+   handle has a sink */
+static int
+check_batch(const unsigned char *corpus, int num_corpus)
+{
+    static const int formats[BATCH_JOBS] =
+    {
+        RFX_FORMAT_BGRA, RFX_FORMAT_RGB, RFX_FORMAT_NV12, RFX_FORMAT_BGRA
+    };
+    static const int create_flags[BATCH_JOBS] =
+    {
+        RFX_FLAGS_RLGR3, RFX_FLAGS_RLGR1, RFX_FLAGS_RLGR3 | RFX_FLAGS_TILE_HASH,
+        RFX_FLAGS_RLGR1 | RFX_FLAGS_TILE_HASH
+    };
+    static const int firsts[] = { 0, 3, 3, 7, 7 };
+    struct rfx_encode_job jobs[BATCH_JOBS];
+    struct rfx_rect region;
+    struct rfx_tile tiles[SURFACE_TILES];
+    struct sink_out so[2];
+    void *hans[BATCH_JOBS];
+    void *ref_hans[BATCH_JOBS];
+    char *bufs[BATCH_JOBS];
+    char *outs[BATCH_JOBS];
+    char *ref_out;
+    void *han;
+    int stride_bytes[BATCH_JOBS];
+    int threads;
+    int call;
+    int job;
+    int num_regions;
+    int num_tiles;
+    int ref_bytes;
+    int ref_error;
+    int error;
+    int fails;
+
+    memset(bufs, 0, sizeof(bufs));
+    memset(outs, 0, sizeof(outs));
+    ref_out = (char *) malloc(CDATA_BYTES);
+    so[0].data = (char *) malloc(CDATA_BYTES);
+    so[1].data = (char *) malloc(CDATA_BYTES);
+    error = (ref_out == 0) || (so[0].data == 0) || (so[1].data == 0);
+    for (job = 0; job < BATCH_JOBS; job++)
+    {
+        bufs[job] = (char *) calloc(1, SURFACE_TILES * TILE_BYTES * 2);
+        outs[job] = (char *) malloc(CDATA_BYTES);
+        error |= (bufs[job] == 0) || (outs[job] == 0);
+    }
+    if (error)
+    {
+        g_fails++;
+        error = 1;
+    }
+    region.x = 0;
+    region.y = 0;
+    region.cx = SURFACE_WIDTH;
+    region.cy = SURFACE_HEIGHT;
+    for (threads = 0; (error == 0) && (threads <= 4); threads += 4)
+    {
+        memset(hans, 0, sizeof(hans));
+        memset(ref_hans, 0, sizeof(ref_hans));
+        for (job = 0; job < BATCH_JOBS; job++)
+        {
+            hans[job] = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                               formats[job],
+                                               create_flags[job] |
+                                               RFX_FLAGS_QUIET);
+            ref_hans[job] = rfxcodec_encode_create(SURFACE_WIDTH,
+                                                   SURFACE_HEIGHT,
+                                                   formats[job],
+                                                   create_flags[job] |
+                                                   RFX_FLAGS_QUIET);
+            if ((hans[job] == 0) || (ref_hans[job] == 0))
+            {
+                error = 1;
+            }
+        }
+        han = hans[0];
+        if ((error == 0) && (threads != 0) &&
+            ((rfxcodec_encode_set_threads(han, threads) != 0) ||
+             (rfxcodec_encode_set_threads(ref_hans[0], threads) != 0)))
+        {
+            error = 1;
+        }
+        if ((error == 0) &&
+            ((rfxcodec_encode_set_sink(hans[BATCH_JOBS - 1], sink_proc,
+                                       so, 5) != 0) ||
+             (rfxcodec_encode_set_sink(ref_hans[BATCH_JOBS - 1], sink_proc,
+                                       so + 1, 5) != 0)))
+        {
+            error = 1;
+        }
+        if (error != 0)
+        {
+            printf("check_batch: create failed\n");
+            g_fails++;
+        }
+        else
+        {
+            rfxcodec_encode_damage(han, &region, 1, &region, &num_regions,
+                                   tiles, &num_tiles);
+        }
+        fails = 0;
+        for (call = 0; (error == 0) &&
+             (call < (int) (sizeof(firsts) / sizeof(firsts[0]))); call++)
+        {
+            for (job = 0; job < BATCH_JOBS; job++)
+            {
+                make_surface(corpus, num_corpus, firsts[call] + job,
+                             formats[job], bufs[job], stride_bytes + job);
+                jobs[job].handle = hans[job];
+                jobs[job].cdata = outs[job];
+                jobs[job].cdata_bytes = CDATA_BYTES;
+                jobs[job].buf = bufs[job];
+                jobs[job].width = SURFACE_WIDTH;
+                jobs[job].height = SURFACE_HEIGHT;
+                jobs[job].stride_bytes = stride_bytes[job];
+                jobs[job].regions = &region;
+                jobs[job].num_regions = num_regions;
+                jobs[job].tiles = tiles;
+                jobs[job].num_tiles = num_tiles;
+                jobs[job].quants = 0;
+                jobs[job].num_quants = 0;
+                jobs[job].flags = (call & 1) ? RFX_FLAGS_ALPHAV1 : 0;
+                jobs[job].error = -1;
+            }
+            if (call == 2)
+            {
+                /* turned away before any job is touched */
+                jobs[2].handle = hans[1];
+                g_checks++;
+                if (rfxcodec_encode_batch(han, jobs, BATCH_JOBS) != 1)
+                {
+                    fails++;
+                    printf("  %d threads: a handle twice not turned away\n",
+                           threads);
+                }
+                jobs[2].handle = 0;
+                g_checks++;
+                if (rfxcodec_encode_batch(han, jobs, BATCH_JOBS) != 1)
+                {
+                    fails++;
+                    printf("  %d threads: a handle of 0 not turned away\n",
+                           threads);
+                }
+                jobs[2].handle = hans[2];
+            }
+            for (job = 0; job < 2; job++)
+            {
+                so[job].bytes = 0;
+                so[job].max_bytes = CDATA_BYTES;
+                so[job].chunks = 0;
+                so[job].fail_chunk = -1;
+            }
+            g_checks++;
+            if (rfxcodec_encode_batch(han, jobs, BATCH_JOBS) != 0)
+            {
+                fails++;
+                printf("  %d threads call %d: batch failed\n", threads, call);
+                continue;
+            }
+            for (job = 0; job < BATCH_JOBS; job++)
+            {
+                ref_bytes = CDATA_BYTES;
+                ref_error = rfxcodec_encode_ex(ref_hans[job], ref_out,
+                                               &ref_bytes, bufs[job],
+                                               SURFACE_WIDTH, SURFACE_HEIGHT,
+                                               stride_bytes[job], &region,
+                                               num_regions, tiles, num_tiles,
+                                               0, 0, jobs[job].flags);
+                g_checks++;
+                if (job == BATCH_JOBS - 1)
+                {
+                    /* the sinks got it, cdata is work space */
+                    if ((jobs[job].error == ref_error) &&
+                        (jobs[job].cdata_bytes == ref_bytes) &&
+                        (so[0].bytes == ref_bytes) &&
+                        (so[1].bytes == ref_bytes) &&
+                        (so[0].chunks == so[1].chunks) &&
+                        (memcmp(so[0].data, so[1].data, ref_bytes) == 0))
+                    {
+                        continue;
+                    }
+                    fails++;
+                    printf("  %d threads call %d: sink job error %d should "
+                           "be %d, %d bytes in %d chunks should be %d in "
+                           "%d\n", threads, call, jobs[job].error, ref_error,
+                           so[0].bytes, so[0].chunks, so[1].bytes,
+                           so[1].chunks);
+                    continue;
+                }
+                if ((jobs[job].error == ref_error) &&
+                    (jobs[job].cdata_bytes == ref_bytes) &&
+                    (memcmp(outs[job], ref_out, ref_bytes) == 0))
+                {
+                    continue;
+                }
+                fails++;
+                printf("  %d threads call %d: job %d error %d should be %d, "
+                       "%d bytes should be %d\n", threads, call, job,
+                       jobs[job].error, ref_error, jobs[job].cdata_bytes,
+                       ref_bytes);
+                if ((ref_error == 0) && (jobs[job].error == 0))
+                {
+                    report_stream((create_flags[job] & RFX_FLAGS_RLGR1) ?
+                                  RLGR1 : RLGR3,
+                                  (const unsigned char *) ref_out, ref_bytes,
+                                  (const unsigned char *) outs[job],
+                                  jobs[job].cdata_bytes);
+                }
+            }
+        }
+        if (error == 0)
+        {
+            g_fails += fails;
+            printf("check_batch: %d threads, %d failed\n", threads, fails);
+        }
+        for (job = 0; job < BATCH_JOBS; job++)
+        {
+            rfxcodec_encode_destroy(hans[job]);
+            rfxcodec_encode_destroy(ref_hans[job]);
+        }
+    }
+    for (job = 0; job < BATCH_JOBS; job++)
+    {
+        free(bufs[job]);
+        free(outs[job]);
+    }
+    free(ref_out);
+    free(so[0].data);
+    free(so[1].data);
+    return error;
+}
+
+/******************************************************************************/
+/* a chunk of a sink must be one whole frame, after the header if it has
+   one, sets frame_idx and header, returns 0 if it is */
+static int
+parse_sink_frame(const unsigned char *data, int bytes, int *frame_idx,
+                 int *header)
+{
+    int pos;
+    int block_type;
+    int block_len;
+    int state;
+
+    /* 0 before the frame begin, 1 in the frame, 2 after the frame end */
+    state = 0;
+    *header = 0;
+    pos = 0;
+    while (pos < bytes)
+    {
+        if (pos + 6 > bytes)
+        {
+            return 1;
+        }
+        block_type = get_uint16(data + pos);
+        block_len = get_uint32(data + pos + 2);
+        if ((block_len < 6) || (block_len > bytes - pos))
+        {
+            return 1;
+        }
+        switch (block_type)
+        {
+            case WBT_SYNC:
+                *header = 1;
+                /* fall through */
+            case WBT_CODEC_VERSIONS:
+            case WBT_CHANNELS:
+            case WBT_CONTEXT:
+                if (state != 0)
+                {
+                    return 1;
+                }
+                break;
+            case WBT_FRAME_BEGIN:
+                if ((state != 0) || (block_len < 14))
+                {
+                    return 1;
+                }
+                *frame_idx = get_uint32(data + pos + 8);
+                state = 1;
+                break;
+            case WBT_REGION:
+            case WBT_EXTENSION:
+            case WBT_EXTENSION_PLUS:
+                if (state != 1)
+                {
+                    return 1;
+                }
+                break;
+            case WBT_FRAME_END:
+                if (state != 1)
+                {
+                    return 1;
+                }
+                state = 2;
+                break;
+            default:
+                return 1;
+        }
+        pos += block_len;
+    }
+    return state == 2 ? 0 : 1;
+}
+
+/******************************************************************************/
+/* the chunks of a call, each must be a whole frame, frame_idx on from
+   *frame_idx, the header only in the first and only if header, decoded
+   into pic, returns the number of bad chunks */
+static int
+check_sink_chunks(void *dec, const struct sink_out *so, int *frame_idx,
+                  int header, char *pic)
+{
+    int chunk;
+    int start;
+    int chunk_idx;
+    int chunk_header;
+    int fails;
+
+    fails = 0;
+    start = 0;
+    for (chunk = 0; chunk < so->chunks; chunk++)
+    {
+        g_checks++;
+        if ((parse_sink_frame((const unsigned char *)
+                              (so->data + start),
+                              so->chunk_ends[chunk] - start,
+                              &chunk_idx, &chunk_header) != 0) ||
+            (chunk_idx != *frame_idx) ||
+            (chunk_header != ((chunk == 0) && header)) ||
+            (rfxcodec_decode(dec, so->data + start,
+                             so->chunk_ends[chunk] - start, pic,
+                             SURFACE_WIDTH, SURFACE_HEIGHT,
+                             SURFACE_WIDTH * 4) != 0))
+        {
+            fails++;
+            printf("  chunk %d is not a whole frame %d%s\n", chunk,
+                   *frame_idx, ((chunk == 0) && header) ?
+                   " with the header" : "");
+        }
+        *frame_idx = *frame_idx + 1;
+        start = so->chunk_ends[chunk];
+    }
+    return fails;
+}
+
+/******************************************************************************/
+/* with a sink of 1, 3 and 5 tiles each chunk must be a whole frame, the
+   next frame_idx, and the chunks must decode to what the output without
+   the sink does, a sink that fails must leave it so the next call carries
+   on from the last chunk it got, with the header again if it did not get
+   it, and with RFX_FLAGS_TILE_HASH bring the client back to the surface
+   even where the chunks it got changed it */
+static int
+check_sink(const unsigned char *corpus, int num_corpus)
+{
+    static const int chunk_tiles[] = { 1, 3, 5, 3 };
+    static const int firsts[] = { 0, 3, 7, 7 };
+    struct rfx_rect region;
+    struct rfx_tile tiles[SURFACE_TILES];
+    struct sink_out so;
+    void *ref_han;
+    void *han;
+    void *ref_dec;
+    void *dec;
+    char *buf;
+    char *ref_out;
+    char *ref_pic;
+    char *pic;
+    char *work;
+    int config;
+    int call;
+    int stride_bytes;
+    int num_regions;
+    int num_tiles;
+    int ref_bytes;
+    int bytes;
+    int frame_idx;
+    int ref_error;
+    int error;
+    int fails;
+
+    buf = (char *) calloc(1, SURFACE_TILES * TILE_BYTES * 2);
+    ref_out = (char *) malloc(CDATA_BYTES);
+    so.data = (char *) malloc(CDATA_BYTES);
+    ref_pic = (char *) malloc(SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+    pic = (char *) malloc(SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+    work = (char *) malloc(CDATA_BYTES);
+    if ((buf == 0) || (ref_out == 0) || (so.data == 0) || (ref_pic == 0) ||
+        (pic == 0) || (work == 0))
+    {
+        g_fails++;
+        free(buf);
+        free(ref_out);
+        free(so.data);
+        free(ref_pic);
+        free(pic);
+        free(work);
+        return 1;
+    }
+    so.max_bytes = CDATA_BYTES;
+    region.x = 0;
+    region.y = 0;
+    region.cx = SURFACE_WIDTH;
+    region.cy = SURFACE_HEIGHT;
+    /* each chunk size, then with the tile hash, a sink that fails */
+    for (config = 0; config < 4; config++)
+    {
+        ref_han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                         RFX_FORMAT_BGRA, RFX_FLAGS_QUIET);
+        han = rfxcodec_encode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                                     RFX_FORMAT_BGRA, RFX_FLAGS_QUIET |
+                                     (config == 3 ? RFX_FLAGS_TILE_HASH : 0));
+        ref_dec = 0;
+        dec = 0;
+        rfxcodec_decode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                               RFX_FORMAT_BGRA, RFX_FLAGS_QUIET, &ref_dec);
+        rfxcodec_decode_create(SURFACE_WIDTH, SURFACE_HEIGHT,
+                               RFX_FORMAT_BGRA, RFX_FLAGS_QUIET, &dec);
+        if ((ref_han == 0) || (han == 0) || (ref_dec == 0) || (dec == 0) ||
+            (rfxcodec_encode_set_sink(han, sink_proc, &so,
+                                      chunk_tiles[config]) != 0))
+        {
+            printf("check_sink: create failed\n");
+            g_fails++;
+            rfxcodec_encode_destroy(ref_han);
+            rfxcodec_encode_destroy(han);
+            rfxcodec_decode_destroy(ref_dec);
+            rfxcodec_decode_destroy(dec);
+            continue;
+        }
+        rfxcodec_encode_damage(han, &region, 1, &region, &num_regions,
+                               tiles, &num_tiles);
+        memset(ref_pic, 0, SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+        memset(pic, 0, SURFACE_WIDTH * SURFACE_HEIGHT * 4);
+        fails = 0;
+        frame_idx = 0;
+        if (config == 3)
+        {
+            /* the sink fails on the first chunk, the header and frame 0
+               go in the next call */
+            make_surface(corpus, num_corpus, 1, RFX_FORMAT_BGRA, buf,
+                         &stride_bytes);
+            so.bytes = 0;
+            so.chunks = 0;
+            so.fail_chunk = 0;
+            bytes = CDATA_BYTES;
+            error = rfxcodec_encode(han, work, &bytes, buf,
+                                    SURFACE_WIDTH, SURFACE_HEIGHT,
+                                    stride_bytes, &region, num_regions,
+                                    tiles, num_tiles, 0, 0);
+            g_checks++;
+            if (error == 0)
+            {
+                fails++;
+                printf("  a sink that fails on the first chunk gave no "
+                       "error\n");
+            }
+        }
+        for (call = 0; call < (int) (sizeof(firsts) / sizeof(firsts[0]));
+             call++)
+        {
+            make_surface(corpus, num_corpus, firsts[call], RFX_FORMAT_BGRA,
+                         buf, &stride_bytes);
+            ref_bytes = CDATA_BYTES;
+            ref_error = rfxcodec_encode(ref_han, ref_out, &ref_bytes, buf,
+                                        SURFACE_WIDTH, SURFACE_HEIGHT,
+                                        stride_bytes, &region, num_regions,
+                                        tiles, num_tiles, 0, 0);
+            if ((config == 3) && (call == 3))
+            {
+                /* the sink gets 2 chunks of 3 tiles of another surface,
+                   this call, the same as the last, must put them back */
+                make_surface(corpus, num_corpus, 1, RFX_FORMAT_BGRA, buf,
+                             &stride_bytes);
+                so.bytes = 0;
+                so.chunks = 0;
+                so.fail_chunk = 2;
+                bytes = CDATA_BYTES;
+                error = rfxcodec_encode(han, work, &bytes, buf,
+                                        SURFACE_WIDTH, SURFACE_HEIGHT,
+                                        stride_bytes, &region, num_regions,
+                                        tiles, num_tiles, 0, 0);
+                g_checks++;
+                if ((error == 0) || (so.chunks != 2))
+                {
+                    fails++;
+                    printf("  a sink that fails on chunk 2, error %d, "
+                           "%d chunks\n", error, so.chunks);
+                }
+                fails += check_sink_chunks(dec, &so, &frame_idx, 0, pic);
+                make_surface(corpus, num_corpus, firsts[call],
+                             RFX_FORMAT_BGRA, buf, &stride_bytes);
+            }
+            so.bytes = 0;
+            so.chunks = 0;
+            so.fail_chunk = -1;
+            bytes = CDATA_BYTES;
+            error = rfxcodec_encode(han, work, &bytes, buf,
+                                    SURFACE_WIDTH, SURFACE_HEIGHT,
+                                    stride_bytes, &region, num_regions,
+                                    tiles, num_tiles, 0, 0);
+            g_checks++;
+            if ((ref_error != 0) || (error != 0) || (bytes != so.bytes) ||
+                (so.chunks < 1) || (so.chunks > num_tiles))
+            {
+                fails++;
+                printf("  %d tile chunks call %d: error %d, %d bytes in %d "
+                       "chunks, %d sent\n", chunk_tiles[config], call,
+                       error, so.bytes, so.chunks, bytes);
+                continue;
+            }
+            fails += check_sink_chunks(dec, &so, &frame_idx, call == 0, pic);
+            rfxcodec_decode(ref_dec, ref_out, ref_bytes, ref_pic,
+                            SURFACE_WIDTH, SURFACE_HEIGHT,
+                            SURFACE_WIDTH * 4);
+            g_checks++;
+            if (memcmp(pic, ref_pic, SURFACE_WIDTH * SURFACE_HEIGHT * 4) != 0)
+            {
+                fails++;
+                printf("  %d tile chunks%s call %d: the chunks decode to "
+                       "another picture\n", chunk_tiles[config],
+                       config == 3 ? " tile hash" : "", call);
+            }
+        }
+        g_fails += fails;
+        printf("check_sink: %d tile chunks%s, %d failed\n",
+               chunk_tiles[config],
+               config == 3 ? ", tile hash and a sink that fails" : "",
+               fails);
+        rfxcodec_encode_destroy(ref_han);
+        rfxcodec_encode_destroy(han);
+        rfxcodec_decode_destroy(ref_dec);
+        rfxcodec_decode_destroy(dec);
+    }
+    free(buf);
+    free(ref_out);
+    free(so.data);
+    free(ref_pic);
+    free(pic);
+    free(work);
+    return 0;
+}
+
+/******************************************************************************/
+static int
+out_usage(void)
+{
+    printf("rfxconform usage\n");
+    printf("checks that every encode function this cpu can run gives the "
+           "same output as the C ones\n");
+    printf("  ./rfxconform\n");
+    printf("  ./rfxconform -i tiles.raw\n");
+    printf("tiles.raw is 64x64 BGRA tiles, one after the other\n");
+    return 0;
+}
+
+/******************************************************************************/
+int
+main(int argc, char **argv)
+{
+    unsigned char *corpus;
+    const char *filename;
+    int num_corpus;
+    int index;
+
+    filename = 0;
+    for (index = 1; index < argc; index++)
+    {
+        if ((strcmp("-i", argv[index]) == 0) && (index + 1 < argc))
+        {
+            index++;
+            filename = argv[index];
+        }
+        else
+        {
+            out_usage();
+            return 1;
+        }
+    }
+    corpus = make_corpus(filename, &num_corpus);
+    if (corpus == 0)
+    {
+        return 1;
+    }
+    printf("rfxconform: %d tiles\n", num_corpus);
+    check_components(corpus, num_corpus, RFX_FLAGS_RLGR3);
+    check_components(corpus, num_corpus, RFX_FLAGS_RLGR1);
+    check_solid(RFX_FLAGS_RLGR3);
+    check_solid(RFX_FLAGS_RLGR1);
+    check_alpha(corpus, num_corpus);
+    check_dwt_rem(corpus, num_corpus);
+    check_streams(corpus, num_corpus, RFX_FLAGS_RLGR3);
+    check_streams(corpus, num_corpus, RFX_FLAGS_RLGR1);
+    check_threads(corpus, num_corpus, RFX_FLAGS_RLGR3);
+    check_threads(corpus, num_corpus, RFX_FLAGS_RLGR1);
+    check_cache(corpus, num_corpus, RFX_FLAGS_RLGR3);
+    check_rlgr_tail(RLGR1);
+    check_rlgr_tail(RLGR3);
+    check_progressive(corpus, num_corpus, 0);
+    check_progressive(corpus, num_corpus, RFX_FLAGS_DWT_REDUCE_EXTRAPOLATE);
+    check_rate();
+    check_overflow(corpus, num_corpus);
+    check_batch(corpus, num_corpus);
+    check_sink(corpus, num_corpus);
+    check_decode(corpus, num_corpus, RFX_FLAGS_RLGR3, 0);
+    check_decode(corpus, num_corpus, RFX_FLAGS_RLGR1, 0);
+    check_decode(corpus, num_corpus, RFX_FLAGS_RLGR3, RFX_FLAGS_ALPHAV1);
+    check_damage();
+    printf("rfxconform: %d checks, %d failed\n", g_checks, g_fails);
+    free(corpus);
+    return g_fails == 0 ? 0 : 1;
+}